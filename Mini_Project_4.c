@@ -8,45 +8,841 @@
  */
 
 #include "lcd.h"
+#include "display.h"
+#include "dashboard.h"
 #include "ultrasonic.h"
+#include "icu.h"
+#include "filter.h"
+#include "zone.h"
+#include "gpio.h"
+#include "scheduler.h"
+#include "perf.h"
+#include "telemetry.h"
+#include "regmap.h"
+#include "sync.h"
+#include "calibration.h"
+#include "temperature.h"
+#include "shell.h"
+#include "uart.h"
+#include "trilateration.h"
+#include "servo.h"
+#include "scan.h"
 #include <avr/interrupt.h>
 
+/* The trigger pin can not be one of the LCD pins on PORTB */
+#if((ULTRASONIC_TRIGGER_PORT_ID == PORTB_ID) && (((LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL) && \
+		(ULTRASONIC_TRIGGER_PIN_ID <= PIN2_ID)) || ((LCD_TRANSPORT == LCD_TRANSPORT_SPI) && (ULTRASONIC_TRIGGER_PIN_ID >= PIN4_ID))))
+
+#error "Trigger pin on an LCD pin (PB0..PB2 parallel, PB4..PB7 SPI), set ULTRASONIC_TRIGGER_PIN_ID"
+
+#endif
+
+/* Smoothing of the displayed distance: new = old + (sample - old) / 2^shift */
+#define APP_FILTER_SHIFT		2
+#define APP_FILTER_MAX_SHIFT	8
+
+/* Valid results farther than this are counted and reported as no echo (cm) */
+#define APP_MAX_RANGE_CM		400
+
+/*
+ * Synchronised pings for several nodes in one room: 1 = ping only in the slot of this node
+ * of the frames started by the sync line (INT0), 0 = free running pings every 100 ms.
+ * Exactly one node is the master, every node has its own slot.
+ */
+#define APP_SYNC_ENABLE			0
+#define APP_SYNC_ROLE			SYNC_ROLE_MASTER
+#define APP_SYNC_SLOT			0
+#define APP_SYNC_SLOTS			4
+#define APP_SYNC_SLOT_TICKS		30000
+
+/*
+ * Scanner: the sensor on a servo (OC1A, PD5) sweeps APP_SCAN_FIRST_ANGLE to APP_SCAN_LAST_ANGLE
+ * degrees in APP_SCAN_STEP degree steps and the polar map is on the scan page. 1 = the ping
+ * task runs the sweep, 0 = fixed sensor.
+ */
+#define APP_SCAN_ENABLE			0
+#define APP_SCAN_FIRST_ANGLE	0
+#define APP_SCAN_LAST_ANGLE		180
+#define APP_SCAN_STEP			5
+
+#if(APP_SYNC_ENABLE || APP_SCAN_ENABLE)
+
+/* The ping task arms the next slot or runs the sweep every 10 ms */
+#define APP_PING_PERIOD_MS		10
+
+#else
+
+/* The sensor needs 60ms between two triggers */
+#define APP_PING_PERIOD_MS		100
+
+#endif
+
+/*
+ * Speed of sound compensated with the LM35 on PA7 (temperature.c), sampled every
+ * APP_TEMPERATURE_PERIOD_MS. PA7 is D7 of the 8-bit parallel LCD bus: only with the
+ * 4-bit bus (-DLCD_BIT_MODE=4) or a serial LCD transport.
+ */
+#if((LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL) || (LCD_BIT_MODE == 4))
+#define APP_TEMPERATURE_ENABLE		1
+#else
+#define APP_TEMPERATURE_ENABLE		0
+#endif
+#define APP_TEMPERATURE_PERIOD_MS	1000
+
+/* Time each page stays on the LCD before the next one (ms) */
+#define APP_PAGE_PERIOD_MS		4000
+
+/* Page setting that rotates the pages */
+#define APP_PAGE_AUTO			0xFF
+
+/* Command shell on the telemetry UART, at most SHELL_BYTES_PER_POLL bytes per run */
+#define APP_SHELL_PERIOD_MS		10
+
+/* Shortest ping period accepted by the shell (the sensor needs 60ms between two triggers) */
+#define APP_MIN_PING_PERIOD_MS	60
+
+/* Inches from cm: cm * 403 / 1024 (0.1% from 1 / 2.54) */
+#define APP_CM_TO_INCH_NUMERATOR	403UL
+#define APP_CM_TO_INCH_SHIFT		10
+
+/* Period of the trend samples (ms), a multiple of DASHBOARD_TICK_MS */
+#define APP_TREND_PERIOD_MS		200
+
+/*
+ * Longest time between two samples giving a velocity (us), above the longest ping period
+ * (65.5 s) and with interval * 4 in 32 bits: the velocity restarts from 0 after a longer gap
+ */
+#define APP_VELOCITY_MAX_INTERVAL_US	100000000UL
+
+/*
+ * Lateral position from two sensors APP_TRILATERATION_BASELINE_CM apart (the second one
+ * triggered on PD7, both echoes on ICP1): 1 = the pings alternate between the sensors and
+ * every pair of echoes at most APP_TRILATERATION_MAX_SKEW_MS apart gives a position page,
+ * only the echoes of sensor 0 give the distance. 0 = one sensor.
+ */
+#define APP_TRILATERATION_ENABLE		0
+#define APP_TRILATERATION_BASELINE_CM	20
+#define APP_TRILATERATION_MAX_SKEW_MS	250
+
+#if(APP_SCAN_ENABLE && (APP_SYNC_ENABLE || APP_TRILATERATION_ENABLE))
+#error "The scanner times its own pings with one sensor"
+#endif
+
+/* Filtered distance shown on the LCD and its rate of change (cm/s, positive = away) */
+static Filter_EmaType g_distanceFilter;
+static uint16 g_distance = 0;
+static sint16 g_velocity = 0;
+static uint32 g_filterState = 0;
+static uint32 g_filterTimestamp = 0;
+
+/* Statistics of the valid measurements */
+static uint16 g_minDistance = 0xFFFF;
+static uint16 g_maxDistance = 0;
+static uint16 g_validCount = 0;
+static uint16 g_rateCount = 0;
+static uint32 g_rateTime = 0;
+static uint16 g_rate = 0;
+
+/* Failed measurements */
+static uint16 g_noEchoCount = 0;
+static uint16 g_timeoutCount = 0;
+
+/* Measurement registers read by the TWI master */
+static Regmap_DataType g_registers;
+
+/* Set by the near zone call back, the LCD task then shows the live page */
+static volatile boolean g_nearAlert = FALSE;
+
+/* Last result of the sensor and whether it is not sent to the telemetry stream yet */
+static Ultrasonic_ResultType g_result;
+static volatile boolean g_resultPending = FALSE;
+
+/* Settings changed at run time by the shell */
+static uint16 g_pingPeriod = APP_PING_PERIOD_MS;
+static uint16 g_maxRange = APP_MAX_RANGE_CM;
+static boolean g_inches = FALSE;
+static uint8 g_pageMode = APP_PAGE_AUTO;
+static boolean g_telemetryEnable = TRUE;
+
+/* Id of the ping task for the period changes */
+static uint8 g_pingTaskId = SCHEDULER_INVALID_TASK;
+
+#if(APP_TRILATERATION_ENABLE)
+
+/* Sensors of the position, the pings alternate between them */
+static const Trilateration_ConfigType g_appTrilateration = {
+	APP_TRILATERATION_BASELINE_CM, APP_TRILATERATION_MAX_SKEW_MS * 1000UL
+};
+static uint8 g_nextSensor = 0;
+
+/* Last position (1/16 cm) and whether there is one yet */
+static Trilateration_PositionType g_position;
+static boolean g_positionValid = FALSE;
+
+/* Trigger the other sensor at the next ping */
+static void App_selectNextSensor(void){
+	Ultrasonic_selectSensor(g_nextSensor);
+	g_nextSensor ^= 1;
+}
+
+#endif
+
+#if(APP_SCAN_ENABLE)
+
+/* Angles of the sweep and the point of the last result */
+static const Scan_ConfigType g_appScan = {APP_SCAN_FIRST_ANGLE, APP_SCAN_LAST_ANGLE, APP_SCAN_STEP};
+static uint8 g_scanPoint = 0;
+
+#endif
+
+#if(APP_SYNC_ENABLE)
+
+/* Trigger armed for a slot and the earliest time of the next one (ICU ticks) */
+static volatile boolean g_pingArmed = FALSE;
+static uint32 g_nextPingTime = 0;
+
+/* Arm the trigger for the next slot of this node once the last measurement is complete */
+static void App_pingTask(void){
+	uint32 slotTime;
+
+	if((g_pingArmed == FALSE) && Sync_getNextSlot(g_nextPingTime, &slotTime)){
+#if(APP_TRILATERATION_ENABLE)
+		App_selectNextSensor();
+#endif
+		Ultrasonic_startMeasurementAt(slotTime);
+		g_pingArmed = TRUE;
+
+		/* The sensor needs its measurement cycle before the next ping */
+		g_nextPingTime = slotTime + ULTRASONIC_PING_SPACING_TICKS;
+	}
+}
+
+#elif(APP_SCAN_ENABLE)
+
+/* Trigger the ping of the next point once the servo settled, step the servo once it is out */
+static void App_pingTask(void){
+	Scan_update();
+}
+
+#else
+
+/* Trigger a new measurement (the sensor needs 60ms between two triggers) */
+static void App_pingTask(void){
+#if(APP_TRILATERATION_ENABLE)
+	App_selectNextSensor();
+#endif
+	Ultrasonic_startMeasurement();
+}
+
+#endif
+
+/* Update the velocity from the filter state (1/256 cm) over the time between two samples (us) */
+static void App_updateVelocity(void){
+	sint32 delta = (sint32)(g_distanceFilter.state - g_filterState);
+	uint32 interval = g_result.timestamp - g_filterTimestamp;
+
+	if(interval > APP_VELOCITY_MAX_INTERVAL_US){
+		g_velocity = 0;
+	}
+	else if((g_validCount > 1) && (interval != 0)){
+		/* delta / 256 cm in interval us = delta * 15625 / (interval * 4) cm/s */
+		g_velocity = (sint16)((delta * 15625) / (sint32)(interval * 4));
+	}
+	g_filterState = g_distanceFilter.state;
+	g_filterTimestamp = g_result.timestamp;
+}
+
+/* Collect the result of the measurement and filter the valid distances */
+static void App_filterTask(void){
+#if(APP_TRILATERATION_ENABLE)
+	Ultrasonic_SampleType sample;
+#endif
+
+	if(Ultrasonic_update()){
+		Ultrasonic_getResult(&g_result);
+#if(APP_SYNC_ENABLE)
+		g_pingArmed = FALSE;
+#endif
+#if(APP_TRILATERATION_ENABLE)
+		/* Every echo goes to the position, a timeout has no echo sample */
+		if(g_result.status != ULTRASONIC_STATUS_TIMEOUT){
+			Ultrasonic_getSample(&sample);
+			if(Trilateration_addSample(&sample, &g_position)){
+				g_positionValid = TRUE;
+			}
+		}
+		if(g_result.sensor != 0){
+			return;
+		}
+#endif
+#if(APP_SCAN_ENABLE)
+		/* Map at the angle of the ping before the range check, the next ping waits for it */
+		Scan_addResult(&g_result, &g_scanPoint);
+#endif
+		if((g_result.status == ULTRASONIC_STATUS_OK) && (g_result.distance > g_maxRange)){
+			g_result.status = ULTRASONIC_STATUS_NO_ECHO;
+		}
+		if(g_result.status == ULTRASONIC_STATUS_OK){
+			g_distance = Filter_emaUpdate(&g_distanceFilter, g_result.distance);
+			g_validCount++;
+			g_rateCount++;
+			App_updateVelocity();
+			if(g_result.distance < g_minDistance){
+				g_minDistance = g_result.distance;
+			}
+			if(g_result.distance > g_maxDistance){
+				g_maxDistance = g_result.distance;
+			}
+		}
+		else if(g_result.status == ULTRASONIC_STATUS_NO_ECHO){
+			g_noEchoCount++;
+		}
+		else{
+			g_timeoutCount++;
+		}
+
+		/* Zone outputs and call backs change only on transitions */
+		Zone_update(&g_result);
+		g_resultPending = TRUE;
+
+		/* Registers for the TWI master, never waits for a read going on */
+		g_registers.timestamp = g_result.timestamp;
+		g_registers.filteredDistance = g_distance;
+		g_registers.distance = g_result.distance;
+		g_registers.validCount = g_validCount;
+		g_registers.noEchoCount = g_noEchoCount;
+		g_registers.timeoutCount = g_timeoutCount;
+		g_registers.glitchCount = ICU_getGlitchCount();
+		g_registers.status = g_result.status;
+		Regmap_publish(&g_registers);
+	}
+}
+
+/*
+ * Use the filter shift set by the shell or the TWI master if it is at most APP_FILTER_MAX_SHIFT
+ * (a shift of 32 or more is undefined in the filter), the register map shows the one in use
+ */
+static boolean App_setFilterShift(uint16 shift){
+	Regmap_ConfigType config;
+	boolean done = FALSE;
+
+	if(shift <= APP_FILTER_MAX_SHIFT){
+		g_distanceFilter.shift = (uint8)shift;
+		done = TRUE;
+	}
+	config.filterShift = g_distanceFilter.shift;
+	Regmap_setConfig(&config);
+
+	return done;
+}
+
+/* Apply the configuration written by the TWI master */
+static void App_configTask(void){
+	Regmap_ConfigType config;
+
+	if(Regmap_getConfig(&config)){
+		App_setFilterShift(config.filterShift);
+	}
+}
+
+#if(APP_TEMPERATURE_ENABLE)
+
+/* Apply the last temperature reading (a table lookup when its degree changes) and start the next one */
+static void App_temperatureTask(void){
+	Temperature_update();
+}
+
+#endif
+
+/* Near zone transitions: bring the live distance on the LCD when an object comes close */
+static void App_nearZoneEvent(uint8 zone_id, boolean inside){
+	(void)zone_id;
+	if(inside){
+		g_nearAlert = TRUE;
+	}
+}
+
+/*
+ * Zones: {lower (cm), upper (cm), hysteresis (cm), debounce (results), output port, output pin, call back}
+ * The near zone lights PC2 and brings the live page, the warning zone lights PC3
+ * (PC0 and PC1 are the TWI lines).
+ */
+static const Zone_ConfigType g_appZones[] = {
+	{0,  30,  3, 3, PORTC_ID, PIN2_ID, App_nearZoneEvent},
+	{30, 100, 5, 3, PORTC_ID, PIN3_ID, NULL_PTR}
+};
+
+/* Stream every measurement (never waits for the UART), unless the shell turned the stream off */
+static void App_telemetryTask(void){
+	if(g_resultPending){
+		if(g_telemetryEnable){
+			Telemetry_sendResult(&g_result);
+		}
+		g_resultPending = FALSE;
+	}
+}
+
+/* Distance or speed in the display unit */
+static sint32 App_toDisplayUnit(sint32 cm){
+	if(g_inches){
+		return (cm * (sint32)APP_CM_TO_INCH_NUMERATOR) / (1L << APP_CM_TO_INCH_SHIFT);
+	}
+	return cm;
+}
+
+/* Page 1: the filtered distance as a number, a bar and a trend */
+static void App_renderLivePage(Dashboard_TextType text){
+	Dashboard_printText(text, 0, 0, "Distance=");
+	Dashboard_printNumber(text, 0, 10, 3, App_toDisplayUnit(g_distance));
+	Dashboard_printText(text, 0, 13, g_inches ? "in" : "cm");
+	Display_renderBar(g_distance, &text[1][0]);
+	Display_renderTrend(&text[1][LCD_COLUMNS - DISPLAY_TREND_CELLS]);
+#if(LCD_ROWS >= 4)
+	Dashboard_printText(text, 2, 0, "Raw=");
+	Dashboard_printNumber(text, 2, 10, 3, App_toDisplayUnit(g_result.distance));
+	Dashboard_printText(text, 2, 13, g_inches ? "in" : "cm");
+#endif
+}
+
+/* Page 2: the filtered distance and its velocity */
+static void App_renderMotionPage(Dashboard_TextType text){
+	Dashboard_printText(text, 0, 0, "Filtered=");
+	Dashboard_printNumber(text, 0, 10, 3, App_toDisplayUnit(g_distance));
+	Dashboard_printText(text, 0, 13, g_inches ? "in" : "cm");
+	Dashboard_printText(text, 1, 0, "Speed=");
+	Dashboard_printNumber(text, 1, 6, 6, App_toDisplayUnit(g_velocity));
+	Dashboard_printText(text, 1, 12, g_inches ? "in/s" : "cm/s");
+}
+
+/* Page 3: minimum, maximum and measurement rate (measured over the page refresh period) */
+static void App_renderStatsPage(Dashboard_TextType text){
+	uint32 now = Scheduler_getTime();
+	uint32 elapsed = now - g_rateTime;
+
+	if(elapsed >= 1000000UL){
+		g_rate = (uint16)(((uint32)g_rateCount * 1000UL) / (elapsed / 1000UL));
+		g_rateCount = 0;
+		g_rateTime = now;
+	}
+
+	Dashboard_printText(text, 0, 0, "Min");
+	Dashboard_printText(text, 0, 8, "Max");
+	if(g_validCount == 0){
+		Dashboard_printText(text, 0, 3, "   -");
+		Dashboard_printText(text, 0, 11, "    -");
+	}
+	else{
+		Dashboard_printNumber(text, 0, 3, 4, App_toDisplayUnit(g_minDistance));
+		Dashboard_printNumber(text, 0, 11, 5, App_toDisplayUnit(g_maxDistance));
+	}
+	Dashboard_printText(text, 1, 0, "Rate");
+	Dashboard_printNumber(text, 1, 4, 5, g_rate);
+	Dashboard_printText(text, 1, 10, "Hz");
+#if(LCD_ROWS >= 4)
+	Dashboard_printText(text, 2, 0, "Valid");
+	Dashboard_printNumber(text, 2, 9, 7, g_validCount);
+#endif
+}
+
+/* Page 4: failed measurements, rejected glitches and dropped telemetry frames */
+static void App_renderErrorsPage(Dashboard_TextType text){
+#if(LCD_ROWS >= 4)
+	Dashboard_printText(text, 0, 0, "No echo");
+	Dashboard_printNumber(text, 0, 9, 7, g_noEchoCount);
+	Dashboard_printText(text, 1, 0, "Timeout");
+	Dashboard_printNumber(text, 1, 9, 7, g_timeoutCount);
+	Dashboard_printText(text, 2, 0, "Glitch");
+	Dashboard_printNumber(text, 2, 9, 7, ICU_getGlitchCount());
+	Dashboard_printText(text, 3, 0, "Dropped");
+	Dashboard_printNumber(text, 3, 9, 7, Telemetry_getDroppedFrames());
+#else
+	Dashboard_printText(text, 0, 0, "NE");
+	Dashboard_printNumber(text, 0, 2, 6, g_noEchoCount);
+	Dashboard_printText(text, 0, 9, "TO");
+	Dashboard_printNumber(text, 0, 11, 5, g_timeoutCount);
+	Dashboard_printText(text, 1, 0, "GL");
+	Dashboard_printNumber(text, 1, 2, 6, ICU_getGlitchCount());
+	Dashboard_printText(text, 1, 9, "DF");
+	Dashboard_printNumber(text, 1, 11, 5, Telemetry_getDroppedFrames());
+#endif
+}
+
+#if(APP_TRILATERATION_ENABLE)
+
+/* Page 5: lateral position (X, positive towards sensor 1) and range (Y) from the middle of the sensors */
+static void App_renderPositionPage(Dashboard_TextType text){
+	Dashboard_printText(text, 0, 0, "X=");
+	Dashboard_printText(text, 1, 0, "Y=");
+	if(g_positionValid == FALSE){
+		Dashboard_printText(text, 0, 6, "-");
+		Dashboard_printText(text, 1, 6, "-");
+		return;
+	}
+	Dashboard_printNumber(text, 0, 2, 5, App_toDisplayUnit(g_position.x / (1 << TRILATERATION_FRACTION_BITS)));
+	Dashboard_printText(text, 0, 8, g_inches ? "in" : "cm");
+	Dashboard_printNumber(text, 1, 2, 5, App_toDisplayUnit(g_position.y >> TRILATERATION_FRACTION_BITS));
+	Dashboard_printText(text, 1, 8, g_inches ? "in" : "cm");
+}
+
+#endif
+
+#if(APP_SCAN_ENABLE)
+
+/* Page 5: angle and range of the last point of the sweep, points per second and sweeps */
+static void App_renderScanPage(Dashboard_TextType text){
+	Scan_StatsType stats;
+	uint16 range = Scan_getRange(g_scanPoint);
+
+	Scan_getStats(&stats);
+	Dashboard_printText(text, 0, 0, "Ang");
+	Dashboard_printNumber(text, 0, 3, 3, Scan_getAngle(g_scanPoint));
+	Dashboard_printText(text, 0, 7, "Rng");
+	if(range == SCAN_NO_RANGE){
+		Dashboard_printText(text, 0, 10, "   -");
+	}
+	else{
+		Dashboard_printNumber(text, 0, 10, 4, App_toDisplayUnit(range));
+	}
+	Dashboard_printText(text, 0, 14, g_inches ? "in" : "cm");
+	Dashboard_printText(text, 1, 0, "Pts/s");
+	Dashboard_printNumber(text, 1, 5, 3, stats.pointRate / 10);
+	Dashboard_printText(text, 1, 8, ".");
+	Dashboard_printNumber(text, 1, 9, 1, stats.pointRate % 10);
+	Dashboard_printText(text, 1, 11, "Sw");
+	Dashboard_printNumber(text, 1, 13, 3, stats.sweeps);
+}
+
+#endif
+
+/* Pages in display order: {render, refresh period (ms)} */
+static const Dashboard_PageConfigType g_appPages[] = {
+	{App_renderLivePage,   200},
+	{App_renderMotionPage, 200},
+	{App_renderStatsPage,  1000},
+#if(APP_TRILATERATION_ENABLE)
+	{App_renderErrorsPage, 500},
+	{App_renderPositionPage, 200}
+#elif(APP_SCAN_ENABLE)
+	{App_renderErrorsPage, 500},
+	{App_renderScanPage, 200}
+#else
+	{App_renderErrorsPage, 500}
+#endif
+};
+
+/* Sample the trend, refresh the page shown and switch to the next page (or show the page set by the shell) */
+static void App_lcdTask(void){
+	static uint16 trendTime = 0;
+	static uint16 pageTime = 0;
+	uint8 page;
+
+	trendTime += DASHBOARD_TICK_MS;
+	if(trendTime >= APP_TREND_PERIOD_MS){
+		trendTime = 0;
+		Display_addTrendSample(g_distance);
+	}
+
+	pageTime += DASHBOARD_TICK_MS;
+	if(g_pageMode != APP_PAGE_AUTO){
+		g_nearAlert = FALSE;
+		if(Dashboard_getPage() != g_pageMode){
+			Dashboard_showPage(g_pageMode);
+		}
+		else{
+			Dashboard_update();
+		}
+	}
+	else if(g_nearAlert){
+		g_nearAlert = FALSE;
+		pageTime = 0;
+		Dashboard_showPage(0);
+	}
+	else if(pageTime >= APP_PAGE_PERIOD_MS){
+		pageTime = 0;
+		page = Dashboard_getPage() + 1;
+		if(page >= (sizeof(g_appPages) / sizeof(g_appPages[0]))){
+			page = 0;
+		}
+		Dashboard_showPage(page);
+	}
+	else{
+		/* Only the changed cells are sent */
+		Dashboard_update();
+	}
+}
+
+/* "get": print the settings */
+static void App_getCommand(uint8 argc, char * argv[]){
+	(void)argc;
+	(void)argv;
+	Shell_print("ping ");
+	Shell_printNumber(g_pingPeriod);
+	Shell_print(" filter ");
+	Shell_printNumber(g_distanceFilter.shift);
+	Shell_print(" range ");
+	Shell_printNumber(g_maxRange);
+	Shell_print(g_inches ? " units in" : " units cm");
+	Shell_print(" page ");
+	if(g_pageMode == APP_PAGE_AUTO){
+		Shell_print("auto");
+	}
+	else{
+		Shell_printNumber(g_pageMode);
+	}
+	Shell_print(" telemetry ");
+	Shell_printNumber(g_telemetryEnable);
+	Shell_print("\r\n");
+}
+
+/*
+ * "set <name> <value>": change a setting, it takes effect at the next run of the task using it
+ * ping <ms>, filter <shift>, range <cm>, units cm|in, page auto|<page>, telemetry 0|1
+ */
+static void App_setCommand(uint8 argc, char * argv[]){
+	uint16 value = 0;
+	boolean isNumber;
+	boolean done = FALSE;
+
+	if(argc != 3){
+		Shell_print("ERR usage: set <name> <value>\r\n");
+		return;
+	}
+
+	isNumber = Shell_parseNumber(argv[2], &value);
+
+	if(Shell_isEqual(argv[1], "ping")){
+#if(!APP_SYNC_ENABLE && !APP_SCAN_ENABLE)
+		/* The sync frames or the sweep give the ping times otherwise */
+		if(isNumber && (value >= APP_MIN_PING_PERIOD_MS) && Scheduler_setPeriod(g_pingTaskId, value)){
+			g_pingPeriod = value;
+			done = TRUE;
+		}
+#endif
+	}
+	else if(Shell_isEqual(argv[1], "filter")){
+		if(isNumber){
+			done = App_setFilterShift(value);
+		}
+	}
+	else if(Shell_isEqual(argv[1], "range")){
+		if(isNumber && (value != 0)){
+			g_maxRange = value;
+			done = TRUE;
+		}
+	}
+	else if(Shell_isEqual(argv[1], "units")){
+		if(Shell_isEqual(argv[2], "cm") || Shell_isEqual(argv[2], "in")){
+			g_inches = (argv[2][0] == 'i');
+			done = TRUE;
+		}
+	}
+	else if(Shell_isEqual(argv[1], "page")){
+		if(Shell_isEqual(argv[2], "auto")){
+			g_pageMode = APP_PAGE_AUTO;
+			done = TRUE;
+		}
+		else if(isNumber && (value < (sizeof(g_appPages) / sizeof(g_appPages[0])))){
+			g_pageMode = (uint8)value;
+			done = TRUE;
+		}
+	}
+	else if(Shell_isEqual(argv[1], "telemetry")){
+		if(isNumber && (value <= 1)){
+			g_telemetryEnable = (value == 1);
+			done = TRUE;
+		}
+	}
+
+	if(done){
+		Shell_print("OK\r\n");
+	}
+	else{
+		Shell_print("ERR ");
+		Shell_print(argv[1]);
+		Shell_print("\r\n");
+	}
+}
+
+/* "stats": print the counters */
+static void App_statsCommand(uint8 argc, char * argv[]){
+#if(APP_TRILATERATION_ENABLE)
+	Trilateration_StatsType stats;
+
+#elif(APP_SCAN_ENABLE)
+	Scan_StatsType stats;
+
+#endif
+	(void)argc;
+	(void)argv;
+	Shell_print("valid ");
+	Shell_printNumber(g_validCount);
+	Shell_print(" noecho ");
+	Shell_printNumber(g_noEchoCount);
+	Shell_print(" timeout ");
+	Shell_printNumber(g_timeoutCount);
+	Shell_print(" glitch ");
+	Shell_printNumber(ICU_getGlitchCount());
+	Shell_print(" dropped ");
+	Shell_printNumber(Telemetry_getDroppedFrames());
+	Shell_print(" rxlost ");
+	Shell_printNumber(UART_getRxDropped());
+#if(APP_TRILATERATION_ENABLE)
+	Trilateration_getStats(&stats);
+	Shell_print(" solved ");
+	Shell_printNumber(stats.solutions);
+	Shell_print(" geometry ");
+	Shell_printNumber(stats.invalidGeometry);
+	Shell_print(" unpaired ");
+	Shell_printNumber(stats.unpaired);
+#elif(APP_SCAN_ENABLE)
+	Scan_getStats(&stats);
+	Shell_print(" sweeps ");
+	Shell_printNumber(stats.sweeps);
+	Shell_print(" sweepms ");
+	Shell_printNumber(stats.sweepTime);
+	Shell_print(" pps ");
+	Shell_printNumber(stats.pointRate / 10);
+	Shell_print(".");
+	Shell_printNumber(stats.pointRate % 10);
+#endif
+	Shell_print("\r\n");
+}
+
+/* Shell commands ("help" lists them) */
+static const Shell_CommandType g_appCommands[] = {
+	{"get",   App_getCommand},
+	{"set",   App_setCommand},
+	{"stats", App_statsCommand}
+};
+
+static const Shell_ConfigType g_appShell = {g_appCommands, sizeof(g_appCommands) / sizeof(g_appCommands[0])};
+
+/* Take the received command bytes and run at most one command (never from an ISR) */
+static void App_shellTask(void){
+	Shell_poll();
+}
+
+/*
+ * Tasks in priority order: {task, period (ms), offset (ms), budget (us)}
+ * The filter task polls the echo, the LCD task only queues the transfers (see lcd.h).
+ * The shell runs last so a command never delays the measurements.
+ */
+static const Scheduler_TaskConfigType g_appTasks[] = {
+#if(APP_TRILATERATION_ENABLE)
+	{App_filterTask,    10,                 0,  400},
+#else
+	{App_filterTask,    10,                 0,  200},
+#endif
+	{App_telemetryTask, 10,                 1,  300},
+	{App_pingTask,      APP_PING_PERIOD_MS, 2,  100},
+	{App_lcdTask,       DASHBOARD_TICK_MS,  5,  800},
+	{App_configTask,    100,                7,  50},
+#if(APP_TEMPERATURE_ENABLE)
+	{App_temperatureTask, APP_TEMPERATURE_PERIOD_MS, 9, 50},
+#endif
+	{App_shellTask,     APP_SHELL_PERIOD_MS, 3, 500}
+};
+
 int main(void){
 
-	/* Variable to store Distance */
-	uint16 dist = 0;
+	uint8 i;
+	uint8 task_id;
+	Regmap_ConfigType regmapConfig;
+#if(APP_SYNC_ENABLE)
+	Sync_ConfigType syncConfig;
+#endif
 
 	/* Initiate Ultrasonic sensor */
 	Ultrasonic_init();
 
+	/* Distance scale of the last field calibration saved in the EEPROM (factory scale if none) */
+	Calibration_init();
+
+#if(APP_SCAN_ENABLE)
+
+	/* Servo pulses on the Timer1 time base of the ICU, then the first angle of the sweep */
+	Servo_init();
+	Scan_init(&g_appScan);
+
+#endif
+
+#if(APP_SYNC_ENABLE)
+
+	/* Ping slots on the sync line (after the ICU and the timers of the sensor) */
+	syncConfig.role = APP_SYNC_ROLE;
+	syncConfig.slot = APP_SYNC_SLOT;
+	syncConfig.slots = APP_SYNC_SLOTS;
+	syncConfig.slotTicks = APP_SYNC_SLOT_TICKS;
+	Sync_init(&syncConfig);
+
+#endif
+
 	/* Initiate LCD */
 	LCD_init();
 
-	/* Display on LCD: "Distance= " */
-	LCD_displayString("Distance=    cm");
+	/* Initiate telemetry stream */
+	Telemetry_init();
+
+	/* Commands on the same UART (text never contains the telemetry sync bytes) */
+	Shell_init(&g_appShell);
+
+	/* Initiate the distance filter */
+	Filter_emaInit(&g_distanceFilter, APP_FILTER_SHIFT);
+
+	/* Initiate the distance zones */
+	Zone_init();
+	for(i = 0; i < (sizeof(g_appZones) / sizeof(g_appZones[0])); i++){
+		Zone_add(&g_appZones[i]);
+	}
+
+#if(APP_TRILATERATION_ENABLE)
+
+	/* Pair the echoes of the two sensors into positions */
+	Trilateration_init(&g_appTrilateration);
+
+#endif
+
+	/* Answer the TWI master with the register map */
+	regmapConfig.filterShift = APP_FILTER_SHIFT;
+	Regmap_init(&regmapConfig);
 
 	/* Enable Global Interrupts */
 	SREG |= (1<<7);
 
-	/* Infinite Loop*/
-	for(;;){
+#if(APP_TEMPERATURE_ENABLE)
 
-		/* Get distance value */
-		dist = Ultrasonic_readDistance();
+	/* First conversion of the LM35, the temperature task applies it */
+	Temperature_init();
 
-		/* Move Cursor */
-		LCD_moveCursor(0, 10);
+#endif
 
-		if(dist < 100){
+	/* Upload the bar and trend glyphs (more transfers than the LCD queue holds without interrupts) */
+	Display_init();
 
-			/* Display distance value */
-			LCD_integerToString(dist);
-			LCD_displayCharacter(' ');
-		}
-		else{
+	/* Register the pages and show the first one */
+	Dashboard_init();
+	for(i = 0; i < (sizeof(g_appPages) / sizeof(g_appPages[0])); i++){
+		Dashboard_addPage(&g_appPages[i]);
+	}
+	Dashboard_showPage(0);
 
-			/* Display distance value */
-			LCD_integerToString(dist);
+	/* Initiate the scheduler and register the tasks, the first releases come after the start up */
+	Scheduler_init();
+	for(i = 0; i < (sizeof(g_appTasks) / sizeof(g_appTasks[0])); i++){
+		task_id = Scheduler_addTask(&g_appTasks[i]);
+		if(g_appTasks[i].task == App_pingTask){
+			g_pingTaskId = task_id;
 		}
 	}
+
+	/* Infinite Loop*/
+	for(;;){
+
+		PERF_BEGIN(loopStart);
+
+		/* Run the released tasks */
+		Scheduler_dispatch();
+
+		PERF_END(PERF_METRIC_MAIN_LOOP, loopStart);
+	}
 }
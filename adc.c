@@ -0,0 +1,97 @@
+ /******************************************************************************
+ *
+ * Module: ADC
+ *
+ * File Name: adc.c
+ *
+ * Description: Source file for the AVR ADC driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "adc.h"
+#include "common_macros.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Global variables to hold the address of the call back function in the application */
+static void(*volatile g_callBackPtr)(uint16 value) = NULL_PTR;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(ADC_vect){
+
+	/* ADIF is cleared by the execution of the vector, ADCW reads ADCL then ADCH */
+	if(g_callBackPtr != NULL_PTR){
+		(*g_callBackPtr)(ADCW);
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize ADC:
+ * 1. Setup the reference voltage
+ * 2. Setup the ADC clock
+ * 3. Enable the ADC and its interrupt
+ * The global interrupts must be enabled.
+ */
+void ADC_init(const Adc_ConfigType * config_ptr){
+
+	/* REFS1:0 = reference, ADLAR = 0 (right adjusted result), MUX4:0 = channel 0 */
+	ADMUX = (config_ptr->reference & 0x03) << REFS0;
+
+	/*
+	 * ADC Control and Status Register A:
+	 * 1. ADEN = 1 to enable the ADC
+	 * 2. ADATE = 0, every conversion is started by ADC_startConversion
+	 * 3. ADIE = 1 to enable the conversion complete interrupt
+	 * 4. ADPS2:0 = ADC clock
+	 */
+	ADCSRA = (1<<ADEN) | (1<<ADIE) | (config_ptr->prescaler & 0x07);
+}
+
+/*
+ * Description :
+ * Set the call back called from the ADC interrupt with the result of every conversion
+ */
+void ADC_setCallBack(void(*a_ptr)(uint16 value)){
+	g_callBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Start the conversion of the given channel without waiting, return FALSE if a
+ * conversion is on the way (nothing is started then)
+ */
+boolean ADC_startConversion(uint8 channel){
+	if(BIT_IS_SET(ADCSRA, ADSC)){
+		return FALSE;
+	}
+
+	/* The channel may change only between two conversions */
+	ADMUX = (ADMUX & 0xE0) | (channel & 0x07);
+	/* ADIF written with zero: a result not served yet stays pending */
+	ADCSRA = (ADCSRA & ~(1<<ADIF)) | (1<<ADSC);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Disable the ADC
+ */
+void ADC_DeInit(void){
+	ADCSRA = 0;
+	ADMUX = 0;
+}
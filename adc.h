@@ -0,0 +1,81 @@
+ /******************************************************************************
+ *
+ * Module: ADC
+ *
+ * File Name: adc.h
+ *
+ * Description: Header file for the AVR ADC driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef ADC_H_
+#define ADC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Highest value of a 10-bit conversion */
+#define ADC_MAXIMUM_VALUE		1023
+
+/* Single ended channels ADC0..ADC7 (PA0..PA7) */
+#define ADC_NUM_OF_CHANNELS		8
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* enum for the reference voltage, the value is REFS1:REFS0 */
+typedef enum{
+	ADC_REFERENCE_AREF, ADC_REFERENCE_AVCC, ADC_REFERENCE_INTERNAL_2V56 = 3
+}Adc_ReferenceType;
+
+/* enum for the ADC clock, the value is ADPS2:0 (50 to 200 kHz for the full resolution) */
+typedef enum{
+	ADC_F_CPU_2 = 1, ADC_F_CPU_4, ADC_F_CPU_8, ADC_F_CPU_16, ADC_F_CPU_32, ADC_F_CPU_64, ADC_F_CPU_128
+}Adc_PrescalerType;
+
+/* Structure that contain members to set the configurations of ADC */
+typedef struct{
+	Adc_ReferenceType reference;
+	Adc_PrescalerType prescaler;
+}Adc_ConfigType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize ADC:
+ * 1. Setup the reference voltage
+ * 2. Setup the ADC clock
+ * 3. Enable the ADC and its interrupt
+ * The global interrupts must be enabled.
+ */
+void ADC_init(const Adc_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Set the call back called from the ADC interrupt with the result of every conversion
+ */
+void ADC_setCallBack(void(*a_ptr)(uint16 value));
+
+/*
+ * Description :
+ * Start the conversion of the given channel without waiting, return FALSE if a
+ * conversion is on the way (nothing is started then)
+ */
+boolean ADC_startConversion(uint8 channel);
+
+/*
+ * Description :
+ * Disable the ADC
+ */
+void ADC_DeInit(void);
+
+#endif /* ADC_H_ */
@@ -0,0 +1,95 @@
+/*
+ ============================================================================
+ Name        : bench_main.c
+ Author      : Mohamed Khaled
+ Description : Benchmark firmware: the application loop of Mini_Project_4.c
+               with markers around the measured parts (see bench_markers.h)
+ ============================================================================
+ */
+
+#include "../lcd.h"
+#include "../ultrasonic.h"
+#include "../telemetry.h"
+#include "../trilateration.h"
+#include "bench_markers.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/* One OUT instruction, the runner subtracts the cost of a marker pair */
+#define BENCH_MARK(code)		(PORTC = (code))
+
+/* Baseline of the trilateration solved per sample (cm), the one of the application */
+#define BENCH_BASELINE_CM		20
+
+int main(void){
+
+	/* Variable to store Distance */
+	uint16 dist = 0;
+
+	/* Variable to store the result sent to the telemetry stream */
+	Ultrasonic_ResultType result;
+
+	/* Position solved from the distance and a second distance a little longer */
+	Trilateration_PositionType position;
+
+	uint8 i;
+
+	/* Marker port as output */
+	DDRC = 0xFF;
+	BENCH_MARK(BENCH_MARK_IDLE);
+
+	/* Same start up as main() */
+	Ultrasonic_init();
+	LCD_init();
+	Telemetry_init();
+	LCD_displayString((const uint8 *)"Distance=    cm");
+	sei();
+
+	/* Cost of the markers themselves */
+	for(i = 0; i < BENCH_CALIBRATION_PAIRS; i++){
+		BENCH_MARK(BENCH_MARK_CALIBRATION_BEGIN);
+		BENCH_MARK(BENCH_MARK_CALIBRATION_END);
+	}
+
+	for(i = 0; i < BENCH_SAMPLES; i++){
+
+		BENCH_MARK(BENCH_MARK_SAMPLE);
+
+		BENCH_MARK(BENCH_MARK_READ_BEGIN);
+		dist = Ultrasonic_readDistance();
+		BENCH_MARK(BENCH_MARK_READ_END);
+
+		Ultrasonic_getResult(&result);
+		Telemetry_sendResult(&result);
+
+		/* One solution per sample, the second sensor 0 to 7.5 cm further than the first */
+		BENCH_MARK(BENCH_MARK_TRILATERATION_BEGIN);
+		Trilateration_solve(dist << TRILATERATION_FRACTION_BITS,
+				(dist << TRILATERATION_FRACTION_BITS) + ((i & 0x0F) << 3), BENCH_BASELINE_CM << TRILATERATION_FRACTION_BITS, &position);
+		BENCH_MARK(BENCH_MARK_TRILATERATION_END);
+
+		/* Same display update as main() */
+		BENCH_MARK(BENCH_MARK_REFRESH_BEGIN);
+		LCD_moveCursor(0, 10);
+		if(dist < 100){
+			LCD_integerToString(dist);
+			LCD_displayCharacter(' ');
+		}
+		else{
+			LCD_integerToString(dist);
+		}
+		BENCH_MARK(BENCH_MARK_REFRESH_END);
+
+		/* One character alone: the cursor is on the 'c' of "cm" after the refresh */
+		BENCH_MARK(BENCH_MARK_CHARACTER_BEGIN);
+		LCD_displayCharacter('c');
+		BENCH_MARK(BENCH_MARK_CHARACTER_END);
+	}
+
+	/* End of the last sample */
+	BENCH_MARK(BENCH_MARK_SAMPLE);
+	BENCH_MARK(BENCH_MARK_DONE);
+
+	for(;;){
+	}
+}
@@ -0,0 +1,45 @@
+ /******************************************************************************
+ *
+ * Module: BENCH
+ *
+ * File Name: bench_markers.h
+ *
+ * Description: Markers written by the benchmark firmware on the marker port, the
+ *              simulator runner time stamps every write with the CPU cycle count
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef BENCH_MARKERS_H_
+#define BENCH_MARKERS_H_
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Port written with the marker codes (not used by the LCD, the sensor or the UART) */
+#define BENCH_MARKER_PORT_NAME			'C'
+
+/* Number of empty marker pairs written first to measure the cost of a marker */
+#define BENCH_CALIBRATION_PAIRS			16
+
+/* Number of measurements of a benchmark run */
+#define BENCH_SAMPLES					100
+
+/* Marker codes: every BEGIN is followed by its END */
+#define BENCH_MARK_IDLE					0x00
+#define BENCH_MARK_CALIBRATION_BEGIN	0x01
+#define BENCH_MARK_CALIBRATION_END		0x02
+#define BENCH_MARK_READ_BEGIN			0x10
+#define BENCH_MARK_READ_END				0x11
+#define BENCH_MARK_CHARACTER_BEGIN		0x20
+#define BENCH_MARK_CHARACTER_END		0x21
+#define BENCH_MARK_REFRESH_BEGIN		0x30
+#define BENCH_MARK_REFRESH_END			0x31
+#define BENCH_MARK_SAMPLE				0x40
+#define BENCH_MARK_TRILATERATION_BEGIN	0x50
+#define BENCH_MARK_TRILATERATION_END	0x51
+#define BENCH_MARK_DONE					0xFF
+
+#endif /* BENCH_MARKERS_H_ */
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Module: BENCH
+# File Name: compare.sh
+# Description: Compare two outputs of simavr_bench (key=value lines), e.g. of two commits
+# Usage: bench/compare.sh before.txt after.txt
+# Author: Mohamed Khaled
+
+if [ $# -ne 2 ]; then
+	echo "usage: $0 before.txt after.txt" >&2
+	exit 2
+fi
+
+awk -F= '
+	NR == FNR { before[$1] = $2; next }
+	($1 in before) {
+		change = (before[$1] != 0) ? sprintf("%+.1f%%", 100.0 * ($2 - before[$1]) / before[$1]) : "-"
+		printf "%-28s %14s %14s %10s\n", $1, before[$1], $2, change
+	}
+' "$1" "$2"
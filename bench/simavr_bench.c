@@ -0,0 +1,386 @@
+ /******************************************************************************
+ *
+ * Module: BENCH - simavr runner
+ *
+ * File Name: simavr_bench.c
+ *
+ * Description: Run the benchmark firmware (bench_main.c built for the ATmega32) on simavr
+ *              with a scripted HC-SR04 model on PB5 (trigger) and ICP1/PD6 (echo), time
+ *              stamp the markers and the input capture interrupt with the CPU cycle count
+ *              and print the results as key=value lines
+ *
+ * Usage: simavr_bench [-s distances.txt] [-c max_cycles] bench.elf
+ *        distances.txt: one distance in cm per line, used in turn for every ping
+ *        (0 means no object), the default sweeps 2 cm to 400 cm
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/sim_interrupts.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_timer.h>
+
+#include "bench_markers.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define BENCH_F_CPU					8000000UL
+
+/* HC-SR04 model: echo starts after the burst, no object gives a 38 ms pulse */
+#define BENCH_SPEED_OF_SOUND		34000
+#define BENCH_ECHO_DELAY_US			460
+#define BENCH_NO_ECHO_US			38000
+#define BENCH_MIN_TRIGGER_US		10
+
+/* Trigger and echo pins (ultrasonic.h and icu.h) */
+#define BENCH_TRIGGER_PORT_NAME		'B'
+#define BENCH_TRIGGER_PIN			5
+#define BENCH_ECHO_PORT_NAME		'D'
+#define BENCH_ECHO_PIN				6
+
+/* TIMER1_CAPT_vect on the ATmega32 */
+#define BENCH_CAPTURE_VECTOR		6
+
+#define BENCH_MAX_DISTANCES			1024
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that accumulates a measured interval in CPU cycles */
+typedef struct{
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	uint32_t count;
+}Bench_StatType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static avr_t * g_avr;
+
+static avr_irq_t * g_echoPinIrq;
+static avr_irq_t * g_echoCaptureIrq;
+
+/* Scripted distances in cm */
+static uint16_t g_distances[BENCH_MAX_DISTANCES];
+static uint32_t g_numOfDistances = 0;
+static uint32_t g_pings = 0;
+
+/* HC-SR04 model state */
+static uint8_t g_triggerLevel = 0;
+static avr_cycle_count_t g_triggerRise = 0;
+static avr_cycle_count_t g_echoBusyUntil = 0;
+
+/* Time of the last echo edge not yet served by the capture interrupt */
+static avr_cycle_count_t g_edgeCycle = 0;
+static uint8_t g_edgePending = 0;
+static avr_cycle_count_t g_isrEntry = 0;
+
+/* Time of the BEGIN marker of every measured part, indexed by marker code */
+static avr_cycle_count_t g_markerCycle[256];
+
+static avr_cycle_count_t g_firstSample = 0;
+static avr_cycle_count_t g_lastSample = 0;
+static uint32_t g_samples = 0;
+static uint8_t g_done = 0;
+
+static Bench_StatType g_calibration;
+static Bench_StatType g_read;
+static Bench_StatType g_refresh;
+static Bench_StatType g_character;
+static Bench_StatType g_trilateration;
+static Bench_StatType g_isrLatency;
+static Bench_StatType g_isrDuration;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add one interval to a statistic
+ */
+static void Bench_add(Bench_StatType * stat_ptr, uint64_t cycles){
+	if((stat_ptr->count == 0) || (cycles < stat_ptr->min)){
+		stat_ptr->min = cycles;
+	}
+	if(cycles > stat_ptr->max){
+		stat_ptr->max = cycles;
+	}
+	stat_ptr->sum += cycles;
+	stat_ptr->count++;
+}
+
+/*
+ * Description :
+ * Print a statistic as key_mean/key_min/key_max lines, the marker cost is subtracted if given
+ */
+static void Bench_print(const char * key, const Bench_StatType * stat_ptr, uint64_t overhead){
+	uint64_t mean = (stat_ptr->count == 0) ? 0 : (stat_ptr->sum / stat_ptr->count);
+
+	printf("%s_mean=%llu\n", key, (unsigned long long)((mean > overhead) ? (mean - overhead) : 0));
+	printf("%s_min=%llu\n", key, (unsigned long long)((stat_ptr->min > overhead) ? (stat_ptr->min - overhead) : 0));
+	printf("%s_max=%llu\n", key, (unsigned long long)((stat_ptr->max > overhead) ? (stat_ptr->max - overhead) : 0));
+}
+
+/*
+ * Description :
+ * Return the echo pulse width in CPU cycles for the next scripted distance
+ */
+static avr_cycle_count_t Bench_nextEchoCycles(void){
+	uint16_t distance = g_distances[g_pings % g_numOfDistances];
+
+	if(distance == 0){
+		return avr_usec_to_cycles(g_avr, BENCH_NO_ECHO_US);
+	}
+
+	/* The sound travels to the object and back */
+	return ((avr_cycle_count_t)distance * 2 * BENCH_F_CPU) / BENCH_SPEED_OF_SOUND;
+}
+
+/*
+ * Description :
+ * Drive the echo pin and the input capture unit of Timer1
+ */
+static void Bench_setEcho(uint32_t level){
+	avr_raise_irq(g_echoPinIrq, level);
+	avr_raise_irq(g_echoCaptureIrq, level);
+
+	g_edgeCycle = g_avr->cycle;
+	g_edgePending = 1;
+}
+
+static avr_cycle_count_t Bench_echoFall(avr_t * avr, avr_cycle_count_t when, void * param){
+	(void)avr;
+	(void)when;
+	(void)param;
+
+	Bench_setEcho(0);
+
+	return 0;
+}
+
+static avr_cycle_count_t Bench_echoRise(avr_t * avr, avr_cycle_count_t when, void * param){
+	(void)when;
+
+	Bench_setEcho(1);
+	avr_cycle_timer_register(avr, (avr_cycle_count_t)(uintptr_t)param, Bench_echoFall, NULL);
+
+	return 0;
+}
+
+/*
+ * Description :
+ * HC-SR04 model: answer every trigger pulse of at least 10 us with an echo pulse
+ */
+static void Bench_triggerChanged(struct avr_irq_t * irq, uint32_t value, void * param){
+	avr_cycle_count_t now = g_avr->cycle;
+
+	(void)irq;
+	(void)param;
+
+	if(value && !g_triggerLevel){
+		g_triggerRise = now;
+	}
+	else if(!value && g_triggerLevel){
+		if(((now - g_triggerRise) >= avr_usec_to_cycles(g_avr, BENCH_MIN_TRIGGER_US)) && (now >= g_echoBusyUntil)){
+			avr_cycle_count_t delay = avr_usec_to_cycles(g_avr, BENCH_ECHO_DELAY_US);
+			avr_cycle_count_t width = Bench_nextEchoCycles();
+
+			avr_cycle_timer_register(g_avr, delay, Bench_echoRise, (void *)(uintptr_t)width);
+			g_echoBusyUntil = now + delay + width;
+			g_pings++;
+		}
+	}
+
+	g_triggerLevel = value ? 1 : 0;
+}
+
+/*
+ * Description :
+ * Time stamp the markers written by the firmware
+ */
+static void Bench_markerWritten(struct avr_irq_t * irq, uint32_t value, void * param){
+	avr_cycle_count_t now = g_avr->cycle;
+
+	(void)irq;
+	(void)param;
+
+	switch(value & 0xFF){
+	case BENCH_MARK_CALIBRATION_END:
+		Bench_add(&g_calibration, now - g_markerCycle[BENCH_MARK_CALIBRATION_BEGIN]);
+		break;
+	case BENCH_MARK_READ_END:
+		Bench_add(&g_read, now - g_markerCycle[BENCH_MARK_READ_BEGIN]);
+		break;
+	case BENCH_MARK_REFRESH_END:
+		Bench_add(&g_refresh, now - g_markerCycle[BENCH_MARK_REFRESH_BEGIN]);
+		break;
+	case BENCH_MARK_CHARACTER_END:
+		Bench_add(&g_character, now - g_markerCycle[BENCH_MARK_CHARACTER_BEGIN]);
+		break;
+	case BENCH_MARK_TRILATERATION_END:
+		Bench_add(&g_trilateration, now - g_markerCycle[BENCH_MARK_TRILATERATION_BEGIN]);
+		break;
+	case BENCH_MARK_SAMPLE:
+		if(g_samples == 0){
+			g_firstSample = now;
+		}
+		g_lastSample = now;
+		g_samples++;
+		break;
+	case BENCH_MARK_DONE:
+		g_done = 1;
+		break;
+	default:
+		break;
+	}
+
+	g_markerCycle[value & 0xFF] = now;
+}
+
+/*
+ * Description :
+ * Input capture interrupt entry and exit: latency from the echo edge and service time
+ */
+static void Bench_captureRunning(struct avr_irq_t * irq, uint32_t value, void * param){
+	avr_cycle_count_t now = g_avr->cycle;
+
+	(void)irq;
+	(void)param;
+
+	if(value){
+		g_isrEntry = now;
+		if(g_edgePending){
+			Bench_add(&g_isrLatency, now - g_edgeCycle);
+			g_edgePending = 0;
+		}
+	}
+	else{
+		Bench_add(&g_isrDuration, now - g_isrEntry);
+	}
+}
+
+/*
+ * Description :
+ * Read the scripted distances, the default sweeps 2 cm to 400 cm
+ */
+static int Bench_loadDistances(const char * path){
+	if(path == NULL){
+		for(g_numOfDistances = 0; g_numOfDistances < 100; g_numOfDistances++){
+			g_distances[g_numOfDistances] = (uint16_t)(2 + ((g_numOfDistances * 37) % 399));
+		}
+	}
+	else{
+		FILE * file_ptr = fopen(path, "r");
+		unsigned int distance;
+
+		if(file_ptr == NULL){
+			perror(path);
+			return -1;
+		}
+		while((g_numOfDistances < BENCH_MAX_DISTANCES) && (fscanf(file_ptr, "%u", &distance) == 1)){
+			g_distances[g_numOfDistances++] = (uint16_t)distance;
+		}
+		fclose(file_ptr);
+	}
+
+	return (g_numOfDistances == 0) ? -1 : 0;
+}
+
+int main(int argc, char * argv[]){
+
+	const char * scriptPath = NULL;
+	unsigned long long maxCycles = 60ULL * BENCH_F_CPU;
+	elf_firmware_t firmware;
+	uint64_t overhead;
+	int state;
+	int option;
+
+	while((option = getopt(argc, argv, "s:c:")) != -1){
+		switch(option){
+		case 's':
+			scriptPath = optarg;
+			break;
+		case 'c':
+			maxCycles = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s distances.txt] [-c max_cycles] bench.elf\n", argv[0]);
+			return 2;
+		}
+	}
+	if((optind >= argc) || (Bench_loadDistances(scriptPath) != 0)){
+		fprintf(stderr, "usage: %s [-s distances.txt] [-c max_cycles] bench.elf\n", argv[0]);
+		return 2;
+	}
+
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(argv[optind], &firmware) != 0){
+		fprintf(stderr, "%s: can not read %s\n", argv[0], argv[optind]);
+		return 2;
+	}
+	strcpy(firmware.mmcu, "atmega32");
+	firmware.frequency = BENCH_F_CPU;
+
+	g_avr = avr_make_mcu_by_name(firmware.mmcu);
+	if(g_avr == NULL){
+		fprintf(stderr, "%s: simavr has no atmega32 core\n", argv[0]);
+		return 2;
+	}
+	avr_init(g_avr);
+	avr_load_firmware(g_avr, &firmware);
+
+	/* Sensor model, markers and the input capture vector */
+	g_echoPinIrq = avr_io_getirq(g_avr, AVR_IOCTL_IOPORT_GETIRQ(BENCH_ECHO_PORT_NAME), BENCH_ECHO_PIN);
+	g_echoCaptureIrq = avr_io_getirq(g_avr, AVR_IOCTL_TIMER_GETIRQ('1'), TIMER_IRQ_IN_ICP);
+	avr_irq_register_notify(avr_io_getirq(g_avr, AVR_IOCTL_IOPORT_GETIRQ(BENCH_TRIGGER_PORT_NAME), BENCH_TRIGGER_PIN),
+			Bench_triggerChanged, NULL);
+	avr_irq_register_notify(avr_io_getirq(g_avr, AVR_IOCTL_IOPORT_GETIRQ(BENCH_MARKER_PORT_NAME), IOPORT_IRQ_PIN_ALL),
+			Bench_markerWritten, NULL);
+	avr_irq_register_notify(avr_get_interrupt_irq(g_avr, BENCH_CAPTURE_VECTOR) + AVR_INT_IRQ_RUNNING,
+			Bench_captureRunning, NULL);
+
+	do{
+		state = avr_run(g_avr);
+	}while(!g_done && (g_avr->cycle < maxCycles) && (state != cpu_Done) && (state != cpu_Crashed));
+
+	if(!g_done){
+		fprintf(stderr, "%s: the firmware did not finish (cycle %llu)\n", argv[0], (unsigned long long)g_avr->cycle);
+		return 1;
+	}
+
+	/* Cost of one marker write, included once in every measured interval */
+	overhead = (g_calibration.count == 0) ? 0 : (g_calibration.sum / g_calibration.count);
+
+	printf("f_cpu=%lu\n", BENCH_F_CPU);
+	printf("samples=%u\n", (g_samples > 0) ? (g_samples - 1) : 0);
+	printf("pings=%u\n", g_pings);
+	printf("marker_cycles=%llu\n", (unsigned long long)overhead);
+	Bench_print("read_distance_cycles", &g_read, overhead);
+	Bench_print("isr_latency_cycles", &g_isrLatency, 0);
+	Bench_print("isr_duration_cycles", &g_isrDuration, 0);
+	Bench_print("lcd_character_cycles", &g_character, overhead);
+	Bench_print("lcd_refresh_cycles", &g_refresh, overhead);
+	Bench_print("trilateration_cycles", &g_trilateration, overhead);
+	printf("samples_per_second=%.3f\n", (g_samples > 1)
+			? ((double)(g_samples - 1) * BENCH_F_CPU / (double)(g_lastSample - g_firstSample)) : 0.0);
+
+	return 0;
+}
@@ -0,0 +1,232 @@
+ /******************************************************************************
+ *
+ * Module: CALIBRATION
+ *
+ * File Name: calibration.c
+ *
+ * Description: Source file of the two-point distance calibration kept in the EEPROM
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "calibration.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Slot and sequence number of the record in use */
+static uint8 g_slot = CALIBRATION_NO_SLOT;
+static uint8 g_sequence = 0;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the CRC-8 of the record without its CRC byte
+ */
+static uint8 Calibration_crc(const uint8 * record_ptr);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read the ring of records in one pass and give the newest valid one to the ultrasonic
+ * driver. Return FALSE if there is none, the factory scale stays in use then.
+ */
+boolean Calibration_init(void){
+	uint8 record[CALIBRATION_RECORD_SIZE];
+	Ultrasonic_CalibrationType calibration;
+	Ultrasonic_CalibrationType newest;
+	uint8 slot;
+
+	g_slot = CALIBRATION_NO_SLOT;
+
+	for(slot = 0; slot < CALIBRATION_SLOTS; slot++){
+		EEPROM_readBlock(CALIBRATION_EEPROM_ADDRESS + (uint16)slot * CALIBRATION_RECORD_SIZE, record, CALIBRATION_RECORD_SIZE);
+
+		/* Erased, torn by a reset during the save or worn out */
+		if(Calibration_crc(record) != record[CALIBRATION_CRC_OFFSET]){
+			continue;
+		}
+
+		calibration.gain = (uint16)record[CALIBRATION_GAIN_OFFSET] | ((uint16)record[CALIBRATION_GAIN_OFFSET + 1] << 8);
+		calibration.offset = (sint32)((uint32)record[CALIBRATION_OFFSET_OFFSET] |
+				((uint32)record[CALIBRATION_OFFSET_OFFSET + 1] << 8) |
+				((uint32)record[CALIBRATION_OFFSET_OFFSET + 2] << 16) |
+				((uint32)record[CALIBRATION_OFFSET_OFFSET + 3] << 24));
+
+		/* ULTRASONIC_MAX_GAIN is the largest uint16 */
+		if(calibration.gain < ULTRASONIC_MIN_GAIN){
+			continue;
+		}
+
+		/* The sequence numbers in the ring are less than CALIBRATION_SLOTS apart, the signed difference orders them */
+		if((g_slot == CALIBRATION_NO_SLOT) || ((sint8)(record[CALIBRATION_SEQUENCE_OFFSET] - g_sequence) > 0)){
+			g_slot = slot;
+			g_sequence = record[CALIBRATION_SEQUENCE_OFFSET];
+			newest = calibration;
+		}
+	}
+
+	if(g_slot == CALIBRATION_NO_SLOT){
+		return FALSE;
+	}
+
+	Ultrasonic_setCalibration(&newest);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Measure the echo time of an object at the given true distance (average of
+ * CALIBRATION_CAPTURE_PINGS pings), return FALSE if no ping got an echo
+ */
+boolean Calibration_capturePoint(uint16 distance, Calibration_PointType * point_ptr){
+	Ultrasonic_SampleType sample;
+	uint32 highTimeSum = 0;
+	uint8 valid = 0;
+	uint8 ping;
+
+	for(ping = 0; ping < CALIBRATION_CAPTURE_PINGS; ping++){
+		Ultrasonic_readDistance();
+
+		if(Ultrasonic_getStatus() == ULTRASONIC_STATUS_OK){
+			Ultrasonic_getSample(&sample);
+			highTimeSum += sample.highTime;
+			valid++;
+		}
+	}
+
+	if(valid == 0){
+		return FALSE;
+	}
+
+	point_ptr->highTime = (uint16)((highTimeSum + valid / 2) / valid);
+	point_ptr->distance = distance;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Compute the gain and the offset going through the two points with the speed multiplier
+ * in use (the divisions of the calibration are here), return FALSE if the points do not give
+ * a gain accepted by the ultrasonic driver or the offset is above CALIBRATION_MAX_OFFSET_CM
+ */
+boolean Calibration_compute(const Calibration_PointType * near_ptr, const Calibration_PointType * far_ptr,
+		Ultrasonic_CalibrationType * calibration_ptr){
+	uint16 highTimeSpan;
+	uint16 speedMultiplier = Ultrasonic_getSpeedMultiplier();
+	uint32 multiplier;
+	uint32 gain;
+	sint32 offset;
+
+	if((far_ptr->highTime <= near_ptr->highTime) || (far_ptr->distance <= near_ptr->distance)){
+		return FALSE;
+	}
+	highTimeSpan = far_ptr->highTime - near_ptr->highTime;
+
+	/* Slope in cm per tick, rounded */
+	multiplier = ((((uint32)(far_ptr->distance - near_ptr->distance)) << ULTRASONIC_CALIBRATION_SHIFT) + highTimeSpan / 2) / highTimeSpan;
+
+	/* Far out of the gains accepted, the shift below stays in 32 bits */
+	if(multiplier > ((uint32)ULTRASONIC_MAX_MULTIPLIER * 2)){
+		return FALSE;
+	}
+
+	/* On the speed of sound now: the gain stays right when the temperature changes */
+	gain = ((multiplier << ULTRASONIC_GAIN_SHIFT) + speedMultiplier / 2) / speedMultiplier;
+	if((gain < ULTRASONIC_MIN_GAIN) || (gain > ULTRASONIC_MAX_GAIN)){
+		return FALSE;
+	}
+
+	/* The multiplier the conversion uses with this gain */
+	multiplier = ((uint32)speedMultiplier * gain) >> ULTRASONIC_GAIN_SHIFT;
+
+	/* Through the near point */
+	offset = ((sint32)near_ptr->distance << ULTRASONIC_CALIBRATION_SHIFT) - (sint32)((uint32)near_ptr->highTime * multiplier);
+	if((offset > ((sint32)CALIBRATION_MAX_OFFSET_CM << ULTRASONIC_CALIBRATION_SHIFT)) ||
+			(offset < -((sint32)CALIBRATION_MAX_OFFSET_CM << ULTRASONIC_CALIBRATION_SHIFT))){
+		return FALSE;
+	}
+
+	calibration_ptr->gain = (uint16)gain;
+	calibration_ptr->offset = offset;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Give the calibration to the ultrasonic driver and save it in the next slot of the ring
+ * (blocks about 8.5 ms for every byte that changes in the slot), return FALSE if the
+ * ultrasonic driver rejects it, nothing is saved then
+ */
+boolean Calibration_save(const Ultrasonic_CalibrationType * calibration_ptr){
+	uint8 record[CALIBRATION_RECORD_SIZE];
+	uint16 address;
+
+	if(Ultrasonic_setCalibration(calibration_ptr) == FALSE){
+		return FALSE;
+	}
+
+	/* The slot after the newest record, the first one of an empty ring */
+	g_slot = (g_slot >= (CALIBRATION_SLOTS - 1)) ? 0 : (uint8)(g_slot + 1);
+	g_sequence++;
+	address = CALIBRATION_EEPROM_ADDRESS + (uint16)g_slot * CALIBRATION_RECORD_SIZE;
+
+	record[CALIBRATION_SEQUENCE_OFFSET] = g_sequence;
+	record[CALIBRATION_GAIN_OFFSET] = (uint8)calibration_ptr->gain;
+	record[CALIBRATION_GAIN_OFFSET + 1] = (uint8)(calibration_ptr->gain >> 8);
+	record[CALIBRATION_OFFSET_OFFSET] = (uint8)calibration_ptr->offset;
+	record[CALIBRATION_OFFSET_OFFSET + 1] = (uint8)((uint32)calibration_ptr->offset >> 8);
+	record[CALIBRATION_OFFSET_OFFSET + 2] = (uint8)((uint32)calibration_ptr->offset >> 16);
+	record[CALIBRATION_OFFSET_OFFSET + 3] = (uint8)((uint32)calibration_ptr->offset >> 24);
+	record[CALIBRATION_CRC_OFFSET] = Calibration_crc(record);
+
+	/*
+	 * The CRC is written last: a reset during the save leaves a record with a wrong CRC,
+	 * the previous record in its own slot stays the newest valid one
+	 */
+	EEPROM_writeBlock(address, record, CALIBRATION_RECORD_SIZE);
+
+	/* Wait for the last byte so a reset right after the return keeps the record */
+	while(EEPROM_isBusy()){
+	}
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the slot of the record in use or CALIBRATION_NO_SLOT
+ */
+uint8 Calibration_getSlot(void){
+	return g_slot;
+}
+
+/*
+ * Description :
+ * Return the CRC-8 of the record without its CRC byte
+ */
+static uint8 Calibration_crc(const uint8 * record_ptr){
+	uint8 crc = 0xFF;
+	uint8 i;
+	uint8 bit;
+
+	for(i = 0; i < CALIBRATION_CRC_OFFSET; i++){
+		crc ^= record_ptr[i];
+		for(bit = 0; bit < 8; bit++){
+			crc = (crc & 0x80) ? (uint8)((crc << 1) ^ 0x07) : (uint8)(crc << 1);
+		}
+	}
+
+	return crc;
+}
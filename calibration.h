@@ -0,0 +1,111 @@
+ /******************************************************************************
+ *
+ * Module: CALIBRATION
+ *
+ * File Name: calibration.h
+ *
+ * Description: Header file of the two-point distance calibration kept in the EEPROM
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef CALIBRATION_H_
+#define CALIBRATION_H_
+
+#include "std_types.h"
+#include "ultrasonic.h"
+#include "eeprom.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * The calibrations are saved in a ring of records in the EEPROM, every save writes the
+ * next slot so the wear is spread over all of them, the newest valid record is used.
+ * Record of CALIBRATION_RECORD_SIZE bytes:
+ * offset 0 : sequence number, one more than the previous record (wraps around)
+ * offset 1 : gain, 2 bytes (low byte first)
+ * offset 3 : offset, 4 bytes (low byte first)
+ * offset 7 : CRC-8 (polynomial 0x07, initial value 0xFF) of offsets 0..6, written last
+ */
+#define CALIBRATION_EEPROM_ADDRESS		0
+#define CALIBRATION_SLOTS				16
+#define CALIBRATION_RECORD_SIZE			8
+
+#define CALIBRATION_SEQUENCE_OFFSET		0
+#define CALIBRATION_GAIN_OFFSET			1
+#define CALIBRATION_OFFSET_OFFSET		3
+#define CALIBRATION_CRC_OFFSET			7
+
+/* Slot number returned by Calibration_getSlot when the factory scale is in use */
+#define CALIBRATION_NO_SLOT				0xFF
+
+/* Largest offset in cm accepted from a two-point calibration */
+#define CALIBRATION_MAX_OFFSET_CM		50
+
+/* Pings averaged by Calibration_capturePoint */
+#define CALIBRATION_CAPTURE_PINGS		8
+
+#if((CALIBRATION_EEPROM_ADDRESS + (CALIBRATION_SLOTS * CALIBRATION_RECORD_SIZE)) > EEPROM_SIZE)
+#error "The calibration ring does not fit in the EEPROM"
+#endif
+
+/* The newest record is found by comparing the 8-bit sequence numbers */
+#if((CALIBRATION_SLOTS < 2) || (CALIBRATION_SLOTS > 128))
+#error "Number of calibration slots must be 2 to 128"
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds a point of the two-point calibration */
+typedef struct{
+	uint16 highTime;				/* Echo time in ICU ticks */
+	uint16 distance;				/* True distance in cm */
+}Calibration_PointType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read the ring of records in one pass and give the newest valid one to the ultrasonic
+ * driver. Return FALSE if there is none, the factory scale stays in use then.
+ */
+boolean Calibration_init(void);
+
+/*
+ * Description :
+ * Measure the echo time of an object at the given true distance (average of
+ * CALIBRATION_CAPTURE_PINGS pings), return FALSE if no ping got an echo
+ */
+boolean Calibration_capturePoint(uint16 distance, Calibration_PointType * point_ptr);
+
+/*
+ * Description :
+ * Compute the gain and the offset going through the two points with the speed multiplier
+ * in use (the divisions of the calibration are here), return FALSE if the points do not give
+ * a gain accepted by the ultrasonic driver or the offset is above CALIBRATION_MAX_OFFSET_CM
+ */
+boolean Calibration_compute(const Calibration_PointType * near_ptr, const Calibration_PointType * far_ptr,
+		Ultrasonic_CalibrationType * calibration_ptr);
+
+/*
+ * Description :
+ * Give the calibration to the ultrasonic driver and save it in the next slot of the ring
+ * (blocks about 8.5 ms for every byte that changes in the slot), return FALSE if the
+ * ultrasonic driver rejects it, nothing is saved then
+ */
+boolean Calibration_save(const Ultrasonic_CalibrationType * calibration_ptr);
+
+/*
+ * Description :
+ * Return the slot of the record in use or CALIBRATION_NO_SLOT
+ */
+uint8 Calibration_getSlot(void);
+
+#endif /* CALIBRATION_H_ */
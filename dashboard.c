@@ -0,0 +1,230 @@
+ /******************************************************************************
+ *
+ * Module: DASHBOARD
+ *
+ * File Name: dashboard.c
+ *
+ * Description: Source file for the LCD pages with cached content and delta updates
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "dashboard.h"
+
+/*******************************************************************************
+ *                           Private Global Variable                           *
+ *******************************************************************************/
+
+/* Pages configurations and their last rendered content */
+static Dashboard_PageConfigType g_pages[DASHBOARD_MAX_PAGES];
+static Dashboard_TextType g_pageText[DASHBOARD_MAX_PAGES];
+static uint8 g_pagesCount = 0;
+
+/* Copy of the DDRAM content, only the cells that differ from it are sent */
+static Dashboard_TextType g_screen;
+
+/* Page shown and milli seconds since its last render */
+static uint8 g_shownPage = DASHBOARD_INVALID_PAGE;
+static uint16 g_elapsed = 0;
+
+static Dashboard_StatsType g_stats;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+static void Dashboard_fill(Dashboard_TextType text, uint8 character);
+static void Dashboard_flush(void);
+
+/*******************************************************************************
+ *                              Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Fill a page content with one character
+ */
+static void Dashboard_fill(Dashboard_TextType text, uint8 character){
+	uint8 row, col;
+
+	for(row = 0; row < LCD_ROWS; row++){
+		for(col = 0; col < LCD_COLUMNS; col++){
+			text[row][col] = character;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Send the cells of the page shown that differ from the LCD content, a run of changed
+ * cells costs one cursor move, a single equal cell between two runs is sent again
+ * since it costs the same as the second cursor move
+ */
+static void Dashboard_flush(void){
+	uint8 row, col, end;
+	uint8 * text_ptr;
+	uint8 * screen_ptr;
+
+	for(row = 0; row < LCD_ROWS; row++){
+		text_ptr = g_pageText[g_shownPage][row];
+		screen_ptr = g_screen[row];
+		col = 0;
+		while(col < LCD_COLUMNS){
+			if(text_ptr[col] == screen_ptr[col]){
+				col++;
+				continue;
+			}
+
+			/* End of the run, including the gaps of one equal cell */
+			end = col + 1;
+			while(end < LCD_COLUMNS){
+				if(text_ptr[end] != screen_ptr[end]){
+					end++;
+				}
+				else if((end + 1 < LCD_COLUMNS) && (text_ptr[end + 1] != screen_ptr[end + 1])){
+					end += 2;
+				}
+				else{
+					break;
+				}
+			}
+
+			LCD_moveCursor(row, col);
+			g_stats.cursorMoves++;
+			for(; col < end; col++){
+				LCD_displayCharacter(text_ptr[col]);
+				screen_ptr[col] = text_ptr[col];
+				g_stats.cells++;
+			}
+		}
+	}
+}
+
+/*
+ * Description :
+ * Initialize the dashboard, the LCD must be clear (after LCD_init or LCD_clearScreen)
+ */
+void Dashboard_init(void){
+	Dashboard_fill(g_screen, ' ');
+	g_pagesCount = 0;
+	g_shownPage = DASHBOARD_INVALID_PAGE;
+	g_elapsed = 0;
+	g_stats.renders = 0;
+	g_stats.cells = 0;
+	g_stats.cursorMoves = 0;
+}
+
+/*
+ * Description :
+ * Add a page with blank content, return its id or DASHBOARD_INVALID_PAGE if the table is full
+ */
+uint8 Dashboard_addPage(const Dashboard_PageConfigType * config_ptr){
+	uint8 page_id;
+
+	if(g_pagesCount >= DASHBOARD_MAX_PAGES){
+		return DASHBOARD_INVALID_PAGE;
+	}
+
+	page_id = g_pagesCount++;
+	g_pages[page_id] = *config_ptr;
+	Dashboard_fill(g_pageText[page_id], ' ');
+
+	return page_id;
+}
+
+/*
+ * Description :
+ * Show a page: render it and send only the cells that differ from the LCD content
+ */
+void Dashboard_showPage(uint8 page_id){
+	if(page_id >= g_pagesCount){
+		return;
+	}
+
+	g_shownPage = page_id;
+	g_elapsed = 0;
+	g_pages[page_id].render(g_pageText[page_id]);
+	g_stats.renders++;
+	Dashboard_flush();
+}
+
+/*
+ * Description :
+ * Return the id of the page shown
+ */
+uint8 Dashboard_getPage(void){
+	return g_shownPage;
+}
+
+/*
+ * Description :
+ * Call every DASHBOARD_TICK_MS: render the page shown when its refresh period elapsed
+ * and send the cells that changed
+ */
+void Dashboard_update(void){
+	if(g_shownPage == DASHBOARD_INVALID_PAGE){
+		return;
+	}
+
+	g_elapsed += DASHBOARD_TICK_MS;
+	if(g_elapsed < g_pages[g_shownPage].refreshPeriod){
+		return;
+	}
+
+	g_elapsed = 0;
+	g_pages[g_shownPage].render(g_pageText[g_shownPage]);
+	g_stats.renders++;
+	Dashboard_flush();
+}
+
+/*
+ * Description :
+ * Write a string into page content from the cell (row, col), it is cut at the end of the row
+ */
+void Dashboard_printText(Dashboard_TextType text, uint8 row, uint8 col, const char * str){
+	while((*str != '\0') && (col < LCD_COLUMNS)){
+		text[row][col++] = *str++;
+	}
+}
+
+/*
+ * Description :
+ * Write a number right aligned in width cells of page content (# when it does not fit)
+ */
+void Dashboard_printNumber(Dashboard_TextType text, uint8 row, uint8 col, uint8 width, sint32 value){
+	uint32 magnitude = (value < 0) ? (uint32)(-value) : (uint32)value;
+	uint8 i = width;
+
+	if((col + width) > LCD_COLUMNS){
+		return;
+	}
+
+	/* Digits from the right, at least one */
+	do{
+		text[row][col + --i] = '0' + (magnitude % 10);
+		magnitude /= 10;
+	}while((magnitude != 0) && (i > 0));
+
+	if((magnitude != 0) || ((value < 0) && (i == 0))){
+		for(i = 0; i < width; i++){
+			text[row][col + i] = '#';
+		}
+		return;
+	}
+
+	if(value < 0){
+		text[row][col + --i] = '-';
+	}
+	while(i > 0){
+		text[row][col + --i] = ' ';
+	}
+}
+
+/*
+ * Description :
+ * Copy the LCD traffic counters
+ */
+void Dashboard_getStats(Dashboard_StatsType * stats_ptr){
+	*stats_ptr = g_stats;
+}
@@ -0,0 +1,105 @@
+ /******************************************************************************
+ *
+ * Module: DASHBOARD
+ *
+ * File Name: dashboard.h
+ *
+ * Description: Header file for the LCD pages with cached content and delta updates
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef DASHBOARD_H_
+#define DASHBOARD_H_
+
+#include "std_types.h"
+#include "lcd.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Maximum number of pages (the position or the scan page is the fifth) */
+#define DASHBOARD_MAX_PAGES			5
+
+/* Returned by Dashboard_addPage when the page table is full */
+#define DASHBOARD_INVALID_PAGE		0xFF
+
+/* Period of the Dashboard_update calls in milli seconds */
+#define DASHBOARD_TICK_MS			50
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Content of a page, one character per cell */
+typedef uint8 Dashboard_TextType[LCD_ROWS][LCD_COLUMNS];
+
+/* Structure that contain members to set the configurations of a page */
+typedef struct{
+	void(*render)(Dashboard_TextType text);	/* Writes the fields into the cached page content */
+	uint16 refreshPeriod;					/* Milli seconds between two renders while the page is shown */
+}Dashboard_PageConfigType;
+
+/* Structure that holds the LCD traffic of the dashboard */
+typedef struct{
+	uint32 renders;
+	uint32 cells;			/* Characters sent */
+	uint32 cursorMoves;		/* One per run of changed cells */
+}Dashboard_StatsType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the dashboard, the LCD must be clear (after LCD_init or LCD_clearScreen)
+ */
+void Dashboard_init(void);
+
+/*
+ * Description :
+ * Add a page with blank content, return its id or DASHBOARD_INVALID_PAGE if the table is full
+ */
+uint8 Dashboard_addPage(const Dashboard_PageConfigType * config_ptr);
+
+/*
+ * Description :
+ * Show a page: render it and send only the cells that differ from the LCD content
+ */
+void Dashboard_showPage(uint8 page_id);
+
+/*
+ * Description :
+ * Return the id of the page shown
+ */
+uint8 Dashboard_getPage(void);
+
+/*
+ * Description :
+ * Call every DASHBOARD_TICK_MS: render the page shown when its refresh period elapsed
+ * and send the cells that changed
+ */
+void Dashboard_update(void);
+
+/*
+ * Description :
+ * Write a string into page content from the cell (row, col), it is cut at the end of the row
+ */
+void Dashboard_printText(Dashboard_TextType text, uint8 row, uint8 col, const char * str);
+
+/*
+ * Description :
+ * Write a number right aligned in width cells of page content (# when it does not fit)
+ */
+void Dashboard_printNumber(Dashboard_TextType text, uint8 row, uint8 col, uint8 width, sint32 value);
+
+/*
+ * Description :
+ * Copy the LCD traffic counters
+ */
+void Dashboard_getStats(Dashboard_StatsType * stats_ptr);
+
+#endif /* DASHBOARD_H_ */
@@ -0,0 +1,184 @@
+ /******************************************************************************
+ *
+ * Module: DISPLAY
+ *
+ * File Name: display.c
+ *
+ * Description: Source file for the bar graph and trend renderer (LCD custom characters)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "display.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Rows of the trend glyphs as written in the LCD */
+static uint8 g_trendGlyphs[DISPLAY_TREND_CELLS][LCD_GLYPH_ROWS];
+
+/* Trend glyph shown by the left cell and pixel columns used in the newest (right) glyph */
+static uint8 g_trendOldest = 0;
+static uint8 g_trendColumns = 0;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Write the rows of a trend glyph that differ from the LCD content,
+ * one address command for the run from the first to the last changed row
+ */
+static void Display_writeTrendGlyph(uint8 glyph, const uint8 * rows);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the renderer: upload the bar glyphs and clear the trend glyphs
+ * (about 70 LCD transfers, call it with the global interrupts enabled so the
+ * LCD queue can not overflow)
+ */
+void Display_init(void){
+	uint8 pattern[LCD_GLYPH_ROWS];
+	uint8 glyph;
+	uint8 row;
+
+	/* Partial bar cell of glyph+1 pixel columns filled from the left */
+	for(glyph = 0; glyph < (LCD_GLYPH_COLUMNS - 1); glyph++){
+		for(row = 0; row < LCD_GLYPH_ROWS; row++){
+			pattern[row] = (0x1F << (LCD_GLYPH_COLUMNS - 1 - glyph)) & 0x1F;
+		}
+		LCD_setCustomCharacter(DISPLAY_BAR_FIRST_GLYPH + glyph, pattern);
+	}
+
+	/* Empty trend, the content of the CGRAM is random after power up */
+	for(row = 0; row < LCD_GLYPH_ROWS; row++){
+		pattern[row] = 0;
+	}
+	for(glyph = 0; glyph < DISPLAY_TREND_CELLS; glyph++){
+		LCD_setCustomCharacter(DISPLAY_TREND_FIRST_GLYPH + glyph, pattern);
+		for(row = 0; row < LCD_GLYPH_ROWS; row++){
+			g_trendGlyphs[glyph][row] = 0;
+		}
+	}
+	g_trendOldest = 0;
+	g_trendColumns = 0;
+}
+
+/*
+ * Description :
+ * Render the value as a bar in DISPLAY_BAR_CELLS characters
+ * (the caller sends only the cells that changed, see dashboard.h)
+ */
+void Display_renderBar(uint16 value, uint8 * cells_ptr){
+	uint16 levels;
+	uint8 cell;
+
+	if(value > DISPLAY_BAR_FULL_SCALE){
+		value = DISPLAY_BAR_FULL_SCALE;
+	}
+
+	/* Bar length in pixel columns, rounded */
+	levels = (uint16)((((uint32)value * (DISPLAY_BAR_CELLS * LCD_GLYPH_COLUMNS)) + (DISPLAY_BAR_FULL_SCALE / 2)) / DISPLAY_BAR_FULL_SCALE);
+
+	for(cell = 0; cell < DISPLAY_BAR_CELLS; cell++){
+		if(levels >= LCD_GLYPH_COLUMNS){
+			cells_ptr[cell] = DISPLAY_FULL_BLOCK;
+			levels -= LCD_GLYPH_COLUMNS;
+		}
+		else if(levels > 0){
+			cells_ptr[cell] = DISPLAY_BAR_FIRST_GLYPH + levels - 1;
+			levels = 0;
+		}
+		else{
+			cells_ptr[cell] = ' ';
+		}
+	}
+}
+
+/*
+ * Description :
+ * Add a sample to the trend, only the changed rows of the newest glyph are written
+ * to the LCD. Every LCD_GLYPH_COLUMNS samples the oldest glyph becomes the newest one.
+ */
+void Display_addTrendSample(uint16 value){
+	uint8 rows[LCD_GLYPH_ROWS];
+	uint8 newest;
+	uint8 height;
+	uint8 row;
+	boolean recycled = FALSE;
+
+	/* The newest glyph is full: the oldest one becomes the new empty newest one */
+	if(g_trendColumns == LCD_GLYPH_COLUMNS){
+		g_trendOldest = (g_trendOldest + 1) % DISPLAY_TREND_CELLS;
+		g_trendColumns = 0;
+		recycled = TRUE;
+	}
+	newest = (g_trendOldest + DISPLAY_TREND_CELLS - 1) % DISPLAY_TREND_CELLS;
+
+	if(value > DISPLAY_TREND_FULL_SCALE){
+		value = DISPLAY_TREND_FULL_SCALE;
+	}
+	height = (uint8)((((uint32)value * LCD_GLYPH_ROWS) + (DISPLAY_TREND_FULL_SCALE / 2)) / DISPLAY_TREND_FULL_SCALE);
+
+	/* Column filled from the bottom row up to the height */
+	for(row = 0; row < LCD_GLYPH_ROWS; row++){
+		rows[row] = (recycled == TRUE) ? 0 : g_trendGlyphs[newest][row];
+		if(row >= (LCD_GLYPH_ROWS - height)){
+			rows[row] |= (1 << (LCD_GLYPH_COLUMNS - 1 - g_trendColumns));
+		}
+	}
+	g_trendColumns++;
+
+	Display_writeTrendGlyph(newest, rows);
+}
+
+/*
+ * Description :
+ * Render the trend in DISPLAY_TREND_CELLS characters, oldest glyph on the left
+ */
+void Display_renderTrend(uint8 * cells_ptr){
+	uint8 cell;
+
+	for(cell = 0; cell < DISPLAY_TREND_CELLS; cell++){
+		cells_ptr[cell] = DISPLAY_TREND_FIRST_GLYPH + ((g_trendOldest + cell) % DISPLAY_TREND_CELLS);
+	}
+}
+
+/*
+ * Description :
+ * Write the rows of a trend glyph that differ from the LCD content,
+ * one address command for the run from the first to the last changed row
+ */
+static void Display_writeTrendGlyph(uint8 glyph, const uint8 * rows){
+	uint8 first = LCD_GLYPH_ROWS;
+	uint8 last = 0;
+	uint8 row;
+
+	for(row = 0; row < LCD_GLYPH_ROWS; row++){
+		if(rows[row] != g_trendGlyphs[glyph][row]){
+			if(first == LCD_GLYPH_ROWS){
+				first = row;
+			}
+			last = row;
+		}
+	}
+
+	/* Nothing changed */
+	if(first == LCD_GLYPH_ROWS){
+		return;
+	}
+
+	LCD_sendCommand(LCD_SET_CGRAM_ADDRESS | ((DISPLAY_TREND_FIRST_GLYPH + glyph) * LCD_GLYPH_ROWS + first));
+	for(row = first; row <= last; row++){
+		LCD_displayCharacter(rows[row]);
+		g_trendGlyphs[glyph][row] = rows[row];
+	}
+}
+
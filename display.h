@@ -0,0 +1,79 @@
+ /******************************************************************************
+ *
+ * Module: DISPLAY
+ *
+ * File Name: display.h
+ *
+ * Description: Header file for the bar graph and trend renderer (LCD custom characters)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include "std_types.h"
+#include "lcd.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Horizontal bar: LCD_GLYPH_COLUMNS levels per cell, value DISPLAY_BAR_FULL_SCALE fills all the cells */
+#define DISPLAY_BAR_CELLS			11
+#define DISPLAY_BAR_FULL_SCALE		400
+
+/*
+ * Trend: one pixel column per sample, DISPLAY_TREND_FULL_SCALE is the full glyph height.
+ * The cells show the custom characters from DISPLAY_TREND_FIRST_GLYPH, the newest on the right.
+ */
+#define DISPLAY_TREND_CELLS			4
+#define DISPLAY_TREND_FULL_SCALE	400
+
+/* Custom characters: partial bar cells of 1..4 pixel columns, then the trend cells */
+#define DISPLAY_BAR_FIRST_GLYPH		0
+#define DISPLAY_TREND_FIRST_GLYPH	(DISPLAY_BAR_FIRST_GLYPH + LCD_GLYPH_COLUMNS - 1)
+
+#if((DISPLAY_TREND_FIRST_GLYPH + DISPLAY_TREND_CELLS) > LCD_CUSTOM_CHARACTERS)
+
+#error "The bar and trend glyphs do not fit in the custom characters"
+
+#endif
+
+/* Character of a full bar cell (all pixels set in the character ROM) */
+#define DISPLAY_FULL_BLOCK			0xFF
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the renderer: upload the bar glyphs and clear the trend glyphs
+ * (about 70 LCD transfers, call it with the global interrupts enabled so the
+ * LCD queue can not overflow)
+ */
+void Display_init(void);
+
+/*
+ * Description :
+ * Render the value as a bar in DISPLAY_BAR_CELLS characters
+ * (the caller sends only the cells that changed, see dashboard.h)
+ */
+void Display_renderBar(uint16 value, uint8 * cells_ptr);
+
+/*
+ * Description :
+ * Add a sample to the trend, only the changed rows of the newest glyph are written
+ * to the LCD. Every LCD_GLYPH_COLUMNS samples the oldest glyph becomes the newest one.
+ */
+void Display_addTrendSample(uint16 value);
+
+/*
+ * Description :
+ * Render the trend in DISPLAY_TREND_CELLS characters, oldest glyph on the left
+ */
+void Display_renderTrend(uint8 * cells_ptr);
+
+#endif /* DISPLAY_H_ */
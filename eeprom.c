@@ -0,0 +1,94 @@
+ /******************************************************************************
+ *
+ * Module: EEPROM
+ *
+ * File Name: eeprom.c
+ *
+ * Description: Source file for the AVR internal EEPROM driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "eeprom.h"
+#include "common_macros.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read one byte of the EEPROM (waits for a write on the way to end first)
+ */
+uint8 EEPROM_readByte(uint16 address){
+
+	/* EEAR must not change during a write */
+	while(BIT_IS_SET(EECR, EEWE)){
+	}
+
+	EEAR = address;
+
+	/* The CPU is halted 4 cycles and EEDR holds the byte */
+	EECR |= (1<<EERE);
+
+	return EEDR;
+}
+
+/*
+ * Description :
+ * Read length bytes of the EEPROM from the given address
+ */
+void EEPROM_readBlock(uint16 address, uint8 * data_ptr, uint16 length){
+	uint16 i;
+
+	for(i = 0; i < length; i++){
+		data_ptr[i] = EEPROM_readByte(address + i);
+	}
+}
+
+/*
+ * Description :
+ * Write one byte of the EEPROM, the byte is not written again if it already holds
+ * the value (every write wears the cell). Waits for the previous write to end but
+ * not for this one (about 8.5 ms).
+ */
+void EEPROM_writeByte(uint16 address, uint8 data){
+	uint8 sreg;
+
+	if(EEPROM_readByte(address) == data){
+		return;
+	}
+
+	EEDR = data;
+
+	/* EEWE must be set at most 4 cycles after EEMWE, no interrupt in between */
+	sreg = SREG;
+	cli();
+	EECR |= (1<<EEMWE);
+	EECR |= (1<<EEWE);
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Write length bytes to the EEPROM from the given address in order
+ * (blocks about 8.5 ms for every changed byte)
+ */
+void EEPROM_writeBlock(uint16 address, const uint8 * data_ptr, uint16 length){
+	uint16 i;
+
+	for(i = 0; i < length; i++){
+		EEPROM_writeByte(address + i, data_ptr[i]);
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE while a write is on the way
+ */
+boolean EEPROM_isBusy(void){
+	return BIT_IS_SET(EECR, EEWE) ? TRUE : FALSE;
+}
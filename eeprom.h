@@ -0,0 +1,62 @@
+ /******************************************************************************
+ *
+ * Module: EEPROM
+ *
+ * File Name: eeprom.h
+ *
+ * Description: Header file for the AVR internal EEPROM driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Size of the ATmega32 EEPROM in bytes */
+#define EEPROM_SIZE			1024
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Read one byte of the EEPROM (waits for a write on the way to end first)
+ */
+uint8 EEPROM_readByte(uint16 address);
+
+/*
+ * Description :
+ * Read length bytes of the EEPROM from the given address
+ */
+void EEPROM_readBlock(uint16 address, uint8 * data_ptr, uint16 length);
+
+/*
+ * Description :
+ * Write one byte of the EEPROM, the byte is not written again if it already holds
+ * the value (every write wears the cell). Waits for the previous write to end but
+ * not for this one (about 8.5 ms).
+ */
+void EEPROM_writeByte(uint16 address, uint8 data);
+
+/*
+ * Description :
+ * Write length bytes to the EEPROM from the given address in order
+ * (blocks about 8.5 ms for every changed byte)
+ */
+void EEPROM_writeBlock(uint16 address, const uint8 * data_ptr, uint16 length);
+
+/*
+ * Description :
+ * Return TRUE while a write is on the way
+ */
+boolean EEPROM_isBusy(void);
+
+#endif /* EEPROM_H_ */
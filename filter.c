@@ -0,0 +1,56 @@
+ /******************************************************************************
+ *
+ * Module: FILTER
+ *
+ * File Name: filter.c
+ *
+ * Description: Source file for the fixed point filters of the measurement stream
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "filter.h"
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize an exponential moving average with the smoothing shift (alpha = 1/2^shift)
+ */
+void Filter_emaInit(Filter_EmaType * filter_ptr, uint8 shift){
+	filter_ptr->state = 0;
+	filter_ptr->shift = shift;
+	filter_ptr->initialized = FALSE;
+}
+
+/*
+ * Description :
+ * Add a sample and return the rounded average
+ */
+uint16 Filter_emaUpdate(Filter_EmaType * filter_ptr, uint16 sample){
+	uint32 input = ((uint32)sample) << FILTER_FRACTION_BITS;
+
+	if(filter_ptr->initialized == FALSE){
+		filter_ptr->state = input;
+		filter_ptr->initialized = TRUE;
+	}
+	else if(input >= filter_ptr->state){
+		filter_ptr->state += (input - filter_ptr->state) >> filter_ptr->shift;
+	}
+	else{
+		filter_ptr->state -= (filter_ptr->state - input) >> filter_ptr->shift;
+	}
+
+	return Filter_emaGet(filter_ptr);
+}
+
+/*
+ * Description :
+ * Return the rounded average
+ */
+uint16 Filter_emaGet(const Filter_EmaType * filter_ptr){
+	return (uint16)((filter_ptr->state + (1UL << (FILTER_FRACTION_BITS - 1))) >> FILTER_FRACTION_BITS);
+}
@@ -0,0 +1,58 @@
+ /******************************************************************************
+ *
+ * Module: FILTER
+ *
+ * File Name: filter.h
+ *
+ * Description: Header file for the fixed point filters of the measurement stream
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Fraction bits of the filter state */
+#define FILTER_FRACTION_BITS		8
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds an exponential moving average: y += (x - y) / 2^shift */
+typedef struct{
+	uint32 state;			/* Average with FILTER_FRACTION_BITS fraction bits */
+	uint8 shift;			/* Smoothing, 0 = no smoothing */
+	boolean initialized;	/* The first sample sets the average */
+}Filter_EmaType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize an exponential moving average with the smoothing shift (alpha = 1/2^shift)
+ */
+void Filter_emaInit(Filter_EmaType * filter_ptr, uint8 shift);
+
+/*
+ * Description :
+ * Add a sample and return the rounded average
+ */
+uint16 Filter_emaUpdate(Filter_EmaType * filter_ptr, uint16 sample);
+
+/*
+ * Description :
+ * Return the rounded average
+ */
+uint16 Filter_emaGet(const Filter_EmaType * filter_ptr);
+
+#endif /* FILTER_H_ */
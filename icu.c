@@ -12,6 +12,8 @@
 
 #include "icu.h"
 #include "gpio.h"
+#include "seqlock.h"
+#include "perf.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
@@ -22,17 +24,109 @@
 /* Global variables to hold the address of the call back function in the application */
 static volatile void(*g_funcCallBackPtr)(void) = NULL_PTR;
 
+/* Minimum accepted time between two edges in Timer1 ticks (0 = rejection disabled) */
+static volatile uint16 g_minPulseWidth = ICU_DEFAULT_MIN_PULSE_WIDTH;
+
+/* Input capture value of the last accepted edge */
+static volatile uint16 g_lastCapture = 0;
+
+/* Flag to indicate that g_lastCapture holds a real edge (no reference before the first edge) */
+static volatile boolean g_lastCaptureValid = FALSE;
+
+/* Accepted edge before the last one, the reference again when the last one is undone */
+static volatile uint16 g_previousCapture = 0;
+static volatile boolean g_previousCaptureValid = FALSE;
+
+/* Call back told about every rejected edge */
+static void(*volatile g_glitchCallBackPtr)(void) = NULL_PTR;
+
+/* Number of edges rejected as glitches */
+static volatile uint16 g_glitchCount = 0;
+
+/* Sequence counter protecting g_glitchCount against torn reads */
+static Seqlock_Type g_glitchLock = 0;
+
+/* Number of Timer1 overflows, the upper 16 bits of the time stamp */
+static volatile uint16 g_overflowCount = 0;
+
+/* Call back of the compare and the time stamp it waits for */
+static void(*volatile g_compareCallBackPtr)(void) = NULL_PTR;
+static volatile uint32 g_compareTime = 0;
+
 /*******************************************************************************
  *                       Interrupt Service Routines                            *
  *******************************************************************************/
 
 ISR(TIMER1_CAPT_vect){
 
-	if(g_funcCallBackPtr != NULL_PTR){
+	PERF_BEGIN(isrStart);
+
+	uint16 capture = ICR1;
+
+	if((g_lastCaptureValid == TRUE) && ((uint16)(capture - g_lastCapture) < g_minPulseWidth)){
+
+		/*
+		 * The pulse that ended with this edge is narrower than the minimum pulse width:
+		 * the pin is back to the level it had before the previous edge, so wait for that
+		 * edge again and drop this one without calling the application
+		 */
+		TCCR1B ^= (1<<ICES1);
+
+		/* Changing the edge may set ICF1, clear it */
+		TIFR = (1<<ICF1);
+
+		Seqlock_writeBegin(&g_glitchLock);
+		g_glitchCount++;
+		Seqlock_writeEnd(&g_glitchLock);
 
-		/* Call the Call Back function in the application after the edge is detected */
-		(*g_funcCallBackPtr)();
+		PERF_COUNT(PERF_COUNTER_GLITCH);
+
+		/*
+		 * The previous edge is undone too, measure the next edge from the one before it:
+		 * an edge near the glitch is not rejected against an edge that is gone
+		 */
+		g_lastCapture = g_previousCapture;
+		g_lastCaptureValid = g_previousCaptureValid;
+		g_previousCaptureValid = FALSE;
+
+		/* The previous edge was passed on already, the application undoes it */
+		if(g_glitchCallBackPtr != NULL_PTR){
+			(*g_glitchCallBackPtr)();
+		}
 	}
+	else{
+
+		/* Keep the accepted edge as a reference for the next one */
+		g_previousCapture = g_lastCapture;
+		g_previousCaptureValid = g_lastCaptureValid;
+		g_lastCapture = capture;
+		g_lastCaptureValid = TRUE;
+
+		if(g_funcCallBackPtr != NULL_PTR){
+
+			/* Call the Call Back function in the application after the edge is detected */
+			(*g_funcCallBackPtr)();
+		}
+	}
+
+	PERF_END(PERF_METRIC_ICU_ISR, isrStart);
+}
+
+ISR(TIMER1_COMPB_vect){
+
+	/* OCR1B holds the low 16 bits only, the match repeats every 2^16 ticks until the time stamp is reached */
+	if((sint32)(ICU_getTimestamp() - g_compareTime) >= 0){
+		TIMSK &= ~(1<<OCIE1B);
+		if(g_compareCallBackPtr != NULL_PTR){
+			(*g_compareCallBackPtr)();
+		}
+	}
+}
+
+ISR(TIMER1_OVF_vect){
+
+	/* Extend Timer1 to 32 bits */
+	g_overflowCount++;
 }
 
 /*******************************************************************************
@@ -45,8 +139,10 @@ ISR(TIMER1_CAPT_vect){
  * 1. Configure Timer1 to Normal Mode
  * 2. Select ICU Edge Select
  * 3. Select Timer1 prescaler
- * 4. Enable Timer/Counter1 Input Capture Interrupt
- * 5. Set ICU Pin as input pin
+ * 4. Enable/Disable the Input Capture Noise Canceler
+ * 5. Set the minimum accepted pulse width
+ * 6. Enable Timer/Counter1 Input Capture and Overflow Interrupts
+ * 7. Set ICU Pin as input pin
  */
 void ICU_init(const Icu_ConfigType * config_ptr){
 
@@ -61,11 +157,14 @@ void ICU_init(const Icu_ConfigType * config_ptr){
 
 	/*
 	 * Configure Timer/Counter1 Control Register B:
-	 * 1. Clear Bit 7(ICNC1) to disable Input Capture Noise Canceler
-	 * 2. Clear  Bit 4:3(WGM13:2) to set Timer1 mode of operation to Normal Mode
+	 * 1. Clear  Bit 4:3(WGM13:2) to set Timer1 mode of operation to Normal Mode
+	 * 2. Bit 7(ICNC1) is set below according to the configuration
 	 */
 	TCCR1B = 0;
 
+	/* Configure Input Capture Noise Canceler */
+	TCCR1B = (TCCR1B & 0x7F) | (((config_ptr->noiseCanceler) & 0x01)<<ICNC1);
+
 	/* Configure ICU Edge Select */
 	TCCR1B = (TCCR1B & 0xBF) | (((config_ptr->edgeSelect) & 0x01)<<ICES1);
 
@@ -78,11 +177,23 @@ void ICU_init(const Icu_ConfigType * config_ptr){
 	/* Initial Value for the input capture register */
 	ICR1 = 0;
 
+	/* Configure glitch rejection, there is no reference edge yet */
+	g_minPulseWidth = config_ptr->minPulseWidth;
+	g_lastCaptureValid = FALSE;
+	g_previousCaptureValid = FALSE;
+	Seqlock_writeBegin(&g_glitchLock);
+	g_glitchCount = 0;
+	Seqlock_writeEnd(&g_glitchLock);
+
+	/* Restart the time stamp */
+	g_overflowCount = 0;
+
 	/*
 	 * Configure Timer/Counter Interrupt Mask Register:
-	 * Set Bit 5(TICIE1) to Enable Timer/Counter1 Input Capture Interrupt
+	 * 1. Set Bit 5(TICIE1) to Enable Timer/Counter1 Input Capture Interrupt
+	 * 2. Set Bit 2(TOIE1) to Enable Timer/Counter1 Overflow Interrupt for the time stamp
 	 */
-	TIMSK |= (1<<TICIE1);
+	TIMSK |= (1<<TICIE1) | (1<<TOIE1);
 
 	/* Set ICU Pin as input pin */
 	GPIO_setupPinDirection(ICU_PORT_ID, ICU_PIN_ID, PIN_INPUT);
@@ -106,6 +217,66 @@ void ICU_setEdgeDetectionType(const Icu_EdgeType edgeSelect){
 
 	/* Configure ICU Edge Select */
 	TCCR1B = (TCCR1B & 0xBF) | (((edgeSelect) & 0x01)<<ICES1);
+
+	/* Changing the edge may set ICF1, clear it */
+	TIFR = (1<<ICF1);
+}
+
+/*
+ * Description :
+ * Enable/Disable the hardware Input Capture Noise Canceler (ICNC1).
+ * When enabled an edge is only accepted after 4 equal samples of the ICP1 pin.
+ */
+void ICU_setNoiseCanceler(const Icu_NoiseCancelerType noiseCanceler){
+
+	/* Configure Input Capture Noise Canceler */
+	TCCR1B = (TCCR1B & 0x7F) | (((noiseCanceler) & 0x01)<<ICNC1);
+}
+
+/*
+ * Description :
+ * Set the minimum pulse width (in Timer1 ticks) measured between two accepted edges.
+ * An edge that comes earlier than that is a glitch, it is dropped without calling the
+ * call back function and the edge select is returned to the edge that was awaited before it.
+ * Zero disables the rejection.
+ */
+void ICU_setMinPulseWidth(uint16 minPulseWidth){
+	g_minPulseWidth = minPulseWidth;
+}
+
+/*
+ * Description:
+ * Function to set the call back function of the rejected edges (called from the capture
+ * interrupt): the edge accepted before a rejected one was half of the glitch, the application
+ * undoes what it did with it
+ */
+void ICU_setGlitchCallBack(void(*a_ptr)(void)){
+	g_glitchCallBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Return TRUE if an edge is captured and its interrupt is not served yet
+ */
+boolean ICU_isCapturePending(void){
+	return (TIFR & (1<<ICF1)) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * Return the number of edges rejected as glitches since the ICU was initialized
+ */
+uint16 ICU_getGlitchCount(void){
+	uint16 glitchCount;
+	uint8 sequence;
+
+	/* Copy again if a glitch was counted during the copy */
+	do{
+		sequence = Seqlock_readBegin(&g_glitchLock);
+		glitchCount = g_glitchCount;
+	}while(Seqlock_readRetry(&g_glitchLock, sequence));
+
+	return glitchCount;
 }
 
 /*
@@ -117,6 +288,111 @@ uint16 ICU_getInputCaptureValue(void){
 	return ICR1;
 }
 
+/*
+ * Description:
+ * Return the input capture value (ICR1) extended to a 32-bit time stamp like ICU_getTimestamp,
+ * it must be called from the call back function only (before the next overflow is served)
+ */
+uint32 ICU_getInputCaptureTimestamp(void){
+	uint16 low = ICR1;
+	uint16 high = g_overflowCount;
+
+	/* The capture happened after an overflow whose interrupt is not served yet */
+	if((TIFR & (1<<TOV1)) && (low < 0x8000)){
+		high++;
+	}
+
+	return (((uint32)high)<<16) | low;
+}
+
+/*
+ * Description:
+ * Return the current Timer1 counter value (TCNT1)
+ */
+uint16 ICU_getTimerValue(void){
+	uint16 timerValue;
+	uint8 sreg = SREG;
+
+	/*
+	 * The 16-bit registers share one TEMP register, an ISR reading ICR1 between the two
+	 * byte reads of TCNT1 corrupts the high byte, so block the interrupts for the read only
+	 */
+	cli();
+	timerValue = TCNT1;
+	SREG = sreg;
+
+	return timerValue;
+}
+
+/*
+ * Description:
+ * Return a 32-bit time stamp in Timer1 ticks: TCNT1 extended by the count of Timer1 overflows.
+ * It wraps around after 2^32 ticks, the difference of two time stamps is always valid.
+ */
+uint32 ICU_getTimestamp(void){
+	uint16 low;
+	uint16 high;
+	uint8 sreg = SREG;
+
+	/* Read TCNT1 and the overflow count together (see ICU_getTimerValue) */
+	cli();
+	low = TCNT1;
+	high = g_overflowCount;
+
+	/* Timer1 overflowed but its interrupt is not served yet, TCNT1 was read after the overflow */
+	if((TIFR & (1<<TOV1)) && (low < 0x8000)){
+		high++;
+	}
+	SREG = sreg;
+
+	return (((uint32)high)<<16) | low;
+}
+
+/*
+ * Description:
+ * Function to set the call back function of the compare (called from its interrupt).
+ */
+void ICU_setCompareCallBack(void(*a_ptr)(void)){
+	g_compareCallBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Call the compare call back when the time stamp reaches the given one (OCR1B compare
+ * match on the Timer1 time base, up to 2^31 ticks ahead), at once if it is reached already
+ */
+void ICU_startCompare(uint32 timestamp){
+	uint8 sreg = SREG;
+	boolean reached;
+
+	cli();
+	g_compareTime = timestamp;
+	OCR1B = (uint16)timestamp;
+
+	/* Clear a match of the previous compare value (write one to clear) */
+	TIFR = (1<<OCF1B);
+	TIMSK |= (1<<OCIE1B);
+
+	/* The time stamp passed while OCR1B was written, the match would come one wrap later */
+	reached = ((sint32)(ICU_getTimestamp() - timestamp) >= 0) ? TRUE : FALSE;
+	if(reached){
+		TIMSK &= ~(1<<OCIE1B);
+	}
+	SREG = sreg;
+
+	if(reached && (g_compareCallBackPtr != NULL_PTR)){
+		(*g_compareCallBackPtr)();
+	}
+}
+
+/*
+ * Description :
+ * Cancel the compare
+ */
+void ICU_stopCompare(void){
+	TIMSK &= ~(1<<OCIE1B);
+}
+
 /*
  * Description :
  * Reset Timer1 Counter(i.e. TCNT1 = 0)
@@ -139,6 +415,10 @@ void ICU_DeInit(void){
 	TCNT1 = 0;
 	ICR1 = 0;
 
-	/* Disable the Input Capture interrupt */
-	TIMSK &= ~(1<<TICIE1);
+	/* Forget the reference edges of the glitch rejection */
+	g_lastCaptureValid = FALSE;
+	g_previousCaptureValid = FALSE;
+
+	/* Disable the Input Capture, Compare B and Overflow interrupts */
+	TIMSK &= ~((1<<TICIE1) | (1<<OCIE1B) | (1<<TOIE1));
 }
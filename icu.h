@@ -22,6 +22,9 @@
 #define ICU_PORT_ID PORTD_ID
 #define ICU_PIN_ID  PIN6_ID
 
+/* Pulses narrower than this (in Timer1 ticks) are rejected as glitches by default, 0 disables rejection */
+#define ICU_DEFAULT_MIN_PULSE_WIDTH	0
+
 /*******************************************************************************
  *                               Types Declaration                             *
  *******************************************************************************/
@@ -36,10 +39,17 @@ typedef enum{
 	NO_CLOCK,F_CPU_CLOCK,F_CPU_8,F_CPU_64,F_CPU_256,F_CPU_1024
 }Icu_EdgeType;
 
+/* enum for the Input Capture Noise Canceler (ICNC1) state */
+typedef enum{
+	ICU_NOISE_CANCELER_OFF, ICU_NOISE_CANCELER_ON
+}Icu_NoiseCancelerType;
+
 /* Structure that contain members to set the configurations of ICU */
 typedef struct{
 	Icu_EdgeType edgeSelect;
 	Icu_Clock clockSelect;
+	Icu_NoiseCancelerType noiseCanceler;
+	uint16 minPulseWidth;
 }Icu_ConfigType;
 
 /*******************************************************************************
@@ -52,8 +62,10 @@ typedef struct{
  * 1. Configure Timer1 to Normal Mode
  * 2. Select ICU Edge Select
  * 3. Select Timer1 prescaler
- * 4. Enable Timer/Counter1 Input Capture Interrupt
- * 5. Set ICU Pin as input pin
+ * 4. Enable/Disable the Input Capture Noise Canceler
+ * 5. Set the minimum accepted pulse width
+ * 6. Enable Timer/Counter1 Input Capture and Overflow Interrupts
+ * 7. Set ICU Pin as input pin
  */
 void ICU_init(const Icu_ConfigType * config_ptr);
 
@@ -76,12 +88,87 @@ void ICU_setEdgeDetectionType(const Icu_EdgeType edgeSelect);
  */
 uint16 ICU_getInputCaptureValue(void);
 
+/*
+ * Description:
+ * Return the input capture value (ICR1) extended to a 32-bit time stamp like ICU_getTimestamp,
+ * it must be called from the call back function only (before the next overflow is served)
+ */
+uint32 ICU_getInputCaptureTimestamp(void);
+
+/*
+ * Description:
+ * Return the current Timer1 counter value (TCNT1)
+ */
+uint16 ICU_getTimerValue(void);
+
+/*
+ * Description:
+ * Return a 32-bit time stamp in Timer1 ticks: TCNT1 extended by the count of Timer1 overflows.
+ * It wraps around after 2^32 ticks, the difference of two time stamps is always valid.
+ */
+uint32 ICU_getTimestamp(void);
+
+/*
+ * Description:
+ * Function to set the call back function of the compare (called from its interrupt).
+ */
+void ICU_setCompareCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Call the compare call back when the time stamp reaches the given one (OCR1B compare
+ * match on the Timer1 time base, up to 2^31 ticks ahead), at once if it is reached already
+ */
+void ICU_startCompare(uint32 timestamp);
+
+/*
+ * Description :
+ * Cancel the compare
+ */
+void ICU_stopCompare(void);
+
 /*
  * Description :
  * Reset Timer1 Counter(i.e. TCNT1 = 0)
  */
 void ICU_clearTimerValue(void);
 
+/*
+ * Description :
+ * Enable/Disable the hardware Input Capture Noise Canceler (ICNC1).
+ * When enabled an edge is only accepted after 4 equal samples of the ICP1 pin.
+ */
+void ICU_setNoiseCanceler(const Icu_NoiseCancelerType noiseCanceler);
+
+/*
+ * Description :
+ * Set the minimum pulse width (in Timer1 ticks) measured between two accepted edges.
+ * An edge that comes earlier than that is a glitch, it is dropped without calling the
+ * call back function and the edge select is returned to the edge that was awaited before it.
+ * Zero disables the rejection.
+ */
+void ICU_setMinPulseWidth(uint16 minPulseWidth);
+
+/*
+ * Description:
+ * Function to set the call back function of the rejected edges (called from the capture
+ * interrupt): the edge accepted before a rejected one was half of the glitch, the application
+ * undoes what it did with it
+ */
+void ICU_setGlitchCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Return TRUE if an edge is captured and its interrupt is not served yet
+ */
+boolean ICU_isCapturePending(void);
+
+/*
+ * Description :
+ * Return the number of edges rejected as glitches since the ICU was initialized
+ */
+uint16 ICU_getGlitchCount(void);
+
 /*
  * Description :
  * Stop Timer1 and ICU Driver
@@ -12,8 +12,148 @@
 
 #include "lcd.h"
 #include "gpio.h"
+#include "timer.h"
 #include "common_macros.h"
-#include <util/delay.h>
+#include "perf.h"
+#include "twi.h"
+#include "spi.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdlib.h> /* To use itoa */
+
+/*******************************************************************************
+ *                            Private Types                                    *
+ *******************************************************************************/
+
+/* enum for the state of the transfers */
+typedef enum{
+	LCD_STATE_IDLE,		/* Queue empty, the controller is ready */
+	LCD_STATE_READY,	/* The timer ends a fixed wait, then the next transfer is sent */
+	LCD_STATE_BUSY		/* The timer polls the busy flag (the end of the I2C or SPI transfer), then the next transfer is sent */
+}LCD_StateType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/*
+ * Transfer queue, an entry is the byte and the LCD_QUEUE_xxx flags,
+ * the API functions are the only writer of g_queueHead and the transfer steps
+ * the only writer of g_queueTail
+ */
+static volatile uint16 g_queue[LCD_QUEUE_SIZE];
+static volatile uint8 g_queueHead = 0;
+static volatile uint8 g_queueTail = 0;
+
+/* State of the transfers */
+static volatile LCD_StateType g_state = LCD_STATE_IDLE;
+
+/* Software timer of the transfer steps */
+static uint8 g_stepTimer = TIMER_INVALID_ID;
+
+/* Time (Timer_getMicros) the queue was empty for the first time after LCD_init, 0 before */
+static volatile uint32 g_readyTime = 0;
+
+/* Flag to indicate that LCD_init found the controller already configured */
+static boolean g_warmStart = FALSE;
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_I2C)
+
+/* Expander bytes of the I2C transaction on the bus */
+static uint8 g_batch[LCD_I2C_BATCH_SIZE];
+
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_SPI)
+
+/* Shift register bytes of one LCD byte (the execution time must pass before the next one) */
+static uint8 g_batch[4];
+
+/* Next shift register byte of the transfer */
+static uint8 g_batchIndex = 0;
+
+#endif
+
+#if(LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL)
+
+/* Bytes of the transfer and the wait after it (0 for none) */
+static uint8 g_batchLength = 0;
+static uint32 g_batchWait = 0;
+
+#endif
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Send the next queued transfer when the controller is ready
+ * and start the timer for the next step, called by the step timer
+ */
+static void LCD_transferStep(void);
+
+/*
+ * Description :
+ * Queue one transfer, start the transfers if they are stopped
+ */
+static void LCD_queueWrite(uint16 entry);
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
+
+/*
+ * Description :
+ * Write one byte to the instruction (RS = 0) or data (RS = 1) register without waiting
+ */
+static void LCD_writeByte(uint8 rs, uint8 value);
+
+#if(LCD_BIT_MODE == 4)
+/*
+ * Description :
+ * Write the high nibble of the value on the 4 data lines with one enable pulse
+ */
+static void LCD_writeNibble(uint8 value);
+#endif
+
+/*
+ * Description :
+ * Read one byte from the busy flag/address counter (RS = 0) or data (RS = 1) register
+ */
+static uint8 LCD_readByte(uint8 rs);
+
+/*
+ * Description :
+ * Return TRUE if the controller kept its configuration and the signature in the
+ * display RAM since the last LCD_init (the MCU restarted while the LCD stayed powered)
+ */
+static boolean LCD_isConfigured(void);
+
+#else
+
+/*
+ * Description :
+ * Add the high nibble of the value to the transfer: the expander byte with E high
+ * then the same byte with E low
+ */
+static void LCD_addNibble(uint8 rs, uint8 value);
+
+/*
+ * Description :
+ * End of the transfer: wait if its last LCD byte needs it, else send the next one,
+ * called from the TWI or SPI interrupt
+ */
+static void LCD_batchDone(boolean ack);
+
+#endif
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_SPI)
+
+/*
+ * Description :
+ * End of a shift register byte: latch it to the outputs and send the next one,
+ * called from the SPI interrupt
+ */
+static void LCD_shiftDone(void);
+
+#endif
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -22,20 +162,51 @@
 /*
  * Description :
  * Initialize the LCD :
- * 1. Setting LCD Pins as Output by GPIO Driver
+ * 1. Setting LCD Pins as Output by GPIO Driver (or the TWI/SPI master of the serial transports)
  * 2. Setting the LCD to 4-bit or 8-bit mode
+ * The commands are queued, they are sent once the global interrupts are enabled.
+ * If the controller is still configured (the MCU restarted while the LCD stayed powered)
+ * the power up wait and the mode commands are skipped, only the display is cleared
+ * (the serial transports can not read back, they always get the full init).
  */
 void LCD_init(void){
 
-	/* Configure RW pin direction and set it on write mode only */
+	/* The transfer steps wait on a software timer instead of delays */
+	Timer_init();
+	if(g_stepTimer == TIMER_INVALID_ID){
+		g_stepTimer = Timer_create(LCD_transferStep);
+	}
+	Timer_stop(g_stepTimer);
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_I2C)
+
+	{
+		Twi_MasterConfigType twiConfig = {LCD_I2C_BIT_RATE};
+		TWI_initMaster(&twiConfig);
+	}
+
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_SPI)
+
+	{
+		Spi_ConfigType spiConfig = {LCD_SPI_CLOCK, SPI_MODE_0, SPI_MSB_FIRST};
+		SPI_setCallBack(LCD_shiftDone);
+		SPI_initMaster(&spiConfig);
+	}
+
+	/* The rising edge of RCLK moves the shifted byte to the outputs */
+	GPIO_setupPinDirection(LCD_SPI_LATCH_PORT_ID, LCD_SPI_LATCH_PIN_ID, PIN_OUTPUT);
+	GPIO_writePin(LCD_SPI_LATCH_PORT_ID, LCD_SPI_LATCH_PIN_ID, LOGIC_LOW);
+
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
+
+	/* Configure RW pin direction and set it on write mode */
 	GPIO_setupPinDirection(LCD_RW_PORT_ID, LCD_RW_PIN_ID, PIN_OUTPUT);
 	GPIO_writePin(LCD_RW_PORT_ID, LCD_RW_PIN_ID, LOGIC_LOW);
 
 	/* Configure RS and E pins direction  */
 	GPIO_setupPinDirection(LCD_RS_PORT_ID, LCD_RS_PIN_ID, PIN_OUTPUT);
 	GPIO_setupPinDirection(LCD_E_PORT_ID, LCD_E_PIN_ID, PIN_OUTPUT);
-
-	_delay_ms(20); /* Since the LCD needs 20 mS to get powered up */
+	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
 
 #if(LCD_BIT_MODE == 4)
 
@@ -45,28 +216,63 @@ void LCD_init(void){
 	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, PIN_OUTPUT);
 	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, PIN_OUTPUT);
 
-	/* Configure LCD as 2 lines 4-Bit mode */
-	LCD_sendCommand(LCD_TWO_LINES_FOUR_BITS_MODE);
-
-	LCD_sendCommand(LCD_TWO_LINES_FOUR_BITS_MODE_INIT1);
-	LCD_sendCommand(LCD_TWO_LINES_FOUR_BITS_MODE_INIT2);
-
 #elif(LCD_BIT_MODE == 8)
 
 	/* Configure LCD Data Port as output */
-	GPIO_setupPortDirection(LCD_DATA_PORT_ID, PIN_OUTPUT);
+	GPIO_setupPortDirection(LCD_DATA_PORT_ID, PORT_OUTPUT);
 
-	/* Configure LCD as 2 lines 8-Bit mode */
-	LCD_sendCommand(LCD_TWO_LINES_EIGHT_BITS_MODE);
+#endif
 
 #endif
 
-	/* Turn ON DISPLAY and Turn OFF CURSOR */
-	LCD_sendCommand(LCD_DISPLAY_ON_CURSOR_OFF);
+	/* Empty the queue */
+	g_queueHead = 0;
+	g_queueTail = 0;
+	g_readyTime = 0;
+#if(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
+	g_warmStart = LCD_isConfigured();
+#else
+	g_warmStart = FALSE;
+#endif
 
-	/* Clear DISPLAY */
-	LCD_sendCommand(LCD_CLEAR_DISPLAY);
+	if(g_warmStart == TRUE){
 
+		/* Configured already, the busy flag works from the first transfer */
+		g_state = LCD_STATE_IDLE;
+	}
+	else{
+
+		/* The first transfer starts after the power up time (20 mS) */
+		g_state = LCD_STATE_READY;
+		Timer_start(g_stepTimer, TIMER_ONE_SHOT, LCD_POWER_UP_TIME_US);
+
+#if(LCD_BIT_MODE == 4)
+
+		/*
+		 * Synchronize the nibbles (8-bit mode three times from any state) then switch to
+		 * 4-bit mode, the busy flag can not be read meanwhile
+		 */
+		LCD_queueWrite(LCD_QUEUE_SYNC_NIBBLE | LCD_EIGHT_BITS_MODE_NIBBLE);
+		LCD_queueWrite(LCD_QUEUE_SYNC_NIBBLE | LCD_EIGHT_BITS_MODE_NIBBLE);
+		LCD_queueWrite(LCD_QUEUE_SYNC_NIBBLE | LCD_EIGHT_BITS_MODE_NIBBLE);
+		LCD_queueWrite(LCD_QUEUE_SYNC_NIBBLE | LCD_FOUR_BITS_MODE_NIBBLE);
+
+		/* Configure LCD as 2 lines 4-Bit mode */
+		LCD_sendCommand(LCD_TWO_LINES_FOUR_BITS_MODE);
+
+#elif(LCD_BIT_MODE == 8)
+
+		/* Configure LCD as 2 lines 8-Bit mode */
+		LCD_sendCommand(LCD_TWO_LINES_EIGHT_BITS_MODE);
+
+#endif
+
+		/* Turn ON DISPLAY and Turn OFF CURSOR */
+		LCD_sendCommand(LCD_DISPLAY_ON_CURSOR_OFF);
+	}
+
+	/* Clear DISPLAY (it writes the signature again) */
+	LCD_clearScreen();
 }
 
 /*
@@ -75,128 +281,452 @@ void LCD_init(void){
  */
 void LCD_sendCommand(uint8 command){
 
-	/* Command Register is selected */
-	GPIO_writePin(LCD_RS_PORT_ID, LCD_RS_PIN_ID, LOGIC_LOW);
+	PERF_BEGIN(transferStart);
 
-	_delay_ms(1); /* Time for tas(Address Set-Up Time) = 50nS */
+	/* Command Register is selected */
+	LCD_queueWrite(command);
 
-	/* Set E(Enable) High */
-	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_HIGH);
+	PERF_END(PERF_METRIC_LCD, transferStart);
+}
 
-	_delay_ms(1); /* Time for tpw-tdsw = 190nS */
+/*
+ * Description :
+ * Display character on LCD
+ */
+void LCD_displayCharacter(uint8 character){
 
-#if(LCD_BIT_MODE == 4)
+	PERF_BEGIN(transferStart);
 
-	/* Send data's (4,5,6,7) bits */
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, GET_BIT(command,4));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, GET_BIT(command,5));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, GET_BIT(command,6));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, GET_BIT(command,7));
+	/* Data Register is selected */
+	LCD_queueWrite(LCD_QUEUE_DATA | character);
 
-	_delay_ms(1); /* Time for tdsw = 100nS */
+	PERF_END(PERF_METRIC_LCD, transferStart);
+}
 
-	/* Set E(Enable) Low */
-	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
+/*
+ * Description :
+ * Wait until all the queued transfers are sent
+ * (return at once if the global interrupts are disabled)
+ */
+void LCD_flush(void){
+	while((g_state != LCD_STATE_IDLE) && BIT_IS_SET(SREG, 7)){
+	}
+}
 
-	_delay_ms(1); /* Time for tah = 13nS */
+/*
+ * Description :
+ * Return the time (Timer_getMicros) the display was valid for the first time after
+ * LCD_init, i.e. the init commands and everything queued with them were sent, 0 before
+ */
+uint32 LCD_getReadyTime(void){
+	return g_readyTime;
+}
 
-	/* Set E(Enable) High */
-	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_HIGH);
+/*
+ * Description :
+ * Return TRUE if the last LCD_init found the controller already configured
+ */
+boolean LCD_isWarmStart(void){
+	return g_warmStart;
+}
 
-	_delay_ms(1); /* Time for tpw-tdsw = 190nS */
+/*
+ * Description :
+ * Queue one transfer, start the transfers if they are stopped
+ */
+static void LCD_queueWrite(uint16 entry){
+	uint8 head = g_queueHead;
+	uint8 next = (head + 1) & (LCD_QUEUE_SIZE - 1);
+	uint8 sreg;
+
+	/* Wait for room, the step timer empties the queue (drop the entry if it never can) */
+	while(next == g_queueTail){
+		if(BIT_IS_CLEAR(SREG, 7)){
+			return;
+		}
+	}
 
-	/* Send data's (0,1,2,3) bits */
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, GET_BIT(command,0));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, GET_BIT(command,1));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, GET_BIT(command,2));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, GET_BIT(command,3));
+	g_queue[head] = entry;
+	g_queueHead = next;
 
-	_delay_ms(1); /* Time for tdsw = 100nS */
+	/* The steps run from the Timer2 interrupt, start them here when they are stopped */
+	sreg = SREG;
+	cli();
+	if(g_state == LCD_STATE_IDLE){
+		g_state = LCD_STATE_READY;
+		LCD_transferStep();
+	}
+	SREG = sreg;
+}
 
-	/* Set E(Enable) Low */
-	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
+#if(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
 
-	_delay_ms(1); /* Time for tah = 13nS */
+/*
+ * Description :
+ * Send the next queued transfer when the controller is ready
+ * and start the timer for the next step, called by the step timer
+ */
+static void LCD_transferStep(void){
+	uint16 entry;
+	uint8 value;
+	uint32 waitTime;
+
+	/* The last transfer is still executed, poll again later */
+	if((g_state == LCD_STATE_BUSY) && BIT_IS_SET(LCD_readByte(LOGIC_LOW), 7)){
+		Timer_start(g_stepTimer, TIMER_ONE_SHOT, LCD_BUSY_POLL_US);
+		return;
+	}
 
-#elif(LCD_BIT_MODE == 8)
+	if(g_queueTail == g_queueHead){
 
-	/* Send Data */
-	GPIO_writePort(LCD_DATA_PORT_ID, command);
+		/* Nothing left to send, the display is valid */
+		g_state = LCD_STATE_IDLE;
+		if(g_readyTime == 0){
+			g_readyTime = Timer_getMicros();
+		}
+		return;
+	}
+	entry = g_queue[g_queueTail];
+	g_queueTail = (g_queueTail + 1) & (LCD_QUEUE_SIZE - 1);
+	value = (uint8)entry;
 
-	_delay_ms(1); /* Time for tdsw = 100nS */
+#if(LCD_BIT_MODE == 4)
 
-	/* Set E(Enable) Low */
-	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
+	if(entry & LCD_QUEUE_SYNC_NIBBLE){
 
-	_delay_ms(1); /* Time for tah = 13nS */
+		/* Instruction Register, high nibble only, then a fixed wait without polling */
+		GPIO_writePin(LCD_RS_PORT_ID, LCD_RS_PIN_ID, LOGIC_LOW);
+		LCD_writeNibble(value);
+		g_state = LCD_STATE_READY;
+		Timer_start(g_stepTimer, TIMER_ONE_SHOT, LCD_SYNC_TIME_US);
+		return;
+	}
 
 #endif
+
+	if(entry & LCD_QUEUE_DATA){
+		LCD_writeByte(LOGIC_HIGH, value);
+		waitTime = LCD_SHORT_EXEC_US;
+	}
+	else{
+		LCD_writeByte(LOGIC_LOW, value);
+
+		/* Clear display (0x01) and return home (0x02, 0x03) are the slow instructions */
+		waitTime = ((value & 0xFC) == 0) ? LCD_LONG_EXEC_US : LCD_SHORT_EXEC_US;
+	}
+
+	/* First poll of the busy flag after the expected execution time */
+	g_state = LCD_STATE_BUSY;
+
+	Timer_start(g_stepTimer, TIMER_ONE_SHOT, waitTime);
 }
 
 /*
  * Description :
- * Display character on LCD
+ * Write one byte to the instruction (RS = 0) or data (RS = 1) register without waiting
  */
-void LCD_displayCharacter(uint8 character){
+static void LCD_writeByte(uint8 rs, uint8 value){
 
-	/* Data Register is selected */
-	GPIO_writePin(LCD_RS_PORT_ID, LCD_RS_PIN_ID, LOGIC_HIGH);
+	/* Instruction or Data Register is selected, write mode (tas = 50nS before E) */
+	GPIO_writePin(LCD_RS_PORT_ID, LCD_RS_PIN_ID, rs);
+	GPIO_writePin(LCD_RW_PORT_ID, LCD_RW_PIN_ID, LOGIC_LOW);
+
+#if(LCD_BIT_MODE == 4)
 
-	_delay_ms(1); /* Time for tas(Address Set-Up Time) = 50nS */
+	/* Send data's (4,5,6,7) bits then data's (0,1,2,3) bits (the writes take longer than tcycE = 500nS) */
+	LCD_writeNibble(value);
+	LCD_writeNibble(value<<4);
+
+#elif(LCD_BIT_MODE == 8)
 
 	/* Set E(Enable) High */
 	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_HIGH);
 
-	_delay_ms(1); /* Time for tpw-tdsw = 190nS */
+	/* Send Data */
+	GPIO_writePort(LCD_DATA_PORT_ID, value);
+
+	/* Set E(Enable) Low, the pin writes take longer than tpw = 230nS and tdsw = 80nS */
+	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
+
+#endif
+}
 
 #if(LCD_BIT_MODE == 4)
 
-	/* Send data's (4,5,6,7) bits */
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, GET_BIT(character,4));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, GET_BIT(character,5));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, GET_BIT(character,6));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, GET_BIT(character,7));
+/*
+ * Description :
+ * Write the high nibble of the value on the 4 data lines with one enable pulse
+ */
+static void LCD_writeNibble(uint8 value){
+
+	/* Set E(Enable) High */
+	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_HIGH);
 
-	_delay_ms(1); /* Time for tdsw = 100nS */
+	/* Send data's (4,5,6,7) bits */
+	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, GET_BIT(value,4));
+	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, GET_BIT(value,5));
+	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, GET_BIT(value,6));
+	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, GET_BIT(value,7));
 
-	/* Set E(Enable) Low */
+	/* Set E(Enable) Low, the pin writes take longer than tpw = 230nS and tdsw = 80nS */
 	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
+}
 
-	_delay_ms(1); /* Time for tah = 13nS */
+#endif
 
-	/* Set E(Enable) High */
+/*
+ * Description :
+ * Read one byte from the busy flag/address counter (RS = 0) or data (RS = 1) register
+ */
+static uint8 LCD_readByte(uint8 rs){
+	uint8 value;
+
+	/* The controller drives the data lines while RW is high */
+#if(LCD_BIT_MODE == 4)
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, PIN_INPUT);
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, PIN_INPUT);
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, PIN_INPUT);
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, PIN_INPUT);
+#elif(LCD_BIT_MODE == 8)
+	GPIO_setupPortDirection(LCD_DATA_PORT_ID, PORT_INPUT);
+#endif
+
+	/* Instruction or Data Register is selected, read mode */
+	GPIO_writePin(LCD_RS_PORT_ID, LCD_RS_PIN_ID, rs);
+	GPIO_writePin(LCD_RW_PORT_ID, LCD_RW_PIN_ID, LOGIC_HIGH);
+
+	/* Set E(Enable) High, the data is valid after tddr = 160nS */
 	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_HIGH);
 
-	_delay_ms(1); /* Time for tpw-tdsw = 190nS */
+#if(LCD_BIT_MODE == 4)
 
-	/* Send data's (0,1,2,3) bits */
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, GET_BIT(character,0));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, GET_BIT(character,1));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, GET_BIT(character,2));
-	GPIO_writePin(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, GET_BIT(character,3));
+	/* Read data's (4,5,6,7) bits */
+	value = (GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID)<<4)
+			| (GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID)<<5)
+			| (GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID)<<6)
+			| (GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID)<<7);
+	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
 
-	_delay_ms(1); /* Time for tdsw = 100nS */
+	/* Read data's (0,1,2,3) bits */
+	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_HIGH);
+	value |= GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID)
+			| (GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID)<<1)
+			| (GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID)<<2)
+			| (GPIO_readPin(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID)<<3);
+	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
 
-	/* Set E(Enable) Low */
+#elif(LCD_BIT_MODE == 8)
+
+	value = GPIO_readPort(LCD_DATA_PORT_ID);
 	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
 
-	_delay_ms(1); /* Time for tah = 13nS */
+#endif
 
+	/* Back to write mode */
+	GPIO_writePin(LCD_RW_PORT_ID, LCD_RW_PIN_ID, LOGIC_LOW);
+#if(LCD_BIT_MODE == 4)
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, PIN_OUTPUT);
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, PIN_OUTPUT);
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, PIN_OUTPUT);
+	GPIO_setupPinDirection(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, PIN_OUTPUT);
 #elif(LCD_BIT_MODE == 8)
+	GPIO_setupPortDirection(LCD_DATA_PORT_ID, PORT_OUTPUT);
+#endif
 
-	/* Send Data */
-	GPIO_writePort(LCD_DATA_PORT_ID, character);
+	return value;
+}
 
-	_delay_ms(1); /* Time for tdsw = 100nS */
+/*
+ * Description :
+ * Return TRUE if the controller kept its configuration and the signature in the
+ * display RAM since the last LCD_init (the MCU restarted while the LCD stayed powered)
+ */
+static boolean LCD_isConfigured(void){
+	uint8 polls = 0;
 
-	/* Set E(Enable) Low */
-	GPIO_writePin(LCD_E_PORT_ID, LCD_E_PIN_ID, LOGIC_LOW);
+	/* An unpowered controller or one in its internal reset never gives the signature */
+	if(BIT_IS_SET(LCD_readByte(LOGIC_LOW), 7)){
+		return FALSE;
+	}
 
-	_delay_ms(1); /* Time for tah = 13nS */
+	/* Address the signature, wait for the short execution time by polling */
+	LCD_writeByte(LOGIC_LOW, LCD_SIGNATURE_ADDRESS | LCD_FORCE_CURSOR_TO_BEGINNING_1ST_LINE);
+	while(BIT_IS_SET(LCD_readByte(LOGIC_LOW), 7)){
+		if(++polls == LCD_SIGNATURE_POLLS){
+			return FALSE;
+		}
+	}
+
+	/* Every data read moves the address counter to the next byte */
+	if(LCD_readByte(LOGIC_HIGH) != LCD_SIGNATURE_BYTE0){
+		return FALSE;
+	}
+
+	return (LCD_readByte(LOGIC_HIGH) == LCD_SIGNATURE_BYTE1) ? TRUE : FALSE;
+}
+
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_I2C)
+
+/*
+ * Description :
+ * Send the queued transfers that fit in one I2C transaction, called by the step
+ * timer and at the end of the last transaction
+ */
+static void LCD_transferStep(void){
+	uint16 entry;
+	uint8 value;
+	uint8 rs;
+
+	if(g_queueTail == g_queueHead){
+
+		/* Nothing left to send, the display is valid */
+		g_state = LCD_STATE_IDLE;
+		if(g_readyTime == 0){
+			g_readyTime = Timer_getMicros();
+		}
+		return;
+	}
+
+	g_batchLength = 0;
+	g_batchWait = 0;
+
+	/* Take whole LCD bytes, stop after a transfer that needs a longer wait than the bus gives */
+	while((g_queueTail != g_queueHead) && (g_batchLength <= (LCD_I2C_BATCH_SIZE - 4))){
+		entry = g_queue[g_queueTail];
+		g_queueTail = (g_queueTail + 1) & (LCD_QUEUE_SIZE - 1);
+		value = (uint8)entry;
+
+		if(entry & LCD_QUEUE_SYNC_NIBBLE){
+
+			/* Instruction Register, high nibble only, the busy flag is not valid after it */
+			LCD_addNibble(LOGIC_LOW, value);
+			g_batchWait = LCD_SYNC_TIME_US;
+			break;
+		}
+
+		rs = (entry & LCD_QUEUE_DATA) ? LOGIC_HIGH : LOGIC_LOW;
+		LCD_addNibble(rs, value);
+		LCD_addNibble(rs, value<<4);
+
+		/* Clear display (0x01) and return home (0x02, 0x03) are the slow instructions */
+		if((rs == LOGIC_LOW) && ((value & 0xFC) == 0)){
+			g_batchWait = LCD_LONG_EXEC_US;
+			break;
+		}
+	}
+
+	/* The end of the transaction sends the next step */
+	g_state = LCD_STATE_BUSY;
+	TWI_masterWrite(LCD_I2C_ADDRESS, g_batch, g_batchLength, LCD_batchDone);
+}
+
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_SPI)
+
+/*
+ * Description :
+ * Send the next queued transfer through the shift register, called by the step
+ * timer once the controller executed the last one
+ */
+static void LCD_transferStep(void){
+	uint16 entry;
+	uint8 value;
+	uint8 rs;
+
+	if(g_queueTail == g_queueHead){
+
+		/* Nothing left to send, the display is valid */
+		g_state = LCD_STATE_IDLE;
+		if(g_readyTime == 0){
+			g_readyTime = Timer_getMicros();
+		}
+		return;
+	}
+	entry = g_queue[g_queueTail];
+	g_queueTail = (g_queueTail + 1) & (LCD_QUEUE_SIZE - 1);
+	value = (uint8)entry;
+
+	g_batchLength = 0;
+	g_batchIndex = 0;
+
+	if(entry & LCD_QUEUE_SYNC_NIBBLE){
+
+		/* Instruction Register, high nibble only, the busy flag is not valid after it */
+		LCD_addNibble(LOGIC_LOW, value);
+		g_batchWait = LCD_SYNC_TIME_US;
+	}
+	else{
+		rs = (entry & LCD_QUEUE_DATA) ? LOGIC_HIGH : LOGIC_LOW;
+		LCD_addNibble(rs, value);
+		LCD_addNibble(rs, value<<4);
+
+		/* Clear display (0x01) and return home (0x02, 0x03) are the slow instructions */
+		g_batchWait = ((rs == LOGIC_LOW) && ((value & 0xFC) == 0)) ? LCD_LONG_EXEC_US : LCD_SHORT_EXEC_US;
+	}
+
+	/* The SPI interrupt latches every byte and sends the next one */
+	g_state = LCD_STATE_BUSY;
+	SPI_sendByte(g_batch[0]);
+}
+
+/*
+ * Description :
+ * End of a shift register byte: latch it to the outputs and send the next one,
+ * called from the SPI interrupt
+ */
+static void LCD_shiftDone(void){
+
+	/* Storage register clock pulse, the outputs change on its rising edge */
+	GPIO_writePin(LCD_SPI_LATCH_PORT_ID, LCD_SPI_LATCH_PIN_ID, LOGIC_HIGH);
+	GPIO_writePin(LCD_SPI_LATCH_PORT_ID, LCD_SPI_LATCH_PIN_ID, LOGIC_LOW);
+
+	if(++g_batchIndex < g_batchLength){
+		SPI_sendByte(g_batch[g_batchIndex]);
+	}
+	else{
+		LCD_batchDone(TRUE);
+	}
+}
 
 #endif
+
+#if(LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL)
+
+/*
+ * Description :
+ * Add the high nibble of the value to the transfer: the expander byte with E high
+ * then the same byte with E low
+ */
+static void LCD_addNibble(uint8 rs, uint8 value){
+
+	/* RW = 0 (write), backlight on, D7..D4 on P7..P4 */
+	uint8 outputs = (value & 0xF0) | (rs<<LCD_EXPANDER_RS_BIT) | (1<<LCD_EXPANDER_BACKLIGHT_BIT);
+
+	/* The falling edge of E latches the nibble (2 uS or more later on both buses) */
+	g_batch[g_batchLength++] = outputs | (1<<LCD_EXPANDER_E_BIT);
+	g_batch[g_batchLength++] = outputs;
 }
 
+/*
+ * Description :
+ * End of the transfer: wait if its last LCD byte needs it, else send the next one,
+ * called from the TWI or SPI interrupt
+ */
+static void LCD_batchDone(boolean ack){
+
+	/* A missing backpack does not stop the queue, the transfers are dropped */
+	(void)ack;
+
+	if(g_batchWait != 0){
+		g_state = LCD_STATE_READY;
+		Timer_start(g_stepTimer, TIMER_ONE_SHOT, g_batchWait);
+	}
+	else{
+		LCD_transferStep();
+	}
+}
+
+#endif
+
 /*
  * Description :
  * Display string(array of characters) on LCD
@@ -249,6 +779,28 @@ void LCD_displayStringRowColumn(uint8 row, uint8 col, const uint8 * character){
  */
 void LCD_clearScreen(void){
 	LCD_sendCommand(LCD_CLEAR_DISPLAY); /* Clear LCD display */
+
+	/* The clear erases the signature out of the visible columns, write it again */
+	LCD_sendCommand(LCD_SIGNATURE_ADDRESS | LCD_FORCE_CURSOR_TO_BEGINNING_1ST_LINE);
+	LCD_displayCharacter(LCD_SIGNATURE_BYTE0);
+	LCD_displayCharacter(LCD_SIGNATURE_BYTE1);
+	LCD_sendCommand(LCD_FORCE_CURSOR_TO_BEGINNING_1ST_LINE);
+}
+
+/*
+ * Description :
+ * Write the LCD_GLYPH_ROWS rows of a custom character (0..7), it is displayed by
+ * LCD_displayCharacter(index). Move the cursor before the next character.
+ */
+void LCD_setCustomCharacter(uint8 index, const uint8 * pattern){
+	uint8 row;
+
+	/* The data writes go to the character generator RAM from this address on */
+	LCD_sendCommand(LCD_SET_CGRAM_ADDRESS | ((index & (LCD_CUSTOM_CHARACTERS - 1)) * LCD_GLYPH_ROWS));
+
+	for(row = 0; row < LCD_GLYPH_ROWS; row++){
+		LCD_displayCharacter(pattern[row]);
+	}
 }
 
 /*
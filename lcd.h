@@ -18,8 +18,36 @@
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
-/* Set LCD's Bit Mode */
+/*
+ * LCD's Transport, selected at build time (-DLCD_TRANSPORT=1 for the backpack, 2 for the
+ * shift register): the HD44780 bus on the MCU pins, an I2C PCF8574 backpack on the TWI
+ * pins (PC0, PC1) or a 74HC595 shift register on the SPI pins (PB4 latch, PB5, PB7)
+ */
+#define  LCD_TRANSPORT_PARALLEL	0
+#define  LCD_TRANSPORT_I2C		1
+#define  LCD_TRANSPORT_SPI		2
+
+#ifndef LCD_TRANSPORT
+#define  LCD_TRANSPORT			LCD_TRANSPORT_PARALLEL
+#endif
+
+#if((LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL) && (LCD_TRANSPORT != LCD_TRANSPORT_I2C) && (LCD_TRANSPORT != LCD_TRANSPORT_SPI))
+
+#error "LCD transport is the parallel bus, the I2C backpack or the SPI shift register"
+
+#endif
+
+/*
+ * Set LCD's Bit Mode (-DLCD_BIT_MODE=4 leaves PA7 free on the parallel bus),
+ * the backpack and the shift register wire D7..D4 only
+ */
+#ifndef LCD_BIT_MODE
+#if(LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL)
+#define  LCD_BIT_MODE			4
+#else
 #define  LCD_BIT_MODE			8
+#endif
+#endif
 
 #if((LCD_BIT_MODE != 4) && (LCD_BIT_MODE != 8))
 
@@ -27,6 +55,24 @@
 
 #endif
 
+#if((LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL) && (LCD_BIT_MODE != 4))
+
+#error "The LCD backpack and shift register wire D7..D4 only, 4 bits mode"
+
+#endif
+
+/* Panel size: 16x2 or 16x4 (LCD_moveCursor has the row addresses of both) */
+#define  LCD_ROWS				2
+#define  LCD_COLUMNS			16
+
+#if((LCD_ROWS != 1) && (LCD_ROWS != 2) && (LCD_ROWS != 4))
+
+#error "LCD panels have 1, 2 or 4 rows"
+
+#endif
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
+
 /* LCD's RS Configuration */
 #define  LCD_RS_PORT_ID 		PORTB_ID
 #define  LCD_RS_PIN_ID 			PIN0_ID
@@ -52,6 +98,103 @@
 
 #endif
 
+#else
+
+/*
+ * Outputs of the PCF8574 (P7..P0) or of the 74HC595 (Q7..Q0), the usual backpack wiring:
+ * D7..D4 are on bits 7..4, RW stays low (the transfers never read the controller)
+ */
+#define  LCD_EXPANDER_RS_BIT		0
+#define  LCD_EXPANDER_RW_BIT		1
+#define  LCD_EXPANDER_E_BIT			2
+#define  LCD_EXPANDER_BACKLIGHT_BIT	3
+
+#endif
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_I2C)
+
+/* 7-bit address of the PCF8574 (0x20..0x27, 0x38..0x3F for the PCF8574A) */
+#define  LCD_I2C_ADDRESS		0x27
+
+/* SCL frequency, the PCF8574 is specified up to 100 kHz */
+#define  LCD_I2C_BIT_RATE		100000UL
+
+/*
+ * Expander bytes of one I2C transaction: every LCD byte is 4 of them (both nibbles with
+ * E high then E low). At 100 kHz a byte takes 9 SCL periods, so a character costs 36 periods
+ * = 360 uS on the bus and 4 TWI interrupts; a transaction adds its START, address and STOP
+ * (about 11 periods). The 37 uS execution time always ends before the next nibble, the
+ * busy flag is never polled. 32 bytes = 8 characters per transaction.
+ */
+#define  LCD_I2C_BATCH_SIZE		32
+
+#if((LCD_I2C_BATCH_SIZE < 4) || (LCD_I2C_BATCH_SIZE > 255))
+
+#error "LCD I2C batch size must be 4 to 255 expander bytes (1 to 63 LCD bytes)"
+
+#endif
+
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_SPI)
+
+/* Storage register clock (RCLK) of the 74HC595, the SS pin stays an output in master mode */
+#define  LCD_SPI_LATCH_PORT_ID	PORTB_ID
+#define  LCD_SPI_LATCH_PIN_ID	PIN4_ID
+
+/*
+ * SCK frequency: at F_CPU/2 a byte takes 16 CPU cycles (2 uS at 8 MHz). Every LCD byte is
+ * 4 shift register bytes (both nibbles with E high then E low), each one latched from the
+ * SPI interrupt, then the step timer waits the execution time (the busy flag can not be
+ * read back): about 10 uS of transfer and 40 uS of wait per character
+ */
+#define  LCD_SPI_CLOCK			SPI_F_CPU_2
+
+#endif
+
+/* Size of the transfer queue in entries, must be a power of 2 and at most 128 */
+#define  LCD_QUEUE_SIZE			64
+
+#if((LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE - 1)) != 0) || (LCD_QUEUE_SIZE > 128)
+
+#error "LCD queue size must be a power of 2 and at most 128"
+
+#endif
+
+/*
+ * Flags of the queue entries: written to the data register, or only the high nibble
+ * is written (4-bit mode synchronization) and followed by a fixed wait
+ */
+#define  LCD_QUEUE_DATA			0x100
+#define  LCD_QUEUE_SYNC_NIBBLE	0x200
+
+/* Time the LCD needs to get powered up in micro seconds */
+#define  LCD_POWER_UP_TIME_US	20000
+
+/* Wait after the 4-bit synchronization nibbles, the busy flag is not valid during them */
+#define  LCD_SYNC_TIME_US		4100
+
+/* First poll of the busy flag after a transfer (execution time 37 uS, 1.52 mS for clear/home) */
+#define  LCD_SHORT_EXEC_US		40
+#define  LCD_LONG_EXEC_US		1600
+
+/* Next polls of the busy flag while it is set */
+#define  LCD_BUSY_POLL_US		20
+
+/*
+ * Signature written by LCD_init and LCD_clearScreen in two display RAM bytes out of the
+ * visible 16 columns, LCD_init skips the power up and the mode commands if it reads it back
+ */
+#define  LCD_SIGNATURE_ADDRESS	0x26
+#define  LCD_SIGNATURE_BYTE0	0x5A
+#define  LCD_SIGNATURE_BYTE1	0xA5
+
+/* Busy flag polls (a few uS each) LCD_init waits for the address of the signature */
+#define  LCD_SIGNATURE_POLLS	50
+
+/* Custom characters (CGRAM): 8 glyphs of 8 rows, 5 pixels per row (bit 4 is the left one) */
+#define  LCD_CUSTOM_CHARACTERS	8
+#define  LCD_GLYPH_ROWS			8
+#define  LCD_GLYPH_COLUMNS		5
+
 /* LCD's Commands */
 #define  LCD_CLEAR_DISPLAY		 					0x01
 #define  LCD_RETURN_HOME		 					0x02
@@ -68,12 +211,15 @@
 #define  LCD_SHIFT_CURSOR_POSITION_RIGHT			0x14
 #define  LCD_SHIFT_ENTIRE_DISPLAY_LEFT 				0x18
 #define  LCD_SHIFT_ENTIRE_DISPLAY_RIGTH				0x1C
+#define  LCD_SET_CGRAM_ADDRESS						0x40
 #define  LCD_FORCE_CURSOR_TO_BEGINNING_1ST_LINE		0x80
 #define  LCD_FORCE_CURSOR_TO_BEGINNING_2ND_LINE		0xC0
 #define  LCD_TWO_LINES_EIGHT_BITS_MODE				0x38
 #define  LCD_TWO_LINES_FOUR_BITS_MODE				0x28
 #define  LCD_TWO_LINES_FOUR_BITS_MODE_INIT1   		0x33
 #define  LCD_TWO_LINES_FOUR_BITS_MODE_INIT2   		0x32
+#define  LCD_EIGHT_BITS_MODE_NIBBLE					0x30
+#define  LCD_FOUR_BITS_MODE_NIBBLE					0x20
 
 
 /*******************************************************************************
@@ -83,23 +229,51 @@
 /*
  * Description :
  * Initialize the LCD :
- * 1. Setting LCD Pins as Output by GPIO Driver
+ * 1. Setting LCD Pins as Output by GPIO Driver (or the TWI/SPI master of the serial transports)
  * 2. Setting the LCD to 4-bit or 8-bit mode
+ * The commands are queued, they are sent once the global interrupts are enabled.
+ * If the controller is still configured (the MCU restarted while the LCD stayed powered)
+ * the power up wait and the mode commands are skipped, only the display is cleared
+ * (the serial transports can not read back, they always get the full init).
  */
 void LCD_init(void);
 
 /*
  * Description :
  * Send Command to LCD
+ * (queued and sent from the Timer2 interrupt when the busy flag is clear, or from the
+ * TWI/SPI interrupt of the serial transports, it waits only when the queue is full)
  */
 void LCD_sendCommand(uint8 command);
 
 /*
  * Description :
  * Display character on LCD
+ * (queued and sent from the Timer2 interrupt when the busy flag is clear, or from the
+ * TWI/SPI interrupt of the serial transports, it waits only when the queue is full)
  */
 void LCD_displayCharacter(uint8 character);
 
+/*
+ * Description :
+ * Wait until all the queued transfers are sent
+ * (return at once if the global interrupts are disabled)
+ */
+void LCD_flush(void);
+
+/*
+ * Description :
+ * Return the time (Timer_getMicros) the display was valid for the first time after
+ * LCD_init, i.e. the init commands and everything queued with them were sent, 0 before
+ */
+uint32 LCD_getReadyTime(void);
+
+/*
+ * Description :
+ * Return TRUE if the last LCD_init found the controller already configured
+ */
+boolean LCD_isWarmStart(void);
+
 /*
  * Description :
  * Display string(array of characters) on LCD
@@ -130,4 +304,11 @@ void LCD_clearScreen(void);
  */
 void LCD_integerToString(int num);
 
+/*
+ * Description :
+ * Write the LCD_GLYPH_ROWS rows of a custom character (0..7), it is displayed by
+ * LCD_displayCharacter(index). Move the cursor before the next character.
+ */
+void LCD_setCustomCharacter(uint8 index, const uint8 * pattern);
+
 #endif /* LCD_H_ */
@@ -0,0 +1,173 @@
+ /******************************************************************************
+ *
+ * Module: PERF
+ *
+ * File Name: perf.c
+ *
+ * Description: Source file for the run time performance counters
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "perf.h"
+#include "seqlock.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Statistics of all metrics (fixed RAM footprint) */
+static volatile Perf_MetricType g_metrics[PERF_NUM_OF_METRICS];
+
+/* Sequence counters protecting every metric against torn reads */
+static Seqlock_Type g_metricLocks[PERF_NUM_OF_METRICS];
+
+/* Event counters, 16-bit so they are protected by the same way */
+static volatile uint16 g_counters[PERF_NUM_OF_COUNTERS];
+
+/* Sequence counters protecting every event counter against torn reads */
+static Seqlock_Type g_counterLocks[PERF_NUM_OF_COUNTERS];
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Clear all metrics and counters
+ */
+void Perf_reset(void){
+	uint8 i;
+	uint8 bin;
+
+	for(i = 0; i < PERF_NUM_OF_METRICS; i++){
+		Seqlock_writeBegin(&g_metricLocks[i]);
+		g_metrics[i].min = 0;
+		g_metrics[i].max = 0;
+		g_metrics[i].sum = 0;
+		g_metrics[i].count = 0;
+		for(bin = 0; bin < PERF_HISTOGRAM_BINS; bin++){
+			g_metrics[i].histogram[bin] = 0;
+		}
+		Seqlock_writeEnd(&g_metricLocks[i]);
+	}
+
+	for(i = 0; i < PERF_NUM_OF_COUNTERS; i++){
+		Seqlock_writeBegin(&g_counterLocks[i]);
+		g_counters[i] = 0;
+		Seqlock_writeEnd(&g_counterLocks[i]);
+	}
+}
+
+/*
+ * Description :
+ * Add one duration (in Timer1 ticks) to a metric,
+ * a metric must be recorded from one context only (the main loop or one ISR)
+ */
+void Perf_record(Perf_MetricIdType metric, uint32 ticks){
+	volatile Perf_MetricType * metric_ptr;
+	uint32 range = ticks;
+	uint8 bin = 0;
+
+	if(metric >= PERF_NUM_OF_METRICS){
+		return;
+	}
+
+	metric_ptr = &g_metrics[metric];
+
+	/* Find the histogram bin: divide by 8 until the duration fits in the first bin */
+	while((range >= 8) && (bin < (PERF_HISTOGRAM_BINS - 1))){
+		range >>= 3;
+		bin++;
+	}
+
+	Seqlock_writeBegin(&g_metricLocks[metric]);
+
+	if((metric_ptr->count == 0) || (ticks < metric_ptr->min)){
+		metric_ptr->min = ticks;
+	}
+	if(ticks > metric_ptr->max){
+		metric_ptr->max = ticks;
+	}
+
+	/* Halve the sum and the count before any of them overflows, the mean stays the same */
+	if((metric_ptr->count == 0xFFFF) || (metric_ptr->sum > (0xFFFFFFFF - ticks))){
+		metric_ptr->sum >>= 1;
+		metric_ptr->count >>= 1;
+	}
+	metric_ptr->sum += ticks;
+	metric_ptr->count++;
+
+	if(metric_ptr->histogram[bin] != 0xFFFF){
+		metric_ptr->histogram[bin]++;
+	}
+
+	Seqlock_writeEnd(&g_metricLocks[metric]);
+}
+
+/*
+ * Description :
+ * Increment an event counter (saturates at 65535),
+ * a counter must be incremented from one context only (the main loop or one ISR)
+ */
+void Perf_count(Perf_CounterIdType counter){
+
+	if((counter < PERF_NUM_OF_COUNTERS) && (g_counters[counter] != 0xFFFF)){
+		Seqlock_writeBegin(&g_counterLocks[counter]);
+		g_counters[counter]++;
+		Seqlock_writeEnd(&g_counterLocks[counter]);
+	}
+}
+
+/*
+ * Description :
+ * Copy the statistics of a metric, the copy is consistent even if it is recorded by an ISR
+ */
+void Perf_getMetric(Perf_MetricIdType metric, Perf_MetricType * metric_ptr){
+	uint8 sequence;
+
+	if(metric >= PERF_NUM_OF_METRICS){
+		return;
+	}
+
+	/* Copy again if the metric was recorded during the copy */
+	do{
+		sequence = Seqlock_readBegin(&g_metricLocks[metric]);
+		*metric_ptr = g_metrics[metric];
+	}while(Seqlock_readRetry(&g_metricLocks[metric], sequence));
+}
+
+/*
+ * Description :
+ * Return the mean duration of a metric copy in Timer1 ticks (0 if nothing was recorded)
+ */
+uint32 Perf_getMean(const Perf_MetricType * metric_ptr){
+
+	if(metric_ptr->count == 0){
+		return 0;
+	}
+
+	return (metric_ptr->sum / metric_ptr->count);
+}
+
+/*
+ * Description :
+ * Return the value of an event counter
+ */
+uint16 Perf_getCounter(Perf_CounterIdType counter){
+	uint16 value;
+	uint8 sequence;
+
+	if(counter >= PERF_NUM_OF_COUNTERS){
+		return 0;
+	}
+
+	/* Copy again if the counter was incremented during the copy */
+	do{
+		sequence = Seqlock_readBegin(&g_counterLocks[counter]);
+		value = g_counters[counter];
+	}while(Seqlock_readRetry(&g_counterLocks[counter], sequence));
+
+	return value;
+}
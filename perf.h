@@ -0,0 +1,131 @@
+ /******************************************************************************
+ *
+ * Module: PERF
+ *
+ * File Name: perf.h
+ *
+ * Description: Header file for the run time performance counters
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef PERF_H_
+#define PERF_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Set to FALSE to remove all the instrumentation from the build */
+#ifndef PERF_ENABLE
+#define PERF_ENABLE				TRUE
+#endif
+
+/* Durations are measured in Timer1 ticks, one tick is PERF_CYCLES_PER_TICK CPU cycles (F_CPU/8) */
+#define PERF_CYCLES_PER_TICK	8
+
+/*
+ * Number of histogram bins of every metric,
+ * bin 0 counts durations of 0..7 ticks and every next bin covers 8 times the range of the one before:
+ * bin i counts durations of [8^i, 8^(i+1)) ticks, the last bin also counts all the longer ones
+ */
+#define PERF_HISTOGRAM_BINS		8
+
+#if(PERF_ENABLE == TRUE)
+
+#include "icu.h"
+
+/* Take the start time stamp of a measured section into a new local variable */
+#define PERF_BEGIN(start)			uint32 start = ICU_getTimestamp()
+
+/* Record the duration of a measured section started by PERF_BEGIN */
+#define PERF_END(metric, start)		Perf_record((metric), ICU_getTimestamp() - (start))
+
+/* Count one event */
+#define PERF_COUNT(counter)			Perf_count(counter)
+
+#else
+
+#define PERF_BEGIN(start)
+#define PERF_END(metric, start)
+#define PERF_COUNT(counter)
+
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* enum for the measured durations */
+typedef enum{
+	PERF_METRIC_ICU_ISR,			/* TIMER1_CAPT_vect entry to exit */
+	PERF_METRIC_TRIGGER_TO_RESULT,	/* Trigger pulse to echo measured */
+	PERF_METRIC_LCD,				/* One LCD command/character call (queueing it) */
+	PERF_METRIC_MAIN_LOOP,			/* One main loop iteration */
+	PERF_METRIC_TRILATERATION,		/* One position solved from a pair of distances */
+	PERF_NUM_OF_METRICS
+}Perf_MetricIdType;
+
+/* enum for the counted events */
+typedef enum{
+	PERF_COUNTER_MISSED,			/* The sensor saw no object (maximum echo pulse) */
+	PERF_COUNTER_TIMEOUT,			/* No echo pulse at all */
+	PERF_COUNTER_GLITCH,			/* Edge rejected by the ICU */
+	PERF_NUM_OF_COUNTERS
+}Perf_CounterIdType;
+
+/* Structure that holds the statistics of one metric (durations in Timer1 ticks) */
+typedef struct{
+	uint32 min;
+	uint32 max;
+	uint32 sum;			/* Sum of the last count durations, both are halved before they overflow */
+	uint16 count;
+	uint16 histogram[PERF_HISTOGRAM_BINS];
+}Perf_MetricType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Clear all metrics and counters
+ */
+void Perf_reset(void);
+
+/*
+ * Description :
+ * Add one duration (in Timer1 ticks) to a metric,
+ * a metric must be recorded from one context only (the main loop or one ISR)
+ */
+void Perf_record(Perf_MetricIdType metric, uint32 ticks);
+
+/*
+ * Description :
+ * Increment an event counter (saturates at 65535),
+ * a counter must be incremented from one context only (the main loop or one ISR)
+ */
+void Perf_count(Perf_CounterIdType counter);
+
+/*
+ * Description :
+ * Copy the statistics of a metric, the copy is consistent even if it is recorded by an ISR
+ */
+void Perf_getMetric(Perf_MetricIdType metric, Perf_MetricType * metric_ptr);
+
+/*
+ * Description :
+ * Return the mean duration of a metric copy in Timer1 ticks (0 if nothing was recorded)
+ */
+uint32 Perf_getMean(const Perf_MetricType * metric_ptr);
+
+/*
+ * Description :
+ * Return the value of an event counter
+ */
+uint16 Perf_getCounter(Perf_CounterIdType counter);
+
+#endif /* PERF_H_ */
@@ -0,0 +1,218 @@
+ /******************************************************************************
+ *
+ * Module: REGMAP
+ *
+ * File Name: regmap.c
+ *
+ * Description: Source file for the register map read by a TWI master
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "regmap.h"
+#include "twi.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Copies of the measurement registers: the newest, the one read by the ISR and a free one */
+#define REGMAP_COPIES		3
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/*
+ * Measurement registers. Regmap_publish is the only writer of g_newest and the ISR the only
+ * writer of g_reading, which is always an old or the current value of g_newest, so the copy
+ * that is neither of them can be written while a read goes on (both are 8-bit, no locking)
+ */
+static uint8 g_copies[REGMAP_COPIES][REGMAP_CONFIG_OFFSET];
+static volatile uint8 g_newest = 0;
+static volatile uint8 g_reading = 0;
+
+/* Configuration registers and whether the master wrote them */
+static volatile uint8 g_config[REGMAP_SIZE - REGMAP_CONFIG_OFFSET];
+static volatile boolean g_configChanged = FALSE;
+
+/* Sequence of the next published measurement */
+static uint8 g_sequence = 0;
+
+/* Register pointer and whether the next written byte sets it */
+static volatile uint8 g_pointer = 0;
+static volatile boolean g_pointerNext = FALSE;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+static void Regmap_start(boolean read);
+static void Regmap_receive(uint8 data);
+static uint8 Regmap_transmit(void);
+static void Regmap_stop(void);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the register map with the configuration registers and answer
+ * the TWI master at REGMAP_SLAVE_ADDRESS
+ */
+void Regmap_init(const Regmap_ConfigType * config_ptr){
+
+	Twi_SlaveConfigType twiConfig = {REGMAP_SLAVE_ADDRESS, FALSE};
+	Twi_SlaveCallBacksType callBacks = {Regmap_start, Regmap_receive, Regmap_transmit, Regmap_stop};
+	uint8 i;
+
+	/* Empty measurement registers */
+	for(i = 0; i < REGMAP_COPIES; i++){
+		g_copies[i][REGMAP_ID_OFFSET] = REGMAP_DEVICE_ID;
+	}
+	g_newest = 0;
+	g_reading = 0;
+	g_sequence = 0;
+
+	g_config[REGMAP_FILTER_SHIFT_OFFSET - REGMAP_CONFIG_OFFSET] = config_ptr->filterShift;
+	g_configChanged = FALSE;
+
+	TWI_setSlaveCallBacks(&callBacks);
+	TWI_initSlave(&twiConfig);
+}
+
+/*
+ * Description :
+ * Publish a measurement without waiting: the registers are written in a free copy
+ * while a read transaction may go on from another one, the next read gets the new copy
+ */
+void Regmap_publish(const Regmap_DataType * data_ptr){
+
+	uint8 newest = g_newest;
+	uint8 reading = g_reading;
+	uint8 * copy_ptr;
+	uint8 free;
+
+	for(free = 0; (free == newest) || (free == reading); free++){
+	}
+	copy_ptr = g_copies[free];
+
+	copy_ptr[REGMAP_SEQUENCE_OFFSET] = g_sequence++;
+	copy_ptr[REGMAP_STATUS_OFFSET] = (uint8)data_ptr->status;
+	copy_ptr[REGMAP_FILTERED_OFFSET] = (uint8)(data_ptr->filteredDistance);
+	copy_ptr[REGMAP_FILTERED_OFFSET + 1] = (uint8)(data_ptr->filteredDistance>>8);
+	copy_ptr[REGMAP_DISTANCE_OFFSET] = (uint8)(data_ptr->distance);
+	copy_ptr[REGMAP_DISTANCE_OFFSET + 1] = (uint8)(data_ptr->distance>>8);
+	copy_ptr[REGMAP_TIMESTAMP_OFFSET] = (uint8)(data_ptr->timestamp);
+	copy_ptr[REGMAP_TIMESTAMP_OFFSET + 1] = (uint8)(data_ptr->timestamp>>8);
+	copy_ptr[REGMAP_TIMESTAMP_OFFSET + 2] = (uint8)(data_ptr->timestamp>>16);
+	copy_ptr[REGMAP_TIMESTAMP_OFFSET + 3] = (uint8)(data_ptr->timestamp>>24);
+	copy_ptr[REGMAP_VALID_OFFSET] = (uint8)(data_ptr->validCount);
+	copy_ptr[REGMAP_VALID_OFFSET + 1] = (uint8)(data_ptr->validCount>>8);
+	copy_ptr[REGMAP_NO_ECHO_OFFSET] = (uint8)(data_ptr->noEchoCount);
+	copy_ptr[REGMAP_NO_ECHO_OFFSET + 1] = (uint8)(data_ptr->noEchoCount>>8);
+	copy_ptr[REGMAP_TIMEOUT_OFFSET] = (uint8)(data_ptr->timeoutCount);
+	copy_ptr[REGMAP_TIMEOUT_OFFSET + 1] = (uint8)(data_ptr->timeoutCount>>8);
+	copy_ptr[REGMAP_GLITCH_OFFSET] = (uint8)(data_ptr->glitchCount);
+	copy_ptr[REGMAP_GLITCH_OFFSET + 1] = (uint8)(data_ptr->glitchCount>>8);
+
+	/* The next read transaction starts from this copy */
+	g_newest = free;
+}
+
+/*
+ * Description :
+ * Copy the configuration registers, return TRUE if the master wrote them since the last call
+ */
+boolean Regmap_getConfig(Regmap_ConfigType * config_ptr){
+
+	/* Status register of the caller */
+	uint8 sreg = SREG;
+
+	boolean changed;
+
+	/* A write of the TWI interrupt between the test and the clear would be lost */
+	cli();
+	changed = g_configChanged;
+	g_configChanged = FALSE;
+	config_ptr->filterShift = g_config[REGMAP_FILTER_SHIFT_OFFSET - REGMAP_CONFIG_OFFSET];
+	SREG = sreg;
+
+	return changed;
+}
+
+/*
+ * Description :
+ * Write the configuration registers with the one in use (changed by another path than the
+ * TWI master), Regmap_getConfig does not report it as a change
+ */
+void Regmap_setConfig(const Regmap_ConfigType * config_ptr){
+
+	/* Single byte register, written by the TWI interrupt too */
+	g_config[REGMAP_FILTER_SHIFT_OFFSET - REGMAP_CONFIG_OFFSET] = config_ptr->filterShift;
+}
+
+/*
+ * Description :
+ * TWI call back: a transaction starts, a read latches the newest copy until its end
+ */
+static void Regmap_start(boolean read){
+	if(read == TRUE){
+		g_reading = g_newest;
+	}
+	else{
+		g_pointerNext = TRUE;
+	}
+}
+
+/*
+ * Description :
+ * TWI call back: the first byte written sets the register pointer, the next ones write
+ * the configuration registers (the others are read only)
+ */
+static void Regmap_receive(uint8 data){
+	if(g_pointerNext == TRUE){
+		g_pointer = data;
+		g_pointerNext = FALSE;
+		return;
+	}
+
+	if((g_pointer >= REGMAP_CONFIG_OFFSET) && (g_pointer < REGMAP_SIZE)){
+		g_config[g_pointer - REGMAP_CONFIG_OFFSET] = data;
+		g_configChanged = TRUE;
+	}
+	g_pointer++;
+}
+
+/*
+ * Description :
+ * TWI call back: next byte read by the master
+ */
+static uint8 Regmap_transmit(void){
+	uint8 data;
+
+	if(g_pointer < REGMAP_CONFIG_OFFSET){
+		data = g_copies[g_reading][g_pointer];
+	}
+	else if(g_pointer < REGMAP_SIZE){
+		data = g_config[g_pointer - REGMAP_CONFIG_OFFSET];
+	}
+	else{
+		return REGMAP_UNUSED_VALUE;
+	}
+	g_pointer++;
+
+	return data;
+}
+
+/*
+ * Description :
+ * TWI call back: end of the transaction
+ */
+static void Regmap_stop(void){
+	g_pointerNext = FALSE;
+}
@@ -0,0 +1,116 @@
+ /******************************************************************************
+ *
+ * Module: REGMAP
+ *
+ * File Name: regmap.h
+ *
+ * Description: Header file for the register map read by a TWI master
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef REGMAP_H_
+#define REGMAP_H_
+
+#include "std_types.h"
+#include "ultrasonic.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* TWI slave address of this node, one per node on the bus */
+#define REGMAP_SLAVE_ADDRESS			0x30
+
+/* Value of the identification register */
+#define REGMAP_DEVICE_ID				0xD1
+
+/*
+ * Register layout, all multi-byte registers are little endian. A write transaction
+ * sets the register pointer with its first byte then writes from it, a read transaction
+ * reads from the register pointer, the pointer increments after every byte so the whole
+ * map is read in one transaction. The measurement registers of one read always come from
+ * the same measurement.
+ * 0x00 : identification (REGMAP_DEVICE_ID)
+ * 0x01 : sequence, incremented for every published measurement
+ * 0x02 : status of the last measurement (Ultrasonic_StatusType)
+ * 0x03 : filtered distance in cm, 2 bytes
+ * 0x05 : last distance in cm, 2 bytes
+ * 0x07 : time stamp of the last measurement, 4 bytes (ICU ticks = micro seconds)
+ * 0x0B : valid measurements, 2 bytes
+ * 0x0D : no echo measurements, 2 bytes
+ * 0x0F : timeouts, 2 bytes
+ * 0x11 : ICU glitches, 2 bytes
+ * 0x13 : filter shift (read/write configuration)
+ */
+#define REGMAP_ID_OFFSET				0x00
+#define REGMAP_SEQUENCE_OFFSET			0x01
+#define REGMAP_STATUS_OFFSET			0x02
+#define REGMAP_FILTERED_OFFSET			0x03
+#define REGMAP_DISTANCE_OFFSET			0x05
+#define REGMAP_TIMESTAMP_OFFSET			0x07
+#define REGMAP_VALID_OFFSET				0x0B
+#define REGMAP_NO_ECHO_OFFSET			0x0D
+#define REGMAP_TIMEOUT_OFFSET			0x0F
+#define REGMAP_GLITCH_OFFSET			0x11
+#define REGMAP_CONFIG_OFFSET			0x13
+#define REGMAP_FILTER_SHIFT_OFFSET		0x13
+#define REGMAP_SIZE						0x14
+
+/* Read beyond the map */
+#define REGMAP_UNUSED_VALUE				0xFF
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds the measurement registers */
+typedef struct{
+	uint32 timestamp;
+	uint16 filteredDistance;
+	uint16 distance;
+	uint16 validCount;
+	uint16 noEchoCount;
+	uint16 timeoutCount;
+	uint16 glitchCount;
+	Ultrasonic_StatusType status;
+}Regmap_DataType;
+
+/* Structure that holds the configuration registers */
+typedef struct{
+	uint8 filterShift;
+}Regmap_ConfigType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the register map with the configuration registers and answer
+ * the TWI master at REGMAP_SLAVE_ADDRESS
+ */
+void Regmap_init(const Regmap_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Publish a measurement without waiting: the registers are written in a free copy
+ * while a read transaction may go on from another one, the next read gets the new copy
+ */
+void Regmap_publish(const Regmap_DataType * data_ptr);
+
+/*
+ * Description :
+ * Copy the configuration registers, return TRUE if the master wrote them since the last call
+ */
+boolean Regmap_getConfig(Regmap_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Write the configuration registers with the one in use (changed by another path than the
+ * TWI master), Regmap_getConfig does not report it as a change
+ */
+void Regmap_setConfig(const Regmap_ConfigType * config_ptr);
+
+#endif /* REGMAP_H_ */
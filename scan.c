@@ -0,0 +1,228 @@
+ /******************************************************************************
+ *
+ * Module: SCAN
+ *
+ * File Name: scan.c
+ *
+ * Description: Source file for the servo sweep that turns the distance reader into a
+ *              scanner with a polar range map
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "scan.h"
+#include "servo.h"
+#include "icu.h"
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+typedef enum{
+	SCAN_STATE_IDLE,		/* Not initialized */
+	SCAN_STATE_SETTLING,	/* Result stored, the next trigger is to be scheduled */
+	SCAN_STATE_TRIGGER,		/* Trigger scheduled at the angle of the echo point */
+	SCAN_STATE_ECHO			/* Trigger sent, the servo turns to the next angle */
+}Scan_StateType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static const Scan_ConfigType * g_config_ptr = NULL_PTR;
+static Scan_StateType g_state = SCAN_STATE_IDLE;
+
+/* Polar range map in cm, one point per step from the first angle */
+static uint16 g_ranges[SCAN_MAX_POINTS];
+static uint8 g_numOfPoints = 0;
+
+/* Point the servo turns to, point of the ping in flight and the direction of the sweep */
+static uint8 g_servoPoint = 0;
+static uint8 g_echoPoint = 0;
+static boolean g_forward = TRUE;
+
+/* ICU time stamps: the servo has settled, trigger of the last ping, start of the sweep */
+static uint32 g_readyTime = 0;
+static uint32 g_triggerTime = 0;
+static uint32 g_sweepStart = 0;
+static boolean g_sweepStarted = FALSE;
+
+static Scan_StatsType g_stats = {0, 0, 0, 0, 0};
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+static void Scan_moveServo(uint8 point, uint8 degrees);
+static void Scan_nextPoint(void);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the sweep (configuration kept by pointer, it must stay valid): clear the map
+ * and turn the servo to the first angle. Return FALSE if the angles are out of order,
+ * the step is 0 or the range has less than two points (the sweep turns back at both ends)
+ * or more than SCAN_MAX_POINTS points.
+ * The servo must be initialized (Servo_init).
+ */
+boolean Scan_init(const Scan_ConfigType * config_ptr){
+	uint8 point;
+
+	if((config_ptr->step == 0) || (config_ptr->firstAngle >= config_ptr->lastAngle)
+			|| ((config_ptr->lastAngle - config_ptr->firstAngle) < config_ptr->step)
+			|| (config_ptr->lastAngle > SERVO_MAX_ANGLE)
+			|| (((config_ptr->lastAngle - config_ptr->firstAngle) / config_ptr->step) >= SCAN_MAX_POINTS)){
+		return FALSE;
+	}
+
+	g_config_ptr = config_ptr;
+	g_numOfPoints = (uint8)((config_ptr->lastAngle - config_ptr->firstAngle) / config_ptr->step + 1);
+	for(point = 0; point < g_numOfPoints; point++){
+		g_ranges[point] = SCAN_NO_RANGE;
+	}
+	g_stats = (Scan_StatsType){0, 0, 0, 0, 0};
+	g_forward = TRUE;
+	g_sweepStarted = FALSE;
+
+	/* The servo may be anywhere: allow a turn over its whole range */
+	Scan_moveServo(0, SERVO_MAX_ANGLE);
+	g_triggerTime = ICU_getTimestamp() - ULTRASONIC_PING_SPACING_TICKS;
+	g_state = SCAN_STATE_SETTLING;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Run the sweep, called periodically in place of the pings:
+ * 1. Once the last result is stored, schedule the next trigger for when the servo has
+ *    settled and the echoes of the last ping died out (Ultrasonic_startMeasurementAt)
+ * 2. Once that trigger pulse is out, turn the servo to the next angle while the echo
+ *    is in flight, the sweep turns back at both ends of the range
+ */
+void Scan_update(void){
+	uint32 spacing;
+
+	if(g_state == SCAN_STATE_SETTLING){
+
+		/* Signed: whichever comes last of the settled servo and the ping spacing */
+		spacing = g_triggerTime + ULTRASONIC_PING_SPACING_TICKS;
+		g_triggerTime = ((sint32)(spacing - g_readyTime) > 0) ? spacing : g_readyTime;
+		g_echoPoint = g_servoPoint;
+		Ultrasonic_startMeasurementAt(g_triggerTime);
+		g_state = SCAN_STATE_TRIGGER;
+	}
+	else if(g_state == SCAN_STATE_TRIGGER){
+		if((sint32)(ICU_getTimestamp() - g_triggerTime) >= 0){
+			Scan_nextPoint();
+			g_state = SCAN_STATE_ECHO;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Store the result of the ping in flight (given by Ultrasonic_update and Ultrasonic_getResult)
+ * at its angle in the map, return TRUE with its point. Every result must be given, the next
+ * ping waits for it.
+ */
+boolean Scan_addResult(const Ultrasonic_ResultType * result_ptr, uint8 * point_ptr){
+	uint32 sweepTicks;
+
+	if(g_state == SCAN_STATE_TRIGGER){
+
+		/* The echo came back before Scan_update saw the trigger */
+		Scan_nextPoint();
+	}
+	else if(g_state != SCAN_STATE_ECHO){
+		return FALSE;
+	}
+
+	if(result_ptr->status == ULTRASONIC_STATUS_OK){
+		g_ranges[g_echoPoint] = result_ptr->distance;
+	}
+	else{
+		g_ranges[g_echoPoint] = SCAN_NO_RANGE;
+		g_stats.missed++;
+	}
+	g_stats.points++;
+	*point_ptr = g_echoPoint;
+
+	/* A sweep goes from one end of the range to the other, timed from trigger to trigger */
+	if((g_echoPoint == 0) || (g_echoPoint == (g_numOfPoints - 1))){
+		if(g_sweepStarted){
+			sweepTicks = g_triggerTime - g_sweepStart;
+			g_stats.sweeps++;
+			g_stats.sweepTime = (uint16)(sweepTicks / 1000UL);
+			g_stats.pointRate = (uint16)(((uint32)(g_numOfPoints - 1) * 10000000UL + sweepTicks / 2) / sweepTicks);
+		}
+		g_sweepStart = g_triggerTime;
+		g_sweepStarted = TRUE;
+	}
+
+	g_state = SCAN_STATE_SETTLING;
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of points of the map
+ */
+uint8 Scan_getNumOfPoints(void){
+	return g_numOfPoints;
+}
+
+/*
+ * Description :
+ * Return the angle of a point of the map in degrees
+ */
+uint8 Scan_getAngle(uint8 point){
+	return (uint8)(g_config_ptr->firstAngle + point * g_config_ptr->step);
+}
+
+/*
+ * Description :
+ * Return the range of a point of the map in cm (SCAN_NO_RANGE without a valid echo)
+ */
+uint16 Scan_getRange(uint8 point){
+	return (point < g_numOfPoints) ? g_ranges[point] : SCAN_NO_RANGE;
+}
+
+/*
+ * Description :
+ * Copy the counts and the rate of the sweep
+ */
+void Scan_getStats(Scan_StatsType * stats_ptr){
+	*stats_ptr = g_stats;
+}
+
+/*
+ * Description :
+ * Turn the servo to a point and compute when it has settled there: the new pulse goes out
+ * at the next frame at the latest, then the horn turns the given degrees and settles
+ */
+static void Scan_moveServo(uint8 point, uint8 degrees){
+	Servo_setAngle(Scan_getAngle(point));
+	g_servoPoint = point;
+	g_readyTime = ICU_getTimestamp() + SERVO_PERIOD_US + SERVO_MAX_PULSE_US
+			+ (uint32)degrees * SCAN_SERVO_US_PER_DEGREE + SCAN_SETTLE_US;
+}
+
+/*
+ * Description :
+ * Turn the servo one step further in the direction of the sweep, back at the ends
+ */
+static void Scan_nextPoint(void){
+	if(g_forward && (g_servoPoint == (g_numOfPoints - 1))){
+		g_forward = FALSE;
+	}
+	else if((g_forward == FALSE) && (g_servoPoint == 0)){
+		g_forward = TRUE;
+	}
+
+	Scan_moveServo(g_forward ? (g_servoPoint + 1) : (g_servoPoint - 1), g_config_ptr->step);
+}
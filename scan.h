@@ -0,0 +1,112 @@
+ /******************************************************************************
+ *
+ * Module: SCAN
+ *
+ * File Name: scan.h
+ *
+ * Description: Header file for the servo sweep that turns the distance reader into a
+ *              scanner with a polar range map
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include "std_types.h"
+#include "ultrasonic.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Size of the polar range map (0 to 180 degrees in 5 degree steps) */
+#define SCAN_MAX_POINTS				37
+
+/* Speed of the servo (0.1 s per 60 degrees, SG90 at 5 V) in micro seconds per degree */
+#define SCAN_SERVO_US_PER_DEGREE	1667
+
+/* Time for the sensor to stop swinging once the horn reached its angle in micro seconds */
+#define SCAN_SETTLE_US				10000
+
+/* Range of a point without a valid echo */
+#define SCAN_NO_RANGE				0
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that contain members to set the configurations of the sweep (angles in degrees) */
+typedef struct{
+	uint8 firstAngle;
+	uint8 lastAngle;			/* At least one step above firstAngle, at most SERVO_MAX_ANGLE */
+	uint8 step;
+}Scan_ConfigType;
+
+/* Structure that holds the counts and the rate of the sweep */
+typedef struct{
+	uint16 points;				/* Results stored in the map */
+	uint16 missed;				/* Of them without a valid echo */
+	uint16 sweeps;				/* Sweeps completed (one end of the range to the other) */
+	uint16 sweepTime;			/* Time of the last sweep in ms */
+	uint16 pointRate;			/* Points per second over the last sweep in 1/10 */
+}Scan_StatsType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the sweep (configuration kept by pointer, it must stay valid): clear the map
+ * and turn the servo to the first angle. Return FALSE if the angles are out of order,
+ * the step is 0 or the range has less than two points (the sweep turns back at both ends)
+ * or more than SCAN_MAX_POINTS points.
+ * The servo must be initialized (Servo_init).
+ */
+boolean Scan_init(const Scan_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Run the sweep, called periodically in place of the pings:
+ * 1. Once the last result is stored, schedule the next trigger for when the servo has
+ *    settled and the echoes of the last ping died out (Ultrasonic_startMeasurementAt)
+ * 2. Once that trigger pulse is out, turn the servo to the next angle while the echo
+ *    is in flight, the sweep turns back at both ends of the range
+ */
+void Scan_update(void);
+
+/*
+ * Description :
+ * Store the result of the ping in flight (given by Ultrasonic_update and Ultrasonic_getResult)
+ * at its angle in the map, return TRUE with its point. Every result must be given, the next
+ * ping waits for it.
+ */
+boolean Scan_addResult(const Ultrasonic_ResultType * result_ptr, uint8 * point_ptr);
+
+/*
+ * Description :
+ * Return the number of points of the map
+ */
+uint8 Scan_getNumOfPoints(void);
+
+/*
+ * Description :
+ * Return the angle of a point of the map in degrees
+ */
+uint8 Scan_getAngle(uint8 point);
+
+/*
+ * Description :
+ * Return the range of a point of the map in cm (SCAN_NO_RANGE without a valid echo)
+ */
+uint16 Scan_getRange(uint8 point);
+
+/*
+ * Description :
+ * Copy the counts and the rate of the sweep
+ */
+void Scan_getStats(Scan_StatsType * stats_ptr);
+
+#endif /* SCAN_H_ */
@@ -0,0 +1,256 @@
+ /******************************************************************************
+ *
+ * Module: SCHEDULER
+ *
+ * File Name: scheduler.c
+ *
+ * Description: Source file for the time triggered cooperative task scheduler (Timer0 tick)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "scheduler.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                            Private Types                                    *
+ *******************************************************************************/
+
+/* Structure that holds a task and its release state */
+typedef struct{
+	Scheduler_TaskConfigType config;
+	volatile uint16 countdown;		/* Ticks to the next release */
+	volatile boolean released;		/* Released and not started yet */
+	volatile boolean missed;		/* Released again before it started */
+	volatile uint32 releaseTick;	/* Tick of the last release */
+	Scheduler_TaskStatsType stats;
+}Scheduler_TaskType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static Scheduler_TaskType g_tasks[SCHEDULER_MAX_TASKS];
+static volatile uint8 g_numOfTasks = 0;
+
+/* Number of ticks since Scheduler_init */
+static volatile uint32 g_ticks = 0;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(TIMER0_COMP_vect){
+
+	uint8 i;
+
+	g_ticks++;
+
+	/* Release the tasks whose period elapsed */
+	for(i = 0; i < g_numOfTasks; i++){
+		if(--g_tasks[i].countdown == 0){
+			g_tasks[i].countdown = g_tasks[i].config.period;
+
+			if(g_tasks[i].released == TRUE){
+				g_tasks[i].missed = TRUE;
+			}
+			g_tasks[i].released = TRUE;
+			g_tasks[i].releaseTick = g_ticks;
+		}
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the scheduler:
+ * 1. Remove all the tasks
+ * 2. Configure Timer0 in CTC mode with a compare match every SCHEDULER_TICK_US
+ * 3. Enable the Timer0 compare match interrupt (the ticks start with the global interrupts)
+ */
+void Scheduler_init(void){
+
+	g_numOfTasks = 0;
+	g_ticks = 0;
+
+	/*
+	 * Configure Timer/Counter0 Control Register:
+	 * 1. Set Bit 7(FOC0) because the timer is not used as PWM
+	 * 2. WGM01:0 = 10 for CTC mode, TOP = OCR0
+	 * 3. COM01:0 = 00, OC0 disconnected
+	 * 4. CS02:0 = 011 for F_CPU/64
+	 */
+	TCNT0 = 0;
+	OCR0 = SCHEDULER_TIMER0_COMPARE;
+	TCCR0 = (1<<FOC0) | (1<<WGM01) | (1<<CS01) | (1<<CS00);
+
+	/* Enable Timer/Counter0 Output Compare Match Interrupt */
+	TIMSK |= (1<<OCIE0);
+}
+
+/*
+ * Description :
+ * Add a periodic task, the tasks added first have the higher priority.
+ * Return the task id or SCHEDULER_INVALID_TASK if the table is full.
+ */
+uint8 Scheduler_addTask(const Scheduler_TaskConfigType * config_ptr){
+	uint8 task_id = g_numOfTasks;
+	uint8 sreg;
+
+	if((task_id >= SCHEDULER_MAX_TASKS) || (config_ptr->period == 0)){
+		return SCHEDULER_INVALID_TASK;
+	}
+
+	g_tasks[task_id].config = *config_ptr;
+	g_tasks[task_id].countdown = config_ptr->offset + 1;
+	g_tasks[task_id].released = FALSE;
+	g_tasks[task_id].missed = FALSE;
+	g_tasks[task_id].releaseTick = 0;
+	g_tasks[task_id].stats = (Scheduler_TaskStatsType){0, 0, 0, 0, 0, 0, 0};
+
+	/* The tick interrupt sees the task only when it is complete */
+	sreg = SREG;
+	cli();
+	g_numOfTasks = task_id + 1;
+	SREG = sreg;
+
+	return task_id;
+}
+
+/*
+ * Description :
+ * Change the release period of a task, the task keeps its phase unless the
+ * new period is shorter than the time left to its next release.
+ * Return FALSE if the task id or the period is not valid.
+ */
+boolean Scheduler_setPeriod(uint8 task_id, uint16 period){
+	uint8 sreg;
+
+	if((task_id >= g_numOfTasks) || (period == 0)){
+		return FALSE;
+	}
+
+	/* The tick interrupt reloads the countdown from the period */
+	sreg = SREG;
+	cli();
+	g_tasks[task_id].config.period = period;
+	if(g_tasks[task_id].countdown > period){
+		g_tasks[task_id].countdown = period;
+	}
+	SREG = sreg;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Run the released tasks, always the released task with the highest priority first,
+ * return when no task is released (call it from the main loop)
+ */
+void Scheduler_dispatch(void){
+	boolean ran;
+	uint8 i;
+
+	do{
+		ran = FALSE;
+
+		for(i = 0; i < g_numOfTasks; i++){
+			Scheduler_TaskType * task_ptr = &g_tasks[i];
+			Scheduler_TaskStatsType * stats_ptr = &task_ptr->stats;
+			uint32 releaseTime;
+			uint32 start;
+			uint32 executionTime;
+			uint32 jitter;
+			boolean missed;
+			uint8 sreg;
+
+			if(task_ptr->released == FALSE){
+				continue;
+			}
+
+			/* Take the release written by the tick interrupt */
+			sreg = SREG;
+			cli();
+			releaseTime = task_ptr->releaseTick * SCHEDULER_TICK_US;
+			missed = task_ptr->missed;
+			task_ptr->released = FALSE;
+			task_ptr->missed = FALSE;
+			SREG = sreg;
+
+			start = Scheduler_getTime();
+			(*task_ptr->config.task)();
+			executionTime = Scheduler_getTime() - start;
+			jitter = start - releaseTime;
+
+			stats_ptr->runs++;
+			stats_ptr->sumExecutionTime += executionTime;
+			stats_ptr->sumJitter += jitter;
+			if(executionTime > stats_ptr->maxExecutionTime){
+				stats_ptr->maxExecutionTime = (executionTime > 0xFFFF) ? 0xFFFF : (uint16)executionTime;
+			}
+			if(jitter > stats_ptr->maxJitter){
+				stats_ptr->maxJitter = (jitter > 0xFFFF) ? 0xFFFF : (uint16)jitter;
+			}
+			if(executionTime > task_ptr->config.budget){
+				stats_ptr->budgetOverruns++;
+			}
+			if((missed == TRUE) || ((jitter + executionTime) > ((uint32)task_ptr->config.period * SCHEDULER_TICK_US))){
+				stats_ptr->deadlineMisses++;
+			}
+
+			/* Start again from the highest priority */
+			ran = TRUE;
+			break;
+		}
+	}while(ran == TRUE);
+}
+
+/*
+ * Description :
+ * Return the time since Scheduler_init in micro seconds (SCHEDULER_US_PER_COUNT resolution)
+ */
+uint32 Scheduler_getTime(void){
+	uint32 ticks;
+	uint8 count;
+	uint8 sreg = SREG;
+
+	/* Read TCNT0 and the tick count together */
+	cli();
+	count = TCNT0;
+	ticks = g_ticks;
+
+	/*
+	 * The tick is the compare match, its interrupt is not served yet: read the count again,
+	 * the first read can be from before the flag
+	 */
+	if(TIFR & (1<<OCF0)){
+		count = TCNT0;
+		ticks++;
+	}
+	SREG = sreg;
+
+	/* TCNT0 equals OCR0 at the tick and restarts from 0 one count later */
+	if(count == SCHEDULER_TIMER0_COMPARE){
+		count = 0;
+	}
+	else{
+		count++;
+	}
+
+	return (ticks * SCHEDULER_TICK_US) + ((uint32)count * SCHEDULER_US_PER_COUNT);
+}
+
+/*
+ * Description :
+ * Copy the timing statistics of a task
+ */
+void Scheduler_getTaskStats(uint8 task_id, Scheduler_TaskStatsType * stats_ptr){
+	if(task_id < g_numOfTasks){
+		*stats_ptr = g_tasks[task_id].stats;
+	}
+}
@@ -0,0 +1,108 @@
+ /******************************************************************************
+ *
+ * Module: SCHEDULER
+ *
+ * File Name: scheduler.h
+ *
+ * Description: Header file for the time triggered cooperative task scheduler (Timer0 tick)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Maximum number of tasks */
+#define SCHEDULER_MAX_TASKS				8
+
+/* Returned by Scheduler_addTask when the task table is full */
+#define SCHEDULER_INVALID_TASK			0xFF
+
+/* Tick period in micro seconds */
+#define SCHEDULER_TICK_US				1000UL
+
+/* Timer0 runs at F_CPU/64 in CTC mode, OCR0 gives one compare match per tick */
+#define SCHEDULER_TIMER0_PRESCALER		64UL
+#define SCHEDULER_TIMER0_COMPARE		((uint8)(((F_CPU / SCHEDULER_TIMER0_PRESCALER) * SCHEDULER_TICK_US / 1000000UL) - 1))
+
+/* Micro seconds per Timer0 count */
+#define SCHEDULER_US_PER_COUNT			((uint16)((SCHEDULER_TIMER0_PRESCALER * 1000000UL) / F_CPU))
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that contain members to set the configurations of a periodic task */
+typedef struct{
+	void(*task)(void);		/* Task function, runs to completion */
+	uint16 period;			/* Release period in ticks, the deadline is the next release */
+	uint16 offset;			/* Ticks from the start to the first release (0 = the first tick) */
+	uint16 budget;			/* Expected worst case execution time in micro seconds */
+}Scheduler_TaskConfigType;
+
+/* Structure that holds the timing statistics of a task (times in micro seconds) */
+typedef struct{
+	uint32 runs;
+	uint32 sumExecutionTime;
+	uint16 maxExecutionTime;
+	uint32 sumJitter;			/* Release to start of the task */
+	uint16 maxJitter;
+	uint16 deadlineMisses;		/* Finished after the next release or released again before it ran */
+	uint16 budgetOverruns;		/* Ran longer than its budget */
+}Scheduler_TaskStatsType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the scheduler:
+ * 1. Remove all the tasks
+ * 2. Configure Timer0 in CTC mode with a compare match every SCHEDULER_TICK_US
+ * 3. Enable the Timer0 compare match interrupt (the ticks start with the global interrupts)
+ */
+void Scheduler_init(void);
+
+/*
+ * Description :
+ * Add a periodic task, the tasks added first have the higher priority.
+ * Return the task id or SCHEDULER_INVALID_TASK if the table is full.
+ */
+uint8 Scheduler_addTask(const Scheduler_TaskConfigType * config_ptr);
+
+/*
+ * Description :
+ * Change the release period of a task, the task keeps its phase unless the
+ * new period is shorter than the time left to its next release.
+ * Return FALSE if the task id or the period is not valid.
+ */
+boolean Scheduler_setPeriod(uint8 task_id, uint16 period);
+
+/*
+ * Description :
+ * Run the released tasks, always the released task with the highest priority first,
+ * return when no task is released (call it from the main loop)
+ */
+void Scheduler_dispatch(void);
+
+/*
+ * Description :
+ * Return the time since Scheduler_init in micro seconds (SCHEDULER_US_PER_COUNT resolution)
+ */
+uint32 Scheduler_getTime(void);
+
+/*
+ * Description :
+ * Copy the timing statistics of a task
+ */
+void Scheduler_getTaskStats(uint8 task_id, Scheduler_TaskStatsType * stats_ptr);
+
+#endif /* SCHEDULER_H_ */
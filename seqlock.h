@@ -0,0 +1,96 @@
+ /******************************************************************************
+ *
+ * Module: SEQLOCK
+ *
+ * File Name: seqlock.h
+ *
+ * Description: Sequence counters to share multi-byte data between an ISR and
+ *              the main loop without disabling the interrupts
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include "std_types.h"
+
+/*
+ * How to use:
+ * The writer (the ISR) wraps every update of the shared data between Seqlock_writeBegin
+ * and Seqlock_writeEnd, it never waits.
+ * The reader (the main loop) copies the data between Seqlock_readBegin and Seqlock_readRetry
+ * and copies again while Seqlock_readRetry returns TRUE, i.e. while an ISR updated the data
+ * in the middle of the copy.
+ *
+ * The sequence is 8-bit so it is read in one instruction, a copy can only be wrongly
+ * accepted if exactly 128 updates happen during it.
+ */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Compiler barrier: keeps the accesses to the shared data between the sequence accesses */
+#define SEQLOCK_BARRIER()	__asm__ __volatile__("" ::: "memory")
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Sequence counter, odd while the writer is updating the shared data */
+typedef volatile uint8 Seqlock_Type;
+
+/*******************************************************************************
+ *                              Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start updating the data protected by the lock (writer side)
+ */
+static inline void Seqlock_writeBegin(Seqlock_Type * lock_ptr){
+	(*lock_ptr)++;
+	SEQLOCK_BARRIER();
+}
+
+/*
+ * Description :
+ * Finish updating the data protected by the lock (writer side)
+ */
+static inline void Seqlock_writeEnd(Seqlock_Type * lock_ptr){
+	SEQLOCK_BARRIER();
+	(*lock_ptr)++;
+}
+
+/*
+ * Description :
+ * Start copying the data protected by the lock (reader side),
+ * return the sequence to pass to Seqlock_readRetry
+ */
+static inline uint8 Seqlock_readBegin(const Seqlock_Type * lock_ptr){
+	uint8 sequence;
+
+	/* Wait until no update is in progress (only possible if the writer is not an ISR) */
+	do{
+		sequence = *lock_ptr;
+	}while(sequence & 0x01);
+
+	SEQLOCK_BARRIER();
+
+	return sequence;
+}
+
+/*
+ * Description :
+ * Finish copying the data protected by the lock (reader side),
+ * return TRUE if the data changed during the copy and it must be copied again
+ */
+static inline boolean Seqlock_readRetry(const Seqlock_Type * lock_ptr, uint8 sequence){
+	SEQLOCK_BARRIER();
+
+	return (*lock_ptr != sequence);
+}
+
+#endif /* SEQLOCK_H_ */
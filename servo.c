@@ -0,0 +1,148 @@
+ /******************************************************************************
+ *
+ * Module: SERVO
+ *
+ * File Name: servo.c
+ *
+ * Description: Source file for the hobby servo driven from the OC1A compare output
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "servo.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Width of the pulse being sent and of the next frames (ICU ticks) */
+static uint16 g_width = (SERVO_MIN_PULSE_US + SERVO_MAX_PULSE_US) / 2;
+static volatile uint16 g_nextWidth = (SERVO_MIN_PULSE_US + SERVO_MAX_PULSE_US) / 2;
+
+/* The next match clears OC1A (end of the pulse) */
+static boolean g_pulseHigh = FALSE;
+
+static volatile uint16 g_frameCount = 0;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/*
+ * The match changed OC1A at its exact time, the interrupt only has to come before
+ * the next edge: load the time of the next edge and the level it sets.
+ */
+ISR(TIMER1_COMPA_vect){
+	if(g_pulseHigh == FALSE){
+
+		/* Start of the pulse: clear OC1A at its end */
+		OCR1A += g_width;
+		TCCR1A = (TCCR1A & ~(1<<COM1A0)) | (1<<COM1A1);
+		g_pulseHigh = TRUE;
+	}
+	else{
+
+		/* End of the pulse: set OC1A at the start of the next frame with the new width */
+		OCR1A += SERVO_PERIOD_US - g_width;
+		TCCR1A |= (1<<COM1A1) | (1<<COM1A0);
+		g_width = g_nextWidth;
+		g_pulseHigh = FALSE;
+		g_frameCount++;
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the servo output:
+ * 1. Set the OC1A pin as output pin
+ * 2. Let the OCR1A compare match set the pin at the start of every frame and clear it
+ *    at the end of the pulse, its interrupt only loads the time of the next edge
+ * 3. Start with the pulse of the middle angle
+ * The ICU must be initialized (Ultrasonic_init): Timer1 keeps running in normal mode
+ * as the time base of the echoes.
+ */
+void Servo_init(void){
+	uint8 sreg;
+
+	/* The pin is low until the first match, then the compare unit drives it */
+	GPIO_writePin(SERVO_PORT_ID, SERVO_PIN_ID, LOGIC_LOW);
+	GPIO_setupPinDirection(SERVO_PORT_ID, SERVO_PIN_ID, PIN_OUTPUT);
+
+	sreg = SREG;
+	cli();
+
+	g_width = g_nextWidth;
+	g_pulseHigh = FALSE;
+	g_frameCount = 0;
+
+	/*
+	 * COM1A1:0 = 11 sets OC1A on the compare match, the first frame starts one
+	 * period from now. WGM11:10 stay 00 (normal mode, shared with the ICU).
+	 */
+	OCR1A = TCNT1 + SERVO_PERIOD_US;
+	TCCR1A |= (1<<COM1A1) | (1<<COM1A0);
+	TIFR = (1<<OCF1A);
+	TIMSK |= (1<<OCIE1A);
+
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Set the pulse width in micro seconds (clamped to the servo range), it is sent from
+ * the next frame on
+ */
+void Servo_setPulseWidth(uint16 width){
+	uint8 sreg;
+
+	if(width < SERVO_MIN_PULSE_US){
+		width = SERVO_MIN_PULSE_US;
+	}
+	else if(width > SERVO_MAX_PULSE_US){
+		width = SERVO_MAX_PULSE_US;
+	}
+
+	/* 16-bit value read by the interrupt */
+	sreg = SREG;
+	cli();
+	g_nextWidth = width;
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Set the angle in degrees (0 to SERVO_MAX_ANGLE), return FALSE and keep the current
+ * pulse if it is out of range
+ */
+boolean Servo_setAngle(uint8 angle){
+	if(angle > SERVO_MAX_ANGLE){
+		return FALSE;
+	}
+
+	Servo_setPulseWidth(SERVO_MIN_PULSE_US
+			+ (uint16)(((uint32)angle * (SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US) + SERVO_MAX_ANGLE / 2) / SERVO_MAX_ANGLE));
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of frames sent since the servo was initialized
+ */
+uint16 Servo_getFrameCount(void){
+	uint16 count;
+	uint8 sreg;
+
+	sreg = SREG;
+	cli();
+	count = g_frameCount;
+	SREG = sreg;
+
+	return count;
+}
@@ -0,0 +1,75 @@
+ /******************************************************************************
+ *
+ * Module: SERVO
+ *
+ * File Name: servo.h
+ *
+ * Description: Header file for the hobby servo driven from the OC1A compare output
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SERVO_H_
+#define SERVO_H_
+
+#include "std_types.h"
+#include "gpio.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* OC1A pin: the compare match of OCR1A sets and clears it without the CPU */
+#define SERVO_PORT_ID				PORTD_ID
+#define SERVO_PIN_ID				PIN5_ID
+
+/* Frame period and pulse widths of the servo in ICU ticks = micro seconds */
+#define SERVO_PERIOD_US				20000
+#define SERVO_MIN_PULSE_US			1000
+#define SERVO_MAX_PULSE_US			2000
+
+/* Angle of the maximum pulse in degrees (the minimum pulse is 0 degrees) */
+#define SERVO_MAX_ANGLE				180
+
+#if((SERVO_MIN_PULSE_US >= SERVO_MAX_PULSE_US) || (SERVO_MAX_PULSE_US >= SERVO_PERIOD_US))
+#error "The servo pulse widths must increase and fit in the frame period"
+#endif
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the servo output:
+ * 1. Set the OC1A pin as output pin
+ * 2. Let the OCR1A compare match set the pin at the start of every frame and clear it
+ *    at the end of the pulse, its interrupt only loads the time of the next edge
+ * 3. Start with the pulse of the middle angle
+ * The ICU must be initialized (Ultrasonic_init): Timer1 keeps running in normal mode
+ * as the time base of the echoes.
+ */
+void Servo_init(void);
+
+/*
+ * Description :
+ * Set the pulse width in micro seconds (clamped to the servo range), it is sent from
+ * the next frame on
+ */
+void Servo_setPulseWidth(uint16 width);
+
+/*
+ * Description :
+ * Set the angle in degrees (0 to SERVO_MAX_ANGLE), return FALSE and keep the current
+ * pulse if it is out of range
+ */
+boolean Servo_setAngle(uint8 angle);
+
+/*
+ * Description :
+ * Return the number of frames sent since the servo was initialized
+ */
+uint16 Servo_getFrameCount(void);
+
+#endif /* SERVO_H_ */
@@ -0,0 +1,279 @@
+ /******************************************************************************
+ *
+ * Module: SHELL
+ *
+ * File Name: shell.c
+ *
+ * Description: Source file for the line oriented command shell over the UART
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "shell.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static const Shell_ConfigType * g_config_ptr = NULL_PTR;
+
+/* Line being received, g_discard is set when it can not be trusted anymore */
+static char g_line[SHELL_LINE_SIZE];
+static uint8 g_lineLength = 0;
+static boolean g_discard = FALSE;
+
+/* Receive losses already seen */
+static uint16 g_rxDropped = 0;
+
+/* Reply of the last command, g_outputSent bytes of it are in the UART already */
+static uint8 g_output[SHELL_OUTPUT_SIZE];
+static uint8 g_outputLength = 0;
+static uint8 g_outputSent = 0;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+static void Shell_flushOutput(void);
+static void Shell_execute(void);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the shell with its command table (kept by pointer, it must stay valid),
+ * the UART must be initialized already
+ */
+void Shell_init(const Shell_ConfigType * config_ptr){
+	g_config_ptr = config_ptr;
+	g_lineLength = 0;
+	g_discard = FALSE;
+	g_rxDropped = UART_getRxDropped();
+	g_outputLength = 0;
+	g_outputSent = 0;
+}
+
+/*
+ * Description :
+ * Run the shell for a bounded time, call it from the main loop (never from an ISR):
+ * 1. Move the pending reply into the UART transmit buffer as far as it fits
+ * 2. Once the reply is sent, take at most SHELL_BYTES_PER_POLL received bytes
+ * 3. Execute at most one complete line, its reply is sent by the next calls
+ */
+void Shell_poll(void){
+	uint8 count = 0;
+	uint8 data;
+	uint16 dropped;
+
+	if(g_config_ptr == NULL_PTR){
+		return;
+	}
+
+	Shell_flushOutput();
+
+	/* The next line waits in the UART receive buffer until the reply is out */
+	if(g_outputLength != 0){
+		return;
+	}
+
+	/* A received byte was lost, the line it belonged to is not complete */
+	dropped = UART_getRxDropped();
+	if(dropped != g_rxDropped){
+		g_rxDropped = dropped;
+		g_discard = TRUE;
+	}
+
+	while((count < SHELL_BYTES_PER_POLL) && (UART_receiveByte(&data) == TRUE)){
+		count++;
+
+		if((data == '\r') || (data == '\n')){
+			if(g_discard == TRUE){
+				Shell_print("ERR line\r\n");
+			}
+			else if(g_lineLength != 0){
+				g_line[g_lineLength] = '\0';
+				Shell_execute();
+			}
+			else{
+
+				/* Empty line or the second character of "\r\n" */
+				continue;
+			}
+
+			g_lineLength = 0;
+			g_discard = FALSE;
+
+			/* One command per call */
+			Shell_flushOutput();
+			return;
+		}
+		else if((data == '\b') || (data == 0x7F)){
+			if(g_lineLength != 0){
+				g_lineLength--;
+			}
+		}
+		else if(g_lineLength < (SHELL_LINE_SIZE - 1)){
+			g_line[g_lineLength] = (char)data;
+			g_lineLength++;
+		}
+		else{
+
+			/* Line too long */
+			g_discard = TRUE;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Append a string to the reply of the current command
+ */
+void Shell_print(const char * str){
+	while((*str != '\0') && (g_outputLength < SHELL_OUTPUT_SIZE)){
+		g_output[g_outputLength] = (uint8)*str;
+		g_outputLength++;
+		str++;
+	}
+}
+
+/*
+ * Description :
+ * Append a signed decimal number to the reply of the current command
+ */
+void Shell_printNumber(sint32 value){
+	char buffer[12];
+	uint8 i = sizeof(buffer) - 1;
+	uint32 magnitude = (value < 0) ? (uint32)(-value) : (uint32)value;
+
+	/* Digits from the end of the buffer */
+	buffer[i] = '\0';
+	do{
+		i--;
+		buffer[i] = (char)('0' + (magnitude % 10));
+		magnitude /= 10;
+	}while(magnitude != 0);
+
+	if(value < 0){
+		i--;
+		buffer[i] = '-';
+	}
+
+	Shell_print(&buffer[i]);
+}
+
+/*
+ * Description :
+ * Convert a decimal string of at most 5 digits to a number,
+ * return FALSE if the string is not a number or is above 65535
+ */
+boolean Shell_parseNumber(const char * str, uint16 * value_ptr){
+	uint32 value = 0;
+	uint8 digits = 0;
+
+	while(*str != '\0'){
+		if((*str < '0') || (*str > '9') || (digits == 5)){
+			return FALSE;
+		}
+		value = (value * 10) + (uint8)(*str - '0');
+		digits++;
+		str++;
+	}
+
+	if((digits == 0) || (value > 0xFFFF)){
+		return FALSE;
+	}
+
+	*value_ptr = (uint16)value;
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return TRUE if the two strings are equal
+ */
+boolean Shell_isEqual(const char * str1, const char * str2){
+	while(*str1 == *str2){
+		if(*str1 == '\0'){
+			return TRUE;
+		}
+		str1++;
+		str2++;
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Move as much of the reply as the UART transmit buffer takes,
+ * SHELL_TX_RESERVE bytes are left for the other senders
+ */
+static void Shell_flushOutput(void){
+	uint8 size = g_outputLength - g_outputSent;
+	uint8 space = UART_getTxFreeSpace();
+
+	space = (space > SHELL_TX_RESERVE) ? (space - SHELL_TX_RESERVE) : 0;
+	if(size > space){
+		size = space;
+	}
+
+	if((size != 0) && (UART_sendBlock(&g_output[g_outputSent], size) == TRUE)){
+		g_outputSent += size;
+	}
+
+	if(g_outputSent == g_outputLength){
+		g_outputLength = 0;
+		g_outputSent = 0;
+	}
+}
+
+/*
+ * Description :
+ * Split the received line in words and call the handler of its command,
+ * "help" lists the commands when the table does not have its own
+ */
+static void Shell_execute(void){
+	char * argv[SHELL_MAX_ARGS];
+	uint8 argc = 0;
+	uint8 i;
+
+	for(i = 0; g_line[i] != '\0'; i++){
+		if((g_line[i] == ' ') || (g_line[i] == '\t')){
+			g_line[i] = '\0';
+		}
+		else if((i == 0) || (g_line[i - 1] == '\0')){
+			if(argc == SHELL_MAX_ARGS){
+				Shell_print("ERR arguments\r\n");
+				return;
+			}
+			argv[argc] = &g_line[i];
+			argc++;
+		}
+	}
+
+	/* Only blanks */
+	if(argc == 0){
+		return;
+	}
+
+	for(i = 0; i < g_config_ptr->numOfCommands; i++){
+		if(Shell_isEqual(argv[0], g_config_ptr->commands[i].name) == TRUE){
+			(*g_config_ptr->commands[i].handler)(argc, argv);
+			return;
+		}
+	}
+
+	if(Shell_isEqual(argv[0], "help") == TRUE){
+		for(i = 0; i < g_config_ptr->numOfCommands; i++){
+			Shell_print(g_config_ptr->commands[i].name);
+			Shell_print(" ");
+		}
+		Shell_print("help\r\n");
+	}
+	else{
+		Shell_print("ERR command\r\n");
+	}
+}
@@ -0,0 +1,104 @@
+ /******************************************************************************
+ *
+ * Module: SHELL
+ *
+ * File Name: shell.h
+ *
+ * Description: Header file for the line oriented command shell over the UART
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SHELL_H_
+#define SHELL_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Longest command line in characters (longer lines are rejected) */
+#define SHELL_LINE_SIZE				32
+
+/* Maximum number of words in a command line, the command name included */
+#define SHELL_MAX_ARGS				4
+
+/* Size of the reply buffer in bytes, a reply longer than this is truncated */
+#define SHELL_OUTPUT_SIZE			128
+
+/* Received bytes taken from the UART by one Shell_poll */
+#define SHELL_BYTES_PER_POLL		16
+
+/* UART transmit bytes left free for the other senders (one telemetry frame) */
+#define SHELL_TX_RESERVE			16
+
+#if(SHELL_OUTPUT_SIZE > 255)
+
+#error "Shell output buffer size must be at most 255"
+
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that describes one command, argv[0] is the command name */
+typedef struct{
+	const char * name;
+	void(*handler)(uint8 argc, char * argv[]);
+}Shell_CommandType;
+
+/* Structure that contain members to set the configurations of the shell */
+typedef struct{
+	const Shell_CommandType * commands;
+	uint8 numOfCommands;
+}Shell_ConfigType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the shell with its command table (kept by pointer, it must stay valid),
+ * the UART must be initialized already
+ */
+void Shell_init(const Shell_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Run the shell for a bounded time, call it from the main loop (never from an ISR):
+ * 1. Move the pending reply into the UART transmit buffer as far as it fits
+ * 2. Once the reply is sent, take at most SHELL_BYTES_PER_POLL received bytes
+ * 3. Execute at most one complete line, its reply is sent by the next calls
+ */
+void Shell_poll(void);
+
+/*
+ * Description :
+ * Append a string to the reply of the current command
+ */
+void Shell_print(const char * str);
+
+/*
+ * Description :
+ * Append a signed decimal number to the reply of the current command
+ */
+void Shell_printNumber(sint32 value);
+
+/*
+ * Description :
+ * Convert a decimal string of at most 5 digits to a number,
+ * return FALSE if the string is not a number or is above 65535
+ */
+boolean Shell_parseNumber(const char * str, uint16 * value_ptr);
+
+/*
+ * Description :
+ * Return TRUE if the two strings are equal
+ */
+boolean Shell_isEqual(const char * str1, const char * str2);
+
+#endif /* SHELL_H_ */
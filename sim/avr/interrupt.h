@@ -0,0 +1,46 @@
+ /******************************************************************************
+ *
+ * Module: SIM
+ *
+ * File Name: interrupt.h
+ *
+ * Description: Host replacement of <avr/interrupt.h>: an ISR is a plain function
+ *              called by the simulator when its interrupt is pending and enabled
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector)		void vector(void)
+
+#define sei()			do{ SREG |= (1<<SREG_I); SIM_serveInterrupts(); }while(0)
+#define cli()			do{ SREG &= ~(1<<SREG_I); }while(0)
+
+/* ATmega32 interrupt vectors, the ones not defined by the drivers are empty */
+void INT0_vect(void);
+void INT1_vect(void);
+void INT2_vect(void);
+void TIMER2_COMP_vect(void);
+void TIMER2_OVF_vect(void);
+void TIMER1_CAPT_vect(void);
+void TIMER1_COMPA_vect(void);
+void TIMER1_COMPB_vect(void);
+void TIMER1_OVF_vect(void);
+void TIMER0_COMP_vect(void);
+void TIMER0_OVF_vect(void);
+void SPI_STC_vect(void);
+void USART_RXC_vect(void);
+void USART_UDRE_vect(void);
+void USART_TXC_vect(void);
+void ADC_vect(void);
+void EE_RDY_vect(void);
+void ANA_COMP_vect(void);
+void TWI_vect(void);
+void SPM_RDY_vect(void);
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
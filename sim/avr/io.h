@@ -0,0 +1,259 @@
+ /******************************************************************************
+ *
+ * Module: SIM
+ *
+ * File Name: io.h
+ *
+ * Description: Host replacement of <avr/io.h>: ATmega32 registers mapped on the
+ *              simulated register file
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include "sim_atmega32.h"
+
+/*******************************************************************************
+ *                                Registers                                    *
+ *******************************************************************************/
+
+/* The simulator itself accesses the fields of g_simRegisters directly */
+#ifndef SIM_NO_REGISTER_MACROS
+
+/* Ports: every access advances the time so the peripheral models see every write */
+#define PORTA	(*SIM_accessPort(&g_simRegisters.PORTA))
+#define PORTB	(*SIM_accessPort(&g_simRegisters.PORTB))
+#define PORTC	(*SIM_accessPort(&g_simRegisters.PORTC))
+#define PORTD	(*SIM_accessPort(&g_simRegisters.PORTD))
+#define DDRA	(g_simRegisters.DDRA)
+#define DDRB	(g_simRegisters.DDRB)
+#define DDRC	(g_simRegisters.DDRC)
+#define DDRD	(g_simRegisters.DDRD)
+#define PINA	(*SIM_readPin(0))
+#define PINB	(*SIM_readPin(1))
+#define PINC	(*SIM_readPin(2))
+#define PIND	(*SIM_readPin(3))
+
+#define SREG	(*SIM_accessStatus())
+#define MCUCR	(g_simRegisters.MCUCR)
+#define MCUCSR	(g_simRegisters.MCUCSR)
+#define GICR	(g_simRegisters.GICR)
+#define GIFR	(*SIM_accessInterruptFlags())
+#define SFIOR	(g_simRegisters.SFIOR)
+#define WDTCR	(g_simRegisters.WDTCR)
+#define TIMSK	(g_simRegisters.TIMSK)
+#define TIFR	(*SIM_accessFlags())
+
+#define TCCR0	(g_simRegisters.TCCR0)
+#define TCNT0	(*SIM_accessTimer0())
+#define OCR0	(g_simRegisters.OCR0)
+
+#define TCCR1A	(g_simRegisters.TCCR1A)
+#define TCCR1B	(g_simRegisters.TCCR1B)
+#define TCNT1	(*SIM_accessTimer1())
+#define OCR1A	(g_simRegisters.OCR1A)
+#define OCR1B	(g_simRegisters.OCR1B)
+#define ICR1	(g_simRegisters.ICR1)
+
+#define TCCR2	(g_simRegisters.TCCR2)
+#define TCNT2	(*SIM_accessTimer2())
+#define OCR2	(g_simRegisters.OCR2)
+#define ASSR	(g_simRegisters.ASSR)
+
+#define UCSRA	(g_simRegisters.UCSRA)
+#define UCSRB	(g_simRegisters.UCSRB)
+#define UCSRC	(g_simRegisters.UCSRC)
+#define UBRRL	(g_simRegisters.UBRRL)
+#define UBRRH	(g_simRegisters.UBRRH)
+#define UDR		(g_simRegisters.UDR)
+
+#define TWBR	(g_simRegisters.TWBR)
+#define TWSR	(g_simRegisters.TWSR)
+#define TWAR	(g_simRegisters.TWAR)
+#define TWDR	(g_simRegisters.TWDR)
+#define TWCR	(g_simRegisters.TWCR)
+
+#define SPCR	(g_simRegisters.SPCR)
+#define SPSR	(g_simRegisters.SPSR)
+#define SPDR	(*SIM_accessSpiData())
+
+#define ADMUX	(g_simRegisters.ADMUX)
+#define ADCSRA	(g_simRegisters.ADCSRA)
+#define ADC		(g_simRegisters.ADC)
+#define ADCW	ADC
+
+#define EEAR	(g_simRegisters.EEAR)
+#define EEDR	(*SIM_accessEepromData())
+#define EECR	(*SIM_accessEeprom())
+
+#endif /* SIM_NO_REGISTER_MACROS */
+
+/*******************************************************************************
+ *                                Register Bits                                *
+ *******************************************************************************/
+
+/* SREG */
+#define SREG_I	7
+
+/* MCUCR / MCUCSR / GICR / GIFR */
+#define SE		7
+#define ISC11	3
+#define ISC10	2
+#define ISC01	1
+#define ISC00	0
+#define JTD		7
+#define ISC2	6
+#define JTRF	4
+#define WDRF	3
+#define BORF	2
+#define EXTRF	1
+#define PORF	0
+#define INT1	7
+#define INT0	6
+#define INT2	5
+#define INTF1	7
+#define INTF0	6
+#define INTF2	5
+
+/* WDTCR */
+#define WDTOE	4
+#define WDE		3
+#define WDP2	2
+#define WDP1	1
+#define WDP0	0
+
+/* TIMSK / TIFR */
+#define OCIE2	7
+#define TOIE2	6
+#define TICIE1	5
+#define OCIE1A	4
+#define OCIE1B	3
+#define TOIE1	2
+#define OCIE0	1
+#define TOIE0	0
+#define OCF2	7
+#define TOV2	6
+#define ICF1	5
+#define OCF1A	4
+#define OCF1B	3
+#define TOV1	2
+#define OCF0	1
+#define TOV0	0
+
+/* TCCR0 / TCCR2 */
+#define FOC0	7
+#define WGM00	6
+#define COM01	5
+#define COM00	4
+#define WGM01	3
+#define CS02	2
+#define CS01	1
+#define CS00	0
+#define FOC2	7
+#define WGM20	6
+#define COM21	5
+#define COM20	4
+#define WGM21	3
+#define CS22	2
+#define CS21	1
+#define CS20	0
+
+/* TCCR1A / TCCR1B */
+#define COM1A1	7
+#define COM1A0	6
+#define COM1B1	5
+#define COM1B0	4
+#define FOC1A	3
+#define FOC1B	2
+#define WGM11	1
+#define WGM10	0
+#define ICNC1	7
+#define ICES1	6
+#define WGM13	4
+#define WGM12	3
+#define CS12	2
+#define CS11	1
+#define CS10	0
+
+/* UCSRA / UCSRB / UCSRC */
+#define RXC		7
+#define TXC		6
+#define UDRE	5
+#define FE		4
+#define DOR		3
+#define PE		2
+#define U2X		1
+#define MPCM	0
+#define RXCIE	7
+#define TXCIE	6
+#define UDRIE	5
+#define RXEN	4
+#define TXEN	3
+#define UCSZ2	2
+#define RXB8	1
+#define TXB8	0
+#define URSEL	7
+#define UMSEL	6
+#define UPM1	5
+#define UPM0	4
+#define USBS	3
+#define UCSZ1	2
+#define UCSZ0	1
+#define UCPOL	0
+
+/* TWCR / TWSR / TWAR */
+#define TWINT	7
+#define TWEA	6
+#define TWSTA	5
+#define TWSTO	4
+#define TWWC	3
+#define TWEN	2
+#define TWIE	0
+#define TWPS1	1
+#define TWPS0	0
+#define TWGCE	0
+
+/* SPCR / SPSR */
+#define SPIE	7
+#define SPE		6
+#define DORD	5
+#define MSTR	4
+#define CPOL	3
+#define CPHA	2
+#define SPR1	1
+#define SPR0	0
+#define SPIF	7
+#define WCOL	6
+#define SPI2X	0
+
+/* ADMUX / ADCSRA / SFIOR */
+#define REFS1	7
+#define REFS0	6
+#define ADLAR	5
+#define MUX4	4
+#define MUX3	3
+#define MUX2	2
+#define MUX1	1
+#define MUX0	0
+#define ADEN	7
+#define ADSC	6
+#define ADATE	5
+#define ADIF	4
+#define ADIE	3
+#define ADPS2	2
+#define ADPS1	1
+#define ADPS0	0
+#define ADTS2	7
+#define ADTS1	6
+#define ADTS0	5
+
+/* EECR */
+#define EERIE	3
+#define EEMWE	2
+#define EEWE	1
+#define EERE	0
+
+#endif /* SIM_AVR_IO_H_ */
@@ -0,0 +1,24 @@
+ /******************************************************************************
+ *
+ * Module: SIM
+ *
+ * File Name: pgmspace.h
+ *
+ * Description: Host replacement of <avr/pgmspace.h>: the tables in flash are
+ *              plain constant arrays on the host
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_AVR_PGMSPACE_H_
+#define SIM_AVR_PGMSPACE_H_
+
+#include "std_types.h"
+
+#define PROGMEM
+
+#define pgm_read_byte(address)		(*(const uint8 *)(address))
+#define pgm_read_word(address)		(*(const uint16 *)(address))
+
+#endif /* SIM_AVR_PGMSPACE_H_ */
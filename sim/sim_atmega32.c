@@ -0,0 +1,1128 @@
+ /******************************************************************************
+ *
+ * Module: SIM
+ *
+ * File Name: sim_atmega32.c
+ *
+ * Description: Simulated ATmega32 register file to build and run the drivers on a host
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+/* Use the register bit names only, the registers are the fields of g_simRegisters */
+#define SIM_NO_REGISTER_MACROS
+
+#include "sim_atmega32.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include <string.h>
+
+/*******************************************************************************
+ *                            Private Types                                    *
+ *******************************************************************************/
+
+/* Structure that holds a scheduled pin change */
+typedef struct{
+	uint64 cycle;
+	uint8 port;
+	uint8 pin;
+	uint8 level;
+	boolean used;
+}Sim_PinEventType;
+
+/* Structure that describes an 8-bit timer (Timer0 or Timer2) */
+typedef struct{
+	volatile uint8 * tccr_ptr;
+	volatile uint8 * tcnt_ptr;
+	volatile uint8 * ocr_ptr;
+	uint8 ocfBit;
+	uint8 tovBit;
+	const uint16 * prescalers;		/* Clock divider selected by CSx2:0 (0 = stopped) */
+	uint64 sync;					/* Time at which TCNTx got its current value */
+}Sim_Timer8Type;
+
+/* Structure that describes an interrupt raised by a flag bit and enabled by a mask bit */
+typedef struct{
+	void(*vector)(void);
+	volatile uint8 * flag_ptr;
+	uint8 flagBit;
+	volatile uint8 * enable_ptr;
+	uint8 enableBit;
+}Sim_InterruptType;
+
+/*******************************************************************************
+ *                      Global Variable                                        *
+ *******************************************************************************/
+
+volatile Sim_RegisterFileType g_simRegisters;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Simulated time in CPU cycles */
+static uint64 g_cycles = 0;
+
+/* Time at which TCNT1 got its current value */
+static uint64 g_timer1Sync = 0;
+
+/* Level of the OC1A compare output (PD5 while COM1A1 is set) and the time of its last change */
+static uint8 g_outputCompareA = LOGIC_LOW;
+static uint64 g_outputCompareCycle = 0;
+
+/* Levels driven by the outside world on every port */
+static uint8 g_pinInputs[4];
+
+static Sim_PinEventType g_pinEvents[SIM_MAX_PIN_EVENTS];
+
+static void(*g_observers[SIM_MAX_OBSERVERS])(void);
+static uint8 g_numOfObservers = 0;
+
+/* Flag to stop the observers from being called again from inside an observer */
+static boolean g_inObserver = FALSE;
+
+static uint8 g_uartOutput[SIM_UART_OUTPUT_SIZE];
+static uint32 g_uartOutputSize = 0;
+
+/* Time at which the UART transmitter is free again */
+static uint64 g_uartBusyUntil = 0;
+
+/* Bytes waiting to be received, the next one is complete at g_uartInputAt (0 when idle) */
+static uint8 g_uartInput[SIM_UART_INPUT_SIZE];
+static uint32 g_uartInputSize = 0;
+static uint32 g_uartInputRead = 0;
+static uint64 g_uartInputAt = 0;
+
+/* Received byte handed to USART_RXC_vect in UDR */
+static uint8 g_uartReceived = 0;
+
+/* Service time charged to every interrupt and the total time spent in the vectors */
+static uint32 g_interruptCycles = 0;
+static uint64 g_interruptTotal = 0;
+
+/* TWI event waiting for TWI_vect */
+static boolean g_twiPending = FALSE;
+
+/* Copies of TIFR and GIFR handed to the drivers, see SIM_accessFlags */
+static volatile uint16 g_flagsCopy = 0xFF00;
+static volatile uint16 g_interruptFlagsCopy = 0xFF00;
+
+/* Copy of SPDR handed to the drivers (a write starts a transfer), see SIM_accessSpiData */
+static volatile uint16 g_spiDataCopy = 0xFF00;
+
+/* End of the SPI transfer on the way (0 when idle) and the last byte shifted out */
+static uint64 g_spiBusyUntil = 0;
+static uint8 g_spiOutput = 0;
+
+/* EEPROM content (erased), it survives SIM_reset like on the target */
+static uint8 g_eeprom[SIM_EEPROM_SIZE] = {[0 ... (SIM_EEPROM_SIZE - 1)] = 0xFF};
+
+/* End of the EEPROM write on the way (0 when idle) and the number of bytes written */
+static uint64 g_eepromBusyUntil = 0;
+static uint32 g_eepromWrites = 0;
+
+/* Voltages on ADC0..ADC7 in mV and the end of the conversion on the way (0 when idle) */
+static uint16 g_adcInputs[8];
+static uint64 g_adcBusyUntil = 0;
+
+static const uint16 g_timer0Prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+static const uint16 g_timer2Prescalers[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+static Sim_Timer8Type g_timers8[2] = {
+	{&g_simRegisters.TCCR0, &g_simRegisters.TCNT0, &g_simRegisters.OCR0, OCF0, TOV0, g_timer0Prescalers, 0},
+	{&g_simRegisters.TCCR2, &g_simRegisters.TCNT2, &g_simRegisters.OCR2, OCF2, TOV2, g_timer2Prescalers, 0},
+};
+
+/* Levels of INT0 (PD2) and INT1 (PD3) at the last check, see Sim_checkExternalInterrupts */
+static uint8 g_externalLevels = 0;
+
+/* Interrupts raised by GIFR/TIFR/SPSR flags in priority order (the lower vector number first) */
+static const Sim_InterruptType g_timerInterrupts[] = {
+	{INT0_vect,         &g_simRegisters.GIFR, INTF0, &g_simRegisters.GICR,  INT0},
+	{INT1_vect,         &g_simRegisters.GIFR, INTF1, &g_simRegisters.GICR,  INT1},
+	{TIMER2_COMP_vect,  &g_simRegisters.TIFR, OCF2,  &g_simRegisters.TIMSK, OCIE2},
+	{TIMER2_OVF_vect,   &g_simRegisters.TIFR, TOV2,  &g_simRegisters.TIMSK, TOIE2},
+	{TIMER1_CAPT_vect,  &g_simRegisters.TIFR, ICF1,  &g_simRegisters.TIMSK, TICIE1},
+	{TIMER1_COMPA_vect, &g_simRegisters.TIFR, OCF1A, &g_simRegisters.TIMSK, OCIE1A},
+	{TIMER1_COMPB_vect, &g_simRegisters.TIFR, OCF1B, &g_simRegisters.TIMSK, OCIE1B},
+	{TIMER1_OVF_vect,   &g_simRegisters.TIFR, TOV1,  &g_simRegisters.TIMSK, TOIE1},
+	{TIMER0_COMP_vect,  &g_simRegisters.TIFR, OCF0,  &g_simRegisters.TIMSK, OCIE0},
+	{TIMER0_OVF_vect,   &g_simRegisters.TIFR, TOV0,  &g_simRegisters.TIMSK, TOIE0},
+	{SPI_STC_vect,      &g_simRegisters.SPSR, SPIF,  &g_simRegisters.SPCR,  SPIE},
+	{ADC_vect,          &g_simRegisters.ADCSRA, ADIF, &g_simRegisters.ADCSRA, ADIE},
+};
+
+#define SIM_NUM_OF_TIMER_INTERRUPTS		(sizeof(g_timerInterrupts) / sizeof(g_timerInterrupts[0]))
+
+/*******************************************************************************
+ *                  Default (empty) Interrupt Service Routines                 *
+ *******************************************************************************/
+
+#define SIM_WEAK_VECTOR(vector)		__attribute__((weak)) void vector(void){}
+
+SIM_WEAK_VECTOR(INT0_vect)
+SIM_WEAK_VECTOR(INT1_vect)
+SIM_WEAK_VECTOR(INT2_vect)
+SIM_WEAK_VECTOR(TIMER2_COMP_vect)
+SIM_WEAK_VECTOR(TIMER2_OVF_vect)
+SIM_WEAK_VECTOR(TIMER1_CAPT_vect)
+SIM_WEAK_VECTOR(TIMER1_COMPA_vect)
+SIM_WEAK_VECTOR(TIMER1_COMPB_vect)
+SIM_WEAK_VECTOR(TIMER1_OVF_vect)
+SIM_WEAK_VECTOR(TIMER0_COMP_vect)
+SIM_WEAK_VECTOR(TIMER0_OVF_vect)
+SIM_WEAK_VECTOR(SPI_STC_vect)
+SIM_WEAK_VECTOR(USART_RXC_vect)
+SIM_WEAK_VECTOR(USART_UDRE_vect)
+SIM_WEAK_VECTOR(USART_TXC_vect)
+SIM_WEAK_VECTOR(ADC_vect)
+SIM_WEAK_VECTOR(EE_RDY_vect)
+SIM_WEAK_VECTOR(ANA_COMP_vect)
+SIM_WEAK_VECTOR(TWI_vect)
+SIM_WEAK_VECTOR(SPM_RDY_vect)
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the Timer1 clock divider selected by CS12:0 (0 when the timer is stopped)
+ */
+static uint16 Sim_timer1Prescaler(void){
+	static const uint16 prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+	return prescalers[g_simRegisters.TCCR1B & 0x07];
+}
+
+/*
+ * Description :
+ * Return the ticks from the current TCNT1 to the next time it equals a value (1..65536)
+ */
+static uint32 Sim_ticksUntil(uint16 value){
+	uint32 ticks = (uint16)(value - g_simRegisters.TCNT1);
+
+	return (ticks == 0) ? 0x10000 : ticks;
+}
+
+/*
+ * Description :
+ * Bring TCNT1 up to the current time and raise the overflow and compare flags it passed,
+ * the OCR1A match sets or clears OC1A as selected by COM1A1:0 at the time of the match
+ */
+static void Sim_syncTimer1(void){
+	uint16 prescaler = Sim_timer1Prescaler();
+	uint64 ticks;
+	uint32 untilCompareA;
+
+	if(prescaler == 0){
+		g_timer1Sync = g_cycles;
+		return;
+	}
+
+	ticks = (g_cycles - g_timer1Sync) / prescaler;
+	if(ticks == 0){
+		return;
+	}
+	untilCompareA = Sim_ticksUntil(g_simRegisters.OCR1A);
+
+	if(ticks >= untilCompareA){
+		g_simRegisters.TIFR |= (1<<OCF1A);
+		if(g_simRegisters.TCCR1A & (1<<COM1A1)){
+			g_outputCompareA = (g_simRegisters.TCCR1A & (1<<COM1A0)) ? LOGIC_HIGH : LOGIC_LOW;
+			g_outputCompareCycle = g_timer1Sync + ((uint64)untilCompareA * prescaler);
+		}
+	}
+	g_timer1Sync += ticks * prescaler;
+
+	if(ticks >= Sim_ticksUntil(g_simRegisters.OCR1B)){
+		g_simRegisters.TIFR |= (1<<OCF1B);
+	}
+	if(ticks >= Sim_ticksUntil(0)){
+		g_simRegisters.TIFR |= (1<<TOV1);
+	}
+
+	g_simRegisters.TCNT1 = (uint16)(g_simRegisters.TCNT1 + ticks);
+}
+
+/*
+ * Description :
+ * Return the time of the next Timer1 overflow or compare match
+ */
+static uint64 Sim_nextTimer1Event(void){
+	uint16 prescaler = Sim_timer1Prescaler();
+	uint32 ticks;
+
+	if(prescaler == 0){
+		return (uint64)-1;
+	}
+
+	ticks = Sim_ticksUntil(0);
+	if(Sim_ticksUntil(g_simRegisters.OCR1A) < ticks){
+		ticks = Sim_ticksUntil(g_simRegisters.OCR1A);
+	}
+	if(Sim_ticksUntil(g_simRegisters.OCR1B) < ticks){
+		ticks = Sim_ticksUntil(g_simRegisters.OCR1B);
+	}
+
+	return g_timer1Sync + ((uint64)ticks * prescaler);
+}
+
+/*
+ * Description :
+ * Return TRUE if an 8-bit timer is in CTC mode (WGMx1:0 = 2)
+ */
+static boolean Sim_timer8Ctc(const Sim_Timer8Type * timer_ptr){
+	return ((*timer_ptr->tccr_ptr & (1<<WGM01)) && !(*timer_ptr->tccr_ptr & (1<<WGM00))) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * Return the ticks of an 8-bit timer to its next compare match (1..256)
+ */
+static uint32 Sim_timer8UntilMatch(const Sim_Timer8Type * timer_ptr){
+	uint32 ticks = (uint8)(*timer_ptr->ocr_ptr - *timer_ptr->tcnt_ptr);
+
+	if(ticks == 0){
+		/* In CTC mode the counter restarts from 0 on the tick after the match */
+		ticks = Sim_timer8Ctc(timer_ptr) ? ((uint32)*timer_ptr->ocr_ptr + 1) : 0x100;
+	}
+
+	return ticks;
+}
+
+/*
+ * Description :
+ * Return the ticks of an 8-bit timer to its next overflow (0 if it does not overflow)
+ */
+static uint32 Sim_timer8UntilOverflow(const Sim_Timer8Type * timer_ptr){
+	if(Sim_timer8Ctc(timer_ptr) && (*timer_ptr->tcnt_ptr <= *timer_ptr->ocr_ptr)){
+		return 0;
+	}
+
+	return 0x100 - *timer_ptr->tcnt_ptr;
+}
+
+/*
+ * Description :
+ * Bring an 8-bit timer up to the current time and raise the compare and overflow flags it passed
+ */
+static void Sim_syncTimer8(Sim_Timer8Type * timer_ptr){
+	uint16 prescaler = timer_ptr->prescalers[*timer_ptr->tccr_ptr & 0x07];
+	uint64 ticks;
+
+	if(prescaler == 0){
+		timer_ptr->sync = g_cycles;
+		return;
+	}
+
+	ticks = (g_cycles - timer_ptr->sync) / prescaler;
+	timer_ptr->sync += ticks * prescaler;
+
+	/* Step from event to event, a step never passes a compare match or an overflow */
+	while(ticks > 0){
+		uint32 untilMatch = Sim_timer8UntilMatch(timer_ptr);
+		uint32 untilOverflow = Sim_timer8UntilOverflow(timer_ptr);
+		uint32 step = (ticks < untilMatch) ? (uint32)ticks : untilMatch;
+
+		if((untilOverflow != 0) && (untilOverflow < step)){
+			step = untilOverflow;
+		}
+
+		if(Sim_timer8Ctc(timer_ptr) && (*timer_ptr->tcnt_ptr == *timer_ptr->ocr_ptr)){
+			*timer_ptr->tcnt_ptr = (uint8)(step - 1);
+		}
+		else{
+			*timer_ptr->tcnt_ptr = (uint8)(*timer_ptr->tcnt_ptr + step);
+		}
+
+		if(step == untilMatch){
+			g_simRegisters.TIFR |= (1<<timer_ptr->ocfBit);
+		}
+		if(step == untilOverflow){
+			g_simRegisters.TIFR |= (1<<timer_ptr->tovBit);
+		}
+
+		ticks -= step;
+	}
+}
+
+/*
+ * Description :
+ * Return the time of the next compare match or overflow of an 8-bit timer
+ */
+static uint64 Sim_nextTimer8Event(const Sim_Timer8Type * timer_ptr){
+	uint16 prescaler = timer_ptr->prescalers[*timer_ptr->tccr_ptr & 0x07];
+	uint32 ticks;
+
+	if(prescaler == 0){
+		return (uint64)-1;
+	}
+
+	ticks = Sim_timer8UntilMatch(timer_ptr);
+	if((Sim_timer8UntilOverflow(timer_ptr) != 0) && (Sim_timer8UntilOverflow(timer_ptr) < ticks)){
+		ticks = Sim_timer8UntilOverflow(timer_ptr);
+	}
+
+	return timer_ptr->sync + ((uint64)ticks * prescaler);
+}
+
+/*
+ * Description :
+ * Bring all the timers up to the current time
+ */
+static void Sim_syncTimers(void){
+	Sim_syncTimer1();
+	Sim_syncTimer8(&g_timers8[0]);
+	Sim_syncTimer8(&g_timers8[1]);
+}
+
+/*
+ * Description :
+ * Change the outside level of a pin and capture the edge if it is ICP1 (PD6)
+ */
+static void Sim_applyPinLevel(uint8 port_num, uint8 pin_num, uint8 level){
+	uint8 oldLevel = (g_pinInputs[port_num] >> pin_num) & 0x01;
+
+	if(level){
+		g_pinInputs[port_num] |= (1<<pin_num);
+	}
+	else{
+		g_pinInputs[port_num] &= ~(1<<pin_num);
+	}
+
+	if((port_num == 3) && (pin_num == 6) && (oldLevel != level) && !(g_simRegisters.DDRD & (1<<6))){
+
+		/* The edge selected by ICES1 copies TCNT1 to ICR1 and raises ICF1 */
+		if(((g_simRegisters.TCCR1B >> ICES1) & 0x01) == level){
+			Sim_syncTimer1();
+			g_simRegisters.ICR1 = g_simRegisters.TCNT1;
+			g_simRegisters.TIFR |= (1<<ICF1);
+		}
+	}
+}
+
+/*
+ * Description :
+ * Raise INTF0/INTF1 on the edges of PD2/PD3 selected by MCUCR, the pins are sampled like
+ * the hardware does even when they are outputs (the level interrupt is not modelled)
+ */
+static void Sim_checkExternalInterrupts(void){
+	uint8 levels = (SIM_getPinLevel(3, 2) << 0) | (SIM_getPinLevel(3, 3) << 1);
+	uint8 changed = levels ^ g_externalLevels;
+	uint8 i;
+
+	for(i = 0; i < 2; i++){
+		uint8 sense = (g_simRegisters.MCUCR >> (i * 2)) & 0x03;
+		uint8 level = (levels >> i) & 0x01;
+
+		if((changed & (1<<i)) && ((sense == 1) || ((sense == 2) && !level) || ((sense == 3) && level))){
+			g_simRegisters.GIFR |= (1<<((i == 0) ? INTF0 : INTF1));
+		}
+	}
+	g_externalLevels = levels;
+}
+
+/*
+ * Description :
+ * Call all the peripheral models once
+ */
+static void Sim_runObservers(void){
+	uint8 i;
+
+	if(g_inObserver){
+		return;
+	}
+
+	Sim_checkExternalInterrupts();
+
+	g_inObserver = TRUE;
+	for(i = 0; i < g_numOfObservers; i++){
+		(*g_observers[i])();
+	}
+	g_inObserver = FALSE;
+}
+
+/*
+ * Description :
+ * Return the SCK divider selected by SPI2X and SPR1:0
+ */
+static uint16 Sim_spiDivider(void){
+	static const uint8 dividers[4] = {4, 16, 64, 128};
+	uint8 divider = dividers[g_simRegisters.SPCR & 0x03];
+
+	return (g_simRegisters.SPSR & (1<<SPI2X)) ? (divider / 2) : divider;
+}
+
+/*
+ * Description :
+ * Return the ADC clock divider selected by ADPS2:0
+ */
+static uint8 Sim_adcDivider(void){
+	uint8 prescaler = g_simRegisters.ADCSRA & 0x07;
+
+	return (prescaler == 0) ? 2 : (uint8)(1 << prescaler);
+}
+
+/*
+ * Description :
+ * Clear the TIFR and GIFR flags written with one by the drivers since the last access,
+ * start the SPI transfer of a SPDR write, do the EEPROM read or write started in EECR,
+ * start the conversion of an ADSC write
+ */
+static void Sim_applyFlagsWrite(void){
+	if((g_flagsCopy & 0xFF00) != 0xFF00){
+		g_simRegisters.TIFR &= ~(uint8)g_flagsCopy;
+	}
+	g_flagsCopy = 0xFF00;
+
+	if((g_interruptFlagsCopy & 0xFF00) != 0xFF00){
+		g_simRegisters.GIFR &= ~(uint8)g_interruptFlagsCopy;
+	}
+	g_interruptFlagsCopy = 0xFF00;
+
+	/* SPDR written in master mode: the byte is shifted out in 8 SCK periods */
+	if((g_spiDataCopy & 0xFF00) != 0xFF00){
+		g_simRegisters.SPDR = (uint8)g_spiDataCopy;
+		if((g_simRegisters.SPCR & (1<<SPE)) && (g_simRegisters.SPCR & (1<<MSTR))){
+			g_spiBusyUntil = g_cycles + 8 * Sim_spiDivider();
+		}
+	}
+	g_spiDataCopy = 0xFF00;
+
+	/* EERE: the byte is in EEDR at once */
+	if(g_simRegisters.EECR & (1<<EERE)){
+		g_simRegisters.EECR &= ~(1<<EERE);
+		g_simRegisters.EEDR = g_eeprom[g_simRegisters.EEAR % SIM_EEPROM_SIZE];
+	}
+
+	/* EEWE: written only with EEMWE set before, EEWE stays set until the end of the write */
+	if((g_simRegisters.EECR & (1<<EEWE)) && (g_eepromBusyUntil == 0)){
+		if(g_simRegisters.EECR & (1<<EEMWE)){
+			g_eeprom[g_simRegisters.EEAR % SIM_EEPROM_SIZE] = g_simRegisters.EEDR;
+			g_eepromWrites++;
+			g_eepromBusyUntil = g_cycles + SIM_EEPROM_WRITE_CYCLES;
+		}
+		else{
+			g_simRegisters.EECR &= ~(1<<EEWE);
+		}
+		g_simRegisters.EECR &= ~(1<<EEMWE);
+	}
+
+	/* ADSC: the result is ready after 13 ADC clocks */
+	if((g_simRegisters.ADCSRA & (1<<ADEN)) && (g_simRegisters.ADCSRA & (1<<ADSC)) && (g_adcBusyUntil == 0)){
+		g_adcBusyUntil = g_cycles + 13 * (uint64)Sim_adcDivider();
+	}
+}
+
+/*
+ * Description :
+ * End the SPI transfer when it is due: the byte is out on MOSI, SPIF is raised
+ */
+static void Sim_syncSpi(void){
+	if((g_spiBusyUntil != 0) && (g_cycles >= g_spiBusyUntil)){
+		g_spiBusyUntil = 0;
+		g_spiOutput = g_simRegisters.SPDR;
+		g_simRegisters.SPSR |= (1<<SPIF);
+	}
+}
+
+/*
+ * Description :
+ * End the ADC conversion when it is due: the input of the channel against the reference
+ * of REFS1:0 (AREF is wired to AVCC) is in ADC, ADSC is cleared and ADIF raised
+ */
+static void Sim_syncAdc(void){
+	uint16 reference;
+	uint32 value;
+
+	if((g_adcBusyUntil != 0) && (g_cycles >= g_adcBusyUntil)){
+		g_adcBusyUntil = 0;
+		reference = ((g_simRegisters.ADMUX >> REFS0) == 3) ? SIM_ADC_INTERNAL_MV : SIM_ADC_AVCC_MV;
+		value = ((uint32)g_adcInputs[g_simRegisters.ADMUX & 0x07] * 1024) / reference;
+		g_simRegisters.ADC = (value > 1023) ? 1023 : (uint16)value;
+		g_simRegisters.ADCSRA &= ~(1<<ADSC);
+		g_simRegisters.ADCSRA |= (1<<ADIF);
+	}
+}
+
+/*
+ * Description :
+ * End the EEPROM write when it is due: EEWE is cleared
+ */
+static void Sim_syncEeprom(void){
+	if((g_eepromBusyUntil != 0) && (g_cycles >= g_eepromBusyUntil)){
+		g_eepromBusyUntil = 0;
+		g_simRegisters.EECR &= ~(1<<EEWE);
+	}
+}
+
+/*
+ * Description :
+ * Execute an interrupt vector with the interrupts blocked after its modelled service time
+ */
+static void Sim_callVector(void(*vector)(void)){
+	uint64 start = g_cycles;
+
+	g_simRegisters.SREG &= ~(1<<SREG_I);
+	if(g_interruptCycles != 0){
+		SIM_advanceCycles(g_interruptCycles);
+	}
+	(*vector)();
+	g_simRegisters.SREG |= (1<<SREG_I);
+
+	g_interruptTotal += g_cycles - start;
+}
+
+/*
+ * Description :
+ * Return the number of CPU cycles needed to send one UART frame
+ */
+static uint64 Sim_uartFrameCycles(void){
+	uint16 ubrr = (uint16)(((g_simRegisters.UBRRH & 0x0F) << 8) | g_simRegisters.UBRRL);
+	uint8 divider = (g_simRegisters.UCSRA & (1<<U2X)) ? 8 : 16;
+
+	/* Start bit, 8 data bits and a stop bit */
+	return (uint64)10 * divider * (ubrr + 1);
+}
+
+/*
+ * Description :
+ * Receive the input bytes that are complete: RXC is raised for each of them,
+ * a byte complete while RXC is still set is lost (DOR)
+ */
+static void Sim_syncUartInput(void){
+	while((g_uartInputAt != 0) && (g_cycles >= g_uartInputAt)){
+		if(g_simRegisters.UCSRB & (1<<RXEN)){
+			if(g_simRegisters.UCSRA & (1<<RXC)){
+				g_simRegisters.UCSRA |= (1<<DOR);
+			}
+			else{
+				g_uartReceived = g_uartInput[g_uartInputRead];
+				g_simRegisters.UCSRA |= (1<<RXC);
+			}
+		}
+		g_uartInputRead++;
+
+		if(g_uartInputRead < g_uartInputSize){
+			g_uartInputAt += Sim_uartFrameCycles();
+		}
+		else{
+			g_uartInputSize = 0;
+			g_uartInputRead = 0;
+			g_uartInputAt = 0;
+		}
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the registers, the time, the scheduled pin changes and the UART output
+ * (the peripheral models stay registered)
+ */
+void SIM_reset(void){
+	memset((void *)&g_simRegisters, 0, sizeof(g_simRegisters));
+	memset(g_pinInputs, 0, sizeof(g_pinInputs));
+	memset(g_pinEvents, 0, sizeof(g_pinEvents));
+
+	/* The transmit data register is empty after reset */
+	g_simRegisters.UCSRA = (1<<UDRE);
+
+	g_cycles = 0;
+	g_timer1Sync = 0;
+	g_outputCompareA = LOGIC_LOW;
+	g_outputCompareCycle = 0;
+	g_timers8[0].sync = 0;
+	g_timers8[1].sync = 0;
+	g_uartOutputSize = 0;
+	g_uartBusyUntil = 0;
+	g_uartInputSize = 0;
+	g_uartInputRead = 0;
+	g_uartInputAt = 0;
+	g_interruptTotal = 0;
+	g_twiPending = FALSE;
+	g_externalLevels = 0;
+	g_spiBusyUntil = 0;
+	g_eepromBusyUntil = 0;
+	g_adcBusyUntil = 0;
+}
+
+/*
+ * Description :
+ * Return the simulated time in CPU cycles
+ */
+uint64 SIM_getCycles(void){
+	return g_cycles;
+}
+
+/*
+ * Description :
+ * Advance the simulated time, the interrupts that become pending are served on the way
+ */
+void SIM_advanceCycles(uint64 cycles){
+	uint64 target = g_cycles + cycles;
+	uint8 i;
+
+	/* The models see the last register writes at the time they were done */
+	Sim_applyFlagsWrite();
+	Sim_runObservers();
+	SIM_serveInterrupts();
+
+	do{
+		uint64 next = target;
+		uint64 timerEvent = Sim_nextTimer1Event();
+
+		for(i = 0; i < 2; i++){
+			if(Sim_nextTimer8Event(&g_timers8[i]) < timerEvent){
+				timerEvent = Sim_nextTimer8Event(&g_timers8[i]);
+			}
+		}
+
+		/* Stop at every event on the way so the interrupts are served at the right time */
+		for(i = 0; i < SIM_MAX_PIN_EVENTS; i++){
+			if(g_pinEvents[i].used && (g_pinEvents[i].cycle < next)){
+				next = g_pinEvents[i].cycle;
+			}
+		}
+		if(timerEvent < next){
+			next = timerEvent;
+		}
+		if((g_uartBusyUntil > g_cycles) && (g_uartBusyUntil < next)){
+			next = g_uartBusyUntil;
+		}
+		if((g_spiBusyUntil > g_cycles) && (g_spiBusyUntil < next)){
+			next = g_spiBusyUntil;
+		}
+		if((g_eepromBusyUntil > g_cycles) && (g_eepromBusyUntil < next)){
+			next = g_eepromBusyUntil;
+		}
+		if((g_adcBusyUntil > g_cycles) && (g_adcBusyUntil < next)){
+			next = g_adcBusyUntil;
+		}
+		if((g_uartInputAt > g_cycles) && (g_uartInputAt < next)){
+			next = g_uartInputAt;
+		}
+
+		if(next > g_cycles){
+			g_cycles = next;
+		}
+
+		Sim_syncTimers();
+		Sim_syncSpi();
+		Sim_syncEeprom();
+		Sim_syncAdc();
+		Sim_syncUartInput();
+
+		/* Apply the pin changes that are due in time order */
+		for(;;){
+			Sim_PinEventType * event_ptr = NULL_PTR;
+
+			for(i = 0; i < SIM_MAX_PIN_EVENTS; i++){
+				if(g_pinEvents[i].used && (g_pinEvents[i].cycle <= g_cycles)
+						&& ((event_ptr == NULL_PTR) || (g_pinEvents[i].cycle < event_ptr->cycle))){
+					event_ptr = &g_pinEvents[i];
+				}
+			}
+			if(event_ptr == NULL_PTR){
+				break;
+			}
+			event_ptr->used = FALSE;
+			Sim_applyPinLevel(event_ptr->port, event_ptr->pin, event_ptr->level);
+		}
+
+		Sim_runObservers();
+		SIM_serveInterrupts();
+
+	}while(g_cycles < target);
+}
+
+/*
+ * Description :
+ * Set the level driven on a pin by the outside world (seen in PINx while the pin is an input)
+ * An edge on ICP1 (PD6) is captured by Timer1 like the hardware does.
+ */
+void SIM_setPinLevel(uint8 port_num, uint8 pin_num, uint8 level){
+	if((port_num < 4) && (pin_num < 8)){
+		Sim_applyPinLevel(port_num, pin_num, (level != 0));
+	}
+}
+
+/*
+ * Description :
+ * Return the level of a pin: the PORTx bit for an output pin (OC1A on PD5 while the compare
+ * output is enabled), the outside level for an input pin
+ */
+uint8 SIM_getPinLevel(uint8 port_num, uint8 pin_num){
+	const volatile uint8 * ports[4] = {&g_simRegisters.PORTA, &g_simRegisters.PORTB, &g_simRegisters.PORTC, &g_simRegisters.PORTD};
+	const volatile uint8 * ddrs[4] = {&g_simRegisters.DDRA, &g_simRegisters.DDRB, &g_simRegisters.DDRC, &g_simRegisters.DDRD};
+
+	if((port_num >= 4) || (pin_num >= 8)){
+		return LOGIC_LOW;
+	}
+
+	if(*ddrs[port_num] & (1<<pin_num)){
+		if((port_num == 3) && (pin_num == 5) && (g_simRegisters.TCCR1A & (1<<COM1A1))){
+			Sim_syncTimer1();
+			return g_outputCompareA;
+		}
+		return (*ports[port_num] >> pin_num) & 0x01;
+	}
+
+	return (g_pinInputs[port_num] >> pin_num) & 0x01;
+}
+
+/*
+ * Description :
+ * Return the time in CPU cycles of the last change of OC1A made by the OCR1A compare match
+ */
+uint64 SIM_getOutputCompareCycle(void){
+	return g_outputCompareCycle;
+}
+
+/*
+ * Description :
+ * Schedule SIM_setPinLevel after delayCycles from now
+ */
+void SIM_schedulePinLevel(uint8 port_num, uint8 pin_num, uint8 level, uint64 delayCycles){
+	uint8 i;
+
+	for(i = 0; i < SIM_MAX_PIN_EVENTS; i++){
+		if(!g_pinEvents[i].used){
+			g_pinEvents[i].cycle = g_cycles + delayCycles;
+			g_pinEvents[i].port = port_num;
+			g_pinEvents[i].pin = pin_num;
+			g_pinEvents[i].level = (level != 0);
+			g_pinEvents[i].used = TRUE;
+			return;
+		}
+	}
+
+	fprintf(stderr, "sim: too many scheduled pin changes\n");
+}
+
+/*
+ * Description :
+ * Interrupt injection: load ICR1 with captureValue, drive ICP1 to pinLevel and
+ * raise the input capture flag, TIMER1_CAPT_vect runs now if it is enabled
+ */
+void SIM_injectCapture(uint16 captureValue, uint8 pinLevel){
+	if(pinLevel){
+		g_pinInputs[3] |= (1<<6);
+	}
+	else{
+		g_pinInputs[3] &= ~(1<<6);
+	}
+
+	g_simRegisters.ICR1 = captureValue;
+	g_simRegisters.TIFR |= (1<<ICF1);
+
+	SIM_serveInterrupts();
+}
+
+/*
+ * Description :
+ * Serve the pending interrupts now (called by sei())
+ */
+void SIM_serveInterrupts(void){
+	boolean served;
+	uint8 i;
+
+	Sim_applyFlagsWrite();
+
+	do{
+		served = FALSE;
+
+		if(!(g_simRegisters.SREG & (1<<SREG_I))){
+			return;
+		}
+		Sim_applyFlagsWrite();
+
+		/* Flag based interrupts: the flag is cleared when the vector is executed */
+		for(i = 0; i < SIM_NUM_OF_TIMER_INTERRUPTS; i++){
+			if((*g_timerInterrupts[i].flag_ptr & (1<<g_timerInterrupts[i].flagBit))
+					&& (*g_timerInterrupts[i].enable_ptr & (1<<g_timerInterrupts[i].enableBit))){
+				*g_timerInterrupts[i].flag_ptr &= ~(1<<g_timerInterrupts[i].flagBit);
+				Sim_callVector(g_timerInterrupts[i].vector);
+				served = TRUE;
+				break;
+			}
+		}
+
+		/* Receive complete: the vector reads UDR, which clears RXC and the error flags */
+		if(!served && (g_simRegisters.UCSRA & (1<<RXC)) && (g_simRegisters.UCSRB & (1<<RXCIE))){
+			g_simRegisters.UDR = g_uartReceived;
+			Sim_callVector(USART_RXC_vect);
+			g_simRegisters.UCSRA &= ~((1<<RXC) | (1<<DOR) | (1<<FE));
+			served = TRUE;
+		}
+
+		/*
+		 * Data register empty: pending while the transmitter is idle and UDRIE is set,
+		 * the ISR either writes UDR or clears UDRIE, so UDRIE still set means a byte was sent
+		 */
+		if(!served && (g_simRegisters.UCSRB & (1<<UDRIE)) && (g_simRegisters.UCSRB & (1<<TXEN))
+				&& (g_cycles >= g_uartBusyUntil)){
+			Sim_callVector(USART_UDRE_vect);
+
+			if(g_simRegisters.UCSRB & (1<<UDRIE)){
+				if(g_uartOutputSize < SIM_UART_OUTPUT_SIZE){
+					g_uartOutput[g_uartOutputSize++] = g_simRegisters.UDR;
+				}
+				g_uartBusyUntil = g_cycles + Sim_uartFrameCycles();
+			}
+			served = TRUE;
+		}
+
+		/*
+		 * TWI: TWINT is set for the vector, the TWCR write of the vector clears it. The event
+		 * stays pending until the vector returns, the bus models take its TWCR write then.
+		 */
+		if(!served && g_twiPending && (g_simRegisters.TWCR & (1<<TWEN)) && (g_simRegisters.TWCR & (1<<TWIE))){
+			g_simRegisters.TWCR |= (1<<TWINT);
+			Sim_callVector(TWI_vect);
+			g_simRegisters.TWCR &= ~(1<<TWINT);
+			g_twiPending = FALSE;
+			served = TRUE;
+		}
+
+	}while(served);
+}
+
+/*
+ * Description :
+ * TWI bus event seen by the slave: load TWSR with the status (and TWDR with the received
+ * byte), TWI_vect runs when the TWI and its interrupt are enabled, the event stays
+ * pending until then. The end of TWI_vect releases the bus (the drivers write TWINT).
+ */
+void SIM_raiseTwi(uint8 status, uint8 data){
+	g_simRegisters.TWSR = (g_simRegisters.TWSR & 0x03) | (status & 0xF8);
+	g_simRegisters.TWDR = data;
+	g_twiPending = TRUE;
+
+	if(!g_inObserver){
+		SIM_serveInterrupts();
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE while the last TWI event is not served by TWI_vect
+ */
+boolean SIM_isTwiPending(void){
+	return g_twiPending;
+}
+
+/*
+ * Description :
+ * Set the CPU cycles every served interrupt takes before its vector runs
+ */
+void SIM_setInterruptCycles(uint32 cycles){
+	g_interruptCycles = cycles;
+}
+
+/*
+ * Description :
+ * Return the CPU cycles spent in interrupt vectors since the reset
+ */
+uint64 SIM_getInterruptCycles(void){
+	return g_interruptTotal;
+}
+
+/*
+ * Description :
+ * Register a peripheral model, it is called every time the registers are accessed
+ * or the time advances and can watch the output pins and schedule input changes
+ */
+void SIM_addObserver(void(*a_observerPtr)(void)){
+	if(g_numOfObservers < SIM_MAX_OBSERVERS){
+		g_observers[g_numOfObservers++] = a_observerPtr;
+	}
+}
+
+/*
+ * Description :
+ * Return the bytes sent on the UART so far and their number
+ */
+const uint8 * SIM_getUartOutput(uint32 * size_ptr){
+	*size_ptr = g_uartOutputSize;
+	return g_uartOutput;
+}
+
+/*
+ * Description :
+ * Queue bytes sent to the UART by the outside world, they arrive at the baud rate
+ * after the bytes queued before them
+ */
+void SIM_sendUartInput(const uint8 * data_ptr, uint32 size){
+	if((g_uartInputSize + size) > SIM_UART_INPUT_SIZE){
+		fprintf(stderr, "sim: too many UART input bytes\n");
+		return;
+	}
+
+	memcpy(&g_uartInput[g_uartInputSize], data_ptr, size);
+	g_uartInputSize += size;
+
+	if((g_uartInputAt == 0) && (g_uartInputSize != 0)){
+		g_uartInputAt = g_cycles + Sim_uartFrameCycles();
+	}
+}
+
+/*
+ * Description :
+ * Forget the bytes sent on the UART so far (the record is full after SIM_UART_OUTPUT_SIZE bytes)
+ */
+void SIM_clearUartOutput(void){
+	g_uartOutputSize = 0;
+}
+
+/*
+ * Description :
+ * Access functions used by the register macros of <avr/io.h>
+ */
+volatile uint8 * SIM_accessPort(volatile uint8 * register_ptr){
+
+	/* The models see the ports before this access, i.e. after every previous write */
+	SIM_advanceCycles(SIM_ACCESS_CYCLES);
+
+	return register_ptr;
+}
+
+volatile uint8 * SIM_readPin(uint8 port_num){
+	volatile uint8 * pins[4] = {&g_simRegisters.PINA, &g_simRegisters.PINB, &g_simRegisters.PINC, &g_simRegisters.PIND};
+	const volatile uint8 * ports[4] = {&g_simRegisters.PORTA, &g_simRegisters.PORTB, &g_simRegisters.PORTC, &g_simRegisters.PORTD};
+	const volatile uint8 * ddrs[4] = {&g_simRegisters.DDRA, &g_simRegisters.DDRB, &g_simRegisters.DDRC, &g_simRegisters.DDRD};
+
+	SIM_advanceCycles(SIM_ACCESS_CYCLES);
+
+	/* Output pins read back the PORTx value, input pins the outside level */
+	*pins[port_num] = (*ports[port_num] & *ddrs[port_num]) | (g_pinInputs[port_num] & ~(*ddrs[port_num]));
+
+	return pins[port_num];
+}
+
+volatile uint16 * SIM_accessTimer1(void){
+	SIM_advanceCycles(SIM_ACCESS_CYCLES);
+	Sim_syncTimer1();
+
+	return &g_simRegisters.TCNT1;
+}
+
+volatile uint8 * SIM_accessTimer0(void){
+	SIM_advanceCycles(SIM_ACCESS_CYCLES);
+	Sim_syncTimer8(&g_timers8[0]);
+
+	return &g_simRegisters.TCNT0;
+}
+
+volatile uint8 * SIM_accessTimer2(void){
+	SIM_advanceCycles(SIM_ACCESS_CYCLES);
+	Sim_syncTimer8(&g_timers8[1]);
+
+	return &g_simRegisters.TCNT2;
+}
+
+volatile uint8 * SIM_accessStatus(void){
+
+	/*
+	 * The I-bit may have been restored by the last write, serve what became pending meanwhile,
+	 * the time also advances so a loop that waits on the I-bit or on an ISR does not stall
+	 */
+	SIM_advanceCycles(SIM_ACCESS_CYCLES);
+
+	return &g_simRegisters.SREG;
+}
+
+volatile uint16 * SIM_accessFlags(void){
+	Sim_applyFlagsWrite();
+	g_flagsCopy = 0xFF00 | g_simRegisters.TIFR;
+
+	return &g_flagsCopy;
+}
+
+volatile uint16 * SIM_accessInterruptFlags(void){
+	Sim_applyFlagsWrite();
+	g_interruptFlagsCopy = 0xFF00 | g_simRegisters.GIFR;
+
+	return &g_interruptFlagsCopy;
+}
+
+volatile uint16 * SIM_accessSpiData(void){
+	Sim_applyFlagsWrite();
+	g_spiDataCopy = 0xFF00 | g_simRegisters.SPDR;
+
+	return &g_spiDataCopy;
+}
+
+volatile uint8 * SIM_accessEeprom(void){
+
+	/* A loop that waits for the end of a write makes progress */
+	SIM_advanceCycles(SIM_ACCESS_CYCLES);
+
+	return &g_simRegisters.EECR;
+}
+
+volatile uint8 * SIM_accessEepromData(void){
+	Sim_applyFlagsWrite();
+
+	return &g_simRegisters.EEDR;
+}
+
+/*
+ * Description :
+ * Return the last byte shifted out on MOSI by the SPI master (what a shift register holds)
+ */
+uint8 SIM_getSpiOutput(void){
+	return g_spiOutput;
+}
+
+/*
+ * Description :
+ * Set the voltage in mV on an ADC input (ADC0..ADC7), it is converted by the next conversions
+ */
+void SIM_setAdcInput(uint8 channel, uint16 millivolts){
+	g_adcInputs[channel & 0x07] = millivolts;
+}
+
+/*
+ * Description :
+ * Return the EEPROM content (SIM_EEPROM_SIZE bytes, the runner may change it)
+ * and the number of bytes written by the drivers so far
+ */
+uint8 * SIM_getEeprom(uint32 * writes_ptr){
+	*writes_ptr = g_eepromWrites;
+
+	return g_eeprom;
+}
+
+/*
+ * Description :
+ * avr-libc: convert an integer to a string in the given radix
+ */
+char * itoa(int value, char * string, int radix){
+	char digits[34];
+	unsigned int magnitude = (value < 0 && radix == 10) ? (unsigned int)(-value) : (unsigned int)value;
+	int length = 0;
+	int i = 0;
+
+	do{
+		uint8 digit = magnitude % radix;
+		digits[length++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
+		magnitude /= radix;
+	}while(magnitude != 0);
+
+	if(value < 0 && radix == 10){
+		string[i++] = '-';
+	}
+	while(length > 0){
+		string[i++] = digits[--length];
+	}
+	string[i] = '\0';
+
+	return string;
+}
@@ -0,0 +1,258 @@
+ /******************************************************************************
+ *
+ * Module: SIM
+ *
+ * File Name: sim_atmega32.h
+ *
+ * Description: Simulated ATmega32 register file to build and run the drivers on a host
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_ATMEGA32_H_
+#define SIM_ATMEGA32_H_
+
+#include "std_types.h"
+
+/*
+ * How it works:
+ * The drivers include <avr/io.h> and <avr/interrupt.h>, with -Isim the host build
+ * gets the headers of this folder instead. Every register is a field of g_simRegisters.
+ * PINx and the TCNTx are read through functions because their value depends on the simulated time.
+ *
+ * Simulated time (CPU cycles at F_CPU) advances on _delay_ms/_delay_us, on SIM_advanceCycles
+ * and by SIM_ACCESS_CYCLES on every access of a PINx/PORTx/TCNTx/SREG register, so the drivers'
+ * polling loops make progress. When the time advances the timers count, scheduled pin
+ * changes are applied, the peripheral models run and pending interrupts are served if the
+ * I-bit of SREG is set. A pending interrupt is also served on the first register access
+ * after SREG restored the I-bit.
+ *
+ * TIFR and GIFR are write-one-to-clear: the drivers access a 16-bit copy whose high byte is 0xFF,
+ * a plain write of the flags to clear replaces the high byte and is applied on the next access.
+ * SPDR uses the same copy: a write starts the SPI transfer (master mode), SPIF is raised
+ * 8 SCK periods later and SIM_getSpiOutput gives the byte shifted out.
+ * EECR and EEDR are accessed through functions too: EERE and EEMWE+EEWE written in EECR
+ * read or write the EEPROM on the next access, EEWE stays set for SIM_EEPROM_WRITE_CYCLES.
+ * The EEPROM content survives SIM_reset.
+ * An ADSC write starts an ADC conversion of the voltage set by SIM_setAdcInput, ADIF is raised
+ * 13 ADC clocks later.
+ * The bytes given to SIM_sendUartInput arrive one frame time apart while the receiver is
+ * enabled, RXC is raised for each of them and cleared by USART_RXC_vect (which reads UDR),
+ * a byte arriving while RXC is still set is lost and DOR is raised.
+ */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#ifndef F_CPU
+#define F_CPU						8000000UL
+#endif
+
+/* Simulated cycles taken by one access of a time dependent register */
+#define SIM_ACCESS_CYCLES			4
+
+/* Maximum number of scheduled pin changes */
+#define SIM_MAX_PIN_EVENTS			64
+
+/* Maximum number of peripheral models */
+#define SIM_MAX_OBSERVERS			8
+
+/* Size of the buffer that records the bytes sent on the UART */
+#define SIM_UART_OUTPUT_SIZE		4096
+
+/* Size of the queue of the bytes waiting to be received by the UART */
+#define SIM_UART_INPUT_SIZE			256
+
+/* EEPROM size and the time of a byte write (8448 cycles of the 1 MHz EEPROM oscillator) */
+#define SIM_EEPROM_SIZE				1024
+#define SIM_EEPROM_WRITE_CYCLES		((F_CPU / 1000000UL) * 8448UL)
+
+/* ADC references in mV (AREF is wired to AVCC) */
+#define SIM_ADC_AVCC_MV				5000
+#define SIM_ADC_INTERNAL_MV			2560
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds all the ATmega32 I/O registers used by the drivers */
+typedef struct{
+	uint8 PORTA, PORTB, PORTC, PORTD;
+	uint8 DDRA, DDRB, DDRC, DDRD;
+	uint8 PINA, PINB, PINC, PIND;		/* Last value read, see SIM_readPin */
+	uint8 SREG;
+	uint8 MCUCR, MCUCSR, GICR, GIFR, SFIOR, WDTCR;
+	uint8 TIMSK, TIFR;
+	uint8 TCCR0, TCNT0, OCR0;
+	uint8 TCCR1A, TCCR1B;
+	uint16 TCNT1, OCR1A, OCR1B, ICR1;
+	uint8 TCCR2, TCNT2, OCR2, ASSR;
+	uint8 UCSRA, UCSRB, UCSRC, UBRRL, UBRRH, UDR;
+	uint8 TWBR, TWSR, TWAR, TWDR, TWCR;
+	uint8 SPCR, SPSR, SPDR;
+	uint8 ADMUX, ADCSRA;
+	uint16 ADC;
+	uint16 EEAR;
+	uint8 EEDR, EECR;
+}Sim_RegisterFileType;
+
+/*******************************************************************************
+ *                      Shared Global Variable                                 *
+ *******************************************************************************/
+
+extern volatile Sim_RegisterFileType g_simRegisters;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the registers, the time, the scheduled pin changes and the UART output
+ * (the peripheral models stay registered)
+ */
+void SIM_reset(void);
+
+/*
+ * Description :
+ * Return the simulated time in CPU cycles
+ */
+uint64 SIM_getCycles(void);
+
+/*
+ * Description :
+ * Advance the simulated time, the interrupts that become pending are served on the way
+ */
+void SIM_advanceCycles(uint64 cycles);
+
+/*
+ * Description :
+ * Set the level driven on a pin by the outside world (seen in PINx while the pin is an input)
+ * An edge on ICP1 (PD6) is captured by Timer1 like the hardware does.
+ */
+void SIM_setPinLevel(uint8 port_num, uint8 pin_num, uint8 level);
+
+/*
+ * Description :
+ * Return the level of a pin: the PORTx bit for an output pin (OC1A on PD5 while the compare
+ * output is enabled), the outside level for an input pin
+ */
+uint8 SIM_getPinLevel(uint8 port_num, uint8 pin_num);
+
+/*
+ * Description :
+ * Return the time in CPU cycles of the last change of OC1A made by the OCR1A compare match
+ */
+uint64 SIM_getOutputCompareCycle(void);
+
+/*
+ * Description :
+ * Schedule SIM_setPinLevel after delayCycles from now
+ */
+void SIM_schedulePinLevel(uint8 port_num, uint8 pin_num, uint8 level, uint64 delayCycles);
+
+/*
+ * Description :
+ * Interrupt injection: load ICR1 with captureValue, drive ICP1 to pinLevel and
+ * raise the input capture flag, TIMER1_CAPT_vect runs now if it is enabled
+ */
+void SIM_injectCapture(uint16 captureValue, uint8 pinLevel);
+
+/*
+ * Description :
+ * TWI bus event seen by the slave: load TWSR with the status (and TWDR with the received
+ * byte), TWI_vect runs when the TWI and its interrupt are enabled, the event stays
+ * pending until then. The end of TWI_vect releases the bus (the drivers write TWINT).
+ */
+void SIM_raiseTwi(uint8 status, uint8 data);
+
+/*
+ * Description :
+ * Return TRUE while the last TWI event is not served by TWI_vect
+ */
+boolean SIM_isTwiPending(void);
+
+/*
+ * Description :
+ * Serve the pending interrupts now (called by sei())
+ */
+void SIM_serveInterrupts(void);
+
+/*
+ * Description :
+ * Set the CPU cycles every served interrupt takes before its vector runs (0 by default),
+ * it models the service time of the vectors on the target: the interrupts stay blocked
+ * and the inputs keep changing meanwhile
+ */
+void SIM_setInterruptCycles(uint32 cycles);
+
+/*
+ * Description :
+ * Return the CPU cycles spent in interrupt vectors since the reset
+ */
+uint64 SIM_getInterruptCycles(void);
+
+/*
+ * Description :
+ * Register a peripheral model, it is called every time the registers are accessed
+ * or the time advances and can watch the output pins and schedule input changes
+ */
+void SIM_addObserver(void(*a_observerPtr)(void));
+
+/*
+ * Description :
+ * Return the bytes sent on the UART so far and their number
+ */
+const uint8 * SIM_getUartOutput(uint32 * size_ptr);
+
+/*
+ * Description :
+ * Queue bytes sent to the UART by the outside world, they arrive at the baud rate
+ * after the bytes queued before them
+ */
+void SIM_sendUartInput(const uint8 * data_ptr, uint32 size);
+
+/*
+ * Description :
+ * Forget the bytes sent on the UART so far (the record is full after SIM_UART_OUTPUT_SIZE bytes)
+ */
+void SIM_clearUartOutput(void);
+
+/*
+ * Description :
+ * Return the last byte shifted out on MOSI by the SPI master (what a shift register holds)
+ */
+uint8 SIM_getSpiOutput(void);
+
+/*
+ * Description :
+ * Set the voltage in mV on an ADC input (ADC0..ADC7), it is converted by the next conversions
+ */
+void SIM_setAdcInput(uint8 channel, uint16 millivolts);
+
+/*
+ * Description :
+ * Return the EEPROM content (SIM_EEPROM_SIZE bytes, the runner may change it)
+ * and the number of bytes written by the drivers so far
+ */
+uint8 * SIM_getEeprom(uint32 * writes_ptr);
+
+/*
+ * Description :
+ * Access functions used by the register macros of <avr/io.h>
+ */
+volatile uint8 * SIM_accessPort(volatile uint8 * register_ptr);
+volatile uint8 * SIM_readPin(uint8 port_num);
+volatile uint16 * SIM_accessTimer1(void);
+volatile uint8 * SIM_accessTimer0(void);
+volatile uint8 * SIM_accessTimer2(void);
+volatile uint8 * SIM_accessStatus(void);
+volatile uint16 * SIM_accessFlags(void);
+volatile uint16 * SIM_accessInterruptFlags(void);
+volatile uint16 * SIM_accessSpiData(void);
+volatile uint8 * SIM_accessEeprom(void);
+volatile uint8 * SIM_accessEepromData(void);
+
+#endif /* SIM_ATMEGA32_H_ */
@@ -0,0 +1,77 @@
+ /******************************************************************************
+ *
+ * Module: SIM - 74HC595 model
+ *
+ * File Name: sim_hc595.c
+ *
+ * Description: Simulated 74HC595 shift register on the SPI master of the simulated
+ *              ATmega32: the latch pin moves the shifted byte to the outputs, which
+ *              drive the HD44780 model
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "sim_hc595.h"
+#include "sim_hd44780.h"
+#include "sim_atmega32.h"
+#include "gpio.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static uint8 g_latchPort = 0;
+static uint8 g_latchPin = 0;
+
+/* Latch level at the last observation */
+static uint8 g_lastLatch = LOGIC_LOW;
+
+static uint32 g_latches = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Observer: the rising edge of RCLK copies the shift register to the outputs
+ */
+static void SIM_HC595_observe(void){
+	uint8 latch = SIM_getPinLevel(g_latchPort, g_latchPin);
+
+	if((latch == LOGIC_HIGH) && (g_lastLatch == LOGIC_LOW)){
+		g_latches++;
+		SIM_HD44780_setExpanderOutputs(SIM_getSpiOutput());
+	}
+
+	g_lastLatch = latch;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model with the pin of its storage register clock (RCLK)
+ */
+void SIM_HC595_init(uint8 latchPort, uint8 latchPin){
+	g_latchPort = latchPort;
+	g_latchPin = latchPin;
+	g_lastLatch = LOGIC_LOW;
+	g_latches = 0;
+
+	/* The storage register powers up undefined, the model starts with the outputs low */
+	SIM_HD44780_setExpanderOutputs(0x00);
+
+	SIM_addObserver(SIM_HC595_observe);
+}
+
+/*
+ * Description :
+ * Return the number of bytes latched to the outputs
+ */
+uint32 SIM_HC595_getLatches(void){
+	return g_latches;
+}
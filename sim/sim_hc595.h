@@ -0,0 +1,36 @@
+ /******************************************************************************
+ *
+ * Module: SIM - 74HC595 model
+ *
+ * File Name: sim_hc595.h
+ *
+ * Description: Simulated 74HC595 shift register on the SPI master of the simulated
+ *              ATmega32: the latch pin moves the shifted byte to the outputs, which
+ *              drive the HD44780 model
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_HC595_H_
+#define SIM_HC595_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model with the pin of its storage register clock (RCLK)
+ */
+void SIM_HC595_init(uint8 latchPort, uint8 latchPin);
+
+/*
+ * Description :
+ * Return the number of bytes latched to the outputs
+ */
+uint32 SIM_HC595_getLatches(void);
+
+#endif /* SIM_HC595_H_ */
@@ -0,0 +1,282 @@
+ /******************************************************************************
+ *
+ * Module: SIM - HC-SR04 model
+ *
+ * File Name: sim_hcsr04.c
+ *
+ * Description: Simulated HC-SR04: answers every trigger pulse with an echo pulse, or with the
+ *              pulse width or serial frame of the PWM and UART output sensors
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "sim_hcsr04.h"
+#include "sim_atmega32.h"
+#include <stdio.h>
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds the state of one sensor */
+typedef struct{
+	uint8 triggerPort;
+	uint8 triggerPin;
+	uint32 distance;			/* mm */
+
+	/* Trigger level at the last observation and the time it went high */
+	uint8 lastTrigger;
+	uint64 triggerRise;
+
+	/* The sensor ignores triggers until the current echo is finished */
+	uint64 busyUntil;
+}Sim_HCSR04_SensorType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static Sim_HCSR04_SensorType g_sensors[SIM_HCSR04_MAX_SENSORS];
+static uint8 g_numOfSensors = 0;
+
+/* Output of the models */
+static uint8 g_output = SIM_HCSR04_OUTPUT_ECHO;
+
+/* Glitch added to the echo pulses, none while the width is zero */
+static sint32 g_glitchOffset = 0;
+static uint32 g_glitchWidth = 0;
+
+/* Speed of sound of the air around the models in cm/s */
+static uint32 g_speedOfSound = SIM_HCSR04_SPEED_OF_SOUND;
+
+static uint32 g_pings = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Turn an echo time at 58 us per cm into the pulse of the PWM output at 147 us per inch
+ */
+static uint64 SIM_HCSR04_toPwmCycles(uint64 echo){
+	return (echo * SIM_HCSR04_PWM_US_PER_INCH * 100) / (58 * 254);
+}
+
+/*
+ * Description :
+ * Schedule the serial frame of a UART output model from the given delay on,
+ * return the delay of its end
+ */
+static uint64 SIM_HCSR04_scheduleFrame(uint64 delay, uint64 echo){
+	uint64 bitCycles = F_CPU / SIM_HCSR04_UART_BAUD;
+	uint32 millimetres = (uint32)((echo * 10) / ((uint64)58 * (F_CPU / 1000000UL)));
+	uint8 frame[4];
+	uint8 level = LOGIC_HIGH;
+	uint8 i;
+	uint8 bit;
+
+	/* No object: 0 mm */
+	if(echo >= (uint64)SIM_HCSR04_NO_ECHO_US * (F_CPU / 1000000UL)){
+		millimetres = 0;
+	}
+	frame[0] = 0xFF;
+	frame[1] = (uint8)(millimetres >> 8);
+	frame[2] = (uint8)millimetres;
+	frame[3] = (uint8)(frame[0] + frame[1] + frame[2]);
+
+	/* Start bit, 8 data bits least significant first, stop bit, only the changes are scheduled */
+	for(i = 0; i < 4; i++){
+		for(bit = 0; bit < 10; bit++){
+			uint8 next = (bit == 0) ? LOGIC_LOW : ((bit == 9) ? LOGIC_HIGH : ((frame[i] >> (bit - 1)) & 1));
+
+			if(next != level){
+				SIM_schedulePinLevel(3, 6, next, delay);
+				level = next;
+			}
+			delay += bitCycles;
+		}
+	}
+
+	return delay;
+}
+
+/*
+ * Description :
+ * Observer: start an echo pulse at the end of every valid trigger pulse
+ */
+static void SIM_HCSR04_observe(void){
+	uint64 now = SIM_getCycles();
+	uint8 i;
+
+	for(i = 0; i < g_numOfSensors; i++){
+		Sim_HCSR04_SensorType * sensor_ptr = &g_sensors[i];
+		uint8 trigger = SIM_getPinLevel(sensor_ptr->triggerPort, sensor_ptr->triggerPin);
+
+		if((trigger == LOGIC_HIGH) && (sensor_ptr->lastTrigger == LOGIC_LOW)){
+			sensor_ptr->triggerRise = now;
+		}
+		else if((trigger == LOGIC_LOW) && (sensor_ptr->lastTrigger == LOGIC_HIGH)){
+			uint64 delay = (uint64)SIM_HCSR04_ECHO_DELAY_US * (F_CPU / 1000000UL);
+			uint64 echo = SIM_HCSR04_getSensorEchoCycles(i);
+
+			if(((now - sensor_ptr->triggerRise) >= ((uint64)SIM_HCSR04_MIN_TRIGGER_US * (F_CPU / 1000000UL))) && (now >= sensor_ptr->busyUntil)){
+				if(g_output == SIM_HCSR04_OUTPUT_UART){
+
+					/* The frame follows the measurement */
+					sensor_ptr->busyUntil = now + SIM_HCSR04_scheduleFrame(delay + echo, echo);
+				}
+				else{
+					if(g_output == SIM_HCSR04_OUTPUT_PWM){
+						echo = SIM_HCSR04_toPwmCycles(echo);
+					}
+					SIM_schedulePinLevel(3, 6, LOGIC_HIGH, delay);
+					SIM_schedulePinLevel(3, 6, LOGIC_LOW, delay + echo);
+					if(g_glitchWidth != 0){
+						uint64 glitch = delay + (sint64)g_glitchOffset * (sint64)(F_CPU / 1000000UL);
+						uint8 level = (g_glitchOffset < 0) ? LOGIC_HIGH : LOGIC_LOW;
+
+						SIM_schedulePinLevel(3, 6, level, glitch);
+						SIM_schedulePinLevel(3, 6, !level, glitch + (uint64)g_glitchWidth * (F_CPU / 1000000UL));
+					}
+					sensor_ptr->busyUntil = now + delay + echo;
+				}
+				g_pings++;
+			}
+		}
+
+		sensor_ptr->lastTrigger = trigger;
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register a model on the given trigger pin, the echo is driven on ICP1 (PD6).
+ * The first model is sensor 0, the functions without a sensor argument act on it.
+ * Return the sensor number of the model.
+ */
+uint8 SIM_HCSR04_init(uint8 triggerPort, uint8 triggerPin){
+	Sim_HCSR04_SensorType * sensor_ptr;
+
+	if(g_numOfSensors >= SIM_HCSR04_MAX_SENSORS){
+		fprintf(stderr, "sim: too many HC-SR04 models\n");
+		return 0;
+	}
+
+	/* One observer serves all the models */
+	if(g_numOfSensors == 0){
+		g_pings = 0;
+		SIM_addObserver(SIM_HCSR04_observe);
+	}
+
+	sensor_ptr = &g_sensors[g_numOfSensors];
+	sensor_ptr->triggerPort = triggerPort;
+	sensor_ptr->triggerPin = triggerPin;
+	sensor_ptr->distance = 0;
+	sensor_ptr->lastTrigger = LOGIC_LOW;
+	sensor_ptr->triggerRise = 0;
+	sensor_ptr->busyUntil = 0;
+
+	return g_numOfSensors++;
+}
+
+/*
+ * Description :
+ * Set the output of the models (SIM_HCSR04_OUTPUT_ECHO by default), the UART output
+ * sets ICP1 idle high
+ */
+void SIM_HCSR04_setOutput(uint8 output){
+	g_output = output;
+	SIM_setPinLevel(3, 6, (output == SIM_HCSR04_OUTPUT_UART) ? LOGIC_HIGH : LOGIC_LOW);
+}
+
+/*
+ * Description :
+ * Add a glitch of widthUs micro seconds to the next echo pulses (echo and PWM outputs):
+ * a dropout offsetUs after the start of the pulse, or a spike before the pulse when
+ * offsetUs is negative. A zero width removes it.
+ */
+void SIM_HCSR04_setGlitch(sint32 offsetUs, uint32 widthUs){
+	g_glitchOffset = offsetUs;
+	g_glitchWidth = widthUs;
+}
+
+/*
+ * Description :
+ * Set the distance of the object in cm, 0 means no object (maximum echo pulse)
+ */
+void SIM_HCSR04_setDistance(uint16 distance){
+	SIM_HCSR04_setSensorDistance(0, (uint32)distance * 10);
+}
+
+/*
+ * Description :
+ * Set the distance of the object seen by a sensor in mm, 0 means no object
+ */
+void SIM_HCSR04_setSensorDistance(uint8 sensor, uint32 millimetres){
+	if(sensor < SIM_HCSR04_MAX_SENSORS){
+		g_sensors[sensor].distance = millimetres;
+	}
+}
+
+/*
+ * Description :
+ * Return the echo pulse width in CPU cycles for the current distance
+ */
+uint64 SIM_HCSR04_getEchoCycles(void){
+	return SIM_HCSR04_getSensorEchoCycles(0);
+}
+
+/*
+ * Description :
+ * Return the echo pulse width in CPU cycles of a sensor for its current distance
+ */
+uint64 SIM_HCSR04_getSensorEchoCycles(uint8 sensor){
+	if((sensor >= SIM_HCSR04_MAX_SENSORS) || (g_sensors[sensor].distance == 0)){
+		return (uint64)SIM_HCSR04_NO_ECHO_US * (F_CPU / 1000000UL);
+	}
+
+	/* The sound travels to the object and back */
+	return ((uint64)g_sensors[sensor].distance * 2 * F_CPU) / ((uint64)g_speedOfSound * 10);
+}
+
+/*
+ * Description :
+ * Return the width in CPU cycles of the pulse driven for the current distance
+ * (the echo or the PWM output pulse)
+ */
+uint64 SIM_HCSR04_getPulseCycles(void){
+	uint64 echo = SIM_HCSR04_getEchoCycles();
+
+	return (g_output == SIM_HCSR04_OUTPUT_PWM) ? SIM_HCSR04_toPwmCycles(echo) : echo;
+}
+
+/*
+ * Description :
+ * Set the speed of sound in cm/s (SIM_HCSR04_SPEED_OF_SOUND by default),
+ * it changes the echo pulse of the next triggers
+ */
+void SIM_HCSR04_setSpeedOfSound(uint32 speed){
+	g_speedOfSound = speed;
+}
+
+/*
+ * Description :
+ * Return the number of trigger pulses answered by the models
+ */
+uint32 SIM_HCSR04_getPings(void){
+	return g_pings;
+}
+
+/*
+ * Description :
+ * Return the time in CPU cycles of the rising edge of the last trigger pulse of sensor 0
+ */
+uint64 SIM_HCSR04_getTriggerCycle(void){
+	return g_sensors[0].triggerRise;
+}
@@ -0,0 +1,125 @@
+ /******************************************************************************
+ *
+ * Module: SIM - HC-SR04 model
+ *
+ * File Name: sim_hcsr04.h
+ *
+ * Description: Simulated HC-SR04: answers every trigger pulse with an echo pulse
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_HCSR04_H_
+#define SIM_HCSR04_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Speed of sound used by the model in cm/s until SIM_HCSR04_setSpeedOfSound */
+#define SIM_HCSR04_SPEED_OF_SOUND		34000
+
+/* Delay from the end of the trigger pulse to the start of the echo pulse in micro seconds */
+#define SIM_HCSR04_ECHO_DELAY_US		460
+
+/* Echo pulse width when no object is found in micro seconds */
+#define SIM_HCSR04_NO_ECHO_US			38000
+
+/* Shortest trigger pulse accepted by the sensor in micro seconds */
+#define SIM_HCSR04_MIN_TRIGGER_US		10
+
+/* Models that can be registered, they all drive the echo on ICP1 (wired OR) */
+#define SIM_HCSR04_MAX_SENSORS			2
+
+/*
+ * Outputs of the models (SIM_HCSR04_setOutput): the echo pulse, a pulse of 147 us per inch
+ * (PWM output sensors) or a serial frame (UART output modules: 9600 baud 8N1, 0xFF, distance
+ * in mm high byte first, sum), both from the echo time at 58 us per cm
+ */
+#define SIM_HCSR04_OUTPUT_ECHO			0
+#define SIM_HCSR04_OUTPUT_PWM			1
+#define SIM_HCSR04_OUTPUT_UART			2
+#define SIM_HCSR04_PWM_US_PER_INCH		147
+#define SIM_HCSR04_UART_BAUD			9600
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register a model on the given trigger pin, the echo is driven on ICP1 (PD6).
+ * The first model is sensor 0, the functions without a sensor argument act on it.
+ * Return the sensor number of the model.
+ */
+uint8 SIM_HCSR04_init(uint8 triggerPort, uint8 triggerPin);
+
+/*
+ * Description :
+ * Set the output of the models (SIM_HCSR04_OUTPUT_ECHO by default), the UART output
+ * sets ICP1 idle high
+ */
+void SIM_HCSR04_setOutput(uint8 output);
+
+/*
+ * Description :
+ * Add a glitch of widthUs micro seconds to the next echo pulses (echo and PWM outputs):
+ * a dropout offsetUs after the start of the pulse, or a spike before the pulse when
+ * offsetUs is negative. A zero width removes it.
+ */
+void SIM_HCSR04_setGlitch(sint32 offsetUs, uint32 widthUs);
+
+/*
+ * Description :
+ * Set the distance of the object in cm, 0 means no object (maximum echo pulse)
+ */
+void SIM_HCSR04_setDistance(uint16 distance);
+
+/*
+ * Description :
+ * Set the distance of the object seen by a sensor in mm, 0 means no object
+ */
+void SIM_HCSR04_setSensorDistance(uint8 sensor, uint32 millimetres);
+
+/*
+ * Description :
+ * Return the echo pulse width in CPU cycles for the current distance
+ */
+uint64 SIM_HCSR04_getEchoCycles(void);
+
+/*
+ * Description :
+ * Return the echo pulse width in CPU cycles of a sensor for its current distance
+ */
+uint64 SIM_HCSR04_getSensorEchoCycles(uint8 sensor);
+
+/*
+ * Description :
+ * Return the width in CPU cycles of the pulse driven for the current distance
+ * (the echo or the PWM output pulse)
+ */
+uint64 SIM_HCSR04_getPulseCycles(void);
+
+/*
+ * Description :
+ * Set the speed of sound in cm/s (SIM_HCSR04_SPEED_OF_SOUND by default),
+ * it changes the echo pulse of the next triggers
+ */
+void SIM_HCSR04_setSpeedOfSound(uint32 speed);
+
+/*
+ * Description :
+ * Return the number of trigger pulses answered by the models
+ */
+uint32 SIM_HCSR04_getPings(void);
+
+/*
+ * Description :
+ * Return the time in CPU cycles of the rising edge of the last trigger pulse of sensor 0
+ */
+uint64 SIM_HCSR04_getTriggerCycle(void);
+
+#endif /* SIM_HCSR04_H_ */
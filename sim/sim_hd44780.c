@@ -0,0 +1,352 @@
+ /******************************************************************************
+ *
+ * Module: SIM - HD44780 model
+ *
+ * File Name: sim_hd44780.c
+ *
+ * Description: Simulated HD44780 LCD controller wired as configured in lcd.h
+ *              (on the MCU pins or on the outputs of the PCF8574 or 74HC595 model)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "sim_hd44780.h"
+#include "sim_atmega32.h"
+#include "gpio.h"
+#include "lcd.h"
+#include "common_macros.h"
+#include <string.h>
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Display data RAM, indexed by the DDRAM address */
+static uint8 g_ddram[128];
+
+/* Character generator RAM: 8 glyphs of 8 rows */
+static uint8 g_cgram[64];
+
+/* Address counter, the RAM it addresses and entry mode */
+static uint8 g_addressCounter = 0;
+static boolean g_cgramSelected = FALSE;
+static boolean g_increment = TRUE;
+
+/* Interface width, the controller powers up in 8-bit mode */
+static boolean g_eightBitMode = TRUE;
+
+/* In 4-bit mode: the high nibble received, waiting for the low one */
+static boolean g_nibblePending = FALSE;
+static uint8 g_highNibble = 0;
+
+/* E level at the last observation and the bus seen while E was high */
+static uint8 g_lastEnable = LOGIC_LOW;
+static uint8 g_latchedRs = LOGIC_LOW;
+static uint8 g_latchedData = 0;
+
+/* The controller accepts the next transfer after this time */
+static uint64 g_busyUntil = 0;
+
+/* Byte driven on the data lines by the current read (both nibbles in 4-bit mode) */
+static uint8 g_readValue = 0;
+
+static Sim_HD44780_StatsType g_stats;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
+
+/*
+ * Description :
+ * Return the value on the data lines of the controller
+ */
+static uint8 SIM_HD44780_readDataLines(void){
+#if(LCD_BIT_MODE == 4)
+
+	/* Only D7..D4 are wired, D3..D0 read as low */
+	return (SIM_getPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID)<<4)
+			| (SIM_getPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID)<<5)
+			| (SIM_getPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID)<<6)
+			| (SIM_getPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID)<<7);
+
+#else
+
+	uint8 value = 0;
+	uint8 pin;
+
+	for(pin = 0; pin < 8; pin++){
+		value |= (SIM_getPinLevel(LCD_DATA_PORT_ID, pin)<<pin);
+	}
+
+	return value;
+
+#endif
+}
+
+/*
+ * Description :
+ * Drive the data lines of the controller (read cycle), the MCU sees them on its input pins
+ */
+static void SIM_HD44780_driveDataLines(uint8 value){
+#if(LCD_BIT_MODE == 4)
+
+	SIM_setPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT4_PIN_ID, GET_BIT(value,4));
+	SIM_setPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT5_PIN_ID, GET_BIT(value,5));
+	SIM_setPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT6_PIN_ID, GET_BIT(value,6));
+	SIM_setPinLevel(LCD_DATA_PORT_ID, LCD_DATA_BIT7_PIN_ID, GET_BIT(value,7));
+
+#else
+
+	uint8 pin;
+
+	for(pin = 0; pin < 8; pin++){
+		SIM_setPinLevel(LCD_DATA_PORT_ID, pin, GET_BIT(value,pin));
+	}
+
+#endif
+}
+
+#else
+
+/*
+ * Description :
+ * The backpack only writes (RW stays low), nothing drives the data lines back
+ */
+static void SIM_HD44780_driveDataLines(uint8 value){
+	(void)value;
+}
+
+#endif
+
+/*
+ * Description :
+ * Execute one complete instruction or data byte
+ */
+static void SIM_HD44780_execute(uint8 rs, uint8 value){
+	uint32 execUs = SIM_HD44780_SHORT_EXEC_US;
+
+	if((rs == LOGIC_HIGH) && g_cgramSelected){
+		g_cgram[g_addressCounter & 0x3F] = value & 0x1F;
+		g_addressCounter = (g_addressCounter + (g_increment ? 1 : -1)) & 0x3F;
+		g_stats.glyphRows++;
+	}
+	else if(rs == LOGIC_HIGH){
+		g_ddram[g_addressCounter & 0x7F] = value;
+		g_addressCounter = (g_addressCounter + (g_increment ? 1 : -1)) & 0x7F;
+		g_stats.characters++;
+	}
+	else{
+		g_stats.commands++;
+
+		if(value & 0x80){
+			/* Set DDRAM address */
+			g_addressCounter = value & 0x7F;
+			g_cgramSelected = FALSE;
+		}
+		else if(value & 0x40){
+			/* Set CGRAM address */
+			g_addressCounter = value & 0x3F;
+			g_cgramSelected = TRUE;
+		}
+		else if(value & 0x20){
+			/* Function set */
+			g_eightBitMode = (value & 0x10) ? TRUE : FALSE;
+		}
+		else if(value & 0x10){
+			/* Cursor or display shift */
+			if(!(value & 0x08)){
+				g_addressCounter = (g_addressCounter + ((value & 0x04) ? 1 : -1)) & 0x7F;
+			}
+		}
+		else if(value & 0x08){
+			/* Display on/off control: the content is kept */
+		}
+		else if(value & 0x04){
+			/* Entry mode set */
+			g_increment = (value & 0x02) ? TRUE : FALSE;
+		}
+		else if(value & 0x02){
+			/* Return home */
+			g_addressCounter = 0;
+			g_cgramSelected = FALSE;
+			execUs = SIM_HD44780_LONG_EXEC_US;
+		}
+		else if(value & 0x01){
+			/* Clear display */
+			memset(g_ddram, ' ', sizeof(g_ddram));
+			g_addressCounter = 0;
+			g_cgramSelected = FALSE;
+			g_increment = TRUE;
+			execUs = SIM_HD44780_LONG_EXEC_US;
+		}
+	}
+
+	g_busyUntil = SIM_getCycles() + ((uint64)execUs * (F_CPU / 1000000UL));
+}
+
+/*
+ * Description :
+ * Latch the bus while E is high and take the transfer on the falling edge of E
+ */
+static void SIM_HD44780_sampleBus(uint8 enable, uint8 rw, uint8 rs, uint8 data){
+	if(enable == LOGIC_HIGH){
+		g_latchedRs = rs;
+
+		if(rw == LOGIC_LOW){
+			g_latchedData = data;
+		}
+		else if(g_lastEnable == LOGIC_LOW){
+
+			/* Read cycle: busy flag and address counter or the display RAM byte */
+			if(g_eightBitMode || !g_nibblePending){
+				if((g_latchedRs == LOGIC_HIGH) && g_cgramSelected){
+					g_readValue = g_cgram[g_addressCounter & 0x3F];
+				}
+				else if(g_latchedRs == LOGIC_HIGH){
+					g_readValue = g_ddram[g_addressCounter & 0x7F];
+				}
+				else{
+					g_readValue = ((SIM_getCycles() < g_busyUntil) ? 0x80 : 0x00) | (g_addressCounter & 0x7F);
+				}
+				SIM_HD44780_driveDataLines(g_readValue);
+			}
+			else{
+
+				/* Second nibble of a 4-bit read */
+				SIM_HD44780_driveDataLines((uint8)(g_readValue<<4));
+			}
+		}
+	}
+	else if(g_lastEnable == LOGIC_HIGH){
+		g_stats.strobes++;
+
+		if(rw == LOGIC_HIGH){
+
+			/* End of a read, a data read moves the address counter */
+			if(!g_eightBitMode){
+				g_nibblePending = !g_nibblePending;
+			}
+			if((g_eightBitMode || !g_nibblePending) && (g_latchedRs == LOGIC_HIGH)){
+				g_stats.reads++;
+				g_addressCounter = (g_addressCounter + (g_increment ? 1 : -1)) & (g_cgramSelected ? 0x3F : 0x7F);
+			}
+		}
+		else{
+
+			if(SIM_getCycles() < g_busyUntil){
+				g_stats.violations++;
+			}
+
+			if(g_eightBitMode){
+				SIM_HD44780_execute(g_latchedRs, g_latchedData);
+			}
+			else if(!g_nibblePending){
+				g_highNibble = g_latchedData & 0xF0;
+				g_nibblePending = TRUE;
+			}
+			else{
+				g_nibblePending = FALSE;
+				SIM_HD44780_execute(g_latchedRs, g_highNibble | (g_latchedData >> 4));
+			}
+		}
+	}
+
+	g_lastEnable = enable;
+}
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
+
+/*
+ * Description :
+ * Observer: sample the bus on the MCU pins
+ */
+static void SIM_HD44780_observe(void){
+	SIM_HD44780_sampleBus(SIM_getPinLevel(LCD_E_PORT_ID, LCD_E_PIN_ID), SIM_getPinLevel(LCD_RW_PORT_ID, LCD_RW_PIN_ID),
+			SIM_getPinLevel(LCD_RS_PORT_ID, LCD_RS_PIN_ID), SIM_HD44780_readDataLines());
+}
+
+#endif
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model, the controller starts powered up in 8-bit mode with an empty display
+ * (the custom characters are not cleared at power up, they start with a pattern)
+ */
+void SIM_HD44780_init(void){
+	memset(g_ddram, ' ', sizeof(g_ddram));
+	memset(g_cgram, 0x15, sizeof(g_cgram));
+	memset(&g_stats, 0, sizeof(g_stats));
+	g_addressCounter = 0;
+	g_cgramSelected = FALSE;
+	g_increment = TRUE;
+	g_eightBitMode = TRUE;
+	g_nibblePending = FALSE;
+	g_lastEnable = LOGIC_LOW;
+
+	/* The controller is busy with its internal reset after power up */
+	g_busyUntil = SIM_getCycles() + ((uint64)SIM_HD44780_POWER_UP_US * (F_CPU / 1000000UL));
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL)
+	SIM_addObserver(SIM_HD44780_observe);
+#endif
+}
+
+#if(LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL)
+
+/*
+ * Description :
+ * New outputs of the PCF8574 backpack or of the 74HC595 (LCD_EXPANDER_xxx_BIT wiring,
+ * D7..D4 on bits 7..4)
+ */
+void SIM_HD44780_setExpanderOutputs(uint8 outputs){
+	SIM_HD44780_sampleBus(GET_BIT(outputs, LCD_EXPANDER_E_BIT), GET_BIT(outputs, LCD_EXPANDER_RW_BIT),
+			GET_BIT(outputs, LCD_EXPANDER_RS_BIT), outputs & 0xF0);
+}
+
+#endif
+
+/*
+ * Description :
+ * The MCU restarted (after SIM_reset) while the LCD stayed powered: the controller keeps
+ * its configuration and display RAM, a transfer cut by the restart is dropped
+ */
+void SIM_HD44780_mcuReset(void){
+	g_busyUntil = 0;
+	g_lastEnable = LOGIC_LOW;
+	g_nibblePending = FALSE;
+	memset(&g_stats, 0, sizeof(g_stats));
+}
+
+/*
+ * Description :
+ * Copy the SIM_HD44780_COLUMNS characters of a row (0..3) and a terminating null
+ */
+void SIM_HD44780_getRow(uint8 row, char * text_ptr){
+	static const uint8 rowAddress[4] = {0x00, 0x40, 0x10, 0x50};
+
+	memcpy(text_ptr, &g_ddram[rowAddress[row & 0x03]], SIM_HD44780_COLUMNS);
+	text_ptr[SIM_HD44780_COLUMNS] = '\0';
+}
+
+/*
+ * Description :
+ * Copy the LCD_GLYPH_ROWS rows of a custom character (0..7)
+ */
+void SIM_HD44780_getGlyph(uint8 index, uint8 * rows_ptr){
+	memcpy(rows_ptr, &g_cgram[(index & 0x07) * 8], 8);
+}
+
+/*
+ * Description :
+ * Copy the bus statistics
+ */
+void SIM_HD44780_getStats(Sim_HD44780_StatsType * stats_ptr){
+	*stats_ptr = g_stats;
+}
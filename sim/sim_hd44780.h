@@ -0,0 +1,92 @@
+ /******************************************************************************
+ *
+ * Module: SIM - HD44780 model
+ *
+ * File Name: sim_hd44780.h
+ *
+ * Description: Simulated HD44780 LCD controller wired as configured in lcd.h
+ *              (on the MCU pins or on the outputs of the PCF8574 or 74HC595 model)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_HD44780_H_
+#define SIM_HD44780_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Time the controller needs after power up before the first command in micro seconds */
+#define SIM_HD44780_POWER_UP_US			15000
+
+/* Execution time of clear display and return home in micro seconds */
+#define SIM_HD44780_LONG_EXEC_US		1520
+
+/* Execution time of all other commands and data writes in micro seconds */
+#define SIM_HD44780_SHORT_EXEC_US		37
+
+/* Number of columns of a row */
+#define SIM_HD44780_COLUMNS				16
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds the bus statistics of the model */
+typedef struct{
+	uint32 commands;		/* Instructions received */
+	uint32 characters;		/* Data bytes written to the display RAM */
+	uint32 glyphRows;		/* Data bytes written to the character generator RAM */
+	uint32 strobes;			/* E falling edges */
+	uint32 reads;			/* Data bytes read back */
+	uint32 violations;		/* Transfers received while the controller was busy */
+}Sim_HD44780_StatsType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model, the controller starts powered up in 8-bit mode with an empty display
+ * (the custom characters are not cleared at power up, they start with a pattern)
+ */
+void SIM_HD44780_init(void);
+
+/*
+ * Description :
+ * New outputs of the PCF8574 backpack or of the 74HC595 (LCD_EXPANDER_xxx_BIT wiring,
+ * D7..D4 on bits 7..4)
+ */
+void SIM_HD44780_setExpanderOutputs(uint8 outputs);
+
+/*
+ * Description :
+ * The MCU restarted (after SIM_reset) while the LCD stayed powered: the controller keeps
+ * its configuration and display RAM, a transfer cut by the restart is dropped
+ */
+void SIM_HD44780_mcuReset(void);
+
+/*
+ * Description :
+ * Copy the SIM_HD44780_COLUMNS characters of a row (0..3) and a terminating null
+ */
+void SIM_HD44780_getRow(uint8 row, char * text_ptr);
+
+/*
+ * Description :
+ * Copy the LCD_GLYPH_ROWS rows of a custom character (0..7)
+ */
+void SIM_HD44780_getGlyph(uint8 index, uint8 * rows_ptr);
+
+/*
+ * Description :
+ * Copy the bus statistics
+ */
+void SIM_HD44780_getStats(Sim_HD44780_StatsType * stats_ptr);
+
+#endif /* SIM_HD44780_H_ */
@@ -0,0 +1,1334 @@
+ /******************************************************************************
+ *
+ * Module: SIM - runner
+ *
+ * File Name: sim_main.c
+ *
+ * Description: Run the application loop of Mini_Project_4.c on the simulated ATmega32
+ *              against the HC-SR04 and HD44780 models and check every measurement
+ *              and every LCD refresh
+ *
+ * Usage: sim_run [-n measurements] [-t telemetry.bin] [-b pings] [-i] [-y slot [-m]] [-T] [-k] [-s] [-p] [-a] [-w]
+ *        -i reads the register map over TWI during every measurement and checks it
+ *        -y pings in the given slot of the sync frames (sent by a sync line model,
+ *        or by this node with -m) after the measurements and checks the trigger times
+ *        -T steps the air temperature (LM35 input and speed of sound of the HC-SR04 model)
+ *        from 0 C to 40 C and checks the compensated distances (not with the 8-bit LCD bus,
+ *        the LM35 is on PA7)
+ *        -k runs a two-point calibration after the measurements, saves it more times
+ *        than the EEPROM ring has slots and checks the record restored after a reset
+ *        (also with the newest record torn)
+ *        -s sends shell command lines on the UART while measuring and checks the replies
+ *        and the measurements
+ *        -p places targets in front of two sensors 20 cm apart (a second HC-SR04 model on
+ *        the second trigger pin), pings them in turn and checks the positions
+ *        -a sweeps the sensor on a servo model (OC1A) over a room and checks the polar map,
+ *        the servo pulses and the points per second
+ *        -b measures a burst of pings after the measurements and checks its aggregate
+ *        -w restarts the MCU after the measurements while the LCD stays powered
+ *        (watchdog reset) and reports the warm start of the display
+ *        Built with -DLCD_TRANSPORT=1 the LCD is on the PCF8574 backpack model
+ *        (the TWI is the master of the LCD bus then, -i is not available), with
+ *        -DLCD_TRANSPORT=2 -DULTRASONIC_TRIGGER_PIN_ID=PIN3_ID on the 74HC595 model on the SPI
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_atmega32.h"
+#include "sim_hcsr04.h"
+#include "sim_hd44780.h"
+#include "sim_twi.h"
+#include "sim_pcf8574.h"
+#include "sim_hc595.h"
+#include "sim_servo.h"
+#include "gpio.h"
+#include "lcd.h"
+#include "display.h"
+#include "dashboard.h"
+#include "ultrasonic.h"
+#include "icu.h"
+#include "telemetry.h"
+#include "regmap.h"
+#include "sync.h"
+#include "calibration.h"
+#include "temperature.h"
+#include "shell.h"
+#include "uart.h"
+#include "trilateration.h"
+#include "servo.h"
+#include "scan.h"
+#include <avr/interrupt.h>
+#include <math.h>
+
+/* The trigger pin can not be one of the LCD pins on PORTB */
+#if((ULTRASONIC_TRIGGER_PORT_ID == PORTB_ID) && (((LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL) && \
+		(ULTRASONIC_TRIGGER_PIN_ID <= PIN2_ID)) || ((LCD_TRANSPORT == LCD_TRANSPORT_SPI) && (ULTRASONIC_TRIGGER_PIN_ID >= PIN4_ID))))
+
+#error "Trigger pin on an LCD pin (PB0..PB2 parallel, PB4..PB7 SPI), set ULTRASONIC_TRIGGER_PIN_ID"
+
+#endif
+
+/*******************************************************************************
+ *                           Private Global Variable                           *
+ *******************************************************************************/
+
+/* Distance shown by the page */
+static uint16 g_simDistance = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the host monotonic time in nano seconds
+ */
+static uint64 Sim_hostNanoseconds(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((uint64)now.tv_sec * 1000000000ULL) + (uint64)now.tv_nsec;
+}
+
+/*
+ * Description :
+ * Same content as the live page of main(): the distance, its bar and its trend
+ */
+static void Sim_renderPage(Dashboard_TextType text){
+	Dashboard_printText(text, 0, 0, "Distance=");
+	Dashboard_printNumber(text, 0, 10, 3, g_simDistance);
+	Dashboard_printText(text, 0, 13, "cm");
+	Display_renderBar(g_simDistance, &text[1][0]);
+	Display_renderTrend(&text[1][LCD_COLUMNS - DISPLAY_TREND_CELLS]);
+}
+
+/* Sync frames of the -y check: slots of 30 ms, 4 nodes */
+#define SIM_SYNC_SLOTS			4
+#define SIM_SYNC_SLOT_TICKS		30000
+#define SIM_SYNC_PINGS			20
+
+/* Sync line model: whether it sends the pulses, the next one and the last rising edge */
+static boolean g_syncGenerate = FALSE;
+static uint64 g_syncNextRise = 0;
+static uint64 g_syncEdgeCycle = 0;
+static uint8 g_syncLevel = LOGIC_LOW;
+
+/* Rendered at every Dashboard_update call */
+static const Dashboard_PageConfigType g_simPage = {Sim_renderPage, DASHBOARD_TICK_MS};
+
+/* Saves of the -k check, more than the slots of the ring so it wraps around */
+#define SIM_CALIBRATION_SAVES	(CALIBRATION_SLOTS + 5)
+
+/* Measurements of the -s check waiting for one reply */
+#define SIM_SHELL_MAX_POLLS		20
+
+/* Setting changed by the -s check */
+static uint16 g_simRange = 0;
+
+/* Sensors of the -p check: baseline and time between the pings of a pair */
+#define SIM_BASELINE_CM			20
+#define SIM_PAIR_SKEW_TICKS		100000UL
+
+/* Position error allowed by the -p check against the geometry of the measured distances (1/16 cm) */
+#define SIM_POSITION_TOLERANCE	32
+
+/* Sweeps of the -a check and the angle error allowed at a trigger (1/100 degree) */
+#define SIM_SCAN_SWEEPS			2
+#define SIM_SCAN_ANGLE_TOLERANCE	50
+
+/*
+ * Glitches of the -g check: width (under ULTRASONIC_MIN_PULSE_WIDTH) and lead of the spike before
+ * the echo in us, the near glitches start this lead before the edge of the echo and end within
+ * the minimum pulse width of it
+ */
+#define SIM_GLITCH_US				20
+#define SIM_GLITCH_SPIKE_LEAD_US	300
+#define SIM_GLITCH_NEAR_LEAD_US		40
+
+/* Cases of the -g check: a dropout in the middle of the echo or near its end, a spike before it or near it */
+#define SIM_GLITCH_CASES			4
+
+/* -a check: sweep running, the horn angle and the echo width at the last trigger */
+static boolean g_scanActive = FALSE;
+static uint8 g_scanTriggerLevel = LOGIC_LOW;
+static uint32 g_scanTriggerAngle = 0;
+static uint64 g_scanEchoCycles = 0;
+static uint32 g_scanTriggers = 0;
+
+/*
+ * Description :
+ * Same start up as main()
+ */
+static void Sim_startApplication(void){
+	Regmap_ConfigType regmapConfig = {2};
+
+	Ultrasonic_init();
+	Calibration_init();
+	LCD_init();
+	Telemetry_init();
+	sei();
+	Regmap_init(&regmapConfig);
+	Display_init();
+	g_simDistance = 0;
+	Dashboard_init();
+	Dashboard_addPage(&g_simPage);
+	Dashboard_showPage(0);
+}
+
+/*
+ * Description :
+ * Check the bar cells and the newest trend column after the sample-th sample
+ */
+static boolean Sim_checkGraphics(uint32 sample, uint16 value, uint8 * glyph_ptr){
+	char row[SIM_HD44780_COLUMNS + 1];
+	uint32 levels = ((uint32)(value > DISPLAY_BAR_FULL_SCALE ? DISPLAY_BAR_FULL_SCALE : value) * DISPLAY_BAR_CELLS * LCD_GLYPH_COLUMNS + DISPLAY_BAR_FULL_SCALE / 2) / DISPLAY_BAR_FULL_SCALE;
+	uint32 height = ((uint32)(value > DISPLAY_TREND_FULL_SCALE ? DISPLAY_TREND_FULL_SCALE : value) * LCD_GLYPH_ROWS + DISPLAY_TREND_FULL_SCALE / 2) / DISPLAY_TREND_FULL_SCALE;
+	uint8 column = sample % LCD_GLYPH_COLUMNS;
+	uint8 cell;
+	uint8 expected;
+
+	SIM_HD44780_getRow(1, row);
+
+	for(cell = 0; cell < DISPLAY_BAR_CELLS; cell++){
+		uint32 fill = (levels > (uint32)cell * LCD_GLYPH_COLUMNS) ? levels - (uint32)cell * LCD_GLYPH_COLUMNS : 0;
+
+		expected = (fill >= LCD_GLYPH_COLUMNS) ? DISPLAY_FULL_BLOCK : ((fill > 0) ? (uint8)(DISPLAY_BAR_FIRST_GLYPH + fill - 1) : ' ');
+		if((uint8)row[cell] != expected){
+			return FALSE;
+		}
+	}
+
+	/* The newest trend glyph is on the right, its column of this sample filled from the bottom */
+	SIM_HD44780_getGlyph((uint8)row[LCD_COLUMNS - 1], glyph_ptr);
+	for(cell = 0; cell < LCD_GLYPH_ROWS; cell++){
+		if(((glyph_ptr[cell] >> (LCD_GLYPH_COLUMNS - 1 - column)) & 1) != ((cell >= LCD_GLYPH_ROWS - height) ? 1 : 0)){
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Observer: send a sync pulse every frame when this node is a slave (scheduled one frame
+ * ahead) and time stamp the rising edges of the sync line
+ */
+static void Sim_syncObserve(void){
+	uint64 now = SIM_getCycles();
+	uint64 frameCycles = (uint64)SIM_SYNC_SLOTS * SIM_SYNC_SLOT_TICKS * (F_CPU / 1000000UL);
+	uint8 level = SIM_getPinLevel(SYNC_PORT_ID, SYNC_PIN_ID);
+
+	if((level == LOGIC_HIGH) && (g_syncLevel == LOGIC_LOW)){
+		g_syncEdgeCycle = now;
+	}
+	g_syncLevel = level;
+
+	if((g_syncGenerate == TRUE) && ((now + frameCycles) >= g_syncNextRise)){
+		SIM_schedulePinLevel(SYNC_PORT_ID, SYNC_PIN_ID, LOGIC_HIGH, g_syncNextRise - now);
+		SIM_schedulePinLevel(SYNC_PORT_ID, SYNC_PIN_ID, LOGIC_LOW, g_syncNextRise - now + SYNC_PULSE_US * (F_CPU / 1000000UL));
+		g_syncNextRise += frameCycles;
+	}
+}
+
+/*
+ * Description :
+ * Ping in the slot of this node of SIM_SYNC_PINGS sync frames, check that every trigger
+ * pulse starts at the slot offset from the sync edge and every distance, return the errors
+ */
+static uint32 Sim_checkSyncSlots(uint8 slot, Sync_RoleType role){
+	Sync_ConfigType config = {role, slot, SIM_SYNC_SLOTS, SIM_SYNC_SLOT_TICKS};
+	uint64 offsetCycles = (uint64)slot * SIM_SYNC_SLOT_TICKS * (F_CPU / 1000000UL);
+	uint64 maxError = 0;
+	uint64 start;
+	uint32 errors = 0;
+	uint32 slotTime;
+	uint32 earliest;
+	uint16 expectedDistance;
+	Ultrasonic_ResultType result;
+	uint8 i;
+
+	g_syncGenerate = (role == SYNC_ROLE_SLAVE) ? TRUE : FALSE;
+	g_syncNextRise = SIM_getCycles();
+	SIM_addObserver(Sim_syncObserve);
+	Sync_init(&config);
+
+	SIM_HCSR04_setDistance(75);
+	expectedDistance = (uint16)((SIM_HCSR04_getEchoCycles() / (F_CPU / 1000000UL)) / ULTRASONIC_CALIBRATION_FACTOR);
+
+	/* Wait for the first sync edge */
+	while(Sync_getEdgeCount() == 0){
+		SIM_advanceCycles(SIM_ACCESS_CYCLES);
+	}
+
+	start = SIM_getCycles();
+	earliest = ICU_getTimestamp();
+	for(i = 0; i < SIM_SYNC_PINGS; i++){
+		uint64 error;
+
+		if(Sync_getNextSlot(earliest, &slotTime) == FALSE){
+			fprintf(stderr, "sync: not synchronised at ping %u\n", i);
+			errors++;
+			break;
+		}
+		Ultrasonic_startMeasurementAt(slotTime);
+		while(!Ultrasonic_update()){
+		}
+		Ultrasonic_getResult(&result);
+
+		/* Trigger pulse to the last sync edge before it */
+		error = SIM_HCSR04_getTriggerCycle() - g_syncEdgeCycle;
+		if(g_syncEdgeCycle > SIM_HCSR04_getTriggerCycle()){
+			error = ~(uint64)0;
+		}
+		error = (error > offsetCycles) ? error - offsetCycles : offsetCycles - error;
+		if(error > maxError){
+			maxError = error;
+		}
+
+		if((result.status != ULTRASONIC_STATUS_OK) || (result.distance + 1 < expectedDistance) || (result.distance > expectedDistance + 1)
+				|| (error > 16 * (F_CPU / 1000000UL))){
+			fprintf(stderr, "sync ping %u: distance %u (status %u) expected %u, trigger %llu cycles off its slot\n",
+					i, result.distance, result.status, expectedDistance, (unsigned long long)error);
+			errors++;
+		}
+
+		/* The sensor needs its measurement cycle before the next ping */
+		earliest = slotTime + ULTRASONIC_PING_SPACING_TICKS;
+	}
+
+	printf("sync_role=%s\nsync_slot=%u\nsync_edges=%u\nsync_max_slot_error_us=%llu\nsync_ping_period_us=%llu\nsync_errors=%u\n",
+			(role == SYNC_ROLE_MASTER) ? "master" : "slave", slot, Sync_getEdgeCount(),
+			(unsigned long long)(maxError / (F_CPU / 1000000UL)),
+			(unsigned long long)((SIM_getCycles() - start) / (F_CPU / 1000000UL) / SIM_SYNC_PINGS), errors);
+
+	g_syncGenerate = FALSE;
+
+	return errors;
+}
+
+/*
+ * Description :
+ * Check a bulk read of the register map against the measurement published before it started
+ */
+static boolean Sim_checkRegisterMap(const uint8 * map_ptr, uint8 size, uint8 sequence, const Ultrasonic_ResultType * result_ptr){
+	if((size != REGMAP_SIZE) || (map_ptr[REGMAP_ID_OFFSET] != REGMAP_DEVICE_ID) || (map_ptr[REGMAP_SEQUENCE_OFFSET] != sequence)){
+		return FALSE;
+	}
+	if((map_ptr[REGMAP_STATUS_OFFSET] != result_ptr->status) ||
+			((map_ptr[REGMAP_DISTANCE_OFFSET] | (map_ptr[REGMAP_DISTANCE_OFFSET + 1] << 8)) != result_ptr->distance) ||
+			((map_ptr[REGMAP_TIMESTAMP_OFFSET] | (map_ptr[REGMAP_TIMESTAMP_OFFSET + 1] << 8) |
+			((uint32)map_ptr[REGMAP_TIMESTAMP_OFFSET + 2] << 16) | ((uint32)map_ptr[REGMAP_TIMESTAMP_OFFSET + 3] << 24)) != result_ptr->timestamp)){
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Measure once, show the distance like main() and wait until the display shows it
+ */
+static uint16 Sim_measureAndDisplay(void){
+	g_simDistance = Ultrasonic_readDistance();
+	Dashboard_update();
+	LCD_flush();
+
+	return g_simDistance;
+}
+
+#if((LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL) || (LCD_BIT_MODE == 4))
+
+/*
+ * Description :
+ * Object at 300 cm in air from 0 C to 40 C: check the degree read from the LM35 and the
+ * compensated distance, report the error of the factory scale for comparison, then check the
+ * hysteresis on the edge of two degrees. Return the number of errors.
+ */
+static uint32 Sim_checkTemperature(void){
+	uint32 errors = 0;
+	uint16 dist;
+	uint16 worstCompensated = 0;
+	uint16 worstFactory = 0;
+	uint16 factoryDistance;
+	uint8 degrees;
+	uint8 step;
+
+	Temperature_init();
+	SIM_HCSR04_setDistance(300);
+
+	for(degrees = 0; degrees <= 40; degrees += 10){
+		SIM_setAdcInput(TEMPERATURE_ADC_CHANNEL, (uint16)degrees * 10);
+		SIM_HCSR04_setSpeedOfSound((uint32)(33145.0 * sqrt(1.0 + degrees / 273.15) + 0.5));
+
+		/* Take the conversion on the way, then the one of the new input */
+		for(step = 0; step < 2; step++){
+			SIM_advanceCycles(F_CPU / 1000);
+			Temperature_update();
+		}
+		SIM_advanceCycles(F_CPU / 1000);
+		Temperature_update();
+
+		dist = Ultrasonic_readDistance();
+		factoryDistance = (uint16)((SIM_HCSR04_getEchoCycles() / (F_CPU / 1000000UL)) / ULTRASONIC_CALIBRATION_FACTOR);
+		if((Temperature_getDegrees() != degrees) || (dist + 1 < 300) || (dist > 300 + 1)){
+			fprintf(stderr, "temperature: %u C read as %u C, 300 cm object got %u cm\n", degrees, Temperature_getDegrees(), dist);
+			errors++;
+		}
+		if(abs((int)dist - 300) > worstCompensated){
+			worstCompensated = (uint16)abs((int)dist - 300);
+		}
+		if(abs((int)factoryDistance - 300) > worstFactory){
+			worstFactory = (uint16)abs((int)factoryDistance - 300);
+		}
+	}
+
+	/* 40.6 C stays 40 C, 41.0 C gives 41 C */
+	SIM_setAdcInput(TEMPERATURE_ADC_CHANNEL, 406);
+	for(step = 0; step < 3; step++){
+		SIM_advanceCycles(F_CPU / 1000);
+		Temperature_update();
+	}
+	if(Temperature_getDegrees() != 40){
+		fprintf(stderr, "temperature: 40.6 C moved to %u C\n", Temperature_getDegrees());
+		errors++;
+	}
+	SIM_setAdcInput(TEMPERATURE_ADC_CHANNEL, 410);
+	for(step = 0; step < 3; step++){
+		SIM_advanceCycles(F_CPU / 1000);
+		Temperature_update();
+	}
+	if(Temperature_getDegrees() != 41){
+		fprintf(stderr, "temperature: 41.0 C read as %u C\n", Temperature_getDegrees());
+		errors++;
+	}
+
+	printf("temperature_worst_error_cm=%u\ntemperature_factory_worst_error_cm=%u\ntemperature_errors=%u\n",
+			worstCompensated, worstFactory, errors);
+
+	/* Back to the speed of sound of the other checks */
+	SIM_HCSR04_setSpeedOfSound(SIM_HCSR04_SPEED_OF_SOUND);
+	Ultrasonic_setSpeedMultiplier(ULTRASONIC_DEFAULT_MULTIPLIER);
+	ADC_DeInit();
+
+	return errors;
+}
+
+#endif
+
+/*
+ * Description :
+ * Calibrate against true distances of 1.02 * object + 4 cm (points at 50 cm and 300 cm),
+ * save the calibration SIM_CALIBRATION_SAVES times, restore it like at boot (also with the
+ * newest record torn) and check a measurement at 150 cm, return the number of errors
+ */
+static uint32 Sim_checkCalibration(void){
+	Ultrasonic_CalibrationType factory = {ULTRASONIC_UNIT_GAIN, 0};
+	Ultrasonic_CalibrationType calibration;
+	Ultrasonic_CalibrationType restored;
+	Calibration_PointType nearPoint;
+	Calibration_PointType farPoint;
+	uint64 nearEcho;
+	uint64 farEcho;
+	uint64 start;
+	uint64 saveCycles = 0;
+	uint64 bootCycles;
+	uint32 errors = 0;
+	uint32 writes;
+	uint8 * eeprom_ptr;
+	uint8 save;
+	uint8 slot;
+	uint16 dist;
+	uint16 expectedDistance;
+
+	SIM_HCSR04_setDistance(50);
+	nearEcho = SIM_HCSR04_getEchoCycles();
+	SIM_HCSR04_setDistance(300);
+	farEcho = SIM_HCSR04_getEchoCycles();
+
+	SIM_HCSR04_setDistance(50);
+	if(Calibration_capturePoint(55, &nearPoint) == FALSE){
+		errors++;
+	}
+	SIM_HCSR04_setDistance(300);
+	if(Calibration_capturePoint(310, &farPoint) == FALSE){
+		errors++;
+	}
+	if(Calibration_compute(&nearPoint, &farPoint, &calibration) == FALSE){
+		fprintf(stderr, "calibration: points %u/%u %u/%u rejected\n", nearPoint.highTime, nearPoint.distance, farPoint.highTime, farPoint.distance);
+		return errors + 1;
+	}
+
+	/* Every save goes to the next slot of the ring */
+	for(save = 0; save < SIM_CALIBRATION_SAVES; save++){
+		start = SIM_getCycles();
+		if((Calibration_save(&calibration) == FALSE) || (Calibration_getSlot() != (save % CALIBRATION_SLOTS))){
+			fprintf(stderr, "calibration: save %u in slot %u\n", save, Calibration_getSlot());
+			errors++;
+		}
+		saveCycles += SIM_getCycles() - start;
+	}
+	slot = Calibration_getSlot();
+
+	/* Boot: the factory scale until the ring is read */
+	Ultrasonic_setCalibration(&factory);
+	start = SIM_getCycles();
+	Calibration_init();
+	bootCycles = SIM_getCycles() - start;
+	Ultrasonic_getCalibration(&restored);
+	if((Calibration_getSlot() != slot) || (restored.gain != calibration.gain) || (restored.offset != calibration.offset)){
+		fprintf(stderr, "calibration: restored slot %u gain %u offset %ld\n", Calibration_getSlot(), restored.gain, (long)restored.offset);
+		errors++;
+	}
+
+	/* Reset during the last save: its CRC is wrong, the record before it is used */
+	eeprom_ptr = SIM_getEeprom(&writes);
+	eeprom_ptr[CALIBRATION_EEPROM_ADDRESS + slot * CALIBRATION_RECORD_SIZE + CALIBRATION_CRC_OFFSET] ^= 0x01;
+	Ultrasonic_setCalibration(&factory);
+	Calibration_init();
+	Ultrasonic_getCalibration(&restored);
+	if((Calibration_getSlot() != ((slot + CALIBRATION_SLOTS - 1) % CALIBRATION_SLOTS)) || (restored.gain != calibration.gain)){
+		fprintf(stderr, "calibration: torn record, restored slot %u gain %u\n", Calibration_getSlot(), restored.gain);
+		errors++;
+	}
+
+	/* The calibrated scale goes through both points */
+	SIM_HCSR04_setDistance(150);
+	expectedDistance = (uint16)(55 + ((double)(SIM_HCSR04_getEchoCycles() - nearEcho) * (310 - 55)) / (double)(farEcho - nearEcho) + 0.5);
+	dist = Ultrasonic_readDistance();
+	if((dist + 1 < expectedDistance) || (dist > expectedDistance + 1)){
+		fprintf(stderr, "calibration: 150 cm object, expected %u got %u\n", expectedDistance, dist);
+		errors++;
+	}
+
+	printf("calibration_gain=%u\ncalibration_offset=%ld\ncalibration_distance=%u\ncalibration_slot=%u\n",
+			calibration.gain, (long)calibration.offset, dist, slot);
+	printf("calibration_eeprom_writes=%u\ncalibration_save_us=%llu\ncalibration_boot_us=%llu\ncalibration_errors=%u\n", writes,
+			(unsigned long long)(saveCycles / SIM_CALIBRATION_SAVES / (F_CPU / 1000000UL)),
+			(unsigned long long)(bootCycles / (F_CPU / 1000000UL)), errors);
+
+	return errors;
+}
+
+/*
+ * Description :
+ * "dist": print the distance shown by the page
+ */
+static void Sim_distCommand(uint8 argc, char * argv[]){
+	(void)argc;
+	(void)argv;
+	Shell_printNumber(g_simDistance);
+	Shell_print("\r\n");
+}
+
+/*
+ * Description :
+ * "range <cm>": change the setting of the check
+ */
+static void Sim_rangeCommand(uint8 argc, char * argv[]){
+	uint16 value;
+
+	if((argc == 2) && Shell_parseNumber(argv[1], &value)){
+		g_simRange = value;
+		Shell_print("OK\r\n");
+	}
+	else{
+		Shell_print("ERR range\r\n");
+	}
+}
+
+static const Shell_CommandType g_simCommands[] = {
+	{"dist",  Sim_distCommand},
+	{"range", Sim_rangeCommand}
+};
+
+static const Shell_ConfigType g_simShell = {g_simCommands, sizeof(g_simCommands) / sizeof(g_simCommands[0])};
+
+/*
+ * Description :
+ * Object at 120 cm: send every line of the script on the UART, measure and poll the shell
+ * like the shell task of main() until the reply is complete, check the reply and every
+ * measurement on the way. Return the number of errors.
+ */
+static uint32 Sim_checkShell(void){
+	static const struct{
+		const char * line;
+		const char * reply;		/* NULL: the distance */
+	}script[] = {
+		{"help\r\n",                                     "dist range help\r\n"},
+		{"range 250\r\n",                                "OK\r\n"},
+		{"range x\r\n",                                  "ERR range\r\n"},
+		{"dist\r\n",                                     NULL},
+		{"\r\n  \r\nbogus\r\n",                          "ERR command\r\n"},
+		{"rangx\be 7\r\n",                               "OK\r\n"},
+		{"dist 1 2 3 4\r\n",                             "ERR arguments\r\n"},
+		{"range 1234567890123456789012345678901\r\n",    "ERR line\r\n"},
+		{"range  65535 \n",                              "OK\r\n"}
+	};
+	Ultrasonic_CalibrationType factory = {ULTRASONIC_UNIT_GAIN, 0};
+	uint32 errors = 0;
+	uint32 polls = 0;
+	uint32 mark;
+	uint32 size;
+	const uint8 * output_ptr;
+	uint16 expectedDistance;
+	uint16 dist = 0;
+	char reply[SHELL_OUTPUT_SIZE + 1];
+	uint8 i;
+	uint8 j;
+
+	Shell_init(&g_simShell);
+
+	/* Factory scale at 20 C whatever the checks before left */
+	Ultrasonic_setCalibration(&factory);
+	Ultrasonic_setSpeedMultiplier(ULTRASONIC_DEFAULT_MULTIPLIER);
+
+	/* Telemetry frames of the measurements before go out first, only the replies are recorded */
+	while(UART_getTxFreeSpace() != (UART_TX_BUFFER_SIZE - 1)){
+		SIM_advanceCycles(F_CPU / 1000UL);
+	}
+	SIM_advanceCycles(F_CPU / 1000UL);
+	SIM_clearUartOutput();
+
+	SIM_HCSR04_setDistance(120);
+	expectedDistance = (uint16)((SIM_HCSR04_getEchoCycles() / (F_CPU / 1000000UL)) / ULTRASONIC_CALIBRATION_FACTOR);
+
+	for(i = 0; i < (sizeof(script) / sizeof(script[0])); i++){
+		SIM_getUartOutput(&mark);
+		SIM_sendUartInput((const uint8 *)script[i].line, strlen(script[i].line));
+		reply[0] = '\0';
+
+		for(j = 0; j < SIM_SHELL_MAX_POLLS; j++){
+
+			/* The commands must not disturb the measurements */
+			dist = Sim_measureAndDisplay();
+			if((dist + 1 < expectedDistance) || (dist > expectedDistance + 1)){
+				fprintf(stderr, "shell: measurement %u cm expected %u\n", dist, expectedDistance);
+				errors++;
+			}
+
+			Shell_poll();
+			polls++;
+
+			/* Wait for the transmission of the reply */
+			SIM_advanceCycles(F_CPU / 1000UL);
+			output_ptr = SIM_getUartOutput(&size);
+			if(((size - mark) > SHELL_OUTPUT_SIZE) || ((size > mark) && (output_ptr[size - 1] == '\n'))){
+				size = ((size - mark) > SHELL_OUTPUT_SIZE) ? (mark + SHELL_OUTPUT_SIZE) : size;
+				memcpy(reply, &output_ptr[mark], size - mark);
+				reply[size - mark] = '\0';
+				break;
+			}
+		}
+
+		if(script[i].reply == NULL){
+			unsigned long value = strtoul(reply, NULL, 10);
+
+			if((value != g_simDistance) || (value + 1 < expectedDistance) || (value > expectedDistance + 1u)){
+				fprintf(stderr, "shell: \"dist\" replied \"%s\" expected %u\n", reply, expectedDistance);
+				errors++;
+			}
+		}
+		else if(strcmp(reply, script[i].reply) != 0){
+			fprintf(stderr, "shell: line %u replied \"%s\" expected \"%s\"\n", i, reply, script[i].reply);
+			errors++;
+		}
+	}
+
+	if((g_simRange != 65535) || (UART_getRxDropped() != 0)){
+		fprintf(stderr, "shell: range %u, %u received bytes lost\n", g_simRange, UART_getRxDropped());
+		errors++;
+	}
+
+	printf("shell_lines=%u\nshell_polls=%u\nshell_errors=%u\n", (uint32)(sizeof(script) / sizeof(script[0])), polls, errors);
+
+	return errors;
+}
+
+/*
+ * Description :
+ * Ping objects with a glitch of SIM_GLITCH_US in the echo pulse (a dropout in its middle or
+ * near its end) or before it (a spike far from it or near it): the distances must be the ones
+ * of the clean pulse and every glitch counted by the ICU, return the number of errors
+ */
+static uint32 Sim_checkGlitch(void){
+	static const uint16 distances[] = {20, 75, 150, 320};
+	Ultrasonic_ResultType result;
+	uint16 expectedDistance;
+	uint16 glitches;
+	sint32 offset;
+	uint32 echoUs;
+	uint32 errors = 0;
+	uint8 i;
+	uint8 glitchCase;
+
+	for(i = 0; i < sizeof(distances) / sizeof(distances[0]); i++){
+		SIM_HCSR04_setDistance(distances[i]);
+		expectedDistance = (uint16)((SIM_HCSR04_getEchoCycles() / (F_CPU / 1000000UL)) / ULTRASONIC_CALIBRATION_FACTOR);
+
+		echoUs = (uint32)(SIM_HCSR04_getPulseCycles() / (F_CPU / 1000000UL));
+
+		for(glitchCase = 0; glitchCase < SIM_GLITCH_CASES; glitchCase++){
+			switch(glitchCase){
+			case 0:
+				offset = (sint32)(echoUs / 2);
+				break;
+			case 1:
+				offset = (sint32)(echoUs - SIM_GLITCH_NEAR_LEAD_US);
+				break;
+			case 2:
+				offset = -SIM_GLITCH_SPIKE_LEAD_US;
+				break;
+			default:
+				offset = -SIM_GLITCH_NEAR_LEAD_US;
+				break;
+			}
+			SIM_HCSR04_setGlitch(offset, SIM_GLITCH_US);
+
+			glitches = ICU_getGlitchCount();
+			Ultrasonic_readDistance();
+			Ultrasonic_getResult(&result);
+			glitches = ICU_getGlitchCount() - glitches;
+
+			if((result.status != ULTRASONIC_STATUS_OK) || (result.distance + 1 < expectedDistance)
+					|| (result.distance > expectedDistance + 1) || (glitches != 1)){
+				fprintf(stderr, "glitch: %s at %d us, object %u cm, expected %u got %u (status %u), %u glitches\n",
+						(glitchCase >= 2) ? "spike" : "dropout", (int)offset, distances[i], expectedDistance, result.distance, result.status, glitches);
+				errors++;
+			}
+		}
+	}
+	SIM_HCSR04_setGlitch(0, 0);
+
+	printf("glitch_pings=%u\nglitch_errors=%u\n", (uint32)(SIM_GLITCH_CASES * sizeof(distances) / sizeof(distances[0])), errors);
+
+	return errors;
+}
+
+/*
+ * Description :
+ * Measure with one sensor and return its echo sample
+ */
+static void Sim_measureSensor(uint8 sensor, Ultrasonic_SampleType * sample_ptr){
+	Ultrasonic_selectSensor(sensor);
+	Ultrasonic_readDistance();
+	Ultrasonic_getSample(sample_ptr);
+}
+
+/*
+ * Description :
+ * Targets in front of two sensors SIM_BASELINE_CM apart: ping sensor 0 then sensor 1 and
+ * check the position against the same geometry solved in floating point from the distances
+ * the driver measures (the echo times of the models, so the scale of the driver is kept).
+ * Then check that distances no point has and pairs too far apart in time give no position.
+ * Return the number of errors.
+ */
+static uint32 Sim_checkTrilateration(void){
+	static const Trilateration_ConfigType config = {SIM_BASELINE_CM, SIM_PAIR_SKEW_TICKS};
+
+	/* Targets in mm */
+	static const sint32 targets[][2] = {
+		{0, 1000}, {-300, 800}, {450, 2500}, {100, 300}, {-150, 1500}, {800, 3000}, {-1200, 2000}, {60, 3800}
+	};
+	Ultrasonic_CalibrationType factory = {ULTRASONIC_UNIT_GAIN, 0};
+	Trilateration_PositionType position;
+	Trilateration_StatsType stats;
+	Ultrasonic_SampleType sample;
+	double baseline = SIM_BASELINE_CM * (double)(1 << TRILATERATION_FRACTION_BITS);
+	sint32 worstX = 0;
+	sint32 worstY = 0;
+	uint32 errors = 0;
+	uint8 i;
+
+	Ultrasonic_setCalibration(&factory);
+	Ultrasonic_setSpeedMultiplier(ULTRASONIC_DEFAULT_MULTIPLIER);
+	if(Trilateration_init(&config) == FALSE){
+		return 1;
+	}
+
+	for(i = 0; i < (sizeof(targets) / sizeof(targets[0])); i++){
+		double halfBaseline = SIM_BASELINE_CM * 5.0;
+		double r0;
+		double r1;
+		double along;
+		sint32 expectedX;
+		sint32 expectedY;
+
+		SIM_HCSR04_setSensorDistance(0, (uint32)(hypot(targets[i][0] + halfBaseline, targets[i][1]) + 0.5));
+		SIM_HCSR04_setSensorDistance(1, (uint32)(hypot(targets[i][0] - halfBaseline, targets[i][1]) + 0.5));
+
+		/* Distances of the driver scale in 1/16 cm */
+		r0 = (double)SIM_HCSR04_getSensorEchoCycles(0) / (F_CPU / 1000000UL) * ULTRASONIC_DEFAULT_MULTIPLIER / (1UL << (ULTRASONIC_CALIBRATION_SHIFT - TRILATERATION_FRACTION_BITS));
+		r1 = (double)SIM_HCSR04_getSensorEchoCycles(1) / (F_CPU / 1000000UL) * ULTRASONIC_DEFAULT_MULTIPLIER / (1UL << (ULTRASONIC_CALIBRATION_SHIFT - TRILATERATION_FRACTION_BITS));
+		along = (r0 * r0 - r1 * r1 + baseline * baseline) / (2.0 * baseline);
+		expectedX = (sint32)lround(along - baseline / 2.0);
+		expectedY = (sint32)lround(sqrt(r0 * r0 - along * along));
+
+		Sim_measureSensor(0, &sample);
+		if(Trilateration_addSample(&sample, &position) == TRUE){
+			errors++;
+		}
+		Sim_measureSensor(1, &sample);
+		if(Trilateration_addSample(&sample, &position) == FALSE){
+			fprintf(stderr, "trilateration: target (%ld, %ld) mm gave no position\n", (long)targets[i][0], (long)targets[i][1]);
+			errors++;
+			continue;
+		}
+
+		if((labs(position.x - expectedX) > SIM_POSITION_TOLERANCE) || (labs((sint32)position.y - expectedY) > SIM_POSITION_TOLERANCE)){
+			fprintf(stderr, "trilateration: target (%ld, %ld) mm, expected (%ld, %ld) got (%d, %u) 1/16 cm\n", (long)targets[i][0],
+					(long)targets[i][1], (long)expectedX, (long)expectedY, position.x, position.y);
+			errors++;
+		}
+		if(labs(position.x - expectedX) > worstX){
+			worstX = labs(position.x - expectedX);
+		}
+		if(labs((sint32)position.y - expectedY) > worstY){
+			worstY = labs((sint32)position.y - expectedY);
+		}
+	}
+
+	/* 50 cm apart with a 20 cm baseline: no point has these distances */
+	SIM_HCSR04_setSensorDistance(0, 1000);
+	SIM_HCSR04_setSensorDistance(1, 1500);
+	Sim_measureSensor(0, &sample);
+	Trilateration_addSample(&sample, &position);
+	Sim_measureSensor(1, &sample);
+	if(Trilateration_addSample(&sample, &position) == TRUE){
+		fprintf(stderr, "trilateration: impossible distances gave a position\n");
+		errors++;
+	}
+
+	/* The second echo comes too late for the first one */
+	SIM_HCSR04_setSensorDistance(1, 1000);
+	Sim_measureSensor(0, &sample);
+	Trilateration_addSample(&sample, &position);
+	SIM_advanceCycles((uint64)SIM_PAIR_SKEW_TICKS * (F_CPU / 1000000UL));
+	Sim_measureSensor(1, &sample);
+	if(Trilateration_addSample(&sample, &position) == TRUE){
+		fprintf(stderr, "trilateration: a stale pair gave a position\n");
+		errors++;
+	}
+
+	Ultrasonic_selectSensor(0);
+	Trilateration_getStats(&stats);
+	if((stats.solutions != (sizeof(targets) / sizeof(targets[0]))) || (stats.invalidGeometry != 1) || (stats.unpaired != 1)){
+		fprintf(stderr, "trilateration: %u solutions, %u invalid, %u unpaired\n", stats.solutions, stats.invalidGeometry, stats.unpaired);
+		errors++;
+	}
+
+	printf("trilateration_solutions=%u\ntrilateration_worst_x_16=%ld\ntrilateration_worst_y_16=%ld\ntrilateration_errors=%u\n",
+			stats.solutions, (long)worstX, (long)worstY, errors);
+
+	return errors;
+}
+
+/*
+ * Description :
+ * Distance of the room of the -a check in mm at an angle in 1/100 degree: a wall 1.5 m in front,
+ * side walls 2 m to the sides and a post at 700 mm from 100 to 115 degrees
+ */
+static uint32 Sim_roomDistance(uint32 angle){
+	double radians = (angle / 100.0) * M_PI / 180.0;
+	double distance = 2000.0 / fabs(cos(radians));
+
+	if((angle >= 10000) && (angle <= 11500)){
+		return 700;
+	}
+	if((sin(radians) > 0.0) && ((1500.0 / sin(radians)) < distance)){
+		distance = 1500.0 / sin(radians);
+	}
+
+	return (uint32)(distance + 0.5);
+}
+
+/*
+ * Description :
+ * Observer: at every trigger pulse of the sweep put the room distance at the angle of the horn
+ * in front of the HC-SR04 model (it takes the distance at the end of the pulse)
+ */
+static void Sim_scanObserve(void){
+	uint8 level = SIM_getPinLevel(ULTRASONIC_TRIGGER_PORT_ID, ULTRASONIC_TRIGGER_PIN_ID);
+
+	if(g_scanActive && (level == LOGIC_HIGH) && (g_scanTriggerLevel == LOGIC_LOW)){
+		g_scanTriggerAngle = SIM_SERVO_getAngle();
+		SIM_HCSR04_setSensorDistance(0, Sim_roomDistance(g_scanTriggerAngle));
+		g_scanEchoCycles = SIM_HCSR04_getEchoCycles();
+		g_scanTriggers++;
+	}
+	g_scanTriggerLevel = level;
+}
+
+/*
+ * Description :
+ * Sweep 0 to 180 degrees in 5 degree steps SIM_SCAN_SWEEPS times over the room: every ping
+ * must go out with the horn settled at the angle of its point (the servo model turns at its
+ * rated speed from the end of each pulse) and store the measured distance there, the sweep
+ * must turn back at the ends. Check the polar map, the frame period of the servo pulses
+ * (compare match edges, no jitter) and the points per second against the ping spacing and
+ * the modelled settle time. Return the number of errors.
+ */
+static uint32 Sim_checkScan(void){
+	static const Scan_ConfigType config = {0, 180, 5};
+
+	/* Step 0, angles out of order, a single point, past the servo range, too many points */
+	static const Scan_ConfigType invalidConfigs[] = {
+		{0, 180, 0}, {90, 90, 5}, {120, 60, 5}, {0, 5, 10}, {0, 181, 5}, {0, 180, 1}
+	};
+	Ultrasonic_CalibrationType factory = {ULTRASONIC_UNIT_GAIN, 0};
+	uint16 expectedMap[SCAN_MAX_POINTS];
+	Ultrasonic_ResultType result;
+	Sim_ServoStatsType servoStats;
+	Scan_StatsType stats;
+	uint64 start = SIM_getCycles();
+	uint64 limit = (uint64)F_CPU * 8;
+	uint32 interval;
+	uint32 expectedRate;
+	uint32 triggers = 0;
+	uint32 errors = 0;
+	uint8 expectedPoint = 0;
+	boolean forward = TRUE;
+	uint8 point;
+
+	Ultrasonic_setCalibration(&factory);
+	Ultrasonic_setSpeedMultiplier(ULTRASONIC_DEFAULT_MULTIPLIER);
+
+	SIM_SERVO_init();
+	SIM_addObserver(Sim_scanObserve);
+	g_scanActive = TRUE;
+
+	Servo_init();
+	for(point = 0; point < sizeof(invalidConfigs) / sizeof(invalidConfigs[0]); point++){
+		if(Scan_init(&invalidConfigs[point]) == TRUE){
+			fprintf(stderr, "scan: %u to %u by %u accepted\n", invalidConfigs[point].firstAngle,
+					invalidConfigs[point].lastAngle, invalidConfigs[point].step);
+			errors++;
+		}
+	}
+	if(Scan_init(&config) == FALSE){
+		return errors + 1;
+	}
+	memset(expectedMap, 0, sizeof(expectedMap));
+
+	do{
+		Scan_update();
+		if(Ultrasonic_update()){
+			Ultrasonic_getResult(&result);
+			if(Scan_addResult(&result, &point) == FALSE){
+				fprintf(stderr, "scan: result not taken\n");
+				errors++;
+				continue;
+			}
+			triggers++;
+
+			if((point != expectedPoint) || (g_scanTriggers != triggers)){
+				fprintf(stderr, "scan: point %u expected %u (%u triggers for %u results)\n", point, expectedPoint, g_scanTriggers, triggers);
+				errors++;
+			}
+			else if(labs((sint32)g_scanTriggerAngle - (sint32)Scan_getAngle(point) * 100) > SIM_SCAN_ANGLE_TOLERANCE){
+				fprintf(stderr, "scan: point %u pinged at %u.%02u degrees\n", point, g_scanTriggerAngle / 100, g_scanTriggerAngle % 100);
+				errors++;
+			}
+			else{
+				expectedMap[point] = (uint16)((g_scanEchoCycles / (F_CPU / 1000000UL)) / ULTRASONIC_CALIBRATION_FACTOR);
+				if((result.status != ULTRASONIC_STATUS_OK) || (result.distance + 1 < expectedMap[point]) || (result.distance > expectedMap[point] + 1)){
+					fprintf(stderr, "scan: point %u expected %u cm got %u (status %u)\n", point, expectedMap[point], result.distance, result.status);
+					errors++;
+				}
+				expectedMap[point] = result.distance;
+			}
+
+			/* Next point of the sweep, back at the ends */
+			if((forward && (expectedPoint == Scan_getNumOfPoints() - 1)) || (!forward && (expectedPoint == 0))){
+				forward = !forward;
+			}
+			expectedPoint = forward ? (expectedPoint + 1) : (expectedPoint - 1);
+
+			Scan_getStats(&stats);
+			if(stats.sweeps >= SIM_SCAN_SWEEPS){
+				break;
+			}
+		}
+		SIM_advanceCycles(F_CPU / 1000);
+	}while((SIM_getCycles() - start) < limit);
+	g_scanActive = FALSE;
+
+	Scan_getStats(&stats);
+	if(stats.sweeps < SIM_SCAN_SWEEPS){
+		fprintf(stderr, "scan: %u sweeps\n", stats.sweeps);
+		errors++;
+	}
+	for(point = 0; point < Scan_getNumOfPoints(); point++){
+		if(Scan_getRange(point) != expectedMap[point]){
+			fprintf(stderr, "scan: map point %u holds %u expected %u\n", point, Scan_getRange(point), expectedMap[point]);
+			errors++;
+		}
+	}
+
+	/* One ping per ping spacing unless the servo takes longer to settle */
+	interval = SERVO_PERIOD_US + SERVO_MAX_PULSE_US + config.step * SCAN_SERVO_US_PER_DEGREE + SCAN_SETTLE_US;
+	if(interval < ULTRASONIC_PING_SPACING_TICKS){
+		interval = ULTRASONIC_PING_SPACING_TICKS;
+	}
+	expectedRate = (10000000UL + interval / 2) / interval;
+	if(((uint32)stats.pointRate + 1 < expectedRate) || (stats.pointRate > expectedRate + 1)){
+		fprintf(stderr, "scan: %u.%u points/s expected %u.%u\n", stats.pointRate / 10, stats.pointRate % 10, expectedRate / 10, expectedRate % 10);
+		errors++;
+	}
+
+	SIM_SERVO_getStats(&servoStats);
+	if((servoStats.frames == 0) || (servoStats.badPulses != 0)
+			|| (servoStats.minPeriod != SERVO_PERIOD_US * (F_CPU / 1000000UL)) || (servoStats.maxPeriod != servoStats.minPeriod)){
+		fprintf(stderr, "scan: %u servo frames (%u bad), period %u to %u cycles\n", servoStats.frames, servoStats.badPulses,
+				servoStats.minPeriod, servoStats.maxPeriod);
+		errors++;
+	}
+
+	printf("scan_points=%u\nscan_sweeps=%u\nscan_sweep_ms=%u\nscan_points_per_second=%u.%u\nservo_frames=%u\nservo_period_jitter_cycles=%u\nscan_errors=%u\n",
+			stats.points, stats.sweeps, stats.sweepTime, stats.pointRate / 10, stats.pointRate % 10, servoStats.frames,
+			servoStats.maxPeriod - servoStats.minPeriod, errors);
+
+	return errors;
+}
+
+int main(int argc, char * argv[]){
+
+	uint32 measurements = 200;
+	const char * telemetryPath = NULL;
+	char expected[SIM_HD44780_COLUMNS + 1] = "Distance=    cm ";
+	char row[SIM_HD44780_COLUMNS + 1];
+	char digits[8];
+	uint64 readCycles = 0;
+	uint64 displayCycles = 0;
+	uint64 graphicsCycles = 0;
+	uint8 glyph[LCD_GLYPH_ROWS];
+	uint64 hostStart;
+	uint64 hostTime;
+	uint32 errors = 0;
+	uint32 i;
+	uint64 firstDisplayCycles = 0;
+	boolean warmRestart = FALSE;
+	boolean calibrate = FALSE;
+	boolean shell = FALSE;
+	boolean position = FALSE;
+	boolean scan = FALSE;
+	boolean glitch = FALSE;
+#if((LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL) || (LCD_BIT_MODE == 4))
+	boolean temperature = FALSE;
+#endif
+	boolean twiReads = FALSE;
+	uint32 twiChecked = 0;
+	uint8 map[SIM_TWI_MAX_BYTES];
+	Ultrasonic_ResultType published = {0, 0, 0, ULTRASONIC_STATUS_OK, 0};
+	Regmap_DataType registers = {0, 0, 0, 0, 0, 0, 0, ULTRASONIC_STATUS_OK};
+	uint8 burstPings = 0;
+	uint8 syncSlot = 0xFF;
+	Sync_RoleType syncRole = SYNC_ROLE_SLAVE;
+	int option;
+	Ultrasonic_ResultType result;
+	Sim_HD44780_StatsType lcdStats;
+	Dashboard_StatsType dashboardStats;
+
+	while((option = getopt(argc, argv, "n:t:b:iy:mTkspagw")) != -1){
+		switch(option){
+		case 'n':
+			measurements = (uint32)strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			telemetryPath = optarg;
+			break;
+		case 'b':
+			burstPings = (uint8)strtoul(optarg, NULL, 10);
+			break;
+		case 'y':
+			syncSlot = (uint8)strtoul(optarg, NULL, 10);
+			break;
+		case 'm':
+			syncRole = SYNC_ROLE_MASTER;
+			break;
+		case 'i':
+#if(LCD_TRANSPORT == LCD_TRANSPORT_I2C)
+			fprintf(stderr, "-i needs the parallel LCD, the TWI is the master of the backpack\n");
+			return 2;
+#else
+			twiReads = TRUE;
+			break;
+#endif
+		case 'T':
+#if((LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL) && (LCD_BIT_MODE == 8))
+			fprintf(stderr, "-T needs PA7 for the LM35, it is D7 of the 8-bit LCD bus\n");
+			return 2;
+#else
+			temperature = TRUE;
+			break;
+#endif
+		case 'k':
+			calibrate = TRUE;
+			break;
+		case 's':
+			shell = TRUE;
+			break;
+		case 'p':
+			position = TRUE;
+			break;
+		case 'a':
+			scan = TRUE;
+			break;
+		case 'g':
+#if(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_UART)
+			fprintf(stderr, "-g needs a pulse output sensor type\n");
+			return 2;
+#else
+			glitch = TRUE;
+			break;
+#endif
+		case 'w':
+			warmRestart = TRUE;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n measurements] [-t telemetry.bin] [-b pings] [-i] [-y slot [-m]] [-T] [-k] [-s] [-p] [-a] [-g] [-w]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	SIM_reset();
+	SIM_HCSR04_init(ULTRASONIC_TRIGGER_PORT_ID, ULTRASONIC_TRIGGER_PIN_ID);
+	SIM_HCSR04_init(ULTRASONIC_TRIGGER2_PORT_ID, ULTRASONIC_TRIGGER2_PIN_ID);
+#if(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_PWM)
+	SIM_HCSR04_setOutput(SIM_HCSR04_OUTPUT_PWM);
+#elif(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_UART)
+	SIM_HCSR04_setOutput(SIM_HCSR04_OUTPUT_UART);
+#endif
+	SIM_HD44780_init();
+#if(LCD_TRANSPORT == LCD_TRANSPORT_I2C)
+	SIM_PCF8574_init(LCD_I2C_ADDRESS);
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_SPI)
+	SIM_HC595_init(LCD_SPI_LATCH_PORT_ID, LCD_SPI_LATCH_PIN_ID);
+#endif
+	SIM_TWI_init();
+
+	Sim_startApplication();
+
+	hostStart = Sim_hostNanoseconds();
+
+	for(i = 0; i < measurements; i++){
+
+		/* Sweep the object from 2 cm to 400 cm */
+		uint16 distance = 2 + (uint16)((i * 37) % 399);
+		uint16 expectedDistance;
+		uint16 dist;
+		uint64 start;
+
+		SIM_HCSR04_setDistance(distance);
+		expectedDistance = (uint16)((SIM_HCSR04_getEchoCycles() / (F_CPU / 1000000UL)) / ULTRASONIC_CALIBRATION_FACTOR);
+
+		/* The master reads the whole map while the measurement goes on */
+		if(twiReads == TRUE){
+			SIM_TWI_startRead(REGMAP_SLAVE_ADDRESS, REGMAP_ID_OFFSET, REGMAP_SIZE);
+		}
+
+		start = SIM_getCycles();
+		dist = Ultrasonic_readDistance();
+		readCycles += SIM_getCycles() - start;
+
+		Ultrasonic_getResult(&result);
+
+		if(twiReads == TRUE){
+			while(SIM_TWI_isBusy()){
+				SIM_advanceCycles(SIM_ACCESS_CYCLES);
+			}
+			if((i > 0) && (Sim_checkRegisterMap(map, SIM_TWI_getReadData(map), (uint8)(i - 1), &published) == FALSE)){
+				fprintf(stderr, "measurement %u: register map read wrong\n", i);
+				errors++;
+			}
+			twiChecked++;
+		}
+
+		/* Same publication as main() */
+		registers.timestamp = result.timestamp;
+		registers.distance = result.distance;
+		registers.status = result.status;
+		Regmap_publish(&registers);
+		published = result;
+		Telemetry_sendResult(&result);
+
+		/* Trend glyphs of the distance */
+		start = SIM_getCycles();
+		Display_addTrendSample(dist);
+		graphicsCycles += SIM_getCycles() - start;
+
+		/* Same page refresh as main(): only the changed cells are sent */
+		start = SIM_getCycles();
+		g_simDistance = dist;
+		Dashboard_update();
+		displayCycles += SIM_getCycles() - start;
+
+		/* The transfers run from the timer interrupt, wait for them before reading the display */
+		LCD_flush();
+		if(i == 0){
+			firstDisplayCycles = SIM_getCycles();
+		}
+
+		/* What the display must show now */
+		snprintf(digits, sizeof(digits), "%3u", dist);
+		memcpy(&expected[10], digits, strlen(digits));
+
+		SIM_HD44780_getRow(0, row);
+
+		if(Sim_checkGraphics(i, dist, glyph) == FALSE){
+			fprintf(stderr, "measurement %u: bar or trend wrong for %u cm\n", i, dist);
+			errors++;
+		}
+
+		/* One Timer1 tick of capture quantization can move the result by one */
+		if((dist + 1 < expectedDistance) || (dist > expectedDistance + 1) || (result.status != ULTRASONIC_STATUS_OK) || (strcmp(row, expected) != 0)){
+			fprintf(stderr, "measurement %u: object %u cm, expected %u got %u (status %u), lcd \"%s\" expected \"%s\"\n",
+					i, distance, expectedDistance, dist, result.status, row, expected);
+			errors++;
+		}
+	}
+
+	hostTime = Sim_hostNanoseconds() - hostStart;
+	SIM_HD44780_getStats(&lcdStats);
+	Dashboard_getStats(&dashboardStats);
+
+	printf("measurements=%u\n", measurements);
+	printf("errors=%u\n", errors);
+	printf("cycles_per_read=%llu\n", (unsigned long long)(readCycles / (measurements ? measurements : 1)));
+	printf("cycles_per_display=%llu\n", (unsigned long long)(displayCycles / (measurements ? measurements : 1)));
+	printf("cycles_per_graphics=%llu\n", (unsigned long long)(graphicsCycles / (measurements ? measurements : 1)));
+	printf("lcd_commands=%u\nlcd_characters=%u\nlcd_glyph_rows=%u\nlcd_violations=%u\n", lcdStats.commands, lcdStats.characters, lcdStats.glyphRows, lcdStats.violations);
+	printf("dashboard_renders=%u\ndashboard_cells=%u\ndashboard_cursor_moves=%u\n", dashboardStats.renders, dashboardStats.cells, dashboardStats.cursorMoves);
+	printf("host_ns_per_measurement=%llu\n", (unsigned long long)(hostTime / (measurements ? measurements : 1)));
+	printf("lcd_warm_start=%u\nlcd_ready_us=%lu\n", LCD_isWarmStart(), (unsigned long)LCD_getReadyTime());
+	printf("first_display_us=%llu\n", (unsigned long long)(firstDisplayCycles / (F_CPU / 1000000UL)));
+
+#if(LCD_TRANSPORT == LCD_TRANSPORT_I2C)
+	{
+		Sim_PCF8574_StatsType i2cStats;
+
+		SIM_PCF8574_getStats(&i2cStats);
+		printf("lcd_i2c_transactions=%u\nlcd_i2c_bytes=%u\nlcd_i2c_nacks=%u\nlcd_i2c_bus_us=%llu\n", i2cStats.transactions,
+				i2cStats.bytes, i2cStats.nacks, (unsigned long long)(i2cStats.busCycles / (F_CPU / 1000000UL)));
+	}
+#elif(LCD_TRANSPORT == LCD_TRANSPORT_SPI)
+	printf("lcd_spi_latches=%u\n", SIM_HC595_getLatches());
+#endif
+
+	if(telemetryPath != NULL){
+		uint32 size;
+		const uint8 * output_ptr = SIM_getUartOutput(&size);
+		FILE * file_ptr = fopen(telemetryPath, "wb");
+
+		if(file_ptr != NULL){
+			fwrite(output_ptr, 1, size, file_ptr);
+			fclose(file_ptr);
+		}
+		printf("telemetry_bytes=%u\n", size);
+	}
+
+	if(twiReads == TRUE){
+		Regmap_ConfigType config;
+		uint8 shift = 5;
+
+		/* Configuration write from the master */
+		SIM_TWI_startWrite(REGMAP_SLAVE_ADDRESS, REGMAP_FILTER_SHIFT_OFFSET, &shift, 1);
+		while(SIM_TWI_isBusy()){
+			SIM_advanceCycles(SIM_ACCESS_CYCLES);
+		}
+		if((Regmap_getConfig(&config) == FALSE) || (config.filterShift != shift) || (Regmap_getConfig(&config) == TRUE)){
+			fprintf(stderr, "register map configuration write wrong\n");
+			errors++;
+		}
+		printf("twi_reads=%u\ntwi_errors=%u\n", twiChecked, errors);
+	}
+
+	if(burstPings != 0){
+		Ultrasonic_BurstType burst;
+		uint16 expectedDistance;
+
+		SIM_HCSR04_setDistance(150);
+		expectedDistance = (uint16)((SIM_HCSR04_getEchoCycles() / (F_CPU / 1000000UL)) / ULTRASONIC_CALIBRATION_FACTOR);
+
+		if((Ultrasonic_readBurst(burstPings, &burst) == FALSE) || (burst.validCount != burst.pings) ||
+				(burst.median + 1 < expectedDistance) || (burst.median > expectedDistance + 1) ||
+				((burst.mean >> ULTRASONIC_BURST_FRACTION_BITS) + 1 < expectedDistance) ||
+				((burst.mean >> ULTRASONIC_BURST_FRACTION_BITS) > expectedDistance + 1) || (burst.spread > 2)){
+			fprintf(stderr, "burst: expected %u got median %u mean %u/%u min %u max %u valid %u/%u\n", expectedDistance,
+					burst.median, burst.mean, 1 << ULTRASONIC_BURST_FRACTION_BITS, burst.min, burst.max, burst.validCount, burst.pings);
+			errors++;
+		}
+		printf("burst_pings=%u\nburst_median=%u\nburst_mean_x%u=%u\nburst_spread=%u\nburst_us=%lu\nburst_errors=%u\n",
+				burst.pings, burst.median, 1 << ULTRASONIC_BURST_FRACTION_BITS, burst.mean, burst.spread, (unsigned long)burst.duration, errors);
+	}
+
+	if(syncSlot < SIM_SYNC_SLOTS){
+		errors += Sim_checkSyncSlots(syncSlot, syncRole);
+	}
+
+#if((LCD_TRANSPORT != LCD_TRANSPORT_PARALLEL) || (LCD_BIT_MODE == 4))
+	if(temperature == TRUE){
+		errors += Sim_checkTemperature();
+	}
+#endif
+
+	if(calibrate == TRUE){
+		errors += Sim_checkCalibration();
+	}
+
+	if(shell == TRUE){
+		errors += Sim_checkShell();
+	}
+
+	if(position == TRUE){
+		errors += Sim_checkTrilateration();
+	}
+
+	if(scan == TRUE){
+		errors += Sim_checkScan();
+	}
+
+	if(glitch == TRUE){
+		errors += Sim_checkGlitch();
+	}
+
+	if(warmRestart == TRUE){
+		uint16 dist;
+
+		/* Watchdog reset: the MCU starts again, the LCD keeps its state */
+		SIM_reset();
+		SIM_HD44780_mcuReset();
+		Sim_startApplication();
+		LCD_flush();
+
+		SIM_HD44780_getRow(0, row);
+		if(strcmp(row, "Distance=   0cm ") != 0){
+			fprintf(stderr, "warm start: lcd \"%s\"\n", row);
+			errors++;
+		}
+		printf("warm_lcd_warm_start=%u\nwarm_lcd_ready_us=%lu\n", LCD_isWarmStart(), (unsigned long)LCD_getReadyTime());
+
+		dist = Sim_measureAndDisplay();
+		printf("warm_first_display_us=%llu\n", (unsigned long long)(SIM_getCycles() / (F_CPU / 1000000UL)));
+
+		snprintf(digits, sizeof(digits), "%3u", dist);
+		memcpy(&expected[10], digits, strlen(digits));
+		SIM_HD44780_getRow(0, row);
+		if(strcmp(row, expected) != 0){
+			fprintf(stderr, "warm start: lcd \"%s\" expected \"%s\"\n", row, expected);
+			errors++;
+		}
+		SIM_HD44780_getStats(&lcdStats);
+		printf("warm_lcd_violations=%u\nwarm_errors=%u\n", lcdStats.violations, errors);
+	}
+
+	return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+ /******************************************************************************
+ *
+ * Module: SIM - PCF8574 backpack model
+ *
+ * File Name: sim_pcf8574.c
+ *
+ * Description: Simulated I2C bus with a PCF8574 LCD backpack: runs the transactions
+ *              the TWI master of the simulated ATmega32 starts and drives the HD44780
+ *              model with the expander outputs
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "sim_pcf8574.h"
+#include "sim_hd44780.h"
+#include "sim_atmega32.h"
+#include "twi.h"
+#include <avr/io.h>
+#include <string.h>
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* enum for the state of the bus */
+typedef enum{
+	SIM_PCF8574_IDLE,		/* Bus free, waiting for TWSTA */
+	SIM_PCF8574_START,		/* START (or repeated START) on the bus */
+	SIM_PCF8574_BYTE,		/* Byte and its acknowledge on the bus */
+	SIM_PCF8574_WAIT		/* Event raised, waiting for the answer of TWI_vect */
+}Sim_PCF8574_StateType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static Sim_PCF8574_StateType g_state = SIM_PCF8574_IDLE;
+static uint8 g_address = 0;
+
+/* A START was sent since the last STOP, the next byte is the address */
+static boolean g_inTransaction = FALSE;
+static boolean g_addressByte = FALSE;
+
+/* The expander acknowledged the address of the transaction */
+static boolean g_selected = FALSE;
+
+/* Byte on the bus and the end of the current bus event */
+static uint8 g_byte = 0;
+static uint64 g_eventStart = 0;
+static uint64 g_nextCycle = 0;
+
+static Sim_PCF8574_StatsType g_stats;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return one SCL period in CPU cycles: F_CPU / (16 + 2 * TWBR * 4^TWPS)
+ */
+static uint64 SIM_PCF8574_bitCycles(void){
+	return 16 + 2 * (uint64)TWBR * (1UL << (2 * (TWSR & 0x03)));
+}
+
+/*
+ * Description :
+ * Take the answer of TWI_vect (or a START requested from the idle bus) from TWCR
+ */
+static void SIM_PCF8574_takeControl(void){
+	uint64 now = SIM_getCycles();
+
+	if(TWCR & (1<<TWSTO)){
+
+		/* STOP: the hardware clears TWSTO, a START requested with it follows */
+		TWCR &= ~(1<<TWSTO);
+		g_inTransaction = FALSE;
+		g_selected = FALSE;
+		g_stats.busCycles += now + SIM_PCF8574_bitCycles() - g_eventStart;
+		g_state = SIM_PCF8574_IDLE;
+		g_nextCycle = now + SIM_PCF8574_bitCycles();
+	}
+
+	if(TWCR & (1<<TWSTA)){
+		if(g_inTransaction == FALSE){
+			g_eventStart = (now > g_nextCycle) ? now : g_nextCycle;
+		}
+		g_stats.transactions++;
+		g_state = SIM_PCF8574_START;
+		g_nextCycle = ((now > g_nextCycle) ? now : g_nextCycle) + SIM_PCF8574_bitCycles();
+	}
+	else if(g_inTransaction == TRUE){
+
+		/* TWINT written without TWSTA/TWSTO: TWDR goes on the bus */
+		g_byte = TWDR;
+		g_state = SIM_PCF8574_BYTE;
+		g_nextCycle = now + 9 * SIM_PCF8574_bitCycles();
+	}
+}
+
+/*
+ * Description :
+ * Observer: run the bus events of the TWI master
+ */
+static void SIM_PCF8574_observe(void){
+	uint64 now = SIM_getCycles();
+
+	if(!(TWCR & (1<<TWEN)) || SIM_isTwiPending()){
+		return;
+	}
+
+	switch(g_state){
+	case SIM_PCF8574_IDLE:
+		if(TWCR & (1<<TWSTA)){
+			SIM_PCF8574_takeControl();
+		}
+		break;
+
+	case SIM_PCF8574_WAIT:
+
+		/* TWI_vect ran: its TWCR write is the next bus event */
+		g_state = SIM_PCF8574_IDLE;
+		SIM_PCF8574_takeControl();
+		break;
+
+	case SIM_PCF8574_START:
+		if(now >= g_nextCycle){
+			SIM_raiseTwi(g_inTransaction ? TWI_MT_REP_START : TWI_MT_START, TWDR);
+			g_inTransaction = TRUE;
+			g_addressByte = TRUE;
+			g_state = SIM_PCF8574_WAIT;
+		}
+		break;
+
+	case SIM_PCF8574_BYTE:
+		if(now >= g_nextCycle){
+			if(g_addressByte){
+				g_addressByte = FALSE;
+				g_selected = (((g_byte >> 1) == g_address) && !(g_byte & 0x01)) ? TRUE : FALSE;
+				if(g_selected == FALSE){
+					g_stats.nacks++;
+				}
+				g_state = SIM_PCF8574_WAIT;
+				SIM_raiseTwi(g_selected ? TWI_MT_SLA_ACK : TWI_MT_SLA_NACK, TWDR);
+			}
+			else{
+
+				/* The outputs change at the acknowledge of the byte */
+				g_stats.bytes++;
+				SIM_HD44780_setExpanderOutputs(g_byte);
+				g_state = SIM_PCF8574_WAIT;
+				SIM_raiseTwi(TWI_MT_DATA_ACK, TWDR);
+			}
+		}
+		break;
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model, the expander answers the 7-bit address (outputs high at power up)
+ */
+void SIM_PCF8574_init(uint8 address){
+	g_address = address;
+	g_state = SIM_PCF8574_IDLE;
+	g_inTransaction = FALSE;
+	g_selected = FALSE;
+	g_nextCycle = 0;
+	memset(&g_stats, 0, sizeof(g_stats));
+
+	SIM_HD44780_setExpanderOutputs(0xFF);
+
+	SIM_addObserver(SIM_PCF8574_observe);
+}
+
+/*
+ * Description :
+ * Copy the bus statistics
+ */
+void SIM_PCF8574_getStats(Sim_PCF8574_StatsType * stats_ptr){
+	*stats_ptr = g_stats;
+}
@@ -0,0 +1,48 @@
+ /******************************************************************************
+ *
+ * Module: SIM - PCF8574 backpack model
+ *
+ * File Name: sim_pcf8574.h
+ *
+ * Description: Simulated I2C bus with a PCF8574 LCD backpack: runs the transactions
+ *              the TWI master of the simulated ATmega32 starts and drives the HD44780
+ *              model with the expander outputs
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_PCF8574_H_
+#define SIM_PCF8574_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds the bus statistics of the model */
+typedef struct{
+	uint32 transactions;	/* STARTs sent by the master */
+	uint32 bytes;			/* Bytes written to the expander */
+	uint32 nacks;			/* Addresses not acknowledged */
+	uint64 busCycles;		/* CPU cycles the bus was busy */
+}Sim_PCF8574_StatsType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model, the expander answers the 7-bit address (outputs high at power up)
+ */
+void SIM_PCF8574_init(uint8 address);
+
+/*
+ * Description :
+ * Copy the bus statistics
+ */
+void SIM_PCF8574_getStats(Sim_PCF8574_StatsType * stats_ptr);
+
+#endif /* SIM_PCF8574_H_ */
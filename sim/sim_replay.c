@@ -0,0 +1,476 @@
+ /******************************************************************************
+ *
+ * Module: SIM - capture trace replay
+ *
+ * File Name: sim_replay.c
+ *
+ * Description: Replay a trace of echo edges through the ICU interrupt, Ultrasonic_edgeProcessing
+ *              and the conversion of the ultrasonic driver on the simulated ATmega32, or find
+ *              the highest edge rate the driver sustains with synthetic traces
+ *
+ * Trace file: one edge per line "<polarity> <tick>", the polarity is R (rising) or F (falling)
+ *             and the tick is the Timer1 count of the edge (1 tick = 1 micro second).
+ *             16-bit ticks (ICR1 values) that wrap around are unwrapped, '#' starts a comment.
+ *
+ * Usage: sim_replay [-s isr_cycles] [-o results.csv] trace.txt
+ *        sim_replay [-s isr_cycles] [-n pulses] -r
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim_atmega32.h"
+#include "gpio.h"
+#include "icu.h"
+#include "ultrasonic.h"
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Estimated service time of TIMER1_CAPT_vect on the target in CPU cycles (entry, ICU
+ * ISR and Ultrasonic_edgeProcessing), measure it with PERF_METRIC_ICU_ISR and use -s
+ */
+#define SIM_REPLAY_ISR_CYCLES			250
+
+/* Edges scheduled ahead of the simulated time, they keep arriving while a vector runs */
+#define SIM_REPLAY_LOOKAHEAD			(SIM_MAX_PIN_EVENTS - 8)
+
+/* Simulated time before the first edge in CPU cycles */
+#define SIM_REPLAY_START_CYCLES			8000
+
+/* Difference in ticks accepted between a result and the pulse of the trace (capture quantization) */
+#define SIM_REPLAY_TOLERANCE_TICKS		2
+
+/* Edge interval range searched by the rate sweep in ticks */
+#define SIM_REPLAY_SWEEP_MIN_INTERVAL	1
+#define SIM_REPLAY_SWEEP_MAX_INTERVAL	20000
+
+/* Timer1 prescaler used by the ultrasonic driver */
+#define SIM_REPLAY_CYCLES_PER_TICK		8
+
+#if(ULTRASONIC_SENSOR_TYPE != ULTRASONIC_SENSOR_HCSR04)
+
+#error "The traces are HC-SR04 echo edges"
+
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds one edge of a trace */
+typedef struct{
+	uint32 tick;		/* Unwrapped Timer1 count of the edge */
+	uint8 level;		/* Pin level after the edge */
+}Sim_ReplayEdgeType;
+
+/* Structure that holds one complete pulse of a trace */
+typedef struct{
+	uint32 fallTick;
+	uint32 width;
+}Sim_ReplayPulseType;
+
+/* Structure that holds the outcome of a replay */
+typedef struct{
+	uint32 edges;
+	uint32 pulses;			/* Rising edge followed by a falling edge in the trace */
+	uint32 samples;			/* Measurements completed by the driver (edge counter) */
+	uint32 results;			/* Measurements converted by Ultrasonic_update */
+	uint32 ok;
+	uint32 noEcho;
+	uint32 desyncs;			/* Results that match no pulse of the trace */
+	uint32 glitches;		/* Edges rejected by the ICU */
+	uint64 isrCycles;		/* CPU cycles spent in the interrupt vectors */
+	uint64 hostNs;
+}Sim_ReplayReportType;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the host monotonic time in nano seconds
+ */
+static uint64 Sim_hostNanoseconds(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((uint64)now.tv_sec * 1000000000ULL) + (uint64)now.tv_nsec;
+}
+
+/*
+ * Description :
+ * Read a trace file, return the number of edges (0 on error) and the allocated edges
+ */
+static uint32 Sim_loadTrace(const char * path, Sim_ReplayEdgeType ** edges_ptr){
+	FILE * file_ptr = fopen(path, "r");
+	Sim_ReplayEdgeType * edges = NULL;
+	uint32 capacity = 0;
+	uint32 count = 0;
+	uint32 lastRaw = 0;
+	uint32 lastTick = 0;
+	uint32 line = 0;
+	char text[128];
+
+	if(file_ptr == NULL){
+		perror(path);
+		return 0;
+	}
+
+	while(fgets(text, sizeof(text), file_ptr) != NULL){
+		char polarity;
+		unsigned long raw;
+		char * comment_ptr = strchr(text, '#');
+
+		line++;
+		if(comment_ptr != NULL){
+			*comment_ptr = '\0';
+		}
+		if(sscanf(text, " %c %lu", &polarity, &raw) != 2){
+			continue;
+		}
+
+		if(count == capacity){
+			capacity = (capacity == 0) ? 1024 : (capacity * 2);
+			edges = realloc(edges, capacity * sizeof(Sim_ReplayEdgeType));
+		}
+
+		switch(polarity){
+		case 'R': case 'r': case '1': case '+':
+			edges[count].level = LOGIC_HIGH;
+			break;
+		case 'F': case 'f': case '0': case '-':
+			edges[count].level = LOGIC_LOW;
+			break;
+		default:
+			fprintf(stderr, "%s:%u: unknown polarity '%c'\n", path, line, polarity);
+			continue;
+		}
+
+		/* A 16-bit capture value lower than the previous one means Timer1 wrapped around */
+		if((count > 0) && (raw < lastRaw) && (raw <= 0xFFFF)){
+			lastTick += (uint32)((raw - lastRaw) & 0xFFFF);
+		}
+		else if(count > 0){
+			lastTick += (uint32)(raw - lastRaw);
+		}
+		else{
+			lastTick = (uint32)raw;
+		}
+		lastRaw = (uint32)raw;
+
+		edges[count++].tick = lastTick;
+	}
+
+	fclose(file_ptr);
+	*edges_ptr = edges;
+
+	return count;
+}
+
+/*
+ * Description :
+ * Fill a synthetic trace of square pulses: every edge interval ticks after the previous one
+ */
+static void Sim_makeTrace(Sim_ReplayEdgeType * edges, uint32 pulses, uint32 interval){
+	uint32 i;
+
+	for(i = 0; i < (pulses * 2); i++){
+		edges[i].tick = 1000 + (i * interval);
+		edges[i].level = ((i & 0x01) == 0) ? LOGIC_HIGH : LOGIC_LOW;
+	}
+}
+
+/*
+ * Description :
+ * Return the pulse of the trace that ends at fallTick, NULL if there is none
+ */
+static const Sim_ReplayPulseType * Sim_findPulse(const Sim_ReplayPulseType * pulses, uint32 count, uint32 fallTick){
+	uint32 low = 0;
+	uint32 high = count;
+
+	/* First pulse ending at or after fallTick - tolerance */
+	while(low < high){
+		uint32 middle = (low + high) / 2;
+
+		if((pulses[middle].fallTick + SIM_REPLAY_TOLERANCE_TICKS) < fallTick){
+			low = middle + 1;
+		}
+		else{
+			high = middle;
+		}
+	}
+
+	if((low < count) && (pulses[low].fallTick <= (fallTick + SIM_REPLAY_TOLERANCE_TICKS))){
+		return &pulses[low];
+	}
+
+	return NULL;
+}
+
+/*
+ * Description :
+ * Replay the edges through the driver, write one CSV line per result if csv_ptr is not NULL
+ */
+static void Sim_replay(const Sim_ReplayEdgeType * edges, uint32 count, FILE * csv_ptr, Sim_ReplayReportType * report_ptr){
+	Sim_ReplayPulseType * pulses = malloc((count / 2 + 1) * sizeof(Sim_ReplayPulseType));
+	Ultrasonic_SampleType sample;
+	Ultrasonic_ResultType result;
+	uint8 lastCount;
+	uint16 glitchStart;
+	uint64 base;
+	uint64 isrStart;
+	uint64 isrLast;
+	uint64 hostStart;
+	uint32 timestampBase;
+	uint32 scheduled = 0;
+	uint32 i;
+
+	memset(report_ptr, 0, sizeof(Sim_ReplayReportType));
+	report_ptr->edges = count;
+
+	/* The complete pulses of the trace, sorted by their falling edge */
+	for(i = 1; i < count; i++){
+		if((edges[i - 1].level == LOGIC_HIGH) && (edges[i].level == LOGIC_LOW)){
+			pulses[report_ptr->pulses].fallTick = edges[i].tick;
+			pulses[report_ptr->pulses].width = edges[i].tick - edges[i - 1].tick;
+			report_ptr->pulses++;
+		}
+	}
+
+	SIM_reset();
+	ICU_DeInit();
+	Ultrasonic_init();
+	sei();
+
+	/* Start from the current state of the driver */
+	Ultrasonic_update();
+	Ultrasonic_getSample(&sample);
+	lastCount = sample.count;
+	glitchStart = ICU_getGlitchCount();
+
+	/* The first edge comes at base, the time stamps of the driver are mapped on the trace ticks */
+	SIM_advanceCycles(SIM_REPLAY_START_CYCLES);
+	base = SIM_getCycles();
+	timestampBase = ICU_getTimestamp();
+
+	isrStart = SIM_getInterruptCycles();
+	isrLast = isrStart;
+	hostStart = Sim_hostNanoseconds();
+
+	for(i = 0; i <= count; i++){
+
+		/* The edges keep coming on time, also while the CPU is inside a vector */
+		while((scheduled < count) && (scheduled < (i + SIM_REPLAY_LOOKAHEAD))){
+			uint64 at = base + ((uint64)(edges[scheduled].tick - edges[0].tick) * SIM_REPLAY_CYCLES_PER_TICK);
+			uint64 now = SIM_getCycles();
+
+			SIM_schedulePinLevel(ICU_PORT_ID, ICU_PIN_ID, edges[scheduled].level, (at > now) ? (at - now) : 0);
+			scheduled++;
+		}
+
+		if(i < count){
+			uint64 at = base + ((uint64)(edges[i].tick - edges[0].tick) * SIM_REPLAY_CYCLES_PER_TICK);
+
+			if(at > SIM_getCycles()){
+				SIM_advanceCycles(at - SIM_getCycles());
+			}
+		}
+		else{
+			/* Let the last vector finish */
+			SIM_advanceCycles(SIM_REPLAY_START_CYCLES);
+		}
+
+		/* The update publishes an echo held until the minimum pulse width passed, count after it */
+		if(Ultrasonic_update()){
+			const Sim_ReplayPulseType * pulse_ptr;
+			uint32 fallTick;
+			uint64 isrNow = SIM_getInterruptCycles();
+
+			Ultrasonic_getSample(&sample);
+			Ultrasonic_getResult(&result);
+			report_ptr->results++;
+
+			if(result.status == ULTRASONIC_STATUS_NO_ECHO){
+				report_ptr->noEcho++;
+			}
+			else{
+				report_ptr->ok++;
+			}
+
+			/* The result must come from a pulse of the trace with the same width */
+			fallTick = edges[0].tick + (result.timestamp - timestampBase);
+			pulse_ptr = Sim_findPulse(pulses, report_ptr->pulses, fallTick);
+			if((pulse_ptr == NULL)
+					|| ((pulse_ptr->width + SIM_REPLAY_TOLERANCE_TICKS) < sample.highTime)
+					|| (pulse_ptr->width > (uint32)(sample.highTime + SIM_REPLAY_TOLERANCE_TICKS))){
+				report_ptr->desyncs++;
+			}
+
+			if(csv_ptr != NULL){
+				fprintf(csv_ptr, "%u,%u,%u,%u,%u,%llu\n", fallTick, sample.highTime, result.distance, result.status,
+						(pulse_ptr == NULL) ? 0 : pulse_ptr->width, (unsigned long long)(isrNow - isrLast));
+			}
+			isrLast = isrNow;
+		}
+
+		/* Count the measurements from the edge counter of the driver */
+		Ultrasonic_getSample(&sample);
+		report_ptr->samples += (uint8)(sample.count - lastCount);
+		lastCount = sample.count;
+	}
+
+	report_ptr->hostNs = Sim_hostNanoseconds() - hostStart;
+	report_ptr->isrCycles = SIM_getInterruptCycles() - isrStart;
+	report_ptr->glitches = (uint16)(ICU_getGlitchCount() - glitchStart);
+
+	free(pulses);
+}
+
+/*
+ * Description :
+ * Print the outcome of a replay
+ */
+static void Sim_printReport(const Sim_ReplayReportType * report_ptr){
+	printf("edges=%u\n", report_ptr->edges);
+	printf("pulses=%u\n", report_ptr->pulses);
+	printf("samples=%u\n", report_ptr->samples);
+	printf("results=%u\n", report_ptr->results);
+	printf("status_ok=%u\nstatus_no_echo=%u\n", report_ptr->ok, report_ptr->noEcho);
+	printf("glitches=%u\n", report_ptr->glitches);
+	printf("missed_pulses=%d\n", (int)(report_ptr->pulses - report_ptr->samples));
+	printf("desyncs=%u\n", report_ptr->desyncs);
+	printf("isr_cycles_per_edge=%llu\n", (unsigned long long)(report_ptr->isrCycles / (report_ptr->edges ? report_ptr->edges : 1)));
+	printf("host_ns_per_edge=%llu\n", (unsigned long long)(report_ptr->hostNs / (report_ptr->edges ? report_ptr->edges : 1)));
+}
+
+/*
+ * Description :
+ * Return TRUE if every pulse of the trace gave exactly one correct measurement
+ */
+static boolean Sim_replayPassed(const Sim_ReplayReportType * report_ptr){
+	return (report_ptr->samples == report_ptr->pulses) && (report_ptr->desyncs == 0);
+}
+
+int main(int argc, char * argv[]){
+
+	uint32 isrCycles = SIM_REPLAY_ISR_CYCLES;
+	uint32 sweepPulses = 200;
+	boolean sweep = FALSE;
+	const char * csvPath = NULL;
+	Sim_ReplayReportType report;
+	int option;
+
+	while((option = getopt(argc, argv, "s:o:n:r")) != -1){
+		switch(option){
+		case 's':
+			isrCycles = (uint32)strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			csvPath = optarg;
+			break;
+		case 'n':
+			sweepPulses = (uint32)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			sweep = TRUE;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s isr_cycles] [-o results.csv] trace.txt\n"
+					"       %s [-s isr_cycles] [-n pulses] -r\n", argv[0], argv[0]);
+			return 2;
+		}
+	}
+
+	SIM_setInterruptCycles(isrCycles);
+	printf("isr_cycles=%u\n", isrCycles);
+
+	if(sweep){
+		Sim_ReplayEdgeType * edges = malloc(sweepPulses * 2 * sizeof(Sim_ReplayEdgeType));
+		uint32 low = SIM_REPLAY_SWEEP_MIN_INTERVAL;
+		uint32 high = SIM_REPLAY_SWEEP_MAX_INTERVAL;
+
+		/* Bisect the shortest edge interval at which every pulse still gives a correct result */
+		Sim_makeTrace(edges, sweepPulses, high);
+		Sim_replay(edges, sweepPulses * 2, NULL, &report);
+		if(!Sim_replayPassed(&report)){
+			printf("max_edge_rate_hz=0\n");
+			free(edges);
+			return 1;
+		}
+
+		while(low < high){
+			uint32 middle = (low + high) / 2;
+
+			Sim_makeTrace(edges, sweepPulses, middle);
+			Sim_replay(edges, sweepPulses * 2, NULL, &report);
+
+			printf("interval_ticks=%u samples=%u/%u desyncs=%u glitches=%u\n", middle, report.samples, report.pulses,
+					report.desyncs, report.glitches);
+
+			if(Sim_replayPassed(&report)){
+				high = middle;
+			}
+			else{
+				low = middle + 1;
+			}
+		}
+
+		/* Report the failure just below the limit */
+		Sim_makeTrace(edges, sweepPulses, (high > 1) ? (high - 1) : 1);
+		Sim_replay(edges, sweepPulses * 2, NULL, &report);
+
+		printf("min_edge_interval_ticks=%u\n", high);
+		printf("max_edge_rate_hz=%u\n", ULTRASONIC_SEC_TO_CLK / high);
+		printf("max_sample_rate_hz=%u\n", ULTRASONIC_SEC_TO_CLK / (2 * high));
+		printf("below_limit_missed_pulses=%d\n", (int)(report.pulses - report.samples));
+		printf("below_limit_desyncs=%u\n", report.desyncs);
+
+		free(edges);
+		return 0;
+	}
+	else{
+		Sim_ReplayEdgeType * edges = NULL;
+		FILE * csv_ptr = NULL;
+		uint32 count;
+
+		if(optind >= argc){
+			fprintf(stderr, "%s: no trace file\n", argv[0]);
+			return 2;
+		}
+
+		count = Sim_loadTrace(argv[optind], &edges);
+		if(count == 0){
+			return 2;
+		}
+
+		if(csvPath != NULL){
+			csv_ptr = fopen(csvPath, "w");
+			if(csv_ptr == NULL){
+				perror(csvPath);
+				return 2;
+			}
+			fprintf(csv_ptr, "fall_tick,high_time,distance,status,trace_width,isr_cycles\n");
+		}
+
+		Sim_replay(edges, count, csv_ptr, &report);
+		Sim_printReport(&report);
+
+		if(csv_ptr != NULL){
+			fclose(csv_ptr);
+		}
+		free(edges);
+
+		return Sim_replayPassed(&report) ? 0 : 1;
+	}
+}
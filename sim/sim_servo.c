@@ -0,0 +1,132 @@
+ /******************************************************************************
+ *
+ * Module: SIM - servo model
+ *
+ * File Name: sim_servo.c
+ *
+ * Description: Simulated hobby servo on OC1A (PD5): decodes the pulses and turns the
+ *              horn towards the angle of the last pulse at a limited speed
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "sim_servo.h"
+#include "sim_atmega32.h"
+#include <string.h>
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Input level at the last observation and the time of the last rising edge */
+static uint8 g_lastLevel = LOGIC_LOW;
+static uint64 g_riseCycle = 0;
+static boolean g_risen = FALSE;
+
+/* The horn turns from g_fromAngle at g_moveCycle towards g_targetAngle (1/100 degree) */
+static uint32 g_fromAngle = 9000;
+static uint32 g_targetAngle = 9000;
+static uint64 g_moveCycle = 0;
+
+static Sim_ServoStatsType g_stats;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the angle of the horn at a given time in 1/100 degree
+ */
+static uint32 SIM_SERVO_angleAt(uint64 cycle){
+	uint64 turned = ((cycle - g_moveCycle) * 100) / ((uint64)SIM_SERVO_US_PER_DEGREE * (F_CPU / 1000000UL));
+
+	if(g_targetAngle >= g_fromAngle){
+		return (turned >= (g_targetAngle - g_fromAngle)) ? g_targetAngle : (g_fromAngle + (uint32)turned);
+	}
+	return (turned >= (g_fromAngle - g_targetAngle)) ? g_targetAngle : (g_fromAngle - (uint32)turned);
+}
+
+/*
+ * Description :
+ * Observer: measure every pulse on OC1A, a pulse in range sets the target from its end on
+ */
+static void SIM_SERVO_observe(void){
+	uint8 level = SIM_getPinLevel(3, 5);
+	uint64 edge;
+	uint32 width;
+
+	if(level == g_lastLevel){
+		return;
+	}
+	g_lastLevel = level;
+	edge = SIM_getOutputCompareCycle();
+
+	if(level == LOGIC_HIGH){
+		if(g_risen){
+			uint32 period = (uint32)(edge - g_riseCycle);
+
+			if((g_stats.minPeriod == 0) || (period < g_stats.minPeriod)){
+				g_stats.minPeriod = period;
+			}
+			if(period > g_stats.maxPeriod){
+				g_stats.maxPeriod = period;
+			}
+		}
+		g_riseCycle = edge;
+		g_risen = TRUE;
+		return;
+	}
+
+	if(g_risen == FALSE){
+		return;
+	}
+
+	width = (uint32)((edge - g_riseCycle) / (F_CPU / 1000000UL));
+	g_stats.frames++;
+	if((width < SIM_SERVO_MIN_PULSE_US) || (width > SIM_SERVO_MAX_PULSE_US)){
+		g_stats.badPulses++;
+		return;
+	}
+
+	g_fromAngle = SIM_SERVO_angleAt(edge);
+	g_targetAngle = ((width - SIM_SERVO_MIN_PULSE_US) * 18000UL) / (SIM_SERVO_MAX_PULSE_US - SIM_SERVO_MIN_PULSE_US);
+	g_moveCycle = edge;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model on OC1A with the horn at 90 degrees, the edges are time stamped at
+ * the compare match that made them
+ */
+void SIM_SERVO_init(void){
+	g_lastLevel = SIM_getPinLevel(3, 5);
+	g_risen = FALSE;
+	g_fromAngle = 9000;
+	g_targetAngle = 9000;
+	g_moveCycle = SIM_getCycles();
+	memset(&g_stats, 0, sizeof(g_stats));
+
+	SIM_addObserver(SIM_SERVO_observe);
+}
+
+/*
+ * Description :
+ * Return the angle of the horn now in 1/100 degree
+ */
+uint32 SIM_SERVO_getAngle(void){
+	return SIM_SERVO_angleAt(SIM_getCycles());
+}
+
+/*
+ * Description :
+ * Copy what the model saw on its input
+ */
+void SIM_SERVO_getStats(Sim_ServoStatsType * stats_ptr){
+	*stats_ptr = g_stats;
+}
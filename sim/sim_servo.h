@@ -0,0 +1,65 @@
+ /******************************************************************************
+ *
+ * Module: SIM - servo model
+ *
+ * File Name: sim_servo.h
+ *
+ * Description: Simulated hobby servo on OC1A (PD5): decodes the pulses and turns the
+ *              horn towards the angle of the last pulse at a limited speed
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_SERVO_H_
+#define SIM_SERVO_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Pulse widths of 0 and 180 degrees in micro seconds */
+#define SIM_SERVO_MIN_PULSE_US			1000
+#define SIM_SERVO_MAX_PULSE_US			2000
+
+/* Speed of the horn: 0.1 s per 60 degrees */
+#define SIM_SERVO_US_PER_DEGREE			1667
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds what the model saw on its input */
+typedef struct{
+	uint32 frames;				/* Complete pulses */
+	uint32 badPulses;			/* Pulses outside the servo range (ignored) */
+	uint32 minPeriod;			/* Shortest and longest time between two rising edges in CPU cycles */
+	uint32 maxPeriod;
+}Sim_ServoStatsType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model on OC1A with the horn at 90 degrees, the edges are time stamped at
+ * the compare match that made them
+ */
+void SIM_SERVO_init(void);
+
+/*
+ * Description :
+ * Return the angle of the horn now in 1/100 degree
+ */
+uint32 SIM_SERVO_getAngle(void);
+
+/*
+ * Description :
+ * Copy what the model saw on its input
+ */
+void SIM_SERVO_getStats(Sim_ServoStatsType * stats_ptr);
+
+#endif /* SIM_SERVO_H_ */
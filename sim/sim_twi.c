@@ -0,0 +1,207 @@
+ /******************************************************************************
+ *
+ * Module: SIM - TWI master model
+ *
+ * File Name: sim_twi.c
+ *
+ * Description: Simulated TWI master: runs register read and write transactions
+ *              against the TWI slave of the simulated ATmega32 while the firmware runs
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "sim_twi.h"
+#include "sim_atmega32.h"
+#include "twi.h"
+#include <avr/io.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* One byte and its acknowledge on the bus */
+#define SIM_TWI_BYTE_CYCLES			((9 * F_CPU) / SIM_TWI_BIT_RATE)
+
+/* START, address, pointer, repeated START, address and the data bytes */
+#define SIM_TWI_MAX_STEPS			(SIM_TWI_MAX_BYTES + 5)
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Bus event seen by the slave, capture = the slave loaded TWDR with a byte for the master */
+typedef struct{
+	uint8 status;
+	uint8 data;
+	boolean capture;
+}Sim_TwiStepType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static Sim_TwiStepType g_steps[SIM_TWI_MAX_STEPS];
+static uint8 g_numOfSteps = 0;
+static uint8 g_step = 0;
+static uint8 g_address = 0;
+static boolean g_busy = FALSE;
+
+/* Time of the next bus event */
+static uint64 g_nextCycle = 0;
+
+static uint8 g_readData[SIM_TWI_MAX_BYTES];
+static uint8 g_readCount = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add a bus event to the transaction
+ */
+static void SIM_TWI_addStep(uint8 status, uint8 data, boolean capture){
+	g_steps[g_numOfSteps].status = status;
+	g_steps[g_numOfSteps].data = data;
+	g_steps[g_numOfSteps].capture = capture;
+	g_numOfSteps++;
+}
+
+/*
+ * Description :
+ * Observer: raise the next bus event once the slave released the bus (served the last one)
+ */
+static void SIM_TWI_observe(void){
+	uint64 now = SIM_getCycles();
+
+	if((g_busy == FALSE) || SIM_isTwiPending() || (now < g_nextCycle)){
+		return;
+	}
+
+	/* Byte loaded by the slave for the last event */
+	if((g_step > 0) && g_steps[g_step - 1].capture){
+		g_readData[g_readCount++] = TWDR;
+	}
+
+	if(g_step == 0){
+
+		/* The address is not acknowledged: the transaction ends at once */
+		if(!(TWCR & (1<<TWEN)) || ((TWAR >> 1) != g_address)){
+			g_busy = FALSE;
+			return;
+		}
+	}
+
+	if(g_step >= g_numOfSteps){
+		g_busy = FALSE;
+		return;
+	}
+
+	SIM_raiseTwi(g_steps[g_step].status, g_steps[g_step].data);
+	g_step++;
+	g_nextCycle = now + SIM_TWI_BYTE_CYCLES;
+}
+
+/*
+ * Description :
+ * Start a transaction whose steps are set
+ */
+static void SIM_TWI_start(uint8 address){
+	g_address = address;
+	g_step = 0;
+	g_readCount = 0;
+	g_nextCycle = SIM_getCycles() + SIM_TWI_BYTE_CYCLES;
+	g_busy = TRUE;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model
+ */
+void SIM_TWI_init(void){
+	g_busy = FALSE;
+	g_readCount = 0;
+
+	SIM_addObserver(SIM_TWI_observe);
+}
+
+/*
+ * Description :
+ * Start a transaction: write the register pointer then read count bytes after a
+ * repeated START, return FALSE if a transaction is going on
+ */
+boolean SIM_TWI_startRead(uint8 address, uint8 reg, uint8 count){
+	uint8 i;
+
+	if((g_busy == TRUE) || (count == 0) || (count > SIM_TWI_MAX_BYTES)){
+		return FALSE;
+	}
+
+	g_numOfSteps = 0;
+	SIM_TWI_addStep(TWI_SR_SLA_ACK, 0, FALSE);
+	SIM_TWI_addStep(TWI_SR_DATA_ACK, reg, FALSE);
+	SIM_TWI_addStep(TWI_SR_STOP, 0, FALSE);
+	SIM_TWI_addStep(TWI_ST_SLA_ACK, 0, TRUE);
+	for(i = 1; i < count; i++){
+		SIM_TWI_addStep(TWI_ST_DATA_ACK, 0, TRUE);
+	}
+
+	/* The master does not acknowledge the last byte */
+	SIM_TWI_addStep(TWI_ST_DATA_NACK, 0, FALSE);
+
+	SIM_TWI_start(address);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Start a transaction: write the register pointer then count bytes,
+ * return FALSE if a transaction is going on
+ */
+boolean SIM_TWI_startWrite(uint8 address, uint8 reg, const uint8 * data_ptr, uint8 count){
+	uint8 i;
+
+	if((g_busy == TRUE) || (count > SIM_TWI_MAX_BYTES)){
+		return FALSE;
+	}
+
+	g_numOfSteps = 0;
+	SIM_TWI_addStep(TWI_SR_SLA_ACK, 0, FALSE);
+	SIM_TWI_addStep(TWI_SR_DATA_ACK, reg, FALSE);
+	for(i = 0; i < count; i++){
+		SIM_TWI_addStep(TWI_SR_DATA_ACK, data_ptr[i], FALSE);
+	}
+	SIM_TWI_addStep(TWI_SR_STOP, 0, FALSE);
+
+	SIM_TWI_start(address);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return TRUE while a transaction is going on
+ */
+boolean SIM_TWI_isBusy(void){
+	return g_busy;
+}
+
+/*
+ * Description :
+ * Copy the bytes of the last read, return their number (0 if the slave did not answer)
+ */
+uint8 SIM_TWI_getReadData(uint8 * data_ptr){
+	uint8 i;
+
+	for(i = 0; i < g_readCount; i++){
+		data_ptr[i] = g_readData[i];
+	}
+
+	return g_readCount;
+}
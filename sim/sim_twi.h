@@ -0,0 +1,65 @@
+ /******************************************************************************
+ *
+ * Module: SIM - TWI master model
+ *
+ * File Name: sim_twi.h
+ *
+ * Description: Simulated TWI master: runs register read and write transactions
+ *              against the TWI slave of the simulated ATmega32 while the firmware runs
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_TWI_H_
+#define SIM_TWI_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* SCL frequency of the master in Hz */
+#define SIM_TWI_BIT_RATE			100000
+
+/* Longest read or write of a transaction */
+#define SIM_TWI_MAX_BYTES			32
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the model
+ */
+void SIM_TWI_init(void);
+
+/*
+ * Description :
+ * Start a transaction: write the register pointer then read count bytes after a
+ * repeated START, return FALSE if a transaction is going on
+ */
+boolean SIM_TWI_startRead(uint8 address, uint8 reg, uint8 count);
+
+/*
+ * Description :
+ * Start a transaction: write the register pointer then count bytes,
+ * return FALSE if a transaction is going on
+ */
+boolean SIM_TWI_startWrite(uint8 address, uint8 reg, const uint8 * data_ptr, uint8 count);
+
+/*
+ * Description :
+ * Return TRUE while a transaction is going on
+ */
+boolean SIM_TWI_isBusy(void);
+
+/*
+ * Description :
+ * Copy the bytes of the last read, return their number (0 if the slave did not answer)
+ */
+uint8 SIM_TWI_getReadData(uint8 * data_ptr);
+
+#endif /* SIM_TWI_H_ */
@@ -0,0 +1,21 @@
+ /******************************************************************************
+ *
+ * Module: SIM
+ *
+ * File Name: stdlib.h
+ *
+ * Description: Host <stdlib.h> plus the avr-libc extensions used by the drivers
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_STDLIB_H_
+#define SIM_STDLIB_H_
+
+#include_next <stdlib.h>
+
+/* avr-libc: convert an integer to a string in the given radix */
+char * itoa(int value, char * string, int radix);
+
+#endif /* SIM_STDLIB_H_ */
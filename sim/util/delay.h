@@ -0,0 +1,21 @@
+ /******************************************************************************
+ *
+ * Module: SIM
+ *
+ * File Name: delay.h
+ *
+ * Description: Host replacement of <util/delay.h>: the delays advance the simulated time
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SIM_UTIL_DELAY_H_
+#define SIM_UTIL_DELAY_H_
+
+#include "sim_atmega32.h"
+
+#define _delay_us(us)	SIM_advanceCycles((uint64)((us) * (F_CPU / 1000000.0)))
+#define _delay_ms(ms)	SIM_advanceCycles((uint64)((ms) * (F_CPU / 1000.0)))
+
+#endif /* SIM_UTIL_DELAY_H_ */
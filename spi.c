@@ -0,0 +1,94 @@
+ /******************************************************************************
+ *
+ * Module: SPI
+ *
+ * File Name: spi.c
+ *
+ * Description: Source file for the AVR SPI master driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "spi.h"
+#include "gpio.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Global variables to hold the address of the call back function in the application */
+static void(*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(SPI_STC_vect){
+
+	/* SPIF is cleared by the execution of the vector */
+	if(g_callBackPtr != NULL_PTR){
+		(*g_callBackPtr)();
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize SPI as a master:
+ * 1. Setup MOSI, SCK and SS as outputs (SS must stay an output in master mode)
+ * 2. Setup the clock, the mode and the bit order
+ * 3. Enable the SPI and its interrupt
+ * The global interrupts must be enabled.
+ */
+void SPI_initMaster(const Spi_ConfigType * config_ptr){
+	GPIO_setupPinDirection(SPI_PORT_ID, SPI_SS_PIN_ID, PIN_OUTPUT);
+	GPIO_setupPinDirection(SPI_PORT_ID, SPI_MOSI_PIN_ID, PIN_OUTPUT);
+	GPIO_setupPinDirection(SPI_PORT_ID, SPI_MISO_PIN_ID, PIN_INPUT);
+	GPIO_setupPinDirection(SPI_PORT_ID, SPI_SCK_PIN_ID, PIN_OUTPUT);
+
+	/* SPI2X = 1 doubles the SCK frequency */
+	SPSR = ((config_ptr->clock >> 2) & 0x01) << SPI2X;
+
+	/*
+	 * SPI Control Register:
+	 * 1. SPIE = 1 to enable the SPI interrupt
+	 * 2. SPE = 1 to enable the SPI
+	 * 3. DORD = bit order
+	 * 4. MSTR = 1 for the master mode
+	 * 5. CPOL:CPHA = mode
+	 * 6. SPR1:0 = clock
+	 */
+	SPCR = (1<<SPIE) | (1<<SPE) | (config_ptr->dataOrder << DORD) | (1<<MSTR)
+			| ((config_ptr->mode & 0x03) << CPHA) | (config_ptr->clock & 0x03);
+}
+
+/*
+ * Description :
+ * Set the call back called from the SPI interrupt at the end of every byte
+ */
+void SPI_setCallBack(void(*a_ptr)(void)){
+	g_callBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Start shifting one byte out without waiting, the call back is called at its end
+ */
+void SPI_sendByte(uint8 data){
+	SPDR = data;
+}
+
+/*
+ * Description :
+ * Disable the SPI
+ */
+void SPI_DeInit(void){
+	SPCR = 0;
+	SPSR = 0;
+}
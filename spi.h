@@ -0,0 +1,87 @@
+ /******************************************************************************
+ *
+ * Module: SPI
+ *
+ * File Name: spi.h
+ *
+ * Description: Header file for the AVR SPI master driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SPI_H_
+#define SPI_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* SPI pins of the ATmega32 */
+#define SPI_PORT_ID			PORTB_ID
+#define SPI_SS_PIN_ID		PIN4_ID
+#define SPI_MOSI_PIN_ID		PIN5_ID
+#define SPI_MISO_PIN_ID		PIN6_ID
+#define SPI_SCK_PIN_ID		PIN7_ID
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* enum for the SCK frequency, the value is SPI2X:SPR1:SPR0 */
+typedef enum{
+	SPI_F_CPU_4, SPI_F_CPU_16, SPI_F_CPU_64, SPI_F_CPU_128, SPI_F_CPU_2, SPI_F_CPU_8, SPI_F_CPU_32
+}Spi_ClockType;
+
+/* enum for the clock polarity and phase (CPOL:CPHA) */
+typedef enum{
+	SPI_MODE_0, SPI_MODE_1, SPI_MODE_2, SPI_MODE_3
+}Spi_ModeType;
+
+/* enum for the bit order of a byte */
+typedef enum{
+	SPI_MSB_FIRST, SPI_LSB_FIRST
+}Spi_DataOrderType;
+
+/* Structure that contain members to set the configurations of SPI */
+typedef struct{
+	Spi_ClockType clock;
+	Spi_ModeType mode;
+	Spi_DataOrderType dataOrder;
+}Spi_ConfigType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize SPI as a master:
+ * 1. Setup MOSI, SCK and SS as outputs (SS must stay an output in master mode)
+ * 2. Setup the clock, the mode and the bit order
+ * 3. Enable the SPI and its interrupt
+ * The global interrupts must be enabled.
+ */
+void SPI_initMaster(const Spi_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Set the call back called from the SPI interrupt at the end of every byte
+ */
+void SPI_setCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Start shifting one byte out without waiting, the call back is called at its end
+ */
+void SPI_sendByte(uint8 data);
+
+/*
+ * Description :
+ * Disable the SPI
+ */
+void SPI_DeInit(void);
+
+#endif /* SPI_H_ */
@@ -0,0 +1,156 @@
+ /******************************************************************************
+ *
+ * Module: SYNC
+ *
+ * File Name: sync.c
+ *
+ * Description: Source file for the ping slots synchronised on a shared sync line
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "sync.h"
+#include "icu.h"
+#include "timer.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static Sync_ConfigType g_config;
+
+/* ICU time stamp of the last sync edge and the number of edges */
+static volatile uint32 g_syncTime = 0;
+static volatile uint16 g_edgeCount = 0;
+
+/* Master: timers that start and end the sync pulse */
+static uint8 g_frameTimer = TIMER_INVALID_ID;
+static uint8 g_pulseTimer = TIMER_INVALID_ID;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+static void Sync_pulseStart(void);
+static void Sync_pulseEnd(void);
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(INT0_vect){
+
+	/* Start of a frame on the time base of the slots */
+	g_syncTime = ICU_getTimestamp();
+	g_edgeCount++;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the synchronisation:
+ * 1. Time stamp the rising edges of the sync line on the ICU time base (INT0 interrupt)
+ * 2. For the master: drive the sync line and send a pulse every frame
+ * The ICU and the timer service must be initialized (Ultrasonic_init).
+ */
+void Sync_init(const Sync_ConfigType * config_ptr){
+
+	g_config = *config_ptr;
+	g_edgeCount = 0;
+
+	/* ISC01:0 = 11 for the rising edge of INT0 */
+	MCUCR |= (1<<ISC01) | (1<<ISC00);
+	GIFR = (1<<INTF0);
+	GICR |= (1<<INT0);
+
+	if(g_config.role == SYNC_ROLE_MASTER){
+		GPIO_writePin(SYNC_PORT_ID, SYNC_PIN_ID, LOGIC_LOW);
+		GPIO_setupPinDirection(SYNC_PORT_ID, SYNC_PIN_ID, PIN_OUTPUT);
+
+		if(g_frameTimer == TIMER_INVALID_ID){
+			g_frameTimer = Timer_create(Sync_pulseStart);
+			g_pulseTimer = Timer_create(Sync_pulseEnd);
+		}
+		Timer_start(g_frameTimer, TIMER_PERIODIC, (uint32)g_config.slots * g_config.slotTicks);
+	}
+	else{
+		GPIO_setupPinDirection(SYNC_PORT_ID, SYNC_PIN_ID, PIN_INPUT);
+	}
+}
+
+/*
+ * Description :
+ * Master: start the sync pulse of a frame
+ */
+static void Sync_pulseStart(void){
+	GPIO_writePin(SYNC_PORT_ID, SYNC_PIN_ID, LOGIC_HIGH);
+	Timer_start(g_pulseTimer, TIMER_ONE_SHOT, SYNC_PULSE_US);
+}
+
+/*
+ * Description :
+ * Master: end the sync pulse
+ */
+static void Sync_pulseEnd(void){
+	GPIO_writePin(SYNC_PORT_ID, SYNC_PIN_ID, LOGIC_LOW);
+}
+
+/*
+ * Description :
+ * Give the start of the first slot of this node at or after the earliest ICU time stamp
+ * and at least SYNC_MIN_LEAD_TICKS from now, return FALSE if the node is not synchronised (no sync edge in the last SYNC_LOST_FRAMES frames)
+ */
+boolean Sync_getNextSlot(uint32 earliest, uint32 * slot_ptr){
+	uint32 frame = (uint32)g_config.slots * g_config.slotTicks;
+	uint32 now = ICU_getTimestamp();
+	uint32 syncTime;
+	uint32 slotStart;
+	uint16 edgeCount;
+	uint8 sreg = SREG;
+
+	/* The time stamp is 32-bit, read it with the edge count in one go */
+	cli();
+	syncTime = g_syncTime;
+	edgeCount = g_edgeCount;
+	SREG = sreg;
+
+	if((edgeCount == 0) || ((now - syncTime) > (SYNC_LOST_FRAMES * frame))){
+		return FALSE;
+	}
+
+	/* A slot that is passed or too close can not be armed any more */
+	if((sint32)(now + SYNC_MIN_LEAD_TICKS - earliest) > 0){
+		earliest = now + SYNC_MIN_LEAD_TICKS;
+	}
+
+	/* Slot of the last frame then the number of whole frames to the earliest time */
+	slotStart = syncTime + (uint32)g_config.slot * g_config.slotTicks;
+	if((sint32)(earliest - slotStart) > 0){
+		slotStart += ((earliest - slotStart + frame - 1) / frame) * frame;
+	}
+	*slot_ptr = slotStart;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of sync edges received
+ */
+uint16 Sync_getEdgeCount(void){
+	uint16 edgeCount;
+	uint8 sreg = SREG;
+
+	/* 16-bit count updated by the INT0 interrupt, read both bytes in one go */
+	cli();
+	edgeCount = g_edgeCount;
+	SREG = sreg;
+
+	return edgeCount;
+}
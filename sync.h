@@ -0,0 +1,83 @@
+ /******************************************************************************
+ *
+ * Module: SYNC
+ *
+ * File Name: sync.h
+ *
+ * Description: Header file for the ping slots synchronised on a shared sync line
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include "std_types.h"
+#include "gpio.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Sync line: INT0 pin of every node, the master drives it (INT0 fires on an output pin too) */
+#define SYNC_PORT_ID				PORTD_ID
+#define SYNC_PIN_ID					PIN2_ID
+
+/* Width of the sync pulse sent by the master in micro seconds */
+#define SYNC_PULSE_US				20
+
+/* Shortest time from Sync_getNextSlot to the slot it gives (ICU ticks), to arm the trigger */
+#define SYNC_MIN_LEAD_TICKS			100
+
+/* The node is not synchronised any more after this many frames without a sync edge */
+#define SYNC_LOST_FRAMES			3
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+typedef enum{
+	SYNC_ROLE_SLAVE, SYNC_ROLE_MASTER
+}Sync_RoleType;
+
+/*
+ * Structure that contain members to set the configurations of the synchronisation:
+ * a frame starts at every rising edge of the sync line and holds slots slots of
+ * slotTicks ICU ticks, the node pings at the start of its slot only. A slot must be
+ * longer than the echoes of a ping take to die out.
+ */
+typedef struct{
+	Sync_RoleType role;		/* The master sends a sync pulse every frame */
+	uint8 slot;				/* Slot of this node, 0 to slots - 1 */
+	uint8 slots;			/* Slots per frame (number of nodes) */
+	uint16 slotTicks;		/* Slot length in ICU ticks = micro seconds */
+}Sync_ConfigType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the synchronisation:
+ * 1. Time stamp the rising edges of the sync line on the ICU time base (INT0 interrupt)
+ * 2. For the master: drive the sync line and send a pulse every frame
+ * The ICU and the timer service must be initialized (Ultrasonic_init).
+ */
+void Sync_init(const Sync_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Give the start of the first slot of this node at or after the earliest ICU time stamp
+ * and at least SYNC_MIN_LEAD_TICKS from now, return FALSE if the node is not synchronised (no sync edge in the last SYNC_LOST_FRAMES frames)
+ */
+boolean Sync_getNextSlot(uint32 earliest, uint32 * slot_ptr);
+
+/*
+ * Description :
+ * Return the number of sync edges received
+ */
+uint16 Sync_getEdgeCount(void);
+
+#endif /* SYNC_H_ */
@@ -0,0 +1,95 @@
+ /******************************************************************************
+ *
+ * Module: TELEMETRY
+ *
+ * File Name: telemetry.c
+ *
+ * Description: Source file for the binary measurement stream over UART
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "telemetry.h"
+#include "uart.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Sequence number of the next frame */
+static uint8 g_sequence = 0;
+
+/* Number of frames dropped because the UART buffer was full */
+static uint16 g_droppedFrames = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the UART driver for the telemetry stream (8N1, TELEMETRY_BAUD_RATE)
+ */
+void Telemetry_init(void){
+
+	/* Configure UART settings */
+	Uart_ConfigType config = {UART_8_BIT,UART_PARITY_DISABLED,UART_ONE_STOP_BIT,TELEMETRY_BAUD_RATE};
+
+	/* Initiate UART */
+	UART_init(&config);
+}
+
+/*
+ * Description :
+ * Queue one frame for a measurement result without waiting,
+ * if the UART buffer is full the frame is dropped and counted, return FALSE in that case
+ */
+boolean Telemetry_sendResult(const Ultrasonic_ResultType * result_ptr){
+
+	uint8 frame[TELEMETRY_FRAME_SIZE];
+	uint8 sum1 = 0;
+	uint8 sum2 = 0;
+	uint8 i;
+
+	frame[0] = TELEMETRY_SYNC1;
+	frame[1] = TELEMETRY_SYNC2;
+	frame[TELEMETRY_SEQUENCE_OFFSET] = g_sequence++;
+	frame[TELEMETRY_TIMESTAMP_OFFSET] = (uint8)(result_ptr->timestamp);
+	frame[TELEMETRY_TIMESTAMP_OFFSET + 1] = (uint8)(result_ptr->timestamp>>8);
+	frame[TELEMETRY_TIMESTAMP_OFFSET + 2] = (uint8)(result_ptr->timestamp>>16);
+	frame[TELEMETRY_TIMESTAMP_OFFSET + 3] = (uint8)(result_ptr->timestamp>>24);
+	frame[TELEMETRY_DISTANCE_OFFSET] = (uint8)(result_ptr->distance);
+	frame[TELEMETRY_DISTANCE_OFFSET + 1] = (uint8)(result_ptr->distance>>8);
+	frame[TELEMETRY_LATENCY_OFFSET] = (uint8)(result_ptr->latency);
+	frame[TELEMETRY_LATENCY_OFFSET + 1] = (uint8)(result_ptr->latency>>8);
+	frame[TELEMETRY_STATUS_OFFSET] = (uint8)(result_ptr->status);
+
+	/* Fletcher-16 checksum of the payload (modulo 255) */
+	for(i = TELEMETRY_SEQUENCE_OFFSET; i < TELEMETRY_CHECKSUM_OFFSET; i++){
+		sum1 = (uint8)(((uint16)sum1 + frame[i]) % 255);
+		sum2 = (uint8)(((uint16)sum2 + sum1) % 255);
+	}
+	frame[TELEMETRY_CHECKSUM_OFFSET] = sum1;
+	frame[TELEMETRY_CHECKSUM_OFFSET + 1] = sum2;
+
+	/* Never wait for the UART, the sequence gap tells the host that a frame is missing */
+	if(UART_sendBlock(frame, TELEMETRY_FRAME_SIZE) == FALSE){
+
+		if(g_droppedFrames != 0xFFFF){
+			g_droppedFrames++;
+		}
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of frames dropped because the UART buffer was full
+ */
+uint16 Telemetry_getDroppedFrames(void){
+	return g_droppedFrames;
+}
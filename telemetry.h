@@ -0,0 +1,70 @@
+ /******************************************************************************
+ *
+ * Module: TELEMETRY
+ *
+ * File Name: telemetry.h
+ *
+ * Description: Header file for the binary measurement stream over UART
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "std_types.h"
+#include "ultrasonic.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* UART baud rate of the stream (0.2% error at 8 MHz in double speed mode) */
+#define TELEMETRY_BAUD_RATE				38400
+
+/*
+ * Frame layout, all multi-byte fields are little endian:
+ * offset 0  : TELEMETRY_SYNC1
+ * offset 1  : TELEMETRY_SYNC2
+ * offset 2  : sequence number, incremented for every frame even the dropped ones
+ * offset 3  : time stamp, 4 bytes (ICU ticks = micro seconds)
+ * offset 7  : distance in cm, 2 bytes
+ * offset 9  : trigger to result latency, 2 bytes (ICU ticks)
+ * offset 11 : status (Ultrasonic_StatusType)
+ * offset 12 : Fletcher-16 checksum of offsets 2..11, 2 bytes (sum1 first then sum2)
+ */
+#define TELEMETRY_SYNC1					0xA5
+#define TELEMETRY_SYNC2					0x5A
+#define TELEMETRY_FRAME_SIZE			14
+#define TELEMETRY_SEQUENCE_OFFSET		2
+#define TELEMETRY_TIMESTAMP_OFFSET		3
+#define TELEMETRY_DISTANCE_OFFSET		7
+#define TELEMETRY_LATENCY_OFFSET		9
+#define TELEMETRY_STATUS_OFFSET			11
+#define TELEMETRY_CHECKSUM_OFFSET		12
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the UART driver for the telemetry stream (8N1, TELEMETRY_BAUD_RATE)
+ */
+void Telemetry_init(void);
+
+/*
+ * Description :
+ * Queue one frame for a measurement result without waiting,
+ * if the UART buffer is full the frame is dropped and counted, return FALSE in that case
+ */
+boolean Telemetry_sendResult(const Ultrasonic_ResultType * result_ptr);
+
+/*
+ * Description :
+ * Return the number of frames dropped because the UART buffer was full
+ */
+uint16 Telemetry_getDroppedFrames(void);
+
+#endif /* TELEMETRY_H_ */
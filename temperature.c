@@ -0,0 +1,135 @@
+ /******************************************************************************
+ *
+ * Module: TEMPERATURE
+ *
+ * File Name: temperature.c
+ *
+ * Description: Source file of the air temperature input (LM35) that compensates
+ *              the speed of sound of the ultrasonic driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "temperature.h"
+#include "ultrasonic.h"
+#include "lcd.h"
+#include <avr/pgmspace.h>
+
+#if((LCD_TRANSPORT == LCD_TRANSPORT_PARALLEL) && (LCD_BIT_MODE == 8))
+
+#error "ADC7 (PA7) is D7 of the 8-bit LCD bus, use the 4-bit bus or a serial LCD transport"
+
+#endif
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/*
+ * Speed multiplier of every degree from 0 C: cm per ICU tick with ULTRASONIC_CALIBRATION_SHIFT
+ * fraction bits, round(c * 2^16 / 2000000) with c = 33145 * sqrt(1 + T / 273.15) cm/s
+ */
+static const uint16 g_speedTable[TEMPERATURE_TABLE_SIZE] PROGMEM = {
+	1086, 1088, 1090, 1092, 1094, 1096, 1098, 1100,	/*  0.. 7 C */
+	1102, 1104, 1106, 1108, 1110, 1112, 1114, 1116,	/*  8..15 C */
+	1117, 1119, 1121, 1123, 1125, 1127, 1129, 1131,	/* 16..23 C */
+	1133, 1135, 1137, 1139, 1140, 1142, 1144, 1146,	/* 24..31 C */
+	1148, 1150, 1152, 1154, 1155, 1157, 1159, 1161,	/* 32..39 C */
+	1163, 1165, 1167, 1168, 1170, 1172, 1174, 1176,	/* 40..47 C */
+	1178, 1179, 1181, 1183, 1185, 1187, 1189, 1190,	/* 48..55 C */
+	1192, 1194, 1196, 1198, 1199, 1201, 1203, 1205	/* 56..63 C */
+};
+
+/* Last conversion, set by the ADC interrupt and taken by Temperature_update */
+static volatile uint16 g_reading = 0;
+static volatile boolean g_readingReady = FALSE;
+
+/* Degree of the speed multiplier in use */
+static uint8 g_degrees = TEMPERATURE_NO_READING;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Call back of the ADC interrupt, keep the conversion for Temperature_update
+ */
+static void Temperature_conversionDone(uint16 value);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the ADC for the LM35 and start the first conversion,
+ * the global interrupts must be enabled
+ */
+void Temperature_init(void){
+	Adc_ConfigType config = {TEMPERATURE_ADC_REFERENCE, TEMPERATURE_ADC_PRESCALER};
+
+	ADC_setCallBack(Temperature_conversionDone);
+	ADC_init(&config);
+
+	g_readingReady = FALSE;
+	g_degrees = TEMPERATURE_NO_READING;
+	ADC_startConversion(TEMPERATURE_ADC_CHANNEL);
+}
+
+/*
+ * Description :
+ * Called at the sampling rate (about once a second is enough): give the speed multiplier of the
+ * last reading to the ultrasonic driver if its degree changed (one table lookup) and start the
+ * next conversion, return TRUE if the speed multiplier changed
+ */
+boolean Temperature_update(void){
+	uint16 reading;
+	uint16 center;
+	uint16 degrees;
+	boolean changed = FALSE;
+
+	/* The next conversion is started below, the interrupt does not write the reading meanwhile */
+	if(g_readingReady == TRUE){
+		reading = g_reading;
+		g_readingReady = FALSE;
+		center = (uint16)g_degrees * TEMPERATURE_STEPS_PER_DEGREE;
+
+		/* Hysteresis around the degree in use, a reading on the edge of two degrees does not toggle */
+		if((g_degrees == TEMPERATURE_NO_READING) || (reading + TEMPERATURE_HYSTERESIS_STEPS < center) ||
+				(reading > center + TEMPERATURE_HYSTERESIS_STEPS)){
+			degrees = (reading + TEMPERATURE_STEPS_PER_DEGREE / 2) / TEMPERATURE_STEPS_PER_DEGREE;
+			if(degrees >= TEMPERATURE_TABLE_SIZE){
+				degrees = TEMPERATURE_TABLE_SIZE - 1;
+			}
+
+			if(degrees != g_degrees){
+				g_degrees = (uint8)degrees;
+				Ultrasonic_setSpeedMultiplier(pgm_read_word(&g_speedTable[degrees]));
+				changed = TRUE;
+			}
+		}
+	}
+
+	ADC_startConversion(TEMPERATURE_ADC_CHANNEL);
+
+	return changed;
+}
+
+/*
+ * Description :
+ * Return the degree of the speed multiplier in use or TEMPERATURE_NO_READING
+ */
+uint8 Temperature_getDegrees(void){
+	return g_degrees;
+}
+
+/*
+ * Description :
+ * Call back of the ADC interrupt, keep the conversion for Temperature_update
+ */
+static void Temperature_conversionDone(uint16 value){
+	g_reading = value;
+	g_readingReady = TRUE;
+}
@@ -0,0 +1,69 @@
+ /******************************************************************************
+ *
+ * Module: TEMPERATURE
+ *
+ * File Name: temperature.h
+ *
+ * Description: Header file of the air temperature input (LM35) that compensates
+ *              the speed of sound of the ultrasonic driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef TEMPERATURE_H_
+#define TEMPERATURE_H_
+
+#include "std_types.h"
+#include "adc.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * LM35 (10 mV per degree from 0 C) on ADC7 (PA7), against the 2.56 V internal reference:
+ * 2.5 mV per step, 4 steps per degree. PA7 is D7 of the LCD bus in the 8-bit parallel mode.
+ */
+#define TEMPERATURE_ADC_CHANNEL			7
+#define TEMPERATURE_ADC_REFERENCE		ADC_REFERENCE_INTERNAL_2V56
+#define TEMPERATURE_STEPS_PER_DEGREE	4
+
+/* ADC clock F_CPU/64 (125 kHz at 8 MHz) */
+#define TEMPERATURE_ADC_PRESCALER		ADC_F_CPU_64
+
+/* A new degree is used when the reading is this many steps away from the degree in use */
+#define TEMPERATURE_HYSTERESIS_STEPS	3
+
+/* Degrees of the speed table (0 C to 63 C), the readings out of it are clamped */
+#define TEMPERATURE_TABLE_SIZE			64
+
+/* Returned by Temperature_getDegrees before the first reading */
+#define TEMPERATURE_NO_READING			0xFF
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the ADC for the LM35 and start the first conversion,
+ * the global interrupts must be enabled
+ */
+void Temperature_init(void);
+
+/*
+ * Description :
+ * Called at the sampling rate (about once a second is enough): give the speed multiplier of the
+ * last reading to the ultrasonic driver if its degree changed (one table lookup) and start the
+ * next conversion, return TRUE if the speed multiplier changed
+ */
+boolean Temperature_update(void);
+
+/*
+ * Description :
+ * Return the degree of the speed multiplier in use or TEMPERATURE_NO_READING
+ */
+uint8 Temperature_getDegrees(void);
+
+#endif /* TEMPERATURE_H_ */
@@ -0,0 +1,248 @@
+ /******************************************************************************
+ *
+ * Module: TIMER
+ *
+ * File Name: timer.c
+ *
+ * Description: Source file for the software timer service (Timer2)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "timer.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                            Private Types                                    *
+ *******************************************************************************/
+
+/* Structure that holds a software timer */
+typedef struct{
+	void(*callback)(void);
+	uint32 expiry;			/* Time of the next expiry in micro seconds */
+	uint32 period;			/* Period in micro seconds, 0 for a one shot timer */
+	boolean running;
+}Timer_Type;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static volatile Timer_Type g_timers[TIMER_MAX_TIMERS];
+static uint8 g_numOfTimers = 0;
+
+/* Number of Timer2 overflows since Timer_init (upper bits of the time stamp) */
+static volatile uint32 g_overflows = 0;
+
+/* Flag to indicate that Timer_process is running (a call back starts a timer) */
+static boolean g_processing = FALSE;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Run the expired timers and program the compare match for the next expiry
+ * if it comes before the next overflow (called with the interrupts disabled)
+ */
+static void Timer_process(void);
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(TIMER2_OVF_vect){
+	g_overflows++;
+	Timer_process();
+}
+
+ISR(TIMER2_COMP_vect){
+	Timer_process();
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the timer service:
+ * 1. Run Timer2 in normal mode at F_CPU/8
+ * 2. Enable the Timer2 overflow interrupt (extends the time stamp)
+ * It keeps the created timers so every driver that uses timers can call it.
+ */
+void Timer_init(void){
+
+	/* Already running */
+	if(TCCR2 != 0){
+		return;
+	}
+
+	/*
+	 * Configure Timer/Counter2 Control Register:
+	 * 1. Set Bit 7(FOC2) because the timer is not used as PWM
+	 * 2. WGM21:0 = 00 for normal mode, the compare match is only used as an interrupt
+	 * 3. COM21:0 = 00, OC2 disconnected
+	 * 4. CS22:0 = 010 for F_CPU/8
+	 */
+	g_overflows = 0;
+	TCNT2 = 0;
+	TCCR2 = (1<<FOC2) | (1<<CS21);
+
+	/* Enable Timer/Counter2 Overflow Interrupt */
+	TIMSK |= (1<<TOIE2);
+}
+
+/*
+ * Description :
+ * Create a stopped timer that calls the function when it expires (from the Timer2
+ * interrupt, keep it short), return its id or TIMER_INVALID_ID if all the timers are used
+ */
+uint8 Timer_create(void(*a_callbackPtr)(void)){
+	uint8 timer_id = g_numOfTimers;
+
+	if(timer_id >= TIMER_MAX_TIMERS){
+		return TIMER_INVALID_ID;
+	}
+
+	g_timers[timer_id].callback = a_callbackPtr;
+	g_timers[timer_id].running = FALSE;
+	g_numOfTimers++;
+
+	return timer_id;
+}
+
+/*
+ * Description :
+ * Start (or restart) a timer, it expires after time_us micro seconds
+ * and again every time_us for the periodic mode
+ */
+void Timer_start(uint8 timer_id, Timer_ModeType mode, uint32 time_us){
+	uint8 sreg;
+
+	if(timer_id >= g_numOfTimers){
+		return;
+	}
+
+	sreg = SREG;
+	cli();
+	g_timers[timer_id].expiry = Timer_getMicros() + time_us;
+	g_timers[timer_id].period = (mode == TIMER_PERIODIC) ? time_us : 0;
+	g_timers[timer_id].running = TRUE;
+
+	/* The new expiry can be the next one, a running Timer_process checks it itself */
+	if(g_processing == FALSE){
+		Timer_process();
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Stop a timer, its function is not called any more
+ */
+void Timer_stop(uint8 timer_id){
+	if(timer_id < g_numOfTimers){
+		g_timers[timer_id].running = FALSE;
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE if the timer is started and did not expire yet (or is periodic)
+ */
+boolean Timer_isRunning(uint8 timer_id){
+	return (timer_id < g_numOfTimers) ? g_timers[timer_id].running : FALSE;
+}
+
+/*
+ * Description :
+ * Return the time since Timer_init in micro seconds
+ */
+uint32 Timer_getMicros(void){
+	uint32 overflows;
+	uint8 count;
+	uint8 sreg = SREG;
+
+	/* Read TCNT2 and the overflow count together */
+	cli();
+	count = TCNT2;
+	overflows = g_overflows;
+
+	/* Overflow not served yet: the count already restarted from 0 */
+	if((TIFR & (1<<TOV2)) && (count < 128)){
+		overflows++;
+	}
+	SREG = sreg;
+
+	return ((overflows << 8) | count) * TIMER_US_PER_COUNT;
+}
+
+/*
+ * Description :
+ * Run the expired timers and program the compare match for the next expiry
+ * if it comes before the next overflow (called with the interrupts disabled)
+ */
+static void Timer_process(void){
+	uint32 now;
+	uint32 remaining;
+	uint32 nextRemaining;
+	uint32 nextExpiry = 0;
+	boolean expired;
+	uint8 i;
+
+	g_processing = TRUE;
+
+	do{
+		do{
+			expired = FALSE;
+			nextRemaining = 0xFFFFFFFF;
+			now = Timer_getMicros();
+
+			for(i = 0; i < g_numOfTimers; i++){
+				if(g_timers[i].running == FALSE){
+					continue;
+				}
+
+				/* Signed difference handles the wrap of the time stamp */
+				if((sint32)(g_timers[i].expiry - now) <= 0){
+					if(g_timers[i].period != 0){
+						g_timers[i].expiry += g_timers[i].period;
+					}
+					else{
+						g_timers[i].running = FALSE;
+					}
+
+					/* The call back can start or stop timers, check all of them again after it */
+					(*g_timers[i].callback)();
+					expired = TRUE;
+					break;
+				}
+
+				remaining = g_timers[i].expiry - now;
+				if(remaining < nextRemaining){
+					nextRemaining = remaining;
+					nextExpiry = g_timers[i].expiry;
+				}
+			}
+		}while(expired == TRUE);
+
+		/* The overflow interrupt handles the expiries after the next overflow */
+		if((nextRemaining / TIMER_US_PER_COUNT) >= (256UL - ((now / TIMER_US_PER_COUNT) & 0xFF))){
+			TIMSK &= ~(1<<OCIE2);
+			break;
+		}
+
+		/* The compare value is the low byte of the expiry in counts */
+		OCR2 = (uint8)((nextExpiry + TIMER_US_PER_COUNT - 1) / TIMER_US_PER_COUNT);
+		TIFR = (1<<OCF2);
+		TIMSK |= (1<<OCIE2);
+
+		/* The counter can pass the compare value while it is programmed, run the timer now then */
+	}while((sint32)(nextExpiry - Timer_getMicros()) <= 0);
+
+	g_processing = FALSE;
+}
@@ -0,0 +1,93 @@
+ /******************************************************************************
+ *
+ * Module: TIMER
+ *
+ * File Name: timer.h
+ *
+ * Description: Header file for the software timer service (Timer2)
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Maximum number of software timers */
+#define TIMER_MAX_TIMERS			4
+
+/* Returned by Timer_create when all the timers are used */
+#define TIMER_INVALID_ID			0xFF
+
+/* Timer2 runs freely at F_CPU/8, the overflow interrupt extends it to 32 bits */
+#define TIMER_PRESCALER				8UL
+
+/* Micro seconds per Timer2 count */
+#define TIMER_US_PER_COUNT			((uint16)((TIMER_PRESCALER * 1000000UL) / F_CPU))
+
+#if((TIMER_PRESCALER * 1000000UL) < F_CPU)
+
+#error "Timer2 prescaler is too small for F_CPU"
+
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+typedef enum{
+	TIMER_ONE_SHOT, TIMER_PERIODIC
+}Timer_ModeType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the timer service:
+ * 1. Run Timer2 in normal mode at F_CPU/8
+ * 2. Enable the Timer2 overflow interrupt (extends the time stamp)
+ * It keeps the created timers so every driver that uses timers can call it.
+ */
+void Timer_init(void);
+
+/*
+ * Description :
+ * Create a stopped timer that calls the function when it expires (from the Timer2
+ * interrupt, keep it short), return its id or TIMER_INVALID_ID if all the timers are used
+ */
+uint8 Timer_create(void(*a_callbackPtr)(void));
+
+/*
+ * Description :
+ * Start (or restart) a timer, it expires after time_us micro seconds
+ * and again every time_us for the periodic mode
+ */
+void Timer_start(uint8 timer_id, Timer_ModeType mode, uint32 time_us);
+
+/*
+ * Description :
+ * Stop a timer, its function is not called any more
+ */
+void Timer_stop(uint8 timer_id);
+
+/*
+ * Description :
+ * Return TRUE if the timer is started and did not expire yet (or is periodic)
+ */
+boolean Timer_isRunning(uint8 timer_id);
+
+/*
+ * Description :
+ * Return the time since Timer_init in micro seconds
+ */
+uint32 Timer_getMicros(void);
+
+#endif /* TIMER_H_ */
@@ -0,0 +1,596 @@
+ /******************************************************************************
+ *
+ * Module: TELEMETRY DECODER (host tool)
+ *
+ * File Name: telemetry_decoder.c
+ *
+ * Description: Decode the binary telemetry stream (see telemetry.h) from a serial port,
+ *              a recorded capture file or stdin and report its statistics
+ *
+ * Build (Linux): gcc -O2 -o telemetry_decoder tools/telemetry_decoder.c -lm
+ *
+ * Usage: telemetry_decoder [-b baud] [-w window] [-c out.csv] [-r report.txt] [input]
+ *        input is a capture file, a serial device or '-' (default) for stdin
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <termios.h>
+
+#include "../telemetry.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Size of one read from the input */
+#define DECODER_READ_SIZE			65536
+
+/* Largest sliding window of distance statistics (in samples) */
+#define DECODER_MAX_WINDOW			4096
+
+/* Default sliding window of distance statistics (in samples) */
+#define DECODER_DEFAULT_WINDOW		32
+
+/* Histograms are exact for values up to this (micro seconds), longer values go to the last bin */
+#define DECODER_HISTOGRAM_SIZE		65536
+
+/* Number of status codes reported by name, other codes are reported as unknown */
+#define DECODER_NUM_OF_STATUS		3
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that holds one decoded frame */
+typedef struct{
+	uint8_t sequence;
+	uint32_t timestamp;
+	uint16_t distance;
+	uint16_t latency;
+	uint8_t status;
+}Decoder_FrameType;
+
+/* Structure that holds a running mean/variance (Welford) with min and max */
+typedef struct{
+	uint64_t count;
+	double mean;
+	double m2;
+	double min;
+	double max;
+}Decoder_RunningType;
+
+/* Structure that holds the sliding window of distances */
+typedef struct{
+	uint16_t values[DECODER_MAX_WINDOW];	/* Ring of the last samples */
+	uint32_t size;							/* Window length */
+	uint32_t count;							/* Samples in the window (up to size) */
+	uint64_t index;							/* Index of the next sample (total samples pushed) */
+	uint64_t sum;
+	uint64_t sumSquares;
+	uint64_t minQueue[DECODER_MAX_WINDOW];	/* Monotonic queues of sample indexes for min/max */
+	uint64_t maxQueue[DECODER_MAX_WINDOW];
+	uint32_t minHead, minCount;
+	uint32_t maxHead, maxCount;
+}Decoder_WindowType;
+
+/* Structure that holds all the statistics of the stream */
+typedef struct{
+	uint64_t bytes;
+	uint64_t frames;
+	uint64_t checksumErrors;
+	uint64_t skippedBytes;
+	uint64_t dropouts;				/* Frames missing according to the sequence numbers */
+	uint64_t statusCount[DECODER_NUM_OF_STATUS + 1];
+	uint64_t firstTimestamp;
+	uint64_t lastTimestamp;			/* Time stamps unwrapped to 64 bits */
+	uint8_t lastSequence;
+	Decoder_RunningType interval;	/* Time between consecutive frames */
+	Decoder_RunningType latency;
+	Decoder_RunningType distance;	/* Distances of the OK samples */
+	uint64_t latencyHistogram[DECODER_HISTOGRAM_SIZE];
+	uint64_t intervalHistogram[DECODER_HISTOGRAM_SIZE];
+}Decoder_StatsType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Large tables are static so the decoder never allocates */
+static Decoder_StatsType g_stats;
+static Decoder_WindowType g_window;
+static uint8_t g_readBuffer[DECODER_READ_SIZE];
+
+/* Names of the status codes (Ultrasonic_StatusType) */
+static const char * const g_statusNames[DECODER_NUM_OF_STATUS + 1] = {
+	"ok", "no_echo", "timeout", "unknown"
+};
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add one value to a running statistic
+ */
+static void Decoder_runningAdd(Decoder_RunningType * running_ptr, double value){
+	double delta;
+
+	if((running_ptr->count == 0) || (value < running_ptr->min)){
+		running_ptr->min = value;
+	}
+	if((running_ptr->count == 0) || (value > running_ptr->max)){
+		running_ptr->max = value;
+	}
+
+	running_ptr->count++;
+	delta = value - running_ptr->mean;
+	running_ptr->mean += delta / (double)running_ptr->count;
+	running_ptr->m2 += delta * (value - running_ptr->mean);
+}
+
+/*
+ * Description :
+ * Return the standard deviation of a running statistic
+ */
+static double Decoder_runningStdDev(const Decoder_RunningType * running_ptr){
+	if(running_ptr->count < 2){
+		return 0.0;
+	}
+	return sqrt(running_ptr->m2 / (double)(running_ptr->count - 1));
+}
+
+/*
+ * Description :
+ * Return the value below which the given fraction of a histogram lies
+ */
+static uint32_t Decoder_percentile(const uint64_t * histogram_ptr, uint64_t total, double fraction){
+	uint64_t target = (uint64_t)ceil(fraction * (double)total);
+	uint64_t accumulated = 0;
+	uint32_t i;
+
+	if(target == 0){
+		target = 1;
+	}
+
+	for(i = 0; i < DECODER_HISTOGRAM_SIZE; i++){
+		accumulated += histogram_ptr[i];
+		if(accumulated >= target){
+			return i;
+		}
+	}
+
+	return DECODER_HISTOGRAM_SIZE - 1;
+}
+
+/*
+ * Description :
+ * Push one distance into the sliding window, the min/max are kept in monotonic queues
+ * so every push costs O(1) amortized whatever the window length is
+ */
+static void Decoder_windowPush(Decoder_WindowType * window_ptr, uint16_t value){
+	uint32_t slot = (uint32_t)(window_ptr->index % window_ptr->size);
+	uint64_t oldest;
+
+	/* Remove the sample leaving the window */
+	if(window_ptr->count == window_ptr->size){
+		window_ptr->sum -= window_ptr->values[slot];
+		window_ptr->sumSquares -= (uint64_t)window_ptr->values[slot] * window_ptr->values[slot];
+	}
+	else{
+		window_ptr->count++;
+	}
+
+	window_ptr->values[slot] = value;
+	window_ptr->sum += value;
+	window_ptr->sumSquares += (uint64_t)value * value;
+
+	/* Drop the queue entries that left the window */
+	oldest = (window_ptr->index + 1 > window_ptr->size) ? (window_ptr->index + 1 - window_ptr->size) : 0;
+	if((window_ptr->minCount > 0) && (window_ptr->minQueue[window_ptr->minHead] < oldest)){
+		window_ptr->minHead = (window_ptr->minHead + 1) % window_ptr->size;
+		window_ptr->minCount--;
+	}
+	if((window_ptr->maxCount > 0) && (window_ptr->maxQueue[window_ptr->maxHead] < oldest)){
+		window_ptr->maxHead = (window_ptr->maxHead + 1) % window_ptr->size;
+		window_ptr->maxCount--;
+	}
+
+	/* Drop the entries that can no longer be the minimum/maximum then append the new sample */
+	while(window_ptr->minCount > 0){
+		uint32_t last = (window_ptr->minHead + window_ptr->minCount - 1) % window_ptr->size;
+		if(window_ptr->values[window_ptr->minQueue[last] % window_ptr->size] < value){
+			break;
+		}
+		window_ptr->minCount--;
+	}
+	window_ptr->minQueue[(window_ptr->minHead + window_ptr->minCount) % window_ptr->size] = window_ptr->index;
+	window_ptr->minCount++;
+
+	while(window_ptr->maxCount > 0){
+		uint32_t last = (window_ptr->maxHead + window_ptr->maxCount - 1) % window_ptr->size;
+		if(window_ptr->values[window_ptr->maxQueue[last] % window_ptr->size] > value){
+			break;
+		}
+		window_ptr->maxCount--;
+	}
+	window_ptr->maxQueue[(window_ptr->maxHead + window_ptr->maxCount) % window_ptr->size] = window_ptr->index;
+	window_ptr->maxCount++;
+
+	window_ptr->index++;
+}
+
+/*
+ * Description :
+ * Return the minimum/maximum/mean/standard deviation of the sliding window
+ */
+static void Decoder_windowStats(const Decoder_WindowType * window_ptr, uint16_t * min_ptr, uint16_t * max_ptr,
+		double * mean_ptr, double * stdDev_ptr){
+	double mean = (double)window_ptr->sum / (double)window_ptr->count;
+	double variance = ((double)window_ptr->sumSquares / (double)window_ptr->count) - (mean * mean);
+
+	*min_ptr = window_ptr->values[window_ptr->minQueue[window_ptr->minHead] % window_ptr->size];
+	*max_ptr = window_ptr->values[window_ptr->maxQueue[window_ptr->maxHead] % window_ptr->size];
+	*mean_ptr = mean;
+	*stdDev_ptr = (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+/*
+ * Description :
+ * Check the Fletcher-16 checksum of a complete frame
+ */
+static int Decoder_checksumValid(const uint8_t * frame_ptr){
+	uint32_t sum1 = 0;
+	uint32_t sum2 = 0;
+	uint32_t i;
+
+	for(i = TELEMETRY_SEQUENCE_OFFSET; i < TELEMETRY_CHECKSUM_OFFSET; i++){
+		sum1 = (sum1 + frame_ptr[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+
+	return (frame_ptr[TELEMETRY_CHECKSUM_OFFSET] == sum1) && (frame_ptr[TELEMETRY_CHECKSUM_OFFSET + 1] == sum2);
+}
+
+/*
+ * Description :
+ * Update the statistics with one valid frame and write its CSV line
+ */
+static void Decoder_processFrame(const Decoder_FrameType * frame_ptr, FILE * csv_ptr){
+	uint64_t timestamp;
+	uint8_t statusIndex = (frame_ptr->status < DECODER_NUM_OF_STATUS) ? frame_ptr->status : DECODER_NUM_OF_STATUS;
+
+	if(g_stats.frames == 0){
+		timestamp = frame_ptr->timestamp;
+		g_stats.firstTimestamp = timestamp;
+	}
+	else{
+		uint64_t interval;
+
+		/* Unwrap the 32-bit time stamp (the difference is always valid modulo 2^32) */
+		interval = (uint32_t)(frame_ptr->timestamp - (uint32_t)g_stats.lastTimestamp);
+		timestamp = g_stats.lastTimestamp + interval;
+
+		Decoder_runningAdd(&g_stats.interval, (double)interval);
+		g_stats.intervalHistogram[(interval < DECODER_HISTOGRAM_SIZE) ? interval : (DECODER_HISTOGRAM_SIZE - 1)]++;
+
+		/* Every skipped sequence number is a frame dropped by the device or lost on the line */
+		g_stats.dropouts += (uint8_t)(frame_ptr->sequence - g_stats.lastSequence - 1);
+	}
+
+	g_stats.frames++;
+	g_stats.lastTimestamp = timestamp;
+	g_stats.lastSequence = frame_ptr->sequence;
+	g_stats.statusCount[statusIndex]++;
+
+	Decoder_runningAdd(&g_stats.latency, (double)frame_ptr->latency);
+	g_stats.latencyHistogram[frame_ptr->latency]++;
+
+	if(frame_ptr->status == 0){
+		Decoder_runningAdd(&g_stats.distance, (double)frame_ptr->distance);
+		Decoder_windowPush(&g_window, frame_ptr->distance);
+	}
+
+	if(csv_ptr != NULL){
+		fprintf(csv_ptr, "%u,%llu,%u,%u,%s", frame_ptr->sequence, (unsigned long long)timestamp,
+				frame_ptr->distance, frame_ptr->latency, g_statusNames[statusIndex]);
+
+		if(g_window.count > 0){
+			uint16_t min, max;
+			double mean, stdDev;
+
+			Decoder_windowStats(&g_window, &min, &max, &mean, &stdDev);
+			fprintf(csv_ptr, ",%u,%u,%.2f,%.2f\n", min, max, mean, stdDev);
+		}
+		else{
+			fputs(",,,,\n", csv_ptr);
+		}
+	}
+}
+
+/*
+ * Description :
+ * Streaming frame parser: feed any number of bytes, complete frames are processed at once.
+ * On a checksum error the search for the sync bytes restarts from the byte after the false sync.
+ */
+static void Decoder_parse(const uint8_t * data_ptr, size_t size, FILE * csv_ptr){
+	static uint8_t frame[TELEMETRY_FRAME_SIZE];
+	static uint32_t length = 0;
+	size_t i;
+
+	for(i = 0; i < size; i++){
+		uint8_t byte = data_ptr[i];
+
+		if((length == 0) && (byte != TELEMETRY_SYNC1)){
+
+			/* Not a frame start */
+			g_stats.skippedBytes++;
+			continue;
+		}
+
+		if((length == 1) && (byte != TELEMETRY_SYNC2)){
+
+			/* The first sync byte was not a frame start, this byte may be one */
+			g_stats.skippedBytes++;
+			if(byte != TELEMETRY_SYNC1){
+				g_stats.skippedBytes++;
+				length = 0;
+			}
+			continue;
+		}
+
+		frame[length++] = byte;
+
+		if(length == TELEMETRY_FRAME_SIZE){
+
+			if(Decoder_checksumValid(frame)){
+				Decoder_FrameType decoded;
+
+				decoded.sequence = frame[TELEMETRY_SEQUENCE_OFFSET];
+				decoded.timestamp = (uint32_t)frame[TELEMETRY_TIMESTAMP_OFFSET]
+						| ((uint32_t)frame[TELEMETRY_TIMESTAMP_OFFSET + 1]<<8)
+						| ((uint32_t)frame[TELEMETRY_TIMESTAMP_OFFSET + 2]<<16)
+						| ((uint32_t)frame[TELEMETRY_TIMESTAMP_OFFSET + 3]<<24);
+				decoded.distance = (uint16_t)(frame[TELEMETRY_DISTANCE_OFFSET] | (frame[TELEMETRY_DISTANCE_OFFSET + 1]<<8));
+				decoded.latency = (uint16_t)(frame[TELEMETRY_LATENCY_OFFSET] | (frame[TELEMETRY_LATENCY_OFFSET + 1]<<8));
+				decoded.status = frame[TELEMETRY_STATUS_OFFSET];
+
+				Decoder_processFrame(&decoded, csv_ptr);
+				length = 0;
+			}
+			else{
+				uint32_t start;
+
+				g_stats.checksumErrors++;
+
+				/* Look for the next sync byte inside the rejected frame and keep the bytes after it */
+				for(start = 1; start < TELEMETRY_FRAME_SIZE; start++){
+					if(frame[start] == TELEMETRY_SYNC1){
+						break;
+					}
+				}
+				g_stats.skippedBytes += start;
+				length = TELEMETRY_FRAME_SIZE - start;
+				memmove(frame, &frame[start], length);
+
+				/* The kept bytes may not be a frame start either, parse them again */
+				if(length > 0){
+					uint8_t rest[TELEMETRY_FRAME_SIZE];
+					uint32_t restLength = length;
+
+					memcpy(rest, frame, restLength);
+					length = 0;
+					Decoder_parse(rest, restLength, csv_ptr);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Description :
+ * Configure a serial device in raw mode at the given baud rate
+ */
+static int Decoder_setupSerial(int fd, long baudRate){
+	struct termios tty;
+	speed_t speed;
+
+	switch(baudRate){
+	case 9600:   speed = B9600;   break;
+	case 19200:  speed = B19200;  break;
+	case 38400:  speed = B38400;  break;
+	case 57600:  speed = B57600;  break;
+	case 115200: speed = B115200; break;
+	case 230400: speed = B230400; break;
+	default:
+		fprintf(stderr, "unsupported baud rate %ld\n", baudRate);
+		return -1;
+	}
+
+	if(tcgetattr(fd, &tty) != 0){
+		perror("tcgetattr");
+		return -1;
+	}
+
+	cfmakeraw(&tty);
+	cfsetispeed(&tty, speed);
+	cfsetospeed(&tty, speed);
+	tty.c_cflag |= (CLOCAL | CREAD);
+	tty.c_cc[VMIN] = 1;
+	tty.c_cc[VTIME] = 0;
+
+	if(tcsetattr(fd, TCSANOW, &tty) != 0){
+		perror("tcsetattr");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Description :
+ * Write the summary report
+ */
+static void Decoder_report(FILE * report_ptr){
+	uint64_t span = g_stats.lastTimestamp - g_stats.firstTimestamp;
+	uint64_t expected = g_stats.frames + g_stats.dropouts;
+	uint32_t i;
+
+	fprintf(report_ptr, "bytes               : %llu\n", (unsigned long long)g_stats.bytes);
+	fprintf(report_ptr, "frames              : %llu\n", (unsigned long long)g_stats.frames);
+	fprintf(report_ptr, "checksum errors     : %llu\n", (unsigned long long)g_stats.checksumErrors);
+	fprintf(report_ptr, "skipped bytes       : %llu\n", (unsigned long long)g_stats.skippedBytes);
+	fprintf(report_ptr, "dropouts            : %llu (%.3f %%)\n", (unsigned long long)g_stats.dropouts,
+			(expected > 0) ? (100.0 * (double)g_stats.dropouts / (double)expected) : 0.0);
+
+	for(i = 0; i <= DECODER_NUM_OF_STATUS; i++){
+		fprintf(report_ptr, "status %-12s : %llu\n", g_statusNames[i], (unsigned long long)g_stats.statusCount[i]);
+	}
+
+	if(g_stats.frames < 2){
+		return;
+	}
+
+	fprintf(report_ptr, "duration            : %.6f s\n", (double)span / 1e6);
+	fprintf(report_ptr, "sample rate         : %.3f Hz\n", (double)(g_stats.frames - 1) * 1e6 / (double)span);
+	fprintf(report_ptr, "interval us         : mean %.1f std(jitter) %.1f min %.0f max %.0f p50 %u p99 %u\n",
+			g_stats.interval.mean, Decoder_runningStdDev(&g_stats.interval), g_stats.interval.min, g_stats.interval.max,
+			Decoder_percentile(g_stats.intervalHistogram, g_stats.interval.count, 0.50),
+			Decoder_percentile(g_stats.intervalHistogram, g_stats.interval.count, 0.99));
+	fprintf(report_ptr, "latency us          : mean %.1f std %.1f min %.0f max %.0f p50 %u p90 %u p99 %u p99.9 %u\n",
+			g_stats.latency.mean, Decoder_runningStdDev(&g_stats.latency), g_stats.latency.min, g_stats.latency.max,
+			Decoder_percentile(g_stats.latencyHistogram, g_stats.latency.count, 0.50),
+			Decoder_percentile(g_stats.latencyHistogram, g_stats.latency.count, 0.90),
+			Decoder_percentile(g_stats.latencyHistogram, g_stats.latency.count, 0.99),
+			Decoder_percentile(g_stats.latencyHistogram, g_stats.latency.count, 0.999));
+
+	if(g_stats.distance.count > 0){
+		fprintf(report_ptr, "distance cm         : mean %.2f std %.2f min %.0f max %.0f\n",
+				g_stats.distance.mean, Decoder_runningStdDev(&g_stats.distance), g_stats.distance.min, g_stats.distance.max);
+	}
+
+	if(g_window.count > 0){
+		uint16_t min, max;
+		double mean, stdDev;
+
+		Decoder_windowStats(&g_window, &min, &max, &mean, &stdDev);
+		fprintf(report_ptr, "last %-5u samples   : mean %.2f std %.2f min %u max %u\n",
+				g_window.count, mean, stdDev, min, max);
+	}
+}
+
+int main(int argc, char * argv[]){
+
+	const char * inputPath = "-";
+	const char * csvPath = NULL;
+	const char * reportPath = NULL;
+	long baudRate = TELEMETRY_BAUD_RATE;
+	long windowSize = DECODER_DEFAULT_WINDOW;
+	FILE * csv_ptr = NULL;
+	FILE * report_ptr = stdout;
+	int fd = STDIN_FILENO;
+	int option;
+	ssize_t count;
+
+	while((option = getopt(argc, argv, "b:w:c:r:h")) != -1){
+		switch(option){
+		case 'b':
+			baudRate = strtol(optarg, NULL, 10);
+			break;
+		case 'w':
+			windowSize = strtol(optarg, NULL, 10);
+			break;
+		case 'c':
+			csvPath = optarg;
+			break;
+		case 'r':
+			reportPath = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-b baud] [-w window(1..%d)] [-c out.csv|-] [-r report.txt] [input|-]\n",
+					argv[0], DECODER_MAX_WINDOW);
+			return (option == 'h') ? 0 : 2;
+		}
+	}
+
+	if(optind < argc){
+		inputPath = argv[optind];
+	}
+
+	if((windowSize < 1) || (windowSize > DECODER_MAX_WINDOW)){
+		fprintf(stderr, "window must be 1..%d samples\n", DECODER_MAX_WINDOW);
+		return 2;
+	}
+	g_window.size = (uint32_t)windowSize;
+
+	if(strcmp(inputPath, "-") != 0){
+		fd = open(inputPath, O_RDONLY | O_NOCTTY);
+		if(fd < 0){
+			fprintf(stderr, "%s: %s\n", inputPath, strerror(errno));
+			return 1;
+		}
+
+		/* A terminal is a serial port: configure it, a regular file is a recorded capture */
+		if(isatty(fd) && (Decoder_setupSerial(fd, baudRate) != 0)){
+			return 1;
+		}
+	}
+
+	if(csvPath != NULL){
+		csv_ptr = (strcmp(csvPath, "-") == 0) ? stdout : fopen(csvPath, "w");
+		if(csv_ptr == NULL){
+			fprintf(stderr, "%s: %s\n", csvPath, strerror(errno));
+			return 1;
+		}
+		if(csv_ptr == stdout){
+			report_ptr = stderr;
+		}
+		fputs("sequence,timestamp_us,distance_cm,latency_us,status,window_min,window_max,window_mean,window_std\n", csv_ptr);
+	}
+
+	if(reportPath != NULL){
+		report_ptr = fopen(reportPath, "w");
+		if(report_ptr == NULL){
+			fprintf(stderr, "%s: %s\n", reportPath, strerror(errno));
+			return 1;
+		}
+	}
+
+	/* Read until the end of the capture (or until the serial port is closed) */
+	while((count = read(fd, g_readBuffer, sizeof(g_readBuffer))) != 0){
+		if(count < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			perror("read");
+			break;
+		}
+		g_stats.bytes += (uint64_t)count;
+		Decoder_parse(g_readBuffer, (size_t)count, csv_ptr);
+	}
+
+	if((csv_ptr != NULL) && (csv_ptr != stdout)){
+		fclose(csv_ptr);
+	}
+
+	Decoder_report(report_ptr);
+
+	if(report_ptr != stdout && report_ptr != stderr){
+		fclose(report_ptr);
+	}
+
+	return 0;
+}
@@ -0,0 +1,202 @@
+ /******************************************************************************
+ *
+ * Module: TRILATERATION
+ *
+ * File Name: trilateration.c
+ *
+ * Description: Source file for the position of the target from the distances of two sensors
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "trilateration.h"
+#include "perf.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+static const Trilateration_ConfigType * g_config_ptr = NULL_PTR;
+
+/* Last valid sample of every sensor not used in a pair yet */
+static Ultrasonic_SampleType g_samples[2];
+static boolean g_waiting[2] = {FALSE, FALSE};
+
+static Trilateration_StatsType g_stats = {0, 0, 0};
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+static uint16 Trilateration_sqrt(uint32 value);
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the pairing with the baseline and the skew (kept by pointer, it must stay valid),
+ * return FALSE if the baseline is 0 or above TRILATERATION_MAX_BASELINE
+ */
+boolean Trilateration_init(const Trilateration_ConfigType * config_ptr){
+	if((config_ptr->baseline == 0) || (config_ptr->baseline > TRILATERATION_MAX_BASELINE)){
+		return FALSE;
+	}
+
+	g_config_ptr = config_ptr;
+	g_waiting[0] = FALSE;
+	g_waiting[1] = FALSE;
+	g_stats = (Trilateration_StatsType){0, 0, 0};
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Feed an echo sample of either sensor, it is paired with the last valid sample of the
+ * other sensor if that one is at most maxSkew older. Each sample is used in one pair only,
+ * a no echo sample drops the waiting sample of its sensor.
+ * Return TRUE with the position when a pair was solved.
+ */
+boolean Trilateration_addSample(const Ultrasonic_SampleType * sample_ptr, Trilateration_PositionType * position_ptr){
+	uint8 sensor = sample_ptr->sensor;
+	uint8 other = sensor ^ 1;
+	uint16 distance0;
+	uint16 distance1;
+	Trilateration_StatusType status;
+
+	if((g_config_ptr == NULL_PTR) || (sensor > 1)){
+		return FALSE;
+	}
+
+	/* A sample of the same sensor replaces the waiting one */
+	if(g_waiting[sensor] == TRUE){
+		g_stats.unpaired++;
+	}
+	g_waiting[sensor] = FALSE;
+
+	if(sample_ptr->status != ULTRASONIC_STATUS_OK){
+		return FALSE;
+	}
+
+	g_samples[sensor] = *sample_ptr;
+	g_waiting[sensor] = TRUE;
+
+	if(g_waiting[other] == FALSE){
+		return FALSE;
+	}
+
+	if((sample_ptr->timestamp - g_samples[other].timestamp) > g_config_ptr->maxSkew){
+
+		/* The target may have moved since the other echo */
+		g_waiting[other] = FALSE;
+		g_stats.unpaired++;
+		return FALSE;
+	}
+
+	g_waiting[0] = FALSE;
+	g_waiting[1] = FALSE;
+
+	/* Distances with the calibration and the speed of sound in use */
+	distance0 = Ultrasonic_convert((uint32)g_samples[0].highTime << TRILATERATION_FRACTION_BITS, TRILATERATION_FRACTION_BITS);
+	distance1 = Ultrasonic_convert((uint32)g_samples[1].highTime << TRILATERATION_FRACTION_BITS, TRILATERATION_FRACTION_BITS);
+
+	PERF_BEGIN(solveStart);
+	status = Trilateration_solve(distance0, distance1, g_config_ptr->baseline << TRILATERATION_FRACTION_BITS, position_ptr);
+	PERF_END(PERF_METRIC_TRILATERATION, solveStart);
+
+	if(status != TRILATERATION_OK){
+		g_stats.invalidGeometry++;
+		return FALSE;
+	}
+
+	position_ptr->timestamp = sample_ptr->timestamp;
+	g_stats.solutions++;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Solve the position from the distances of sensor 0 and sensor 1 and the baseline (all in
+ * 1/16 cm): x = (r0^2 - r1^2) / (2 * baseline), y = sqrt(r0^2 - (x + baseline / 2)^2).
+ * Return TRILATERATION_INVALID_GEOMETRY if the distances break the triangle inequality
+ * or one is above TRILATERATION_MAX_DISTANCE.
+ */
+Trilateration_StatusType Trilateration_solve(uint16 distance0, uint16 distance1, uint16 baseline, Trilateration_PositionType * position_ptr){
+	uint16 difference = (distance0 > distance1) ? (distance0 - distance1) : (distance1 - distance0);
+	uint32 square0 = (uint32)distance0 * distance0;
+	sint32 numerator;
+	sint32 along;
+	uint32 alongSquare;
+
+	if((distance0 > (TRILATERATION_MAX_DISTANCE << TRILATERATION_FRACTION_BITS))
+			|| (distance1 > (TRILATERATION_MAX_DISTANCE << TRILATERATION_FRACTION_BITS))){
+		return TRILATERATION_INVALID_GEOMETRY;
+	}
+
+	/* The target and the two sensors make a triangle (a flat one on the baseline line) */
+	if((difference > baseline) || (((uint32)distance0 + distance1) < baseline)){
+		return TRILATERATION_INVALID_GEOMETRY;
+	}
+
+	/* Distance along the baseline from sensor 0: (r0^2 - r1^2 + b^2) / 2b, rounded */
+	numerator = (sint32)(square0 + (uint32)baseline * baseline) - (sint32)((uint32)distance1 * distance1);
+	if(numerator >= 0){
+		along = (numerator + baseline) / (sint32)(2 * (uint32)baseline);
+	}
+	else{
+		along = -((-numerator + baseline) / (sint32)(2 * (uint32)baseline));
+	}
+
+	/* |along| <= r0 with a valid triangle, only the rounding can make the square larger */
+	alongSquare = (uint32)(along * along);
+
+	position_ptr->x = (sint16)(along - (baseline >> 1));
+	position_ptr->y = (alongSquare < square0) ? Trilateration_sqrt(square0 - alongSquare) : 0;
+
+	return TRILATERATION_OK;
+}
+
+/*
+ * Description :
+ * Copy the counts of the pairing
+ */
+void Trilateration_getStats(Trilateration_StatsType * stats_ptr){
+	*stats_ptr = g_stats;
+}
+
+/*
+ * Description :
+ * Return the rounded square root of a 32-bit number, one bit of the root per
+ * step with shifts and subtractions only (16 steps)
+ */
+static uint16 Trilateration_sqrt(uint32 value){
+	uint32 root = 0;
+	uint32 bit = 1UL << 30;
+
+	/* Highest power of 4 not above the value */
+	while(bit > value){
+		bit >>= 2;
+	}
+
+	while(bit != 0){
+		if(value >= (root + bit)){
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	/* value is now n - root^2, round up when n is above (root + 1/2)^2 */
+	if(value > root){
+		root++;
+	}
+
+	return (uint16)root;
+}
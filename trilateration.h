@@ -0,0 +1,97 @@
+ /******************************************************************************
+ *
+ * Module: TRILATERATION
+ *
+ * File Name: trilateration.h
+ *
+ * Description: Header file for the position of the target from the distances of two sensors
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef TRILATERATION_H_
+#define TRILATERATION_H_
+
+#include "std_types.h"
+#include "ultrasonic.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Fraction bits of the distances and of the position (1/16 cm) */
+#define TRILATERATION_FRACTION_BITS		4
+
+/* Longest baseline and longest distance in cm, the position fits in 16 bits */
+#define TRILATERATION_MAX_BASELINE		200
+#define TRILATERATION_MAX_DISTANCE		1000
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* enum for the result of a solution */
+typedef enum{
+	TRILATERATION_OK, TRILATERATION_INVALID_GEOMETRY
+}Trilateration_StatusType;
+
+/*
+ * Structure that holds a position in 1/16 cm: sensor 0 is at (-baseline / 2, 0), sensor 1
+ * at (+baseline / 2, 0) and both face the positive y axis
+ */
+typedef struct{
+	uint32 timestamp;			/* ICU time stamp of the newer echo of the pair */
+	sint16 x;
+	uint16 y;
+}Trilateration_PositionType;
+
+/* Structure that contain members to set the configurations of the pairing */
+typedef struct{
+	uint16 baseline;			/* Distance between the sensors in cm */
+	uint32 maxSkew;				/* Longest time between the echoes of a pair in ICU ticks */
+}Trilateration_ConfigType;
+
+/* Structure that holds the counts of the pairing */
+typedef struct{
+	uint16 solutions;
+	uint16 invalidGeometry;		/* Pairs of distances that no point has (or out of range) */
+	uint16 unpaired;			/* Echoes dropped: too old for the next echo of the other sensor */
+}Trilateration_StatsType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the pairing with the baseline and the skew (kept by pointer, it must stay valid),
+ * return FALSE if the baseline is 0 or above TRILATERATION_MAX_BASELINE
+ */
+boolean Trilateration_init(const Trilateration_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Feed an echo sample of either sensor, it is paired with the last valid sample of the
+ * other sensor if that one is at most maxSkew older. Each sample is used in one pair only,
+ * a no echo sample drops the waiting sample of its sensor.
+ * Return TRUE with the position when a pair was solved.
+ */
+boolean Trilateration_addSample(const Ultrasonic_SampleType * sample_ptr, Trilateration_PositionType * position_ptr);
+
+/*
+ * Description :
+ * Solve the position from the distances of sensor 0 and sensor 1 and the baseline (all in
+ * 1/16 cm): x = (r0^2 - r1^2) / (2 * baseline), y = sqrt(r0^2 - (x + baseline / 2)^2).
+ * Return TRILATERATION_INVALID_GEOMETRY if the distances break the triangle inequality
+ * or one is above TRILATERATION_MAX_DISTANCE.
+ */
+Trilateration_StatusType Trilateration_solve(uint16 distance0, uint16 distance1, uint16 baseline, Trilateration_PositionType * position_ptr);
+
+/*
+ * Description :
+ * Copy the counts of the pairing
+ */
+void Trilateration_getStats(Trilateration_StatsType * stats_ptr);
+
+#endif /* TRILATERATION_H_ */
@@ -0,0 +1,285 @@
+ /******************************************************************************
+ *
+ * Module: TWI
+ *
+ * File Name: twi.c
+ *
+ * Description: Source file for the AVR TWI (I2C) driver, interrupt driven slave and master
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "twi.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                            Private Types                                    *
+ *******************************************************************************/
+
+/* enum for the state of the master transaction */
+typedef enum{
+	TWI_MASTER_IDLE,
+	TWI_MASTER_START,		/* START requested, sent once the bus is free */
+	TWI_MASTER_SENDING		/* Address and data bytes on the bus */
+}TWI_MasterStateType;
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Call backs of the slave transactions */
+static Twi_SlaveCallBacksType g_callBacks = {NULL_PTR, NULL_PTR, NULL_PTR, NULL_PTR};
+
+/* Master transaction: slave address, bytes to write and the next one */
+static volatile TWI_MasterStateType g_masterState = TWI_MASTER_IDLE;
+static uint8 g_masterAddress = 0;
+static const uint8 * g_masterData = NULL_PTR;
+static uint8 g_masterLength = 0;
+static uint8 g_masterIndex = 0;
+static void(*g_masterCallBack)(boolean ack) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Private Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * End the master transaction and call its call back (it may start the next one)
+ */
+static void TWI_masterDone(boolean ack);
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(TWI_vect){
+
+	/* Release the bus (clear TWINT) and keep acknowledging the own address by default */
+	uint8 control = (1<<TWINT) | (1<<TWEA) | (1<<TWEN) | (1<<TWIE);
+
+	switch(TWSR & TWI_STATUS_MASK){
+	case TWI_MT_START:
+	case TWI_MT_REP_START:
+
+		/* Slave address + W, the whole transaction is sent again after a lost arbitration */
+		g_masterState = TWI_MASTER_SENDING;
+		g_masterIndex = 0;
+		TWDR = (uint8)(g_masterAddress << 1);
+		break;
+
+	case TWI_MT_SLA_ACK:
+	case TWI_MT_DATA_ACK:
+		if(g_masterIndex < g_masterLength){
+			TWDR = g_masterData[g_masterIndex++];
+		}
+		else{
+			control |= (1<<TWSTO);
+			TWI_masterDone(TRUE);
+		}
+		break;
+
+	case TWI_MT_SLA_NACK:
+	case TWI_MT_DATA_NACK:
+		control |= (1<<TWSTO);
+		TWI_masterDone(FALSE);
+		break;
+
+	case TWI_MT_ARB_LOST:
+
+		/* Start again once the other master released the bus */
+		g_masterState = TWI_MASTER_START;
+		break;
+
+	case TWI_SR_ARB_LOST_SLA_ACK:
+	case TWI_SR_ARB_LOST_GCALL_ACK:
+
+		/* Lost the arbitration to a master addressing this node, start again after it */
+		if(g_masterState == TWI_MASTER_SENDING){
+			g_masterState = TWI_MASTER_START;
+		}
+		if(g_callBacks.start != NULL_PTR){
+			(*g_callBacks.start)(FALSE);
+		}
+		break;
+
+	case TWI_SR_SLA_ACK:
+	case TWI_SR_GCALL_ACK:
+		if(g_callBacks.start != NULL_PTR){
+			(*g_callBacks.start)(FALSE);
+		}
+		break;
+
+	case TWI_SR_DATA_ACK:
+	case TWI_SR_GCALL_DATA_ACK:
+		if(g_callBacks.receive != NULL_PTR){
+			(*g_callBacks.receive)(TWDR);
+		}
+		break;
+
+	case TWI_ST_ARB_LOST_SLA_ACK:
+		if(g_masterState == TWI_MASTER_SENDING){
+			g_masterState = TWI_MASTER_START;
+		}
+		if(g_callBacks.start != NULL_PTR){
+			(*g_callBacks.start)(TRUE);
+		}
+		TWDR = (g_callBacks.transmit != NULL_PTR) ? (*g_callBacks.transmit)() : 0xFF;
+		break;
+
+	case TWI_ST_SLA_ACK:
+		if(g_callBacks.start != NULL_PTR){
+			(*g_callBacks.start)(TRUE);
+		}
+		TWDR = (g_callBacks.transmit != NULL_PTR) ? (*g_callBacks.transmit)() : 0xFF;
+		break;
+
+	case TWI_ST_DATA_ACK:
+		TWDR = (g_callBacks.transmit != NULL_PTR) ? (*g_callBacks.transmit)() : 0xFF;
+		break;
+
+	case TWI_SR_STOP:
+	case TWI_ST_DATA_NACK:
+	case TWI_ST_LAST_DATA:
+		if(g_callBacks.stop != NULL_PTR){
+			(*g_callBacks.stop)();
+		}
+		break;
+
+	case TWI_BUS_ERROR:
+
+		/* Release the lines, no STOP is sent on the bus, the transaction of this node failed */
+		control |= (1<<TWSTO);
+		if(g_masterState != TWI_MASTER_IDLE){
+			TWI_masterDone(FALSE);
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	/*
+	 * A requested START (new transaction, lost arbitration or addressed as a slave meanwhile)
+	 * is sent after the STOP or as soon as the bus is free
+	 */
+	if(g_masterState == TWI_MASTER_START){
+		control |= (1<<TWSTA);
+	}
+
+	TWCR = control;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the TWI as an interrupt driven slave:
+ * 1. Setup the slave address and the general call recognition
+ * 2. Enable the TWI, its interrupt and the acknowledge of the own address
+ * The global interrupts must be enabled.
+ */
+void TWI_initSlave(const Twi_SlaveConfigType * config_ptr){
+
+	/* 7-bit address in TWA6:0, TWGCE = 1 to answer the general call */
+	TWAR = (uint8)(config_ptr->address << 1) | ((config_ptr->generalCall == TRUE) ? (1<<TWGCE) : 0);
+
+	/*
+	 * TWI Control Register:
+	 * 1. TWEA = 1 to acknowledge the own address
+	 * 2. TWEN = 1 to enable the TWI
+	 * 3. TWIE = 1 to enable the TWI interrupt
+	 * 4. TWSTA kept if a master transaction waits for the bus
+	 */
+	TWCR = (1<<TWEA) | (1<<TWEN) | (1<<TWIE) | ((g_masterState == TWI_MASTER_START) ? (1<<TWSTA) : 0);
+}
+
+/*
+ * Description :
+ * Set the call backs of the slave transactions
+ */
+void TWI_setSlaveCallBacks(const Twi_SlaveCallBacksType * callBacks_ptr){
+	g_callBacks = *callBacks_ptr;
+}
+
+/*
+ * Description :
+ * Initialize the TWI master: setup the bit rate and enable the TWI and its interrupt.
+ * It keeps the slave configuration, the node can be a master and a slave on one bus.
+ */
+void TWI_initMaster(const Twi_MasterConfigType * config_ptr){
+
+	/* SCL frequency = F_CPU / (16 + 2 * TWBR * prescaler), prescaler 1 */
+	TWSR = 0;
+	TWBR = (uint8)(((F_CPU / config_ptr->bitRate) - 16) / 2);
+
+	g_masterState = TWI_MASTER_IDLE;
+
+	/* TWEA = 1 acknowledges the own address only if TWI_initSlave set one */
+	TWCR = (1<<TWEA) | (1<<TWEN) | (1<<TWIE);
+}
+
+/*
+ * Description :
+ * Start writing length bytes to the slave at the 7-bit address in one transaction
+ * (START, address + W, the bytes, STOP) from the TWI interrupt. The buffer must stay
+ * valid until the end, the call back gets TRUE if every byte was acknowledged.
+ * Return FALSE if the last transaction is not finished yet.
+ */
+boolean TWI_masterWrite(uint8 address, const uint8 * data_ptr, uint8 length, void(*callBack)(boolean ack)){
+	uint8 sreg;
+
+	if(g_masterState != TWI_MASTER_IDLE){
+		return FALSE;
+	}
+
+	g_masterAddress = address;
+	g_masterData = data_ptr;
+	g_masterLength = length;
+	g_masterCallBack = callBack;
+
+	/*
+	 * TWSTA = 1 sends a START once the bus is free, TWINT is written as 0 so an event waiting
+	 * for the interrupt is kept (the interrupt sets TWSTA again when it releases the bus)
+	 */
+	sreg = SREG;
+	cli();
+	g_masterState = TWI_MASTER_START;
+	TWCR = (1<<TWSTA) | (1<<TWEA) | (1<<TWEN) | (1<<TWIE);
+	SREG = sreg;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return TRUE while a master transaction is running
+ */
+boolean TWI_isMasterBusy(void){
+	return (g_masterState != TWI_MASTER_IDLE) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * End the master transaction and call its call back (it may start the next one)
+ */
+static void TWI_masterDone(boolean ack){
+	g_masterState = TWI_MASTER_IDLE;
+
+	if(g_masterCallBack != NULL_PTR){
+		(*g_masterCallBack)(ack);
+	}
+}
+
+/*
+ * Description :
+ * Disable the TWI
+ */
+void TWI_DeInit(void){
+	TWCR = 0;
+	TWAR = 0;
+	g_masterState = TWI_MASTER_IDLE;
+}
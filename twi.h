@@ -0,0 +1,119 @@
+ /******************************************************************************
+ *
+ * Module: TWI
+ *
+ * File Name: twi.h
+ *
+ * Description: Header file for the AVR TWI (I2C) driver, interrupt driven slave and master
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef TWI_H_
+#define TWI_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Status codes of TWSR (prescaler bits masked) in master transmitter mode */
+#define TWI_STATUS_MASK					0xF8
+#define TWI_MT_START					0x08	/* START sent */
+#define TWI_MT_REP_START				0x10	/* Repeated START sent */
+#define TWI_MT_SLA_ACK					0x18	/* Slave address + W sent, ACK received */
+#define TWI_MT_SLA_NACK					0x20
+#define TWI_MT_DATA_ACK					0x28	/* Data byte sent, ACK received */
+#define TWI_MT_DATA_NACK				0x30
+#define TWI_MT_ARB_LOST					0x38	/* Arbitration lost to another master */
+
+/* Status codes of TWSR in slave mode */
+#define TWI_SR_SLA_ACK					0x60	/* Own address + W received */
+#define TWI_SR_ARB_LOST_SLA_ACK			0x68
+#define TWI_SR_GCALL_ACK				0x70	/* General call received */
+#define TWI_SR_ARB_LOST_GCALL_ACK		0x78
+#define TWI_SR_DATA_ACK					0x80	/* Data byte received, ACK returned */
+#define TWI_SR_DATA_NACK				0x88
+#define TWI_SR_GCALL_DATA_ACK			0x90
+#define TWI_SR_GCALL_DATA_NACK			0x98
+#define TWI_SR_STOP						0xA0	/* STOP or repeated START */
+#define TWI_ST_SLA_ACK					0xA8	/* Own address + R received */
+#define TWI_ST_ARB_LOST_SLA_ACK			0xB0
+#define TWI_ST_DATA_ACK					0xB8	/* Data byte sent, ACK received */
+#define TWI_ST_DATA_NACK				0xC0	/* Data byte sent, NACK received (end of the read) */
+#define TWI_ST_LAST_DATA				0xC8
+#define TWI_BUS_ERROR					0x00
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Structure that contain members to set the configurations of the TWI slave */
+typedef struct{
+	uint8 address;			/* 7-bit slave address */
+	boolean generalCall;	/* Answer the general call address 0 too */
+}Twi_SlaveConfigType;
+
+/* Structure that contain members to set the configurations of the TWI master */
+typedef struct{
+	uint32 bitRate;			/* SCL frequency in Hz (100000 or 400000), prescaler 1 */
+}Twi_MasterConfigType;
+
+/* Call backs of a slave transaction, all are called from the TWI interrupt */
+typedef struct{
+	void(*start)(boolean read);		/* Addressed, read = TRUE if the master reads */
+	void(*receive)(uint8 data);		/* Byte written by the master */
+	uint8(*transmit)(void);			/* Next byte read by the master */
+	void(*stop)(void);				/* End of the transaction (STOP, repeated START or last byte read) */
+}Twi_SlaveCallBacksType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the TWI as an interrupt driven slave:
+ * 1. Setup the slave address and the general call recognition
+ * 2. Enable the TWI, its interrupt and the acknowledge of the own address
+ * The global interrupts must be enabled.
+ */
+void TWI_initSlave(const Twi_SlaveConfigType * config_ptr);
+
+/*
+ * Description :
+ * Set the call backs of the slave transactions
+ */
+void TWI_setSlaveCallBacks(const Twi_SlaveCallBacksType * callBacks_ptr);
+
+/*
+ * Description :
+ * Initialize the TWI master: setup the bit rate and enable the TWI and its interrupt.
+ * It keeps the slave configuration, the node can be a master and a slave on one bus.
+ */
+void TWI_initMaster(const Twi_MasterConfigType * config_ptr);
+
+/*
+ * Description :
+ * Start writing length bytes to the slave at the 7-bit address in one transaction
+ * (START, address + W, the bytes, STOP) from the TWI interrupt. The buffer must stay
+ * valid until the end, the call back gets TRUE if every byte was acknowledged.
+ * Return FALSE if the last transaction is not finished yet.
+ */
+boolean TWI_masterWrite(uint8 address, const uint8 * data_ptr, uint8 length, void(*callBack)(boolean ack));
+
+/*
+ * Description :
+ * Return TRUE while a master transaction is running
+ */
+boolean TWI_isMasterBusy(void);
+
+/*
+ * Description :
+ * Disable the TWI
+ */
+void TWI_DeInit(void);
+
+#endif /* TWI_H_ */
@@ -0,0 +1,219 @@
+ /******************************************************************************
+ *
+ * Module: UART
+ *
+ * File Name: uart.c
+ *
+ * Description: Source file for the AVR UART driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "uart.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/*
+ * Transmit ring buffer, the main loop is the only writer of g_txHead and
+ * the ISR is the only writer of g_txTail, both are 8-bit so no locking is needed
+ */
+static volatile uint8 g_txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 g_txHead = 0;
+static volatile uint8 g_txTail = 0;
+
+/*
+ * Receive ring buffer, the ISR is the only writer of g_rxHead and
+ * the main loop is the only writer of g_rxTail
+ */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0;
+static volatile uint8 g_rxTail = 0;
+
+/* Received bytes lost, written by the ISR only */
+static volatile uint16 g_rxDropped = 0;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(USART_UDRE_vect){
+
+	uint8 tail = g_txTail;
+
+	if(tail == g_txHead){
+
+		/* Buffer is empty, disable the Data Register Empty interrupt until new data is queued */
+		UCSRB &= ~(1<<UDRIE);
+	}
+	else{
+
+		/* Send the next byte */
+		UDR = g_txBuffer[tail];
+		g_txTail = (tail + 1) & (UART_TX_BUFFER_SIZE - 1);
+	}
+}
+
+ISR(USART_RXC_vect){
+
+	/* The status must be read before UDR, reading UDR clears it */
+	uint8 status = UCSRA;
+	uint8 data = UDR;
+	uint8 head = g_rxHead;
+	uint8 next = (head + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+	if((status & ((1<<FE) | (1<<DOR))) || (next == g_rxTail)){
+
+		/* Damaged byte, byte lost before this one or no room: the line is not complete anymore */
+		g_rxDropped++;
+	}
+
+	if(!(status & (1<<FE)) && (next != g_rxTail)){
+		g_rxBuffer[head] = data;
+		g_rxHead = next;
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize UART:
+ * 1. Setup the frame format (data bits, parity and stop bits)
+ * 2. Enable the transmitter and the receiver in double speed mode
+ * 3. Setup the baud rate
+ * Transmission and reception are interrupt driven, the global interrupts must be enabled.
+ */
+void UART_init(const Uart_ConfigType * config_ptr){
+
+	uint16 ubrrValue;
+
+	/* Empty the transmit and receive buffers */
+	g_txHead = 0;
+	g_txTail = 0;
+	g_rxHead = 0;
+	g_rxTail = 0;
+	g_rxDropped = 0;
+
+	/* U2X = 1 for double transmission speed */
+	UCSRA = (1<<U2X);
+
+	/*
+	 * UART Control and Status Register B:
+	 * 1. TXEN = 1 to enable the transmitter
+	 * 2. RXEN = 1 and RXCIE = 1 to receive into the receive buffer
+	 * 3. UDRIE is set by the send functions when there is data to send
+	 * 4. UCSZ2 = 0 since 9-bit data mode is not supported
+	 */
+	UCSRB = (1<<TXEN) | (1<<RXEN) | (1<<RXCIE);
+
+	/*
+	 * UART Control and Status Register C:
+	 * 1. URSEL = 1 to write to UCSRC
+	 * 2. UMSEL = 0 for asynchronous operation
+	 * 3. UPM1:0 for the parity mode
+	 * 4. USBS for the number of stop bits
+	 * 5. UCSZ1:0 for the number of data bits
+	 */
+	UCSRC = (1<<URSEL) | (((config_ptr->parity) & 0x03)<<UPM0) | (((config_ptr->stopBit) & 0x01)<<USBS) | (((config_ptr->bitData) & 0x03)<<UCSZ0);
+
+	/* Calculate the UBRR register value for the double speed mode */
+	ubrrValue = (uint16)(((F_CPU / (config_ptr->baudRate * 8UL))) - 1);
+
+	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH */
+	UBRRH = ubrrValue>>8;
+	UBRRL = ubrrValue;
+}
+
+/*
+ * Description :
+ * Put one byte in the transmit buffer without waiting,
+ * return FALSE if the buffer is full (the byte is not sent)
+ */
+boolean UART_sendByte(uint8 data){
+	return UART_sendBlock(&data, 1);
+}
+
+/*
+ * Description :
+ * Put a block of bytes in the transmit buffer without waiting,
+ * the block is queued completely or not at all (return FALSE if there is no room for it)
+ */
+boolean UART_sendBlock(const uint8 * data_ptr, uint8 size){
+
+	uint8 head = g_txHead;
+
+	if(UART_getTxFreeSpace() < size){
+		return FALSE;
+	}
+
+	while(size > 0){
+		g_txBuffer[head] = *data_ptr;
+		head = (head + 1) & (UART_TX_BUFFER_SIZE - 1);
+		data_ptr++;
+		size--;
+	}
+
+	/* Publish the whole block at once */
+	g_txHead = head;
+
+	/* Start (or keep) the transmission */
+	UCSRB |= (1<<UDRIE);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of free bytes in the transmit buffer
+ */
+uint8 UART_getTxFreeSpace(void){
+
+	/* One byte is kept empty to distinguish a full buffer from an empty one */
+	return (UART_TX_BUFFER_SIZE - 1) - ((g_txHead - g_txTail) & (UART_TX_BUFFER_SIZE - 1));
+}
+
+/*
+ * Description :
+ * Take the oldest received byte from the receive buffer without waiting,
+ * return FALSE if nothing was received
+ */
+boolean UART_receiveByte(uint8 * data_ptr){
+
+	uint8 tail = g_rxTail;
+
+	if(tail == g_rxHead){
+		return FALSE;
+	}
+
+	*data_ptr = g_rxBuffer[tail];
+
+	/* Free the byte only after it was copied */
+	g_rxTail = (tail + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of received bytes lost since the initialization
+ * (receive buffer full, data overrun or frame error)
+ */
+uint16 UART_getRxDropped(void){
+
+	uint16 dropped;
+	uint8 sreg = SREG;
+
+	/* 16-bit counter written by the ISR */
+	cli();
+	dropped = g_rxDropped;
+	SREG = sreg;
+
+	return dropped;
+}
@@ -0,0 +1,115 @@
+ /******************************************************************************
+ *
+ * Module: UART
+ *
+ * File Name: uart.h
+ *
+ * Description: Header file for the AVR UART driver
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef UART_H_
+#define UART_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Size of the transmit ring buffer in bytes, must be a power of 2 and at most 128 */
+#define UART_TX_BUFFER_SIZE		64
+
+#if((UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) != 0) || (UART_TX_BUFFER_SIZE > 128)
+
+#error "UART transmit buffer size must be a power of 2 and at most 128"
+
+#endif
+
+/* Size of the receive ring buffer in bytes, must be a power of 2 and at most 128 */
+#define UART_RX_BUFFER_SIZE		64
+
+#if((UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) != 0) || (UART_RX_BUFFER_SIZE > 128)
+
+#error "UART receive buffer size must be a power of 2 and at most 128"
+
+#endif
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* enum for the number of data bits in a frame */
+typedef enum{
+	UART_5_BIT, UART_6_BIT, UART_7_BIT, UART_8_BIT
+}Uart_BitDataType;
+
+/* enum for the parity mode */
+typedef enum{
+	UART_PARITY_DISABLED, UART_PARITY_EVEN = 2, UART_PARITY_ODD
+}Uart_ParityType;
+
+/* enum for the number of stop bits */
+typedef enum{
+	UART_ONE_STOP_BIT, UART_TWO_STOP_BITS
+}Uart_StopBitType;
+
+/* Structure that contain members to set the configurations of UART */
+typedef struct{
+	Uart_BitDataType bitData;
+	Uart_ParityType parity;
+	Uart_StopBitType stopBit;
+	uint32 baudRate;
+}Uart_ConfigType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize UART:
+ * 1. Setup the frame format (data bits, parity and stop bits)
+ * 2. Enable the transmitter and the receiver in double speed mode
+ * 3. Setup the baud rate
+ * Transmission and reception are interrupt driven, the global interrupts must be enabled.
+ */
+void UART_init(const Uart_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Put one byte in the transmit buffer without waiting,
+ * return FALSE if the buffer is full (the byte is not sent)
+ */
+boolean UART_sendByte(uint8 data);
+
+/*
+ * Description :
+ * Put a block of bytes in the transmit buffer without waiting,
+ * the block is queued completely or not at all (return FALSE if there is no room for it)
+ */
+boolean UART_sendBlock(const uint8 * data_ptr, uint8 size);
+
+/*
+ * Description :
+ * Return the number of free bytes in the transmit buffer
+ */
+uint8 UART_getTxFreeSpace(void);
+
+/*
+ * Description :
+ * Take the oldest received byte from the receive buffer without waiting,
+ * return FALSE if nothing was received
+ */
+boolean UART_receiveByte(uint8 * data_ptr);
+
+/*
+ * Description :
+ * Return the number of received bytes lost since the initialization
+ * (receive buffer full, data overrun or frame error)
+ */
+uint16 UART_getRxDropped(void);
+
+#endif /* UART_H_ */
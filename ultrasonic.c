@@ -13,20 +13,95 @@
 #include "ultrasonic.h"
 #include "gpio.h"
 #include "icu.h"
-#include <util/delay.h>
+#include "seqlock.h"
+#include "timer.h"
+#include "perf.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*******************************************************************************
+ *                            Private Types                                    *
+ *******************************************************************************/
+
+/* enum for the echo pin state tracked by the edge processing, ENDED until the falling edge
+ * is known not to be the start of a glitch
+ */
+typedef enum{
+	ULTRASONIC_ECHO_LOW, ULTRASONIC_ECHO_HIGH, ULTRASONIC_ECHO_ENDED
+}Ultrasonic_EchoStateType;
 
 /*******************************************************************************
  *                      Private Global Variable                                *
  *******************************************************************************/
 
-/* Global Variable to store edge counts */
-static volatile uint8 g_edgeCount = 0;
+#if(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_UART)
+
+/* Bits of the byte being received (start bit included), ULTRASONIC_UART_IDLE between bytes */
+static volatile uint8 g_uartBits = ULTRASONIC_UART_IDLE;
+
+/* Data bits received so far, least significant bit first */
+static volatile uint8 g_uartByte = 0;
+
+/* ICU time stamps of the last edge and of the start bit of the byte being received */
+static volatile uint32 g_uartEdgeTime = 0;
+static volatile uint32 g_uartByteStart = 0;
+
+/* Bytes of the frame received so far and the time stamp of the start of its header */
+static volatile uint8 g_uartFrame[ULTRASONIC_UART_FRAME_SIZE];
+static volatile uint8 g_uartIndex = 0;
+static volatile uint32 g_uartFrameStart = 0;
+
+#else
+
+/* Global Variable to store the echo pin state as seen by the edge processing */
+static volatile Ultrasonic_EchoStateType g_echoState = ULTRASONIC_ECHO_LOW;
+
+/* Global Variable to store the input capture value at the start of the echo pulse */
+static volatile uint16 g_echoStart = 0;
+
+/* Input capture value and time stamp of the falling edge while the echo state is ENDED */
+static volatile uint16 g_echoEnd = 0;
+static volatile uint32 g_echoEndTime = 0;
+
+#endif
+
+/* Global Variable to store the last complete echo measurement */
+static volatile Ultrasonic_SampleType g_sample = {0, 0, 0, ULTRASONIC_STATUS_OK, 0};
+
+/* Sequence counter protecting g_sample against torn reads */
+static Seqlock_Type g_sampleLock = 0;
+
+/* Result of the last Ultrasonic_readDistance call */
+static Ultrasonic_ResultType g_result = {0, 0, 0, ULTRASONIC_STATUS_OK, 0};
+
+/* Count of the measurement converted into g_result */
+static uint8 g_resultCount = 0;
+
+/* Time stamp of the last trigger pulse */
+static uint32 g_triggerTime = 0;
+
+/* Flag to indicate that the echo of the last trigger pulse is not complete yet */
+static boolean g_waitingEcho = FALSE;
+
+/* Software timer that ends the trigger pulse */
+static uint8 g_triggerTimer = TIMER_INVALID_ID;
 
-/* Global Variable to store periodic time */
-static volatile uint16 g_timePeriod = 0;
+/* Trigger pins of the sensors */
+static const uint8 g_triggerPorts[ULTRASONIC_NUM_OF_SENSORS] = {ULTRASONIC_TRIGGER_PORT_ID, ULTRASONIC_TRIGGER2_PORT_ID};
+static const uint8 g_triggerPins[ULTRASONIC_NUM_OF_SENSORS] = {ULTRASONIC_TRIGGER_PIN_ID, ULTRASONIC_TRIGGER2_PIN_ID};
 
-/* Global Variable to store high time plus period */
-static volatile uint16 g_timePeriodPlusHigh = 0;
+/* Sensor of the next trigger pulse and the sensor that sent the last one (read by the ICU interrupt) */
+static volatile uint8 g_sensor = 0;
+static volatile uint8 g_triggeredSensor = 0;
+
+/* Calibration of the conversion, none until one is set */
+static Ultrasonic_CalibrationType g_calibration = {ULTRASONIC_UNIT_GAIN, 0};
+
+/* Speed multiplier of the speed of sound, the factory scale until one is set */
+static uint16 g_speedMultiplier = ULTRASONIC_DEFAULT_MULTIPLIER;
+
+/* Product of the speed multiplier and of the gain used by the conversion */
+static uint16 g_multiplier = ULTRASONIC_DEFAULT_MULTIPLIER;
 
 /*******************************************************************************
  *                      Private Functions Prototypes                           *
@@ -39,13 +114,87 @@ static volatile uint16 g_timePeriodPlusHigh = 0;
  */
 static void Ultrasonic_Trigger(void);
 
+/*
+ * Description :
+ * Call back of the trigger timer, end the trigger pulse
+ */
+static void Ultrasonic_triggerEnd(void);
+
+/*
+ * Description :
+ * Publish a complete measurement of the triggered sensor (the echo time and the ICU time
+ * stamp of its end), from the ICU interrupt or with the interrupts disabled
+ */
+static void Ultrasonic_addSample(uint16 highTime, uint32 timestamp);
+
+/*
+ * Description :
+ * Compute the multiplier of the conversion from the speed multiplier and the gain
+ */
+static void Ultrasonic_updateMultiplier(void);
+
+/*
+ * Sensor type: every type has these, only the one selected by ULTRASONIC_SENSOR_TYPE
+ * is built and they are called directly
+ */
+
+/*
+ * Description :
+ * Configure the ICU for the output of the sensor type
+ */
+static void Ultrasonic_sensorInit(void);
+
 /*
  * Description :
  * 1. This is the call back function called by the ICU driver
  * 2. This is used to calculate the high time (pulse time) generated by the ultrasonic sensor
+ *    or to receive the frame of the UART type, and to publish the sample when it is complete
  */
 static void Ultrasonic_edgeProcessing(void);
 
+/*
+ * Description :
+ * Call back of the ICU driver for a rejected edge: undo the edge before it
+ */
+static void Ultrasonic_glitchProcessing(void);
+
+/*
+ * Description :
+ * Complete a measurement the ICU interrupt can not complete alone, called by Ultrasonic_update
+ */
+static void Ultrasonic_sensorPoll(void);
+
+/*
+ * Description :
+ * Convert a reading of the sensor type (pulse width or mm) into the echo time of the HC-SR04
+ */
+static uint16 Ultrasonic_toEchoTime(uint16 reading);
+
+#if(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_UART)
+
+/*
+ * Description :
+ * Add the bits at the given line level from the last edge to the given time stamp
+ * to the byte being received
+ */
+static void Ultrasonic_uartShift(uint32 timestamp, uint8 level);
+
+/*
+ * Description :
+ * Add a received byte to the frame and publish the sample when the frame is complete
+ */
+static void Ultrasonic_uartReceive(uint8 data);
+
+#else
+
+/*
+ * Description :
+ * Publish the echo pulse that ended with the falling edge held in the ENDED state
+ */
+static void Ultrasonic_echoEnd(void);
+
+#endif
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -56,20 +205,32 @@ static void Ultrasonic_edgeProcessing(void);
  * 1. Initialize the ICU driver
  * 2. Setup the ICU call back function
  * 3. Setup the direction for the trigger pin as output pin through the GPIO driver
+ * 4. Create the timer that ends the trigger pulse
  */
 void Ultrasonic_init(void){
 
+	uint8 sensor_id;
+
 	/* Set Callback Function */
 	ICU_setCallBack(Ultrasonic_edgeProcessing);
+	ICU_setGlitchCallBack(Ultrasonic_glitchProcessing);
 
-	/* Configure ICU settings */
-	Icu_ConfigType config = {RISING_EDGE,F_CPU_8};
+	/* Initiate ICU for the output of the sensor */
+	Ultrasonic_sensorInit();
 
-	/* Initiate ICU */
-	ICU_init(&config);
+	/* Set the trigger pins as output pins */
+	for(sensor_id = 0; sensor_id < ULTRASONIC_NUM_OF_SENSORS; sensor_id++){
+		GPIO_setupPinDirection(g_triggerPorts[sensor_id], g_triggerPins[sensor_id], PIN_OUTPUT);
+	}
+
+	/* Triggers at a given time come from the Timer1 compare */
+	ICU_setCompareCallBack(Ultrasonic_Trigger);
 
-	/* Set trigger pin as output pin */
-	GPIO_setupPinDirection(ULTRASONIC_TRIGGER_PORT_ID, ULTRASONIC_TRIGGER_PIN_ID, PIN_OUTPUT);
+	/* The trigger pulse is ended by a one shot timer instead of a delay */
+	Timer_init();
+	if(g_triggerTimer == TIMER_INVALID_ID){
+		g_triggerTimer = Timer_create(Ultrasonic_triggerEnd);
+	}
 }
 
 /*
@@ -79,87 +240,680 @@ void Ultrasonic_init(void){
  */
 static void Ultrasonic_Trigger(void){
 
+	/* The echo belongs to the sensor triggered now */
+	g_triggeredSensor = g_sensor;
+
 	/* Set trigger pin High */
-	GPIO_writePin(ULTRASONIC_TRIGGER_PORT_ID, ULTRASONIC_TRIGGER_PIN_ID, LOGIC_HIGH);
+	GPIO_writePin(g_triggerPorts[g_triggeredSensor], g_triggerPins[g_triggeredSensor], LOGIC_HIGH);
 
-	/* wait 10 us */
-	_delay_us(10);
+	/* Set it Low after ULTRASONIC_TRIGGER_PULSE_US without waiting here */
+	Timer_start(g_triggerTimer, TIMER_ONE_SHOT, ULTRASONIC_TRIGGER_PULSE_US);
+}
+
+/*
+ * Description :
+ * Call back of the trigger timer, end the trigger pulse
+ */
+static void Ultrasonic_triggerEnd(void){
 
 	/* Set trigger pin Low */
-	GPIO_writePin(ULTRASONIC_TRIGGER_PORT_ID, ULTRASONIC_TRIGGER_PIN_ID, LOGIC_LOW);
+	GPIO_writePin(g_triggerPorts[g_triggeredSensor], g_triggerPins[g_triggeredSensor], LOGIC_LOW);
 }
 
 /*
  * Description :
  * 1. Send the trigger pulse by using Ultrasonic_Trigger function
  * 2. Start the measurements by the ICU from this moment
+ * 3. Wait for the echo at most ULTRASONIC_TIMEOUT_TICKS, on timeout or no echo
+ *    the last valid distance is returned and the status tells why
  */
 uint16 Ultrasonic_readDistance(void){
 
-	/* Store Value of distance */
-	static uint16 distance = 0;
+	Ultrasonic_startMeasurement();
+
+	/* Wait for a complete echo pulse or the timeout */
+	while(!Ultrasonic_update()){
+	}
+
+	return g_result.distance;
+}
+
+/*
+ * Description :
+ * Measure pings times (1 to ULTRASONIC_BURST_MAX_PINGS) back to back, every trigger pulse
+ * ULTRASONIC_PING_SPACING_TICKS after the previous one, and aggregate the valid distances
+ * while they come (the mean is computed on the echo times, not on the rounded distances).
+ * Return FALSE if no measurement was valid, the aggregate is zero then.
+ */
+boolean Ultrasonic_readBurst(uint8 pings, Ultrasonic_BurstType * burst_ptr){
+
+	/* Valid distances kept sorted for the median */
+	uint16 sorted[ULTRASONIC_BURST_MAX_PINGS];
+
+	/* Sum of the valid echo times */
+	uint32 highTimeSum = 0;
+
+	Ultrasonic_SampleType sample;
+	uint32 firstTrigger = 0;
+	uint8 valid = 0;
+	uint8 ping;
+	uint8 i;
+
+	if(pings == 0){
+		pings = 1;
+	}
+	else if(pings > ULTRASONIC_BURST_MAX_PINGS){
+		pings = ULTRASONIC_BURST_MAX_PINGS;
+	}
+
+	burst_ptr->pings = pings;
+	burst_ptr->min = 0xFFFF;
+	burst_ptr->max = 0;
+
+	for(ping = 0; ping < pings; ping++){
+
+		/* Every ping at the sensor's minimum spacing from the previous one (even out of the burst) */
+		while((ICU_getTimestamp() - g_triggerTime) < ULTRASONIC_PING_SPACING_TICKS){
+		}
+
+		Ultrasonic_startMeasurement();
+		if(ping == 0){
+			firstTrigger = g_triggerTime;
+		}
+
+		while(!Ultrasonic_update()){
+		}
+
+		if(g_result.status != ULTRASONIC_STATUS_OK){
+			continue;
+		}
+
+		Ultrasonic_getSample(&sample);
+		highTimeSum += sample.highTime;
+
+		if(g_result.distance < burst_ptr->min){
+			burst_ptr->min = g_result.distance;
+		}
+		if(g_result.distance > burst_ptr->max){
+			burst_ptr->max = g_result.distance;
+		}
+
+		/* Insert in order */
+		for(i = valid; (i > 0) && (sorted[i - 1] > g_result.distance); i--){
+			sorted[i] = sorted[i - 1];
+		}
+		sorted[i] = g_result.distance;
+		valid++;
+	}
+
+	burst_ptr->duration = g_result.timestamp - firstTrigger;
+	burst_ptr->validCount = valid;
+
+	if(valid == 0){
+		burst_ptr->median = 0;
+		burst_ptr->mean = 0;
+		burst_ptr->min = 0;
+		burst_ptr->max = 0;
+		burst_ptr->spread = 0;
+
+		return FALSE;
+	}
+
+	burst_ptr->median = (valid & 1) ? sorted[valid / 2] : (uint16)((sorted[valid / 2 - 1] + sorted[valid / 2] + 1) / 2);
+	burst_ptr->mean = Ultrasonic_convert(((highTimeSum << ULTRASONIC_BURST_FRACTION_BITS) + valid / 2) / valid,
+			ULTRASONIC_BURST_FRACTION_BITS);
+	burst_ptr->spread = burst_ptr->max - burst_ptr->min;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Trigger the given sensor (0 to ULTRASONIC_NUM_OF_SENSORS - 1) from the next trigger pulse on,
+ * return FALSE and keep the current one if it does not exist
+ */
+boolean Ultrasonic_selectSensor(uint8 sensor_id){
+	if(sensor_id >= ULTRASONIC_NUM_OF_SENSORS){
+		return FALSE;
+	}
+
+	g_sensor = sensor_id;
+	return TRUE;
+}
 
-	/* Send the trigger pulse */
+/*
+ * Description :
+ * Send the trigger pulse and return at once, Ultrasonic_update gives the result
+ * when the echo is complete or after ULTRASONIC_TIMEOUT_TICKS
+ */
+void Ultrasonic_startMeasurement(void){
+
+	/* Status register of the caller */
+	uint8 sreg;
+
+	/* Drop a measurement completed before this trigger */
+	Ultrasonic_update();
+
+	/*
+	 * Send the trigger pulse with the interrupts disabled: the pin write is a read, modify,
+	 * write of a port the LCD strobes (E, the SPI latch) from its interrupts
+	 */
+	sreg = SREG;
+	cli();
+	g_triggerTime = ICU_getTimestamp();
+	g_waitingEcho = TRUE;
 	Ultrasonic_Trigger();
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Send the trigger pulse when the ICU time stamp reaches the given one (from the Timer1
+ * compare interrupt) and return at once, Ultrasonic_update gives the result like after
+ * Ultrasonic_startMeasurement
+ */
+void Ultrasonic_startMeasurementAt(uint32 timestamp){
+
+	/* Drop a measurement completed before this trigger */
+	Ultrasonic_update();
+
+	/* The timeout counts from the trigger pulse, not from now */
+	g_triggerTime = timestamp;
+	g_waitingEcho = TRUE;
+	ICU_startCompare(timestamp);
+}
+
+/*
+ * Description :
+ * Convert the last echo measurement into the result if the ICU interrupt completed
+ * a new one since the previous call, return TRUE in this case (does not block).
+ * Also return TRUE with the timeout status when the echo of the last trigger is late.
+ */
+boolean Ultrasonic_update(void){
+
+	/* Snapshot of the measurement */
+	Ultrasonic_SampleType sample;
+
+	/* Time stamp while waiting for the echo */
+	uint32 now;
+
+	Ultrasonic_sensorPoll();
+	Ultrasonic_getSample(&sample);
+
+	if(sample.count == g_resultCount){
+
+		/* Only the ISR writes the count, nothing is reset here */
+		if(g_waitingEcho == TRUE){
+			now = ICU_getTimestamp();
 
-	/* Wait for edges */
-	while(g_edgeCount < 2);
+			/* Signed: the trigger of Ultrasonic_startMeasurementAt may be still to come */
+			if((sint32)(now - g_triggerTime) > (sint32)ULTRASONIC_TIMEOUT_TICKS){
 
-	if((g_edgeCount > 2) && (g_edgeCount < 4)){
+				/* The sensor did not answer, keep the last distance */
+				g_result.timestamp = now;
+				g_result.latency = (uint16)(now - g_triggerTime);
+				g_result.status = ULTRASONIC_STATUS_TIMEOUT;
+				g_result.sensor = g_triggeredSensor;
+				g_waitingEcho = FALSE;
+				PERF_COUNT(PERF_COUNTER_TIMEOUT);
 
-		/* wait for edges */
-		while(g_edgeCount < 4);
+				return TRUE;
+			}
+		}
+
+		return FALSE;
+	}
+	g_resultCount = sample.count;
+
+	if(g_waitingEcho == TRUE){
+		g_waitingEcho = FALSE;
+		PERF_END(PERF_METRIC_TRIGGER_TO_RESULT, g_triggerTime);
 	}
 
-	if(g_edgeCount == 4){
+	g_result.timestamp = sample.timestamp;
+	g_result.latency = (uint16)(sample.timestamp - g_triggerTime);
+	g_result.status = sample.status;
+	g_result.sensor = sample.sensor;
 
-		/* Reset edge counter */
-		g_edgeCount = 0;
+	if(sample.status == ULTRASONIC_STATUS_NO_ECHO){
+
+		/* No object in range, keep the last distance */
+		PERF_COUNT(PERF_COUNTER_MISSED);
+	}
+	else{
 
 		/* Store the value of high time */
-		distance = (((uint16)g_timePeriodPlusHigh - g_timePeriod)/ULTRASONIC_CALIBRATION_FACTOR);
+		g_result.distance = Ultrasonic_convert(sample.highTime, 0);
+	}
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the status of the last Ultrasonic_readDistance call
+ */
+Ultrasonic_StatusType Ultrasonic_getStatus(void){
+	return g_result.status;
+}
+
+/*
+ * Description :
+ * Copy the result of the last Ultrasonic_readDistance call
+ */
+void Ultrasonic_getResult(Ultrasonic_ResultType * result_ptr){
+	*result_ptr = g_result;
+}
+
+/*
+ * Description :
+ * Copy the last echo measurement, the copy is consistent even if
+ * the ICU interrupt completes a new measurement in the middle of it
+ */
+void Ultrasonic_getSample(Ultrasonic_SampleType * sample_ptr){
+	uint8 sequence;
+
+	/* Copy again if the ICU interrupt updated the sample during the copy */
+	do{
+		sequence = Seqlock_readBegin(&g_sampleLock);
+		*sample_ptr = g_sample;
+	}while(Seqlock_readRetry(&g_sampleLock, sequence));
+}
+
+/*
+ * Description :
+ * Publish a complete measurement of the triggered sensor (the echo time and the ICU time
+ * stamp of its end), from the ICU interrupt or with the interrupts disabled
+ */
+static void Ultrasonic_addSample(uint16 highTime, uint32 timestamp){
+	Seqlock_writeBegin(&g_sampleLock);
+	g_sample.highTime = highTime;
+	g_sample.timestamp = timestamp;
+	g_sample.status = (highTime > ULTRASONIC_NO_ECHO_WIDTH) ? ULTRASONIC_STATUS_NO_ECHO : ULTRASONIC_STATUS_OK;
+	g_sample.sensor = g_triggeredSensor;
+	g_sample.count++;
+	Seqlock_writeEnd(&g_sampleLock);
+}
+
+#if(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_UART)
+
+/*
+ * Description :
+ * Configure the ICU for the output of the sensor type
+ */
+static void Ultrasonic_sensorInit(void){
+
+	/* The line is idle high, a byte starts with a falling edge */
+	Icu_ConfigType config = {FALLING_EDGE,F_CPU_8,ICU_NOISE_CANCELER_ON,ULTRASONIC_MIN_PULSE_WIDTH};
+
+	ICU_init(&config);
+	g_uartBits = ULTRASONIC_UART_IDLE;
+	g_uartIndex = 0;
+}
+
+/*
+ * Description :
+ * 1. This is the call back function called by the ICU driver
+ * 2. This is used to calculate the high time (pulse time) generated by the ultrasonic sensor
+ *    or to receive the frame of the UART type, and to publish the sample when it is complete
+ */
+static void Ultrasonic_edgeProcessing(void){
+
+	/* Time stamp of this edge */
+	uint32 timestamp = ICU_getInputCaptureTimestamp();
+
+	/* The edge is decided from the line level, like the echo pulse of the other types */
+	if(GPIO_readPin(ICU_PORT_ID, ICU_PIN_ID) == LOGIC_LOW){
+		ICU_setEdgeDetectionType(RISING_EDGE);
+
+		if(g_uartBits != ULTRASONIC_UART_IDLE){
+
+			/* The line was high since the last edge, a byte is complete when only its stop bit is left */
+			Ultrasonic_uartShift(timestamp, LOGIC_HIGH);
+			if(g_uartBits < (ULTRASONIC_UART_BYTE_BITS - 1)){
+				g_uartEdgeTime = timestamp;
+				return;
+			}
+			Ultrasonic_uartReceive(g_uartByte);
+		}
+
+		/* Start bit of the next byte */
+		g_uartBits = 0;
+		g_uartByte = 0;
+		g_uartEdgeTime = timestamp;
+		g_uartByteStart = timestamp;
+	}
+	else{
+		ICU_setEdgeDetectionType(FALLING_EDGE);
+
+		if(g_uartBits != ULTRASONIC_UART_IDLE){
+
+			/* The line was low since the last edge, a low stop bit is a framing error */
+			Ultrasonic_uartShift(timestamp, LOGIC_LOW);
+			if(g_uartBits >= ULTRASONIC_UART_BYTE_BITS){
+				g_uartBits = ULTRASONIC_UART_IDLE;
+				g_uartIndex = 0;
+			}
+			g_uartEdgeTime = timestamp;
+		}
 	}
+}
+
+/*
+ * Description :
+ * Call back of the ICU driver for a rejected edge: undo the edge before it
+ */
+static void Ultrasonic_glitchProcessing(void){
 
-	return distance;
+	/* Bits and bytes can not be told apart from a glitch any more, drop the frame (the ping times out) */
+	g_uartBits = ULTRASONIC_UART_IDLE;
+	g_uartIndex = 0;
+}
+
+/*
+ * Description :
+ * Complete a measurement the ICU interrupt can not complete alone, called by Ultrasonic_update
+ */
+static void Ultrasonic_sensorPoll(void){
+
+	/* Status register of the caller */
+	uint8 sreg = SREG;
+
+	uint32 now;
+
+	/* The last byte of a frame ends with the line high, no edge tells when it is complete */
+	cli();
+	if(g_uartBits != ULTRASONIC_UART_IDLE){
+		now = ICU_getTimestamp();
+		if((now - g_uartEdgeTime) > ((uint32)ULTRASONIC_UART_BYTE_BITS * ULTRASONIC_UART_BIT_TICKS)){
+
+			/* A line low for a whole byte is a framing error too */
+			if(GPIO_readPin(ICU_PORT_ID, ICU_PIN_ID) == LOGIC_HIGH){
+				Ultrasonic_uartShift(now, LOGIC_HIGH);
+				Ultrasonic_uartReceive(g_uartByte);
+			}
+			else{
+				g_uartIndex = 0;
+			}
+			g_uartBits = ULTRASONIC_UART_IDLE;
+		}
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Convert a reading of the sensor type (pulse width or mm) into the echo time of the HC-SR04
+ */
+static uint16 Ultrasonic_toEchoTime(uint16 reading){
+
+	/* No object or out of the range of the conversion: longer than any echo */
+	if((reading == 0) || (reading > ULTRASONIC_UART_MAX_MM)){
+		return 0xFFFF;
+	}
+
+	return (uint16)(((uint32)reading * ULTRASONIC_UART_ECHO_SCALE) >> ULTRASONIC_CALIBRATION_SHIFT);
+}
+
+/*
+ * Description :
+ * Add the bits at the given line level from the last edge to the given time stamp
+ * to the byte being received
+ */
+static void Ultrasonic_uartShift(uint32 timestamp, uint8 level){
+
+	/* Subtractions instead of a division, a byte has ten bits at most */
+	uint32 interval = timestamp - g_uartEdgeTime;
+
+	while((interval > (ULTRASONIC_UART_BIT_TICKS / 2)) && (g_uartBits < ULTRASONIC_UART_BYTE_BITS)){
+
+		/* Bit 0 is the start bit, 1 to 8 the data bits (least significant first), 9 the stop bit */
+		if((g_uartBits >= 1) && (g_uartBits <= 8)){
+			g_uartByte = (g_uartByte >> 1) | ((level == LOGIC_HIGH) ? 0x80 : 0);
+		}
+		g_uartBits++;
+		interval -= ULTRASONIC_UART_BIT_TICKS;
+	}
+}
+
+/*
+ * Description :
+ * Add a received byte to the frame and publish the sample when the frame is complete
+ */
+static void Ultrasonic_uartReceive(uint8 data){
+
+	/* Wait for the header before the rest of a frame */
+	if((g_uartIndex == 0) && (data != ULTRASONIC_UART_HEADER)){
+		return;
+	}
+	if(g_uartIndex == 0){
+		g_uartFrameStart = g_uartByteStart;
+	}
+
+	g_uartFrame[g_uartIndex++] = data;
+	if(g_uartIndex < ULTRASONIC_UART_FRAME_SIZE){
+		return;
+	}
+	g_uartIndex = 0;
+
+	/* A frame with a wrong sum is dropped, the measurement times out */
+	if((uint8)(g_uartFrame[0] + g_uartFrame[1] + g_uartFrame[2]) == g_uartFrame[3]){
+		Ultrasonic_addSample(Ultrasonic_toEchoTime(((uint16)g_uartFrame[1] << 8) | g_uartFrame[2]), g_uartFrameStart);
+	}
+}
+
+#else
+
+/*
+ * Description :
+ * Configure the ICU for the output of the sensor type
+ */
+static void Ultrasonic_sensorInit(void){
+
+	/* Configure ICU settings */
+	Icu_ConfigType config = {RISING_EDGE,F_CPU_8,ICU_NOISE_CANCELER_ON,ULTRASONIC_MIN_PULSE_WIDTH};
+
+	/* Initiate ICU */
+	ICU_init(&config);
 }
 
 /*
  * Description :
  * 1. This is the call back function called by the ICU driver
  * 2. This is used to calculate the high time (pulse time) generated by the ultrasonic sensor
+ *    or to receive the frame of the UART type, and to publish the sample when it is complete
  */
 static void Ultrasonic_edgeProcessing(void){
 
-	/* Increment edge counter */
-	g_edgeCount++;
+	/* Get the Timer1 value at this edge */
+	uint16 capture = ICU_getInputCaptureValue();
+
+	/*
+	 * Decide the edge from the actual echo pin level instead of counting edges,
+	 * so a lost or rejected edge can not shift the measurement out of phase
+	 */
+	if(GPIO_readPin(ICU_PORT_ID, ICU_PIN_ID) == LOGIC_HIGH){
 
-	if(g_edgeCount == 1){
+		/* The pin stayed low longer than a glitch, the last echo pulse is complete */
+		if(g_echoState == ULTRASONIC_ECHO_ENDED){
+			Ultrasonic_echoEnd();
+		}
 
-		/* Clear TIMER1 counter to count only the high time*/
-		ICU_clearTimerValue();
+		/* Start of the echo pulse (restart the measurement if a pulse was already started) */
+		g_echoStart = capture;
+		g_echoState = ULTRASONIC_ECHO_HIGH;
 
 		/* Change the edge to falling from rising */
 		ICU_setEdgeDetectionType(FALLING_EDGE);
 	}
-	else if(g_edgeCount == 2){
+	else{
+
+		if(g_echoState == ULTRASONIC_ECHO_HIGH){
+
+			/*
+			 * End of the echo pulse unless a rising edge comes back within the minimum pulse
+			 * width (a dropout inside the echo): held until the next rising edge or the poll
+			 */
+			g_echoEnd = capture;
+			g_echoEndTime = ICU_getInputCaptureTimestamp();
+			g_echoState = ULTRASONIC_ECHO_ENDED;
+		}
 
 		/* Return it to rising edge again */
 		ICU_setEdgeDetectionType(RISING_EDGE);
 	}
-	else if(g_edgeCount == 3){
+}
 
-		/* Get period time value from TIMER1 counter */
-		g_timePeriod = ICU_getInputCaptureValue();
+/*
+ * Description :
+ * Call back of the ICU driver for a rejected edge: undo the edge before it
+ */
+static void Ultrasonic_glitchProcessing(void){
 
-		/* Return it to falling edge again */
-		ICU_setEdgeDetectionType(FALLING_EDGE);
+	if(g_echoState == ULTRASONIC_ECHO_ENDED){
+
+		/* A dropout inside the echo, it goes on from the same start */
+		g_echoState = ULTRASONIC_ECHO_HIGH;
 	}
-	else if(g_edgeCount == 4){
+	else if(g_echoState == ULTRASONIC_ECHO_HIGH){
 
-		/* Get high time plus period value from TIMER1 counter */
-		g_timePeriodPlusHigh = ICU_getInputCaptureValue();
+		/* A spike while the pin is low, no echo started */
+		g_echoState = ULTRASONIC_ECHO_LOW;
+	}
+}
 
-		/* Return it to rising edge again */
-		ICU_setEdgeDetectionType(RISING_EDGE);
+/*
+ * Description :
+ * Complete a measurement the ICU interrupt can not complete alone, called by Ultrasonic_update
+ */
+static void Ultrasonic_sensorPoll(void){
+
+	/* Status register of the caller */
+	uint8 sreg = SREG;
+
+	/* The pin stayed low the minimum pulse width after the falling edge: no glitch, publish */
+	cli();
+	if((g_echoState == ULTRASONIC_ECHO_ENDED) && (ICU_isCapturePending() == FALSE)
+			&& ((ICU_getTimestamp() - g_echoEndTime) >= ULTRASONIC_MIN_PULSE_WIDTH)){
+		Ultrasonic_echoEnd();
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Publish the echo pulse that ended with the falling edge held in the ENDED state
+ */
+static void Ultrasonic_echoEnd(void){
+
+	/* Timer1 runs freely so the difference handles the overflow */
+	Ultrasonic_addSample(Ultrasonic_toEchoTime(g_echoEnd - g_echoStart), g_echoEndTime);
+	g_echoState = ULTRASONIC_ECHO_LOW;
+}
+
+/*
+ * Description :
+ * Convert a reading of the sensor type (pulse width or mm) into the echo time of the HC-SR04
+ */
+static uint16 Ultrasonic_toEchoTime(uint16 reading){
+
+#if(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_PWM)
+
+	/* Longer than any echo already, the product would not fit in 32 bits */
+	if(reading > ULTRASONIC_NO_ECHO_WIDTH){
+		return reading;
+	}
+
+	return (uint16)(((uint32)reading * ULTRASONIC_PWM_ECHO_SCALE) >> ULTRASONIC_CALIBRATION_SHIFT);
+
+#else
+
+	/* The echo pulse is the echo time */
+	return reading;
+
+#endif
+}
+
+#endif
+
+/*
+ * Description :
+ * Use the given calibration of the conversion from the next result on, return FALSE
+ * and keep the current one if the gain is out of ULTRASONIC_MIN_GAIN..ULTRASONIC_MAX_GAIN
+ */
+boolean Ultrasonic_setCalibration(const Ultrasonic_CalibrationType * calibration_ptr){
+	/* ULTRASONIC_MAX_GAIN is the largest uint16 */
+	if(calibration_ptr->gain < ULTRASONIC_MIN_GAIN){
+		return FALSE;
+	}
+
+	/* Only the main loop converts, no ISR reads it */
+	g_calibration = *calibration_ptr;
+	Ultrasonic_updateMultiplier();
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Copy the calibration of the conversion in use
+ */
+void Ultrasonic_getCalibration(Ultrasonic_CalibrationType * calibration_ptr){
+	*calibration_ptr = g_calibration;
+}
+
+/*
+ * Description :
+ * Use the given speed multiplier (cm per ICU tick for the speed of sound of the air now,
+ * ULTRASONIC_CALIBRATION_SHIFT fraction bits) from the next result on, return FALSE and
+ * keep the current one if it is out of ULTRASONIC_MIN_MULTIPLIER..ULTRASONIC_MAX_MULTIPLIER
+ */
+boolean Ultrasonic_setSpeedMultiplier(uint16 multiplier){
+	if((multiplier < ULTRASONIC_MIN_MULTIPLIER) || (multiplier > ULTRASONIC_MAX_MULTIPLIER)){
+		return FALSE;
+	}
+
+	g_speedMultiplier = multiplier;
+	Ultrasonic_updateMultiplier();
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the speed multiplier in use (ULTRASONIC_DEFAULT_MULTIPLIER until one is set)
+ */
+uint16 Ultrasonic_getSpeedMultiplier(void){
+	return g_speedMultiplier;
+}
+
+/*
+ * Description :
+ * Compute the multiplier of the conversion from the speed multiplier and the gain
+ */
+static void Ultrasonic_updateMultiplier(void){
+	g_multiplier = (uint16)(((uint32)g_speedMultiplier * g_calibration.gain) >> ULTRASONIC_GAIN_SHIFT);
+}
+
+/*
+ * Description :
+ * Convert an echo time with fractionBits fraction bits into the distance in cm with
+ * the same fraction bits, rounded to the nearest (a multiplication and shifts, no division)
+ * with the calibration in use, fractionBits at most 4 so the product with an echo time
+ * fits in 32 bits
+ */
+uint16 Ultrasonic_convert(uint32 highTime, uint8 fractionBits){
+
+	/* The echo times are below ULTRASONIC_NO_ECHO_WIDTH, the product fits in 32 bits */
+	sint32 distance = (sint32)((highTime * g_multiplier) >> fractionBits) + g_calibration.offset;
+
+	/* Half of the last bit of the result: rounded to the nearest at every resolution and with any scale */
+	distance += (sint32)1 << (ULTRASONIC_CALIBRATION_SHIFT - fractionBits - 1);
+
+	/* A negative offset can take the shortest echoes below zero */
+	if(distance < 0){
+		return 0;
 	}
+
+	return (uint16)((uint32)distance >> (ULTRASONIC_CALIBRATION_SHIFT - fractionBits));
 }
@@ -18,6 +18,27 @@
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
+/*
+ * Sensor type, selected at build time (-DULTRASONIC_SENSOR_TYPE=1 for the PWM output, 2 for
+ * the UART output): the HC-SR04 echo pulse, the pulse width output of the MaxBotix type
+ * sensors (147 us per inch) or the serial frames of the waterproof modules (A02YYUW type).
+ * Every type is triggered on its trigger pin and answers on ICP1, its reading is turned into
+ * the echo time of the HC-SR04 so the samples, the conversion, the calibration and the speed
+ * of sound are the same for all of them.
+ */
+#define ULTRASONIC_SENSOR_HCSR04	0
+#define ULTRASONIC_SENSOR_PWM		1
+#define ULTRASONIC_SENSOR_UART		2
+
+#ifndef ULTRASONIC_SENSOR_TYPE
+#define ULTRASONIC_SENSOR_TYPE		ULTRASONIC_SENSOR_HCSR04
+#endif
+
+#if((ULTRASONIC_SENSOR_TYPE != ULTRASONIC_SENSOR_HCSR04) && (ULTRASONIC_SENSOR_TYPE != ULTRASONIC_SENSOR_PWM) && (ULTRASONIC_SENSOR_TYPE != ULTRASONIC_SENSOR_UART))
+
+#error "Ultrasonic sensor type is the HC-SR04, the PWM output or the UART output"
+
+#endif
 
 /* Speed of Sound */
 #define ULTRASONIC_SPEED_OF_SOUND	34000
@@ -34,9 +55,166 @@
  */
 #define ULTRASONIC_CALIBRATION_FACTOR ((uint8)((ULTRASONIC_SEC_TO_CLK * 2)/ULTRASONIC_SPEED_OF_SOUND))
 
-/* Trigger port pin */
+/* Fraction bits of the speed multiplier (cm per ICU tick) and of the calibration offset (cm) */
+#define ULTRASONIC_CALIBRATION_SHIFT	16
+
+/* Speed multiplier of the factory scale: 1/ULTRASONIC_CALIBRATION_FACTOR cm per ICU tick */
+#define ULTRASONIC_DEFAULT_MULTIPLIER	((uint16)(((1UL << ULTRASONIC_CALIBRATION_SHIFT) + ULTRASONIC_CALIBRATION_FACTOR / 2) / ULTRASONIC_CALIBRATION_FACTOR))
+
+/* Speed multipliers accepted by Ultrasonic_setSpeedMultiplier: half to twice the factory scale */
+#define ULTRASONIC_MIN_MULTIPLIER		(ULTRASONIC_DEFAULT_MULTIPLIER / 2)
+#define ULTRASONIC_MAX_MULTIPLIER		(ULTRASONIC_DEFAULT_MULTIPLIER * 2)
+
+/* Fraction bits of the calibration gain and the gains accepted by Ultrasonic_setCalibration:
+ * half to twice, the product of the multipliers with any echo time fits in 32 bits
+ */
+#define ULTRASONIC_GAIN_SHIFT			15
+#define ULTRASONIC_UNIT_GAIN			(1U << ULTRASONIC_GAIN_SHIFT)
+#define ULTRASONIC_MIN_GAIN				(ULTRASONIC_UNIT_GAIN / 2)
+#define ULTRASONIC_MAX_GAIN				(ULTRASONIC_UNIT_GAIN * 2 - 1)
+
+/* Echo pulses/gaps narrower than this (in ICU ticks = micro seconds) are glitches,
+ * the shortest valid echo (2 cm) is about 116 micro seconds and a serial bit 104
+ */
+#define ULTRASONIC_MIN_PULSE_WIDTH	50
+
+/* The sensor ends the echo pulse after about 38 ms when no object is found,
+ * echo times longer than this (in ICU ticks) are reported as no echo
+ */
+#define ULTRASONIC_NO_ECHO_WIDTH	36000
+
+/* Longest wait (in ICU ticks) from the trigger pulse to the end of the echo pulse */
+#define ULTRASONIC_TIMEOUT_TICKS	60000
+
+#if(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_PWM)
+
+/* Shortest time (in ICU ticks) from a trigger pulse to the next one (the 49 ms reading cycle) */
+#define ULTRASONIC_PING_SPACING_TICKS	50000
+
+/* The sensor ranges while RX is high for at least 20 micro seconds */
+#define ULTRASONIC_TRIGGER_PULSE_US	25
+
+/* Scale of the pulse width output and the echo time of one pulse width tick
+ * (ULTRASONIC_CALIBRATION_SHIFT fraction bits), the HC-SR04 has 58 us of echo per cm
+ */
+#define ULTRASONIC_PWM_US_PER_INCH	147
+#define ULTRASONIC_PWM_ECHO_SCALE	((uint32)((((uint32)ULTRASONIC_CALIBRATION_FACTOR * 254UL << ULTRASONIC_CALIBRATION_SHIFT) + ULTRASONIC_PWM_US_PER_INCH * 50UL) / (ULTRASONIC_PWM_US_PER_INCH * 100UL)))
+
+#elif(ULTRASONIC_SENSOR_TYPE == ULTRASONIC_SENSOR_UART)
+
+/* Shortest time (in ICU ticks) from a trigger pulse to the next one, the frame of a ping
+ * must be out before the next ping
+ */
+#define ULTRASONIC_PING_SPACING_TICKS	60000
+
+/* The module (controlled output mode) ranges on a pulse on its RX pin */
+#define ULTRASONIC_TRIGGER_PULSE_US	10
+
+/*
+ * Frame of the module on its TX pin, received on ICP1 from the edge time stamps (the UART
+ * stays with the telemetry and the shell): 9600 baud 8N1, header, distance in mm (high
+ * byte first) and the low byte of the sum of the first three bytes. 0 mm means no object.
+ */
+#define ULTRASONIC_UART_BIT_TICKS	(ULTRASONIC_SEC_TO_CLK / 9600)
+#define ULTRASONIC_UART_BYTE_BITS	10
+#define ULTRASONIC_UART_HEADER		0xFF
+#define ULTRASONIC_UART_FRAME_SIZE	4
+
+/* Bit count of the receiver while the line is idle between bytes */
+#define ULTRASONIC_UART_IDLE		0xFF
+
+/* Echo time of one mm (ULTRASONIC_CALIBRATION_SHIFT fraction bits) and the longest distance
+ * converted, the HC-SR04 has 58 us of echo per cm
+ */
+#define ULTRASONIC_UART_ECHO_SCALE	((uint32)((((uint32)ULTRASONIC_CALIBRATION_FACTOR << ULTRASONIC_CALIBRATION_SHIFT) + 5) / 10))
+#define ULTRASONIC_UART_MAX_MM		7500
+
+#else
+
+/* Shortest time (in ICU ticks) from a trigger pulse to the next one, the echoes of a ping
+ * must die out before the next ping (measurement cycle of the sensor)
+ */
+#define ULTRASONIC_PING_SPACING_TICKS	60000
+
+/* Width of the trigger pulse in micro seconds (the sensor needs at least 10) */
+#define ULTRASONIC_TRIGGER_PULSE_US	10
+
+#endif
+
+/* Maximum pings of a burst (the median needs the valid distances of the burst) */
+#define ULTRASONIC_BURST_MAX_PINGS		15
+
+/* Fraction bits of the mean distance of a burst */
+#define ULTRASONIC_BURST_FRACTION_BITS	4
+
+/*
+ * Trigger port pin, set by the application build when PB5 is taken
+ * (-DULTRASONIC_TRIGGER_PIN_ID=PIN3_ID with the LCD on the SPI shift register)
+ */
+#ifndef ULTRASONIC_TRIGGER_PORT_ID
 #define ULTRASONIC_TRIGGER_PORT_ID	PORTB_ID
+#endif
+#ifndef ULTRASONIC_TRIGGER_PIN_ID
 #define ULTRASONIC_TRIGGER_PIN_ID	PIN5_ID
+#endif
+
+/*
+ * Sensors sharing the ICU: their echo outputs are ORed on ICP1 (diodes and a pull down,
+ * ANDed with a pull up for the idle high UART outputs) and only the sensor triggered last
+ * answers. Sensor 0 is triggered on the pin above, sensor 1 on PD7.
+ */
+#define ULTRASONIC_NUM_OF_SENSORS	2
+#define ULTRASONIC_TRIGGER2_PORT_ID	PORTD_ID
+#define ULTRASONIC_TRIGGER2_PIN_ID	PIN7_ID
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* enum for the result of a measurement */
+typedef enum{
+	ULTRASONIC_STATUS_OK, ULTRASONIC_STATUS_NO_ECHO, ULTRASONIC_STATUS_TIMEOUT
+}Ultrasonic_StatusType;
+
+/* Structure that holds the last echo measurement */
+typedef struct{
+	uint32 timestamp;				/* ICU time stamp at the end of the echo pulse (frame start for UART) */
+	uint16 highTime;				/* Echo pulse high time in ICU ticks (equivalent echo time for PWM, UART) */
+	uint8 count;					/* Number of completed measurements (wraps around) */
+	Ultrasonic_StatusType status;	/* ULTRASONIC_STATUS_OK or ULTRASONIC_STATUS_NO_ECHO */
+	uint8 sensor;					/* Sensor triggered for this echo */
+}Ultrasonic_SampleType;
+
+/* Structure that holds the result of the last Ultrasonic_readDistance call */
+typedef struct{
+	uint32 timestamp;				/* ICU time stamp at the end of the echo pulse (or of the timeout) */
+	uint16 distance;				/* Distance in cm (the last valid one if the status is not OK) */
+	uint16 latency;					/* Trigger pulse to result in ICU ticks */
+	Ultrasonic_StatusType status;
+	uint8 sensor;					/* Sensor triggered for this result */
+}Ultrasonic_ResultType;
+
+/* Structure that holds the aggregate of a burst of measurements (distances in cm) */
+typedef struct{
+	uint32 duration;				/* First trigger pulse to the last result in ICU ticks */
+	uint16 median;
+	uint16 mean;					/* With ULTRASONIC_BURST_FRACTION_BITS fraction bits */
+	uint16 min;
+	uint16 max;
+	uint16 spread;					/* max - min */
+	uint8 validCount;				/* Measurements with the OK status, the aggregate is over them */
+	uint8 pings;
+}Ultrasonic_BurstType;
+
+/*
+ * Structure that holds the calibration of the conversion of the echo time into the distance:
+ * multiplier = (speed multiplier * gain) >> ULTRASONIC_GAIN_SHIFT, computed when one changes
+ * distance = (highTime * multiplier + offset + 1/2) >> ULTRASONIC_CALIBRATION_SHIFT
+ */
+typedef struct{
+	uint16 gain;					/* ULTRASONIC_GAIN_SHIFT fraction bits */
+	sint32 offset;					/* cm (ULTRASONIC_CALIBRATION_SHIFT fraction bits), the intercept */
+}Ultrasonic_CalibrationType;
 
 /*******************************************************************************
  *                              Functions Prototypes                           *
@@ -48,6 +226,7 @@
  * 1. Initialize the ICU driver
  * 2. Setup the ICU call back function
  * 3. Setup the direction for the trigger pin as output pin through the GPIO driver
+ * 4. Create the timer that ends the trigger pulse
  */
 void Ultrasonic_init(void);
 
@@ -55,7 +234,103 @@ void Ultrasonic_init(void);
  * Description :
  * 1. Send the trigger pulse by using Ultrasonic_Trigger function
  * 2. Start the measurements by the ICU from this moment
+ * 3. Wait for the echo at most ULTRASONIC_TIMEOUT_TICKS, on timeout or no echo
+ *    the last valid distance is returned and the status tells why
  */
 uint16 Ultrasonic_readDistance(void);
 
+/*
+ * Description :
+ * Measure pings times (1 to ULTRASONIC_BURST_MAX_PINGS) back to back, every trigger pulse
+ * ULTRASONIC_PING_SPACING_TICKS after the previous one, and aggregate the valid distances
+ * while they come (the mean is computed on the echo times, not on the rounded distances).
+ * Return FALSE if no measurement was valid, the aggregate is zero then.
+ */
+boolean Ultrasonic_readBurst(uint8 pings, Ultrasonic_BurstType * burst_ptr);
+
+/*
+ * Description :
+ * Trigger the given sensor (0 to ULTRASONIC_NUM_OF_SENSORS - 1) from the next trigger pulse on,
+ * return FALSE and keep the current one if it does not exist
+ */
+boolean Ultrasonic_selectSensor(uint8 sensor_id);
+
+/*
+ * Description :
+ * Send the trigger pulse and return at once, Ultrasonic_update gives the result
+ * when the echo is complete or after ULTRASONIC_TIMEOUT_TICKS
+ */
+void Ultrasonic_startMeasurement(void);
+
+/*
+ * Description :
+ * Send the trigger pulse when the ICU time stamp reaches the given one (from the Timer1
+ * compare interrupt) and return at once, Ultrasonic_update gives the result like after
+ * Ultrasonic_startMeasurement
+ */
+void Ultrasonic_startMeasurementAt(uint32 timestamp);
+
+/*
+ * Description :
+ * Convert the last echo measurement into the result if the ICU interrupt completed
+ * a new one since the previous call, return TRUE in this case (does not block).
+ * Also return TRUE with the timeout status when the echo of the last trigger is late.
+ */
+boolean Ultrasonic_update(void);
+
+/*
+ * Description :
+ * Return the status of the last Ultrasonic_readDistance call
+ */
+Ultrasonic_StatusType Ultrasonic_getStatus(void);
+
+/*
+ * Description :
+ * Copy the result of the last Ultrasonic_readDistance call
+ */
+void Ultrasonic_getResult(Ultrasonic_ResultType * result_ptr);
+
+/*
+ * Description :
+ * Copy the last echo measurement, the copy is consistent even if
+ * the ICU interrupt completes a new measurement in the middle of it
+ */
+void Ultrasonic_getSample(Ultrasonic_SampleType * sample_ptr);
+
+/*
+ * Description :
+ * Use the given calibration of the conversion from the next result on, return FALSE
+ * and keep the current one if the gain is out of ULTRASONIC_MIN_GAIN..ULTRASONIC_MAX_GAIN
+ */
+boolean Ultrasonic_setCalibration(const Ultrasonic_CalibrationType * calibration_ptr);
+
+/*
+ * Description :
+ * Copy the calibration of the conversion in use
+ */
+void Ultrasonic_getCalibration(Ultrasonic_CalibrationType * calibration_ptr);
+
+/*
+ * Description :
+ * Use the given speed multiplier (cm per ICU tick for the speed of sound of the air now,
+ * ULTRASONIC_CALIBRATION_SHIFT fraction bits) from the next result on, return FALSE and
+ * keep the current one if it is out of ULTRASONIC_MIN_MULTIPLIER..ULTRASONIC_MAX_MULTIPLIER
+ */
+boolean Ultrasonic_setSpeedMultiplier(uint16 multiplier);
+
+/*
+ * Description :
+ * Return the speed multiplier in use (ULTRASONIC_DEFAULT_MULTIPLIER until one is set)
+ */
+uint16 Ultrasonic_getSpeedMultiplier(void);
+
+/*
+ * Description :
+ * Convert an echo time with fractionBits fraction bits into the distance in cm with
+ * the same fraction bits, rounded to the nearest (a multiplication and shifts, no division)
+ * with the calibration in use, fractionBits at most 4 so the product with an echo time
+ * fits in 32 bits
+ */
+uint16 Ultrasonic_convert(uint32 highTime, uint8 fractionBits);
+
 #endif /* ULTRASONIC_H_ */
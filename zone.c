@@ -0,0 +1,138 @@
+ /******************************************************************************
+ *
+ * Module: ZONE
+ *
+ * File Name: zone.c
+ *
+ * Description: Source file for the distance zones with hysteresis and debounce
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#include "zone.h"
+#include "gpio.h"
+
+/*******************************************************************************
+ *                      Private Global Variable                                *
+ *******************************************************************************/
+
+/* Zones configurations */
+static Zone_ConfigType g_zones[ZONE_MAX_ZONES];
+static uint8 g_zonesCount = 0;
+
+/* Bit i set while the object is inside the zone i */
+static uint8 g_activeZones = 0;
+
+/* Consecutive results that disagree with the state of every zone */
+static uint8 g_pendingCount[ZONE_MAX_ZONES];
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Remove all the zones
+ */
+void Zone_init(void){
+	g_zonesCount = 0;
+	g_activeZones = 0;
+}
+
+/*
+ * Description :
+ * Add a zone (outside at first, its output pin is set as output low),
+ * return its id or ZONE_INVALID_ID if the table is full
+ */
+uint8 Zone_add(const Zone_ConfigType * config_ptr){
+	uint8 zone_id;
+
+	if(g_zonesCount >= ZONE_MAX_ZONES){
+		return ZONE_INVALID_ID;
+	}
+
+	zone_id = g_zonesCount++;
+	g_zones[zone_id] = *config_ptr;
+	g_pendingCount[zone_id] = 0;
+
+	if(config_ptr->outputPort != ZONE_NO_OUTPUT){
+		GPIO_writePin(config_ptr->outputPort, config_ptr->outputPin, LOGIC_LOW);
+		GPIO_setupPinDirection(config_ptr->outputPort, config_ptr->outputPin, PIN_OUTPUT);
+	}
+
+	return zone_id;
+}
+
+/*
+ * Description :
+ * Feed a measurement result: count the results that disagree with the state of every
+ * zone and switch the state, the output and call the call back only on a transition.
+ * Timeouts (no answer of the sensor) are ignored.
+ */
+void Zone_update(const Ultrasonic_ResultType * result_ptr){
+	const Zone_ConfigType * zone_ptr;
+	uint8 zone_id;
+	uint8 mask;
+	boolean inside;
+	boolean measured;
+
+	if(result_ptr->status == ULTRASONIC_STATUS_TIMEOUT){
+		return;
+	}
+
+	for(zone_id = 0; zone_id < g_zonesCount; zone_id++){
+		zone_ptr = &g_zones[zone_id];
+		mask = (uint8)(1 << zone_id);
+		inside = (g_activeZones & mask) ? TRUE : FALSE;
+
+		/* State given by this result alone, the hysteresis widens the zone while inside */
+		if(result_ptr->status == ULTRASONIC_STATUS_NO_ECHO){
+			measured = FALSE;
+		}
+		else if(inside){
+			measured = ((result_ptr->distance + zone_ptr->hysteresis >= zone_ptr->lower) &&
+					(result_ptr->distance < zone_ptr->upper + zone_ptr->hysteresis)) ? TRUE : FALSE;
+		}
+		else{
+			measured = ((result_ptr->distance >= zone_ptr->lower) &&
+					(result_ptr->distance < zone_ptr->upper)) ? TRUE : FALSE;
+		}
+
+		if(measured == inside){
+			g_pendingCount[zone_id] = 0;
+			continue;
+		}
+
+		if(++g_pendingCount[zone_id] < zone_ptr->debounce){
+			continue;
+		}
+
+		/* Transition */
+		g_pendingCount[zone_id] = 0;
+		g_activeZones ^= mask;
+
+		if(zone_ptr->outputPort != ZONE_NO_OUTPUT){
+			GPIO_writePin(zone_ptr->outputPort, zone_ptr->outputPin, measured ? LOGIC_HIGH : LOGIC_LOW);
+		}
+		if(zone_ptr->callBack != NULL_PTR){
+			(*zone_ptr->callBack)(zone_id, measured);
+		}
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE if the object is inside the zone
+ */
+boolean Zone_isInside(uint8 zone_id){
+	return (g_activeZones & (uint8)(1 << zone_id)) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * Return the zones the object is inside, bit i for the zone i
+ */
+uint8 Zone_getActiveZones(void){
+	return g_activeZones;
+}
@@ -0,0 +1,88 @@
+ /******************************************************************************
+ *
+ * Module: ZONE
+ *
+ * File Name: zone.h
+ *
+ * Description: Header file for the distance zones with hysteresis and debounce
+ *
+ * Author: Mohamed Khaled
+ *
+ *******************************************************************************/
+
+#ifndef ZONE_H_
+#define ZONE_H_
+
+#include "std_types.h"
+#include "ultrasonic.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Maximum number of zones (one bit each in Zone_getActiveZones) */
+#define ZONE_MAX_ZONES			8
+
+/* Returned by Zone_add when the zone table is full */
+#define ZONE_INVALID_ID			0xFF
+
+/* Output port of a zone that only raises its call back */
+#define ZONE_NO_OUTPUT			0xFF
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/*
+ * Structure that contain members to set the configurations of a zone, the zone is
+ * entered when lower <= distance < upper and left when the distance is out of
+ * [lower - hysteresis, upper + hysteresis), a no echo result is out of every zone
+ */
+typedef struct{
+	uint16 lower;								/* cm */
+	uint16 upper;								/* cm */
+	uint16 hysteresis;							/* cm */
+	uint8 debounce;								/* Consecutive results needed for a transition, 0 or 1 = none */
+	uint8 outputPort;							/* Port driven while inside or ZONE_NO_OUTPUT */
+	uint8 outputPin;
+	void(*callBack)(uint8 zone_id, boolean inside);	/* Called on the transitions or NULL_PTR */
+}Zone_ConfigType;
+
+/*******************************************************************************
+ *                              Functions Prototypes                           *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Remove all the zones
+ */
+void Zone_init(void);
+
+/*
+ * Description :
+ * Add a zone (outside at first, its output pin is set as output low),
+ * return its id or ZONE_INVALID_ID if the table is full
+ */
+uint8 Zone_add(const Zone_ConfigType * config_ptr);
+
+/*
+ * Description :
+ * Feed a measurement result: count the results that disagree with the state of every
+ * zone and switch the state, the output and call the call back only on a transition.
+ * Timeouts (no answer of the sensor) are ignored.
+ */
+void Zone_update(const Ultrasonic_ResultType * result_ptr);
+
+/*
+ * Description :
+ * Return TRUE if the object is inside the zone
+ */
+boolean Zone_isInside(uint8 zone_id);
+
+/*
+ * Description :
+ * Return the zones the object is inside, bit i for the zone i
+ */
+uint8 Zone_getActiveZones(void);
+
+#endif /* ZONE_H_ */